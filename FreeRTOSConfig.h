@@ -63,6 +63,7 @@
 #define configUSE_NEWLIB_REENTRANT              0
 #define configENABLE_BACKWARD_COMPATIBILITY     0
 #define configNUM_THREAD_LOCAL_STORAGE_POINTERS 5
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES   3   // [1] = I2C bus completions, [2] = DMA I2C completions
 
 /* System */
 #define configSTACK_DEPTH_TYPE                  uint32_t
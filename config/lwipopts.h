@@ -41,6 +41,11 @@
 #define DNS_TABLE_SIZE                 4
 #define DNS_MAX_NAME_LENGTH            256
 
+/* ===== SNTP (src/wall_clock.c) ===== */
+#include "wall_clock.h"
+#define SNTP_SERVER_DNS                1
+#define SNTP_SET_SYSTEM_TIME(sec)      wall_clock_set_unix((uint32_t)(sec))
+
 /* ===== UDP / TCP ===== */
 #define LWIP_UDP                       1
 #define LWIP_TCP                       1
@@ -81,6 +81,11 @@
 #define MBEDTLS_SSL_CLI_C
 #define MBEDTLS_SSL_PROTO_TLS1_2
 #define MBEDTLS_SSL_SERVER_NAME_INDICATION
+/* Abbreviated handshakes on reconnect (session IDs work without this) */
+#define MBEDTLS_SSL_SESSION_TICKETS
+/* DTLS 1.2 for the CoAP uplink (coap_udp.c); the handshake timer is our own */
+#define MBEDTLS_SSL_PROTO_DTLS
+#define MBEDTLS_SSL_DTLS_ANTI_REPLAY
 
 /* Key exchanges we actually want */
 #define MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED
@@ -27,12 +27,20 @@
 # THE SOFTWARE.
 ******************************************************************************/
 #include "DEV_Config.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 /**
  * delay x ms
 **/
 void DEV_Delay_ms(UDOUBLE xms)
 {
-    sleep_ms(xms);
+    // Under the scheduler, sleep instead of spinning. The extra tick makes it
+    // an "at least xms" delay, since the first tick may be partly elapsed.
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+        vTaskDelay(pdMS_TO_TICKS(xms) + 1);
+    else
+        sleep_ms(xms);
 }
 
 void DEV_Delay_us(UDOUBLE xus)
@@ -41,28 +49,289 @@ void DEV_Delay_us(UDOUBLE xus)
 }
 /**
  * I2C
+ *
+ * Transfers are driven by DMA: the TX channel feeds IC_DATA_CMD with 16-bit
+ * command words (data byte, or a read command, plus RESTART/STOP flags),
+ * the RX channel drains received bytes. Command words are generated into
+ * two small staging halves; the TX DMA IRQ starts the next half and refills
+ * the one just sent, so an 8 KB OLED frame needs no 16 KB command buffer.
+ * If the refill is late the TX FIFO runs dry and the master simply holds
+ * SCL low until more commands arrive.
+ *
+ * Completion is the STOP_DET (or TX_ABRT) interrupt. Those interrupts are
+ * only unmasked while an async transfer is running, so the SDK's polling
+ * i2c_*_blocking() calls, still used before the scheduler starts, keep
+ * seeing the raw status bits.
 **/
+typedef struct {
+    int tx_dma;
+    int rx_dma;
+    dma_channel_config tx_cfg;
+    dma_channel_config rx_cfg;
+    uint16_t stage[2][DEV_I2C_DMA_CHUNK];
+    uint32_t stage_len[2];
+    uint32_t cur;
+
+    const uint8_t *wbuf;
+    uint32_t wlen;
+    uint32_t rlen;
+    uint32_t total;  // command words in the transfer
+    uint32_t next;   // next command word to generate
+
+    TaskHandle_t waiter;
+    volatile bool busy;
+    volatile int result;
+    uint32_t t_start;
+    DEV_I2C_Stats stats;
+} DEV_I2C_Async;
+
+static DEV_I2C_Async i2c_async[2] = { { .tx_dma = -1, .rx_dma = -1 }, { .tx_dma = -1, .rx_dma = -1 } };
+
+static inline DEV_I2C_Async *i2c_async_of(i2c_inst_t *I2C_PORT)
+{
+    return &i2c_async[i2c_hw_index(I2C_PORT)];
+}
+
+static uint32_t i2c_fill_stage(DEV_I2C_Async *a, uint16_t *dst)
+{
+    uint32_t n = 0;
+    while (n < DEV_I2C_DMA_CHUNK && a->next < a->total) {
+        uint32_t i = a->next++;
+        uint16_t w = (i < a->wlen) ? a->wbuf[i] : I2C_IC_DATA_CMD_CMD_BITS;
+        if (i == a->wlen && a->wlen)
+            w |= I2C_IC_DATA_CMD_RESTART_BITS;
+        if (i == a->total - 1)
+            w |= I2C_IC_DATA_CMD_STOP_BITS;
+        dst[n++] = w;
+    }
+    return n;
+}
+
+/* IRQ context (or interrupts disabled). */
+static void i2c_async_finish(i2c_inst_t *I2C_PORT, DEV_I2C_Async *a, int result)
+{
+    a->busy = false; // before the aborts: stops the DMA IRQ from restarting TX
+    i2c_get_hw(I2C_PORT)->intr_mask = 0;
+    dma_channel_abort(a->tx_dma);
+    if (a->rlen)
+        dma_channel_abort(a->rx_dma);
+    a->result = result;
+    a->stats.bus_us += time_us_32() - a->t_start;
+    if (result >= 0) {
+        a->stats.transfers++;
+        a->stats.bytes += a->total;
+    }
+}
+
+static void i2c_async_irq(i2c_inst_t *I2C_PORT)
+{
+    uint32_t t0 = time_us_32();
+    DEV_I2C_Async *a = i2c_async_of(I2C_PORT);
+    i2c_hw_t *hw = i2c_get_hw(I2C_PORT);
+    uint32_t stat = hw->intr_stat;
+    BaseType_t woken = pdFALSE;
+
+    if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS) {
+        (void)hw->clr_tx_abrt;
+        if (a->busy) {
+            a->stats.aborts++;
+            i2c_async_finish(I2C_PORT, a, PICO_ERROR_GENERIC);
+            vTaskNotifyGiveIndexedFromISR(a->waiter, DEV_I2C_NOTIFY_INDEX, &woken);
+        }
+    }
+    if (stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS) {
+        (void)hw->clr_stop_det;
+        if (a->busy) {
+            // The last byte can still be in the RX FIFO for a few cycles
+            while (a->rlen && dma_channel_is_busy(a->rx_dma))
+                tight_loop_contents();
+            i2c_async_finish(I2C_PORT, a, (int)(a->rlen ? a->rlen : a->wlen));
+            vTaskNotifyGiveIndexedFromISR(a->waiter, DEV_I2C_NOTIFY_INDEX, &woken);
+        }
+    }
+    a->stats.cpu_us += time_us_32() - t0;
+    portYIELD_FROM_ISR(woken);
+}
+
+static void i2c0_async_irq(void) { i2c_async_irq(i2c0); }
+static void i2c1_async_irq(void) { i2c_async_irq(i2c1); }
+
+static void i2c_dma_irq(void)
+{
+    for (int p = 0; p < 2; p++) {
+        DEV_I2C_Async *a = &i2c_async[p];
+        if (a->tx_dma < 0 || !dma_channel_get_irq1_status(a->tx_dma))
+            continue;
+        uint32_t t0 = time_us_32();
+        dma_channel_acknowledge_irq1(a->tx_dma);
+        if (a->busy) {
+            uint32_t done = a->cur, nxt = done ^ 1;
+            a->stage_len[done] = 0;
+            if (a->stage_len[nxt]) {
+                dma_channel_transfer_from_buffer_now(a->tx_dma, a->stage[nxt], a->stage_len[nxt]);
+                a->cur = nxt;
+                a->stage_len[done] = i2c_fill_stage(a, a->stage[done]);
+            }
+        }
+        a->stats.cpu_us += time_us_32() - t0;
+    }
+}
+
+static void DEV_I2C_Async_Init(i2c_inst_t *I2C_PORT)
+{
+    DEV_I2C_Async *a = i2c_async_of(I2C_PORT);
+    i2c_hw_t *hw = i2c_get_hw(I2C_PORT);
+
+    a->tx_dma = dma_claim_unused_channel(true);
+    a->tx_cfg = dma_channel_get_default_config(a->tx_dma);
+    channel_config_set_transfer_data_size(&a->tx_cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&a->tx_cfg, true);
+    channel_config_set_write_increment(&a->tx_cfg, false);
+    channel_config_set_dreq(&a->tx_cfg, i2c_get_dreq(I2C_PORT, true));
+    dma_channel_configure(a->tx_dma, &a->tx_cfg, &hw->data_cmd, NULL, 0, false);
+    dma_channel_set_irq1_enabled(a->tx_dma, true);
+
+    a->rx_dma = dma_claim_unused_channel(true);
+    a->rx_cfg = dma_channel_get_default_config(a->rx_dma);
+    channel_config_set_transfer_data_size(&a->rx_cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&a->rx_cfg, false);
+    channel_config_set_write_increment(&a->rx_cfg, true);
+    channel_config_set_dreq(&a->rx_cfg, i2c_get_dreq(I2C_PORT, false));
+
+    hw->intr_mask = 0;
+    hw->dma_tdlr = 8;   // keep the TX FIFO at least half full
+    hw->dma_rdlr = 0;   // request as soon as one byte arrives
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+
+    uint irq = (I2C_PORT == i2c0) ? I2C0_IRQ : I2C1_IRQ;
+    irq_set_exclusive_handler(irq, (I2C_PORT == i2c0) ? i2c0_async_irq : i2c1_async_irq);
+    irq_set_enabled(irq, true);
+}
+
+int DEV_I2C_Xfer_Start(i2c_inst_t *I2C_PORT, uint8_t addr, const uint8_t *wbuf, uint32_t wlen, uint8_t *rbuf, uint32_t rlen)
+{
+    DEV_I2C_Async *a = i2c_async_of(I2C_PORT);
+    i2c_hw_t *hw = i2c_get_hw(I2C_PORT);
+    uint32_t t0 = time_us_32();
+
+    if (a->tx_dma < 0 || wlen + rlen == 0)
+        return PICO_ERROR_INVALID_ARG;
+    if (a->busy)
+        return PICO_ERROR_GENERIC;
+
+    a->wbuf = wbuf;
+    a->wlen = wlen;
+    a->rlen = rlen;
+    a->total = wlen + rlen;
+    a->next = 0;
+    a->waiter = xTaskGetCurrentTaskHandle();
+    a->result = 0;
+    ulTaskNotifyValueClearIndexed(NULL, DEV_I2C_NOTIFY_INDEX, ~0u); // drop a late completion from a timed-out transfer
+
+    hw->enable = 0;
+    hw->tar = addr;
+    hw->enable = 1;
+    (void)hw->clr_stop_det;
+    (void)hw->clr_tx_abrt;
+
+    if (rlen)
+        dma_channel_configure(a->rx_dma, &a->rx_cfg, rbuf, &hw->data_cmd, rlen, true);
+    a->stage_len[0] = i2c_fill_stage(a, a->stage[0]);
+    a->stage_len[1] = i2c_fill_stage(a, a->stage[1]);
+    a->cur = 0;
+
+    a->t_start = time_us_32();
+    a->busy = true;
+    hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+    dma_channel_transfer_from_buffer_now(a->tx_dma, a->stage[0], a->stage_len[0]);
+
+    uint32_t irq = save_and_disable_interrupts(); // the IRQs update the same counter
+    a->stats.cpu_us += time_us_32() - t0;
+    restore_interrupts(irq);
+    return 0;
+}
+
+int DEV_I2C_Xfer_Wait(i2c_inst_t *I2C_PORT, uint32_t timeout_ms)
+{
+    DEV_I2C_Async *a = i2c_async_of(I2C_PORT);
+
+    while (a->busy) {
+        if (ulTaskNotifyTakeIndexed(DEV_I2C_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(timeout_ms)) == 0) {
+            uint32_t irq = save_and_disable_interrupts();
+            if (a->busy) {
+                a->stats.timeouts++;
+                i2c_async_finish(I2C_PORT, a, PICO_ERROR_TIMEOUT);
+                i2c_get_hw(I2C_PORT)->enable = I2C_IC_ENABLE_ENABLE_BITS | I2C_IC_ENABLE_ABORT_BITS;
+            }
+            restore_interrupts(irq);
+        }
+    }
+    return a->result;
+}
+
+/* Generous bound: 10 ms plus ~0.125 ms per byte (one byte is ~0.09 ms at 100 kHz) */
+static inline uint32_t i2c_timeout_ms(uint32_t len)
+{
+    return 10 + len / 8;
+}
+
+int DEV_I2C_Xfer(i2c_inst_t *I2C_PORT, uint8_t addr, const uint8_t *wbuf, uint32_t wlen, uint8_t *rbuf, uint32_t rlen)
+{
+    int ret = DEV_I2C_Xfer_Start(I2C_PORT, addr, wbuf, wlen, rbuf, rlen);
+    if (ret < 0)
+        return ret;
+    return DEV_I2C_Xfer_Wait(I2C_PORT, i2c_timeout_ms(wlen + rlen));
+}
+
+void DEV_I2C_Get_Stats(i2c_inst_t *I2C_PORT, DEV_I2C_Stats *stats)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    *stats = i2c_async_of(I2C_PORT)->stats;
+    restore_interrupts(irq);
+}
+
+/* The classic API: DMA + sleep once the scheduler runs, polling before. */
+static inline bool i2c_use_async(void)
+{
+    return xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+}
 
 void DEV_I2C_Write_Byte(i2c_inst_t *I2C_PORT,uint8_t addr, uint8_t reg, uint8_t Value)
 {
     uint8_t data[2] = {reg, Value};
-    i2c_write_blocking(I2C_PORT, addr, data, 2, false);
+    if (i2c_use_async())
+        DEV_I2C_Xfer(I2C_PORT, addr, data, 2, NULL, 0);
+    else
+        i2c_write_blocking(I2C_PORT, addr, data, 2, false);
 }
 
 void DEV_I2C_Write_nByte(i2c_inst_t *I2C_PORT,uint8_t addr, uint8_t *pData, uint32_t Len)
 {
-    i2c_write_blocking(I2C_PORT, addr, pData, Len, false);
+    if (i2c_use_async())
+        DEV_I2C_Xfer(I2C_PORT, addr, pData, Len, NULL, 0);
+    else
+        i2c_write_blocking(I2C_PORT, addr, pData, Len, false);
 }
 
 uint8_t DEV_I2C_ReadByte(i2c_inst_t *I2C_PORT,uint8_t addr, uint8_t reg)
 {
-    uint8_t buf;
-    i2c_write_blocking(I2C_PORT,addr,&reg,1,true);
-    i2c_read_blocking(I2C_PORT,addr,&buf,1,false);
+    uint8_t buf = 0;
+    DEV_I2C_Read_nByte(I2C_PORT, addr, reg, &buf, 1);
     return buf;
 }
+void DEV_I2C_Read_nByte_Raw(i2c_inst_t *I2C_PORT,uint8_t addr, uint8_t *pData, uint32_t Len)
+{
+    if (i2c_use_async())
+        DEV_I2C_Xfer(I2C_PORT, addr, NULL, 0, pData, Len);
+    else
+        i2c_read_blocking(I2C_PORT, addr, pData, Len, false);
+}
 void DEV_I2C_Read_nByte(i2c_inst_t *I2C_PORT,uint8_t addr,uint8_t reg, uint8_t *pData, uint32_t Len)
 {
+    if (i2c_use_async()) {
+        DEV_I2C_Xfer(I2C_PORT, addr, &reg, 1, pData, Len);
+        return;
+    }
     i2c_write_blocking(I2C_PORT,addr,&reg,1,true);
     i2c_read_blocking(I2C_PORT,addr,pData,Len,false);
 }
@@ -82,11 +351,17 @@ UBYTE DEV_Module_Init(void)
     gpio_pull_up(OLED_SDA_PIN);
     gpio_pull_up(OLED_SCL_PIN);
 
-    i2c_init(SENSOR_I2C_PORT,100*1000);
+    i2c_init(SENSOR_I2C_PORT,400*1000); // fast mode: full-rate IMU FIFO drains need ~12 KB/s
     gpio_set_function(SENSOR_SDA_PIN,GPIO_FUNC_I2C);
     gpio_set_function(SENSOR_SCL_PIN,GPIO_FUNC_I2C);
     gpio_pull_up(SENSOR_SDA_PIN);
     gpio_pull_up(SENSOR_SCL_PIN);
+
+    // DMA I2C; TX refills share DMA_IRQ_1 (DMA_IRQ_0 belongs to the ADC engine)
+    irq_add_shared_handler(DMA_IRQ_1, i2c_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+    DEV_I2C_Async_Init(OLED_I2C_PORT);
+    DEV_I2C_Async_Init(SENSOR_I2C_PORT);
     
     printf("DEV_Module_Init OK \r\n");
     return 0;
@@ -35,6 +35,9 @@
 #include "hardware/i2c.h"
 #include "hardware/pwm.h"
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 /**
  * data
 **/
@@ -55,6 +58,32 @@
 #define SENSOR_SDA_PIN  (8)
 #define SENSOR_SCL_PIN  (9)
 
+#ifndef IMU_INT1_PIN
+#define IMU_INT1_PIN    (20)  // QMI8658 INT1 (wake-on-motion)
+#endif
+#ifndef IMU_INT2_PIN
+#define IMU_INT2_PIN    (21)  // QMI8658 INT2 (FIFO watermark / data ready)
+#endif
+
+/**
+ * DMA I2C
+**/
+#ifndef DEV_I2C_DMA_CHUNK
+#define DEV_I2C_DMA_CHUNK     (32)  // data_cmd words per staging half, refilled from the DMA IRQ
+#endif
+#ifndef DEV_I2C_NOTIFY_INDEX
+#define DEV_I2C_NOTIFY_INDEX  (2)   // task notification slot used for completions
+#endif
+
+typedef struct {
+    uint32_t transfers;
+    uint32_t bytes;
+    uint32_t aborts;    // NACK / arbitration lost
+    uint32_t timeouts;
+    uint64_t cpu_us;    // setup + IRQ time
+    uint64_t bus_us;    // start to completion
+} DEV_I2C_Stats;
+
 /*------------------------------------------------------------------------------------------------------*/
 
 void DEV_Delay_ms(UDOUBLE xms);
@@ -64,6 +93,20 @@ void DEV_I2C_Write_Byte(i2c_inst_t *I2C_PORT,uint8_t addr, uint8_t reg, uint8_t
 void DEV_I2C_Write_nByte(i2c_inst_t *I2C_PORT,uint8_t addr, uint8_t *pData, uint32_t Len);
 uint8_t DEV_I2C_ReadByte(i2c_inst_t *I2C_PORT,uint8_t addr, uint8_t reg);
 void DEV_I2C_Read_nByte(i2c_inst_t *I2C_PORT,uint8_t addr,uint8_t reg, uint8_t *pData, uint32_t Len);
+void DEV_I2C_Read_nByte_Raw(i2c_inst_t *I2C_PORT,uint8_t addr, uint8_t *pData, uint32_t Len); // no register byte
+
+/*
+ * Asynchronous transfers (scheduler must be running). A transfer is an
+ * optional write followed by an optional read (repeated start between them)
+ * and always ends with STOP. The caller sleeps until the STOP/abort IRQ
+ * notifies it on DEV_I2C_NOTIFY_INDEX. One transfer per port at a time: each
+ * port must have a single owning task.
+ * Results are bytes transferred (read length if any) or PICO_ERROR_*.
+ */
+int  DEV_I2C_Xfer_Start(i2c_inst_t *I2C_PORT, uint8_t addr, const uint8_t *wbuf, uint32_t wlen, uint8_t *rbuf, uint32_t rlen);
+int  DEV_I2C_Xfer_Wait(i2c_inst_t *I2C_PORT, uint32_t timeout_ms);
+int  DEV_I2C_Xfer(i2c_inst_t *I2C_PORT, uint8_t addr, const uint8_t *wbuf, uint32_t wlen, uint8_t *rbuf, uint32_t rlen);
+void DEV_I2C_Get_Stats(i2c_inst_t *I2C_PORT, DEV_I2C_Stats *stats);
 
 
 
@@ -29,6 +29,7 @@
 ******************************************************************************/
 #include "OLED_1in5.h"
 #include "stdio.h"
+#include <string.h>
 
 /*******************************************************************************
 function:
@@ -159,19 +160,38 @@ void OLED_1in5_Clear(uint8_t color)
 /********************************************************************************
 function:
             Update all memory to OLED
+            Returns 0, or the PICO_ERROR_* of the first failed row transfer
+            (the rest of the frame is not sent)
 ********************************************************************************/
-void OLED_1in5_Display(uint8_t *Image)
+int OLED_1in5_Display(uint8_t *Image)
 {
-    uint8_t image [(OLED_1in5_WIDTH/2)+1];
-    image[0]=0x40;
+    uint8_t image[2][(OLED_1in5_WIDTH/2)+1];
+    image[0][0]=0x40;
+    image[1][0]=0x40;
     OLED_1in5_SetWindows(0, 0, OLED_1in5_WIDTH - 1, OLED_1in5_HEIGHT - 1);
 
-    for (uint16_t i = 0; i < OLED_1in5_HEIGHT; i++)
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
     {
-        for(uint16_t j= 0;j<(OLED_1in5_WIDTH /2);j++)
+        for (uint16_t i = 0; i < OLED_1in5_HEIGHT; i++)
         {
-            image[1+j]=Image[j+i*(OLED_1in5_WIDTH/2)];
+            memcpy(&image[0][1], &Image[i*(OLED_1in5_WIDTH/2)], OLED_1in5_WIDTH/2);
+            DEV_I2C_Write_nByte(OLED_I2C_PORT,OLED_1in5_ADDR,image[0], (OLED_1in5_WIDTH / 2)+1);
         }
-            DEV_I2C_Write_nByte(OLED_I2C_PORT,OLED_1in5_ADDR,image, (OLED_1in5_WIDTH / 2)+1);
+        return 0;
+    }
+
+    // DMA sends one row while the next one is copied; the task sleeps in between.
+    // A failed wait has already aborted its transfer, so nothing is left in flight.
+    int ret;
+    for (uint16_t i = 0; i < OLED_1in5_HEIGHT; i++)
+    {
+        uint8_t *row = image[i & 1];
+        memcpy(&row[1], &Image[i*(OLED_1in5_WIDTH/2)], OLED_1in5_WIDTH/2);
+        if (i > 0 && (ret = DEV_I2C_Xfer_Wait(OLED_I2C_PORT, 10)) < 0)
+            return ret;
+        if ((ret = DEV_I2C_Xfer_Start(OLED_I2C_PORT, OLED_1in5_ADDR, row, (OLED_1in5_WIDTH / 2)+1, NULL, 0)) < 0)
+            return ret;
     }
+    ret = DEV_I2C_Xfer_Wait(OLED_I2C_PORT, 10);
+    return ret < 0 ? ret : 0;
 }
@@ -47,7 +47,7 @@ function:
 
 void OLED_1in5_Init(void);
 void OLED_1in5_Clear(uint8_t color);
-void OLED_1in5_Display(uint8_t *Image);
+int  OLED_1in5_Display(uint8_t *Image);
 
 #endif  
 	 
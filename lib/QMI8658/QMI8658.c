@@ -25,11 +25,13 @@ typedef struct
 
 static unsigned short acc_lsb_div = 0;
 static unsigned short gyro_lsb_div = 0;
+static struct QMI8658_Scale QMI8658_scale;
 static unsigned short ae_q_lsb_div = (1 << 14);
 static unsigned short ae_v_lsb_div = (1 << 10);
 static unsigned int imu_timestamp = 0;
 static struct QMI8658Config QMI8658_config;
 static unsigned char QMI8658_slave_addr = QMI8658_SLAVE_ADDR_L;
+static unsigned char QMI8658_fifo_ctrl = QMI8658_FifoMode_Bypass;
 
 unsigned char QMI8658_write_reg(unsigned char reg, unsigned char value)
 {
@@ -39,6 +41,7 @@ unsigned char QMI8658_write_reg(unsigned char reg, unsigned char value)
 	while ((!ret) && (retry++ < 5))
 	{
 		DEV_I2C_Write_Byte(SENSOR_I2C_PORT,QMI8658_slave_addr, reg, value);
+		ret = 1; // the transport reports no errors; one write is enough
 	}
 	return ret;
 }
@@ -55,6 +58,17 @@ unsigned char QMI8658_write_regs(unsigned char reg, unsigned char *value, unsign
 	return ret;
 }
 
+unsigned char QMI8658_get_slave_addr(void)
+{
+	return QMI8658_slave_addr;
+}
+
+void QMI8658_get_sensitivity(unsigned short *acc_lsb_per_g, unsigned short *gyro_lsb_per_dps)
+{
+	*acc_lsb_per_g = acc_lsb_div;
+	*gyro_lsb_per_dps = gyro_lsb_div;
+}
+
 unsigned char QMI8658_read_reg(unsigned char reg, unsigned char *buf, unsigned short len)
 {
 	unsigned char ret = 0;
@@ -153,6 +167,32 @@ void QMI8658_set_layout(short layout)
 }
 #endif
 
+// Reciprocals are taken here, once per range change, not per sample
+static void QMI8658_update_scale(void)
+{
+#if defined(QMI8658_UINT_MG_DPS)
+	const float acc_unit = 1000.0f, gyro_unit = 1.0f;
+#else
+	const float acc_unit = ONE_G, gyro_unit = 0.01745f;
+#endif
+
+	if (acc_lsb_div)
+	{
+		QMI8658_scale.accScale = acc_unit / acc_lsb_div;
+		QMI8658_scale_q(QMI8658_scale.accScale, &QMI8658_scale.accK, &QMI8658_scale.accShift);
+	}
+	if (gyro_lsb_div)
+	{
+		QMI8658_scale.gyrScale = gyro_unit / gyro_lsb_div;
+		QMI8658_scale_q(QMI8658_scale.gyrScale, &QMI8658_scale.gyrK, &QMI8658_scale.gyrShift);
+	}
+}
+
+void QMI8658_get_scale(struct QMI8658_Scale *scale)
+{
+	*scale = QMI8658_scale;
+}
+
 void QMI8658_config_acc(enum QMI8658_AccRange range, enum QMI8658_AccOdr odr, enum QMI8658_LpfConfig lpfEnable, enum QMI8658_StConfig stEnable)
 {
 	unsigned char ctl_dada;
@@ -175,6 +215,7 @@ void QMI8658_config_acc(enum QMI8658_AccRange range, enum QMI8658_AccOdr odr, en
 		range = QMI8658AccRange_8g;
 		acc_lsb_div = (1 << 12);
 	}
+	QMI8658_update_scale();
 	if (stEnable == QMI8658St_Enable)
 		ctl_dada = (unsigned char)range | (unsigned char)odr | 0x80;
 	else
@@ -235,6 +276,7 @@ void QMI8658_config_gyro(enum QMI8658_GyrRange range, enum QMI8658_GyrOdr odr, e
 		gyro_lsb_div = 64;
 		break;
 	}
+	QMI8658_update_scale();
 
 	if (stEnable == QMI8658St_Enable)
 		ctl_dada = (unsigned char)range | (unsigned char)odr | 0x80;
@@ -344,13 +386,15 @@ void QMI8658_read_gyro_xyz(float gyro_xyz[3])
 	// QMI8658_printf("fis210x gyro:	%f	%f	%f\n", gyro_xyz[0], gyro_xyz[1], gyro_xyz[2]);
 }
 
+void QMI8658_decode_xyz(const unsigned char buf_reg[12], float acc[3], float gyro[3])
+{
+	// m/s2 and rad/s (mg and dps with QMI8658_UINT_MG_DPS); scale precomputed per range
+	QMI8658_decode_scaled(&QMI8658_scale, buf_reg, acc, gyro);
+}
+
 void QMI8658_read_xyz(float acc[3], float gyro[3], unsigned int *tim_count)
 {
 	unsigned char buf_reg[12];
-	short raw_acc_xyz[3];
-	short raw_gyro_xyz[3];
-	//	float acc_t[3];
-	//	float gyro_t[3];
 
 	if (tim_count)
 	{
@@ -367,6 +411,11 @@ void QMI8658_read_xyz(float acc[3], float gyro[3], unsigned int *tim_count)
 	}
 
 	QMI8658_read_reg(QMI8658Register_Ax_L, buf_reg, 12); // 0x19, 25
+	QMI8658_decode_xyz(buf_reg, acc, gyro);
+}
+
+void QMI8658_decode_xyz_raw(const unsigned char buf_reg[12], short raw_acc_xyz[3], short raw_gyro_xyz[3])
+{
 	raw_acc_xyz[0] = (short)((unsigned short)(buf_reg[1] << 8) | (buf_reg[0]));
 	raw_acc_xyz[1] = (short)((unsigned short)(buf_reg[3] << 8) | (buf_reg[2]));
 	raw_acc_xyz[2] = (short)((unsigned short)(buf_reg[5] << 8) | (buf_reg[4]));
@@ -374,36 +423,6 @@ void QMI8658_read_xyz(float acc[3], float gyro[3], unsigned int *tim_count)
 	raw_gyro_xyz[0] = (short)((unsigned short)(buf_reg[7] << 8) | (buf_reg[6]));
 	raw_gyro_xyz[1] = (short)((unsigned short)(buf_reg[9] << 8) | (buf_reg[8]));
 	raw_gyro_xyz[2] = (short)((unsigned short)(buf_reg[11] << 8) | (buf_reg[10]));
-
-#if defined(QMI8658_UINT_MG_DPS)
-	// mg
-	acc[AXIS_X] = (float)(raw_acc_xyz[AXIS_X] * 1000.0f) / acc_lsb_div;
-	acc[AXIS_Y] = (float)(raw_acc_xyz[AXIS_Y] * 1000.0f) / acc_lsb_div;
-	acc[AXIS_Z] = (float)(raw_acc_xyz[AXIS_Z] * 1000.0f) / acc_lsb_div;
-#else
-	// m/s2
-	acc[AXIS_X] = (float)(raw_acc_xyz[AXIS_X] * ONE_G) / acc_lsb_div;
-	acc[AXIS_Y] = (float)(raw_acc_xyz[AXIS_Y] * ONE_G) / acc_lsb_div;
-	acc[AXIS_Z] = (float)(raw_acc_xyz[AXIS_Z] * ONE_G) / acc_lsb_div;
-#endif
-	//	acc[AXIS_X] = imu_map.sign[AXIS_X]*acc_t[imu_map.map[AXIS_X]];
-	//	acc[AXIS_Y] = imu_map.sign[AXIS_Y]*acc_t[imu_map.map[AXIS_Y]];
-	//	acc[AXIS_Z] = imu_map.sign[AXIS_Z]*acc_t[imu_map.map[AXIS_Z]];
-
-#if defined(QMI8658_UINT_MG_DPS)
-	// dps
-	gyro[0] = (float)(raw_gyro_xyz[0] * 1.0f) / gyro_lsb_div;
-	gyro[1] = (float)(raw_gyro_xyz[1] * 1.0f) / gyro_lsb_div;
-	gyro[2] = (float)(raw_gyro_xyz[2] * 1.0f) / gyro_lsb_div;
-#else
-	// rad/s
-	gyro[AXIS_X] = (float)(raw_gyro_xyz[AXIS_X] * 0.01745f) / gyro_lsb_div; // *pi/180
-	gyro[AXIS_Y] = (float)(raw_gyro_xyz[AXIS_Y] * 0.01745f) / gyro_lsb_div;
-	gyro[AXIS_Z] = (float)(raw_gyro_xyz[AXIS_Z] * 0.01745f) / gyro_lsb_div;
-#endif
-	//	gyro[AXIS_X] = imu_map.sign[AXIS_X]*gyro_t[imu_map.map[AXIS_X]];
-	//	gyro[AXIS_Y] = imu_map.sign[AXIS_Y]*gyro_t[imu_map.map[AXIS_Y]];
-	//	gyro[AXIS_Z] = imu_map.sign[AXIS_Z]*gyro_t[imu_map.map[AXIS_Z]];
 }
 
 void QMI8658_read_xyz_raw(short raw_acc_xyz[3], short raw_gyro_xyz[3], unsigned int *tim_count)
@@ -424,14 +443,113 @@ void QMI8658_read_xyz_raw(short raw_acc_xyz[3], short raw_gyro_xyz[3], unsigned
 		*tim_count = imu_timestamp;
 	}
 	QMI8658_read_reg(QMI8658Register_Ax_L, buf_reg, 12); // 0x19, 25
+	QMI8658_decode_xyz_raw(buf_reg, raw_acc_xyz, raw_gyro_xyz);
+}
 
-	raw_acc_xyz[0] = (short)((unsigned short)(buf_reg[1] << 8) | (buf_reg[0]));
-	raw_acc_xyz[1] = (short)((unsigned short)(buf_reg[3] << 8) | (buf_reg[2]));
-	raw_acc_xyz[2] = (short)((unsigned short)(buf_reg[5] << 8) | (buf_reg[4]));
+/*
+ * CTRL9 handshake: write the command, wait for STATUSINT.CmdDone, then
+ * acknowledge so the device clears the flag again. Returns 0 if either
+ * step timed out, i.e. the command may not have run.
+ */
+static unsigned char QMI8658_doCtrl9Command(enum QMI8658_Ctrl9Command cmd)
+{
+	unsigned char status = 0;
+	int retry = 0;
 
-	raw_gyro_xyz[0] = (short)((unsigned short)(buf_reg[7] << 8) | (buf_reg[6]));
-	raw_gyro_xyz[1] = (short)((unsigned short)(buf_reg[9] << 8) | (buf_reg[8]));
-	raw_gyro_xyz[2] = (short)((unsigned short)(buf_reg[11] << 8) | (buf_reg[10]));
+	QMI8658_write_reg(QMI8658Register_Ctrl9, cmd);
+	while (!(status & QMI8658_STATUSINT_CMD_DONE) && (retry++ < 100))
+	{
+		QMI8658_read_reg(QMI8658Register_StatusInt, &status, 1);
+	}
+	QMI8658_write_reg(QMI8658Register_Ctrl9, QMI8658_Ctrl9_Cmd_Ack);
+	if (!(status & QMI8658_STATUSINT_CMD_DONE))
+		return 0;
+	retry = 0;
+	while ((status & QMI8658_STATUSINT_CMD_DONE) && (retry++ < 100))
+	{
+		QMI8658_read_reg(QMI8658Register_StatusInt, &status, 1);
+	}
+	return retry < 100;
+}
+
+/*
+ * FIFO. With accelerometer and gyroscope enabled each ODR tick stores one
+ * QMI8658_FIFO_FRAME_BYTES frame in the same layout as Ax_L..Gz_H. The
+ * watermark is in ODR samples; Stream mode keeps the newest samples and
+ * flags QMI8658_FIFO_STATUS_OVFLOW when the host fell behind.
+ * Returns 0 if the FIFO reset command was not acknowledged.
+ */
+unsigned char QMI8658_config_fifo(unsigned char watermark, enum QMI8658_FifoSize size, enum QMI8658_FifoMode mode)
+{
+	unsigned char ctrl7 = 0;
+	unsigned char ok;
+
+	// The FIFO must be configured with the sensors disabled
+	QMI8658_read_reg(QMI8658Register_Ctrl7, &ctrl7, 1);
+	QMI8658_write_reg(QMI8658Register_Ctrl7, QMI8658_CTRL7_DISABLE_ALL);
+
+	QMI8658_fifo_ctrl = (unsigned char)(size | mode);
+	QMI8658_write_reg(QMI8658Register_FifoWtmTh, watermark);
+	QMI8658_write_reg(QMI8658Register_FifoCtrl, QMI8658_fifo_ctrl);
+	ok = QMI8658_doCtrl9Command(QMI8658_Ctrl9_Cmd_Rst_Fifo);
+
+	QMI8658_write_reg(QMI8658Register_Ctrl7, ctrl7);
+	return ok;
+}
+
+/*
+ * INT1/INT2 output enables. With the FIFO in Bypass, INT2 is data-ready;
+ * otherwise FIFO watermark/full go to INT2 (or INT1 with
+ * QMI8658_CTRL1_FIFO_INT1). Wake-on-motion picks its line itself.
+ */
+void QMI8658_config_interrupts(unsigned char int_flags)
+{
+	unsigned char ctrl1 = 0;
+
+	QMI8658_read_reg(QMI8658Register_Ctrl1, &ctrl1, 1);
+	ctrl1 = (unsigned char)((ctrl1 & ~QMI8658_CTRL1_INT_MASK) | (int_flags & QMI8658_CTRL1_INT_MASK));
+	QMI8658_write_reg(QMI8658Register_Ctrl1, ctrl1);
+}
+
+unsigned char QMI8658_reset_fifo(void)
+{
+	return QMI8658_doCtrl9Command(QMI8658_Ctrl9_Cmd_Rst_Fifo);
+}
+
+unsigned short QMI8658_read_fifo_status(unsigned char *fifo_status)
+{
+	unsigned char buf[2];
+
+	QMI8658_read_reg(QMI8658Register_FifoSmplCnt, buf, 2); // SMPL_CNT, FIFO_STATUS
+	if (fifo_status)
+		*fifo_status = buf[1];
+	return (unsigned short)((((unsigned short)(buf[1] & 0x03) << 8) | buf[0]) * 2);
+}
+
+/*
+ * Drain up to max_bytes (whole frames only) in a single burst. Returns the
+ * number of bytes copied to buf, or PICO_ERROR_TIMEOUT without reading if
+ * the device did not acknowledge the FIFO read request (FIFO_DATA would
+ * not hold FIFO samples then).
+ */
+int QMI8658_read_fifo(unsigned char *buf, unsigned short max_bytes, unsigned char *fifo_status)
+{
+	unsigned short bytes = QMI8658_read_fifo_status(fifo_status);
+
+	if (bytes > max_bytes)
+		bytes = max_bytes;
+	bytes -= bytes % QMI8658_FIFO_FRAME_BYTES;
+	if (bytes == 0)
+		return 0;
+
+	if (!QMI8658_doCtrl9Command(QMI8658_Ctrl9_Cmd_Req_Fifo))
+	{
+		QMI8658_write_reg(QMI8658Register_FifoCtrl, QMI8658_fifo_ctrl); // in case read mode was entered
+		return PICO_ERROR_TIMEOUT;
+	}
+	QMI8658_read_reg(QMI8658Register_FifoData, buf, bytes); // FIFO_DATA does not auto-increment
+	QMI8658_write_reg(QMI8658Register_FifoCtrl, QMI8658_fifo_ctrl); // leave FIFO read mode
+	return bytes;
 }
 
 void QMI8658_read_ae(float quat[4], float velocity[3])
@@ -460,7 +578,12 @@ void QMI8658_read_ae(float quat[4], float velocity[3])
 	velocity[2] = (float)(raw_v_xyz[2] * 1.0f) / ae_v_lsb_div;
 }
 
-void QMI8658_enableWakeOnMotion(void)
+/*
+ * Wake-on-motion: accelerometer only, 2g at the 21 Hz low-power ODR, INT1
+ * toggles (starting low) when any axis moves past the threshold. Returns 0
+ * if the WoM command was not acknowledged.
+ */
+unsigned char QMI8658_enableWakeOnMotion(void)
 {
 	unsigned char womCmd[3];
 	enum QMI8658_Interrupt interrupt = QMI8658_Int1;
@@ -478,21 +601,24 @@ void QMI8658_enableWakeOnMotion(void)
 	QMI8658_write_reg(QMI8658Register_Cal1_L, womCmd[1]);
 	QMI8658_write_reg(QMI8658Register_Cal1_H, womCmd[2]);
 
-	// QMI8658_doCtrl9Command(Ctrl9_ConfigureWakeOnMotion);
+	if (!QMI8658_doCtrl9Command(QMI8658_Ctrl9_Cmd_WoM_Setting))
+		return 0;
 	QMI8658_enableSensors(QMI8658_CTRL7_ACC_ENABLE);
-	// while(1)
-	//{
-	//	QMI8658_read_reg(QMI8658Register_Status1,&womCmd[0],1);
-	//	if(womCmd[0]&0x01)
-	//		break;
-	// }
+	return 1;
 }
 
-void QMI8658_disableWakeOnMotion(void)
+/*
+ * Leave wake-on-motion and restore the configuration QMI8658_init() applied
+ * (ranges, ODRs, sensors). The FIFO and interrupt setup are the caller's.
+ */
+unsigned char QMI8658_disableWakeOnMotion(void)
 {
 	QMI8658_enableSensors(QMI8658_CTRL7_DISABLE_ALL);
 	QMI8658_write_reg(QMI8658Register_Cal1_L, 0);
-	// QMI8658_doCtrl9Command(Ctrl9_ConfigureWakeOnMotion);
+	if (!QMI8658_doCtrl9Command(QMI8658_Ctrl9_Cmd_WoM_Setting))
+		return 0;
+	QMI8658_Config_apply(&QMI8658_config);
+	return 1;
 }
 
 void QMI8658_enableSensors(unsigned char enableFlags)
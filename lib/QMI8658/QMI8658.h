@@ -2,6 +2,7 @@
 #define QMI8658_H
 
 #include "DEV_Config.h"
+#include "QMI8658_convert.h"
 #include <stdint.h>
 #include <stdlib.h> //itoa()
 #include <stdio.h>
@@ -29,7 +30,22 @@
 #define QMI8658_CONFIG_ACCGYRMAG_ENABLE (QMI8658_CONFIG_ACC_ENABLE | QMI8658_CONFIG_GYR_ENABLE | QMI8658_CONFIG_MAG_ENABLE)
 #define QMI8658_CONFIG_AEMAG_ENABLE (QMI8658_CONFIG_AE_ENABLE | QMI8658_CONFIG_MAG_ENABLE)
 
+#define QMI8658_CTRL1_INT2_ENABLE (0x10)
+#define QMI8658_CTRL1_INT1_ENABLE (0x08)
+#define QMI8658_CTRL1_FIFO_INT1 (0x04) /* FIFO interrupts on INT1 instead of INT2 */
+#define QMI8658_CTRL1_INT_MASK (0x1C)
+
 #define QMI8658_STATUS1_CMD_DONE (0x01)
+#define QMI8658_STATUSINT_CMD_DONE (0x80)
+
+#define QMI8658_FIFO_STATUS_FULL (0x80)
+#define QMI8658_FIFO_STATUS_WTM (0x40)
+#define QMI8658_FIFO_STATUS_OVFLOW (0x20)
+#define QMI8658_FIFO_STATUS_NOT_EMPTY (0x10)
+#define QMI8658_FIFO_CTRL_RD_MODE (0x80)
+
+/* One FIFO frame with accelerometer and gyroscope enabled: ax ay az gx gy gz */
+#define QMI8658_FIFO_FRAME_BYTES (12)
 #define QMI8658_STATUS1_WAKEUP_EVENT (0x04)
 
 enum QMI8658Register
@@ -72,12 +88,16 @@ enum QMI8658Register
     QMI8658Register_Cal4_L,
     /*! \brief Calibration register 4 least significant byte. */
     QMI8658Register_Cal4_H,
+    /*! \brief FIFO watermark level, in ODR samples. */
+    QMI8658Register_FifoWtmTh = 19,
     /*! \brief FIFO control register. */
-    QMI8658Register_FifoCtrl = 19,
+    QMI8658Register_FifoCtrl, // 20
+    /*! \brief FIFO sample count, 8 LSBs (unit: 2 bytes). */
+    QMI8658Register_FifoSmplCnt, // 21
+    /*! \brief FIFO status register (flags + sample count MSBs). */
+    QMI8658Register_FifoStatus, // 22
     /*! \brief FIFO data register. */
-    QMI8658Register_FifoData, // 20
-    /*! \brief FIFO status register. */
-    QMI8658Register_FifoStatus, // 21
+    QMI8658Register_FifoData, // 23
     /*! \brief Output data overrun and availability. */
     QMI8658Register_StatusInt = 45,
     /*! \brief Output data overrun and availability. */
@@ -222,8 +242,11 @@ enum QMI8658_Ois_Register
 enum QMI8658_Ctrl9Command
 {
     QMI8658_Ctrl9_Cmd_NOP = 0X00,
+    QMI8658_Ctrl9_Cmd_Ack = 0X00,
     QMI8658_Ctrl9_Cmd_GyroBias = 0X01,
     QMI8658_Ctrl9_Cmd_Rqst_Sdi_Mod = 0X03,
+    QMI8658_Ctrl9_Cmd_Rst_Fifo = 0X04,
+    QMI8658_Ctrl9_Cmd_Req_Fifo = 0X05,
     QMI8658_Ctrl9_Cmd_WoM_Setting = 0x08,
     QMI8658_Ctrl9_Cmd_AccelHostDeltaOffset = 0x09,
     QMI8658_Ctrl9_Cmd_GyroHostDeltaOffset = 0x0A,
@@ -270,6 +293,21 @@ enum QMI8658_AccRange
     QMI8658AccRange_16g = 0x03 << 4 /*!< \brief +/- 16g range */
 };
 
+enum QMI8658_FifoMode
+{
+    QMI8658_FifoMode_Bypass = 0x00, /*!< \brief FIFO disabled. */
+    QMI8658_FifoMode_Fifo = 0x01,   /*!< \brief Stop collecting when full. */
+    QMI8658_FifoMode_Stream = 0x02  /*!< \brief Overwrite the oldest samples when full. */
+};
+
+enum QMI8658_FifoSize
+{
+    QMI8658_FifoSize_16 = (0 << 2),  /*!< \brief 16 samples per sensor. */
+    QMI8658_FifoSize_32 = (1 << 2),  /*!< \brief 32 samples per sensor. */
+    QMI8658_FifoSize_64 = (2 << 2),  /*!< \brief 64 samples per sensor. */
+    QMI8658_FifoSize_128 = (3 << 2)  /*!< \brief 128 samples per sensor. */
+};
+
 enum QMI8658_AccOdr
 {
     QMI8658AccOdr_8000Hz = 0x00,         /*!< \brief High resolution 8000Hz output rate. */
@@ -367,6 +405,7 @@ enum QMI8658_GyrUnit
     QMI8658GyrUnit_rads /*!< \brief Gyroscope output in rad/s. */
 };
 
+
 struct QMI8658Config
 {
     /*! \brief Sensor fusion input selection. */
@@ -479,12 +518,22 @@ extern void QMI8658_enableSensors(unsigned char enableFlags);
 extern void QMI8658_read_acc_xyz(float acc_xyz[3]);
 extern void QMI8658_read_gyro_xyz(float gyro_xyz[3]);
 extern void QMI8658_read_xyz(float acc[3], float gyro[3], unsigned int *tim_count);
+extern void QMI8658_decode_xyz(const unsigned char buf_reg[12], float acc[3], float gyro[3]); // 12 bytes from Ax_L
+extern unsigned char QMI8658_get_slave_addr(void); // valid after QMI8658_init()
+extern void QMI8658_get_sensitivity(unsigned short *acc_lsb_per_g, unsigned short *gyro_lsb_per_dps);
+extern void QMI8658_get_scale(struct QMI8658_Scale *scale); // updated by every range change
+extern void QMI8658_decode_xyz_raw(const unsigned char buf_reg[12], short raw_acc_xyz[3], short raw_gyro_xyz[3]);
+extern unsigned char QMI8658_config_fifo(unsigned char watermark, enum QMI8658_FifoSize size, enum QMI8658_FifoMode mode); // 0: CTRL9 timeout
+extern unsigned char QMI8658_reset_fifo(void); // 0: CTRL9 timeout
+extern void QMI8658_config_interrupts(unsigned char int_flags); // QMI8658_CTRL1_INT* bits
+extern unsigned short QMI8658_read_fifo_status(unsigned char *fifo_status); // returns bytes buffered
+extern int QMI8658_read_fifo(unsigned char *buf, unsigned short max_bytes, unsigned char *fifo_status); // bytes, or PICO_ERROR_TIMEOUT
 extern void QMI8658_read_xyz_raw(short raw_acc_xyz[3], short raw_gyro_xyz[3], unsigned int *tim_count);
 extern void QMI8658_read_ae(float quat[4], float velocity[3]);
 extern unsigned char QMI8658_readStatus0(void);
 extern unsigned char QMI8658_readStatus1(void);
 extern float QMI8658_readTemp(void);
-extern void QMI8658_enableWakeOnMotion(void);
-extern void QMI8658_disableWakeOnMotion(void);
+extern unsigned char QMI8658_enableWakeOnMotion(void); // 0: CTRL9 timeout
+extern unsigned char QMI8658_disableWakeOnMotion(void); // restores the init configuration; 0: CTRL9 timeout
 
 #endif
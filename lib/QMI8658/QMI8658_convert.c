@@ -0,0 +1,89 @@
+/*
+ * QMI8658 raw-count conversion, see QMI8658_convert.h.
+ */
+#include <assert.h>
+
+#include "QMI8658_convert.h"
+
+/* The Q16 path stays in 32 bits: the largest product is -2^15 * k */
+_Static_assert((long long)QMI8658_Q_K_MAX * 32768 <= 2147483647LL, "raw * k must fit in 32 bits");
+
+void QMI8658_scale_q(float scale, int *k, unsigned char *shift)
+{
+	float kf = scale * (float)(1 << QMI8658_Q_FRAC_BITS);
+
+	*shift = 0;
+	while (kf < 32768.0f && *shift < 30)
+	{
+		kf *= 2.0f;
+		(*shift)++;
+	}
+	*k = (int)(kf + 0.5f);
+	if (*k > QMI8658_Q_K_MAX && *shift > 0) // rounded up to 2^16
+	{
+		*k = (*k + 1) >> 1;
+		(*shift)--;
+	}
+	assert(*k <= QMI8658_Q_K_MAX); // scale >= 1.0 has no 32-bit form
+}
+
+/* (raw * k) >> shift, rounded half up. The rounding is added after all but
+ * the last bit is shifted out, so it cannot overflow the product. */
+static inline int QMI8658_q16(short raw, int k, unsigned char shift)
+{
+	int p = raw * k;
+
+	return shift ? ((p >> (shift - 1)) + 1) >> 1 : p;
+}
+
+/*
+ * Batch conversion of n interleaved samples (QMI8658_RAW_AXES shorts each)
+ * into the same layout. The Q16 path is one 32-bit multiply, two shifts
+ * and an add per axis; the float path one int-to-float and one multiply.
+ */
+void QMI8658_convert_q16(const struct QMI8658_Scale *scale, const short *raw, int *out, unsigned int n)
+{
+	const int ka = scale->accK, kg = scale->gyrK;
+	const unsigned char sa = scale->accShift, sg = scale->gyrShift;
+
+	while (n--)
+	{
+		out[0] = QMI8658_q16(raw[0], ka, sa);
+		out[1] = QMI8658_q16(raw[1], ka, sa);
+		out[2] = QMI8658_q16(raw[2], ka, sa);
+		out[3] = QMI8658_q16(raw[3], kg, sg);
+		out[4] = QMI8658_q16(raw[4], kg, sg);
+		out[5] = QMI8658_q16(raw[5], kg, sg);
+		raw += QMI8658_RAW_AXES;
+		out += QMI8658_RAW_AXES;
+	}
+}
+
+void QMI8658_decode_scaled(const struct QMI8658_Scale *scale, const unsigned char buf_reg[12], float acc[3], float gyro[3])
+{
+	for (int i = 0; i < 3; i++)
+	{
+		short a = (short)((unsigned short)(buf_reg[2 * i + 1] << 8) | buf_reg[2 * i]);
+		short g = (short)((unsigned short)(buf_reg[2 * i + 7] << 8) | buf_reg[2 * i + 6]);
+
+		acc[i] = (float)a * scale->accScale;
+		gyro[i] = (float)g * scale->gyrScale;
+	}
+}
+
+void QMI8658_convert_float(const struct QMI8658_Scale *scale, const short *raw, float *out, unsigned int n)
+{
+	const float fa = scale->accScale, fg = scale->gyrScale;
+
+	while (n--)
+	{
+		out[0] = (float)raw[0] * fa;
+		out[1] = (float)raw[1] * fa;
+		out[2] = (float)raw[2] * fa;
+		out[3] = (float)raw[3] * fg;
+		out[4] = (float)raw[4] * fg;
+		out[5] = (float)raw[5] * fg;
+		raw += QMI8658_RAW_AXES;
+		out += QMI8658_RAW_AXES;
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef QMI8658_CONVERT_H
+#define QMI8658_CONVERT_H
+
+/*
+ * Raw-count conversion for the QMI8658, kept free of SDK headers so the
+ * host tools (tools/qmi8658_convert_bench) build the same code.
+ *
+ * The firmware converts one sample per FIFO drain (QMI8658_decode_xyz()) and
+ * fuses raw counts (src/imu_fusion.c), so no batch goes through the
+ * QMI8658_convert_*() kernels yet; they are for consumers of SI samples.
+ */
+
+/*!
+ * \brief Per-LSB scale factors for the configured ranges, in the units of
+ * QMI8658_decode_xyz() (m/s2 and rad/s, or mg and dps with
+ * QMI8658_UINT_MG_DPS). Fixed-point form: value_q16 = (raw * k) >> shift,
+ * rounded, with k normalised to [2^15, 2^16). |raw| <= 2^15, so the
+ * product stays within 32 bits.
+ */
+struct QMI8658_Scale
+{
+    float accScale;
+    float gyrScale;
+    int accK;
+    int gyrK;
+    unsigned char accShift;
+    unsigned char gyrShift;
+};
+
+#define QMI8658_Q_FRAC_BITS (16)
+#define QMI8658_Q_K_MAX (0xFFFF) /* largest k with |raw * k| < 2^31 for every raw */
+#define QMI8658_RAW_AXES (6) /* ax ay az gx gy gz per interleaved sample */
+
+/* scale (units per LSB) as k and shift; scale must be below 1.0 */
+extern void QMI8658_scale_q(float scale, int *k, unsigned char *shift);
+extern void QMI8658_convert_q16(const struct QMI8658_Scale *scale, const short *raw, int *out, unsigned int n);
+extern void QMI8658_convert_float(const struct QMI8658_Scale *scale, const short *raw, float *out, unsigned int n);
+/* One 12-byte register block (Ax_L .. Gz_H) to floats: QMI8658_decode_xyz() */
+extern void QMI8658_decode_scaled(const struct QMI8658_Scale *scale, const unsigned char buf_reg[12], float acc[3], float gyro[3]);
+
+#endif
@@ -57,7 +57,7 @@ static uint16_t SGP40_ReadByte()
 {
 
     uint8_t Rbuf[3];
-    i2c_read_blocking(SENSOR_I2C_PORT, SGP40_ADDR, Rbuf, 3, false);
+    DEV_I2C_Read_nByte_Raw(SENSOR_I2C_PORT, SGP40_ADDR, Rbuf, 3);
     return (Rbuf[0] << 8) | Rbuf[1];
 }
 
@@ -66,11 +66,8 @@ uint8_t crc_value(uint8_t msb, uint8_t lsb)
     uint8_t crc = 0xff;
     crc ^= msb;
     crc = CRC_TABLE[crc];
-    if (lsb != 0)
-    {
-        crc ^= lsb;
-        crc = CRC_TABLE[crc];
-    }
+    crc ^= lsb;
+    crc = CRC_TABLE[crc];
     return crc;
 }
 
@@ -95,39 +92,108 @@ uint8_t SGP40_init(void)
     VocAlgorithm_init(&voc_algorithm_params);
 }
 
-uint16_t SGP40_MeasureRaw(float temp, float humi)
+void SGP40_BuildMeasureCmd(float temp, float humi, uint8_t cmd[SGP40_MEAS_CMD_LEN])
 {
-
     uint16_t h = humi * 0xffff / 100;
-    uint8_t paramh[2] = {h >> 8, h & 0xff};
-    uint8_t crch = crc_value(paramh[0], paramh[1]);
-    // printf("%d   %d \n",paramh[0],paramh[1]);
     uint16_t t = (temp + 45) * 0xffff / 175;
-    uint8_t paramt[2] = {t >> 8, t & 0xff};
-    uint8_t crct = crc_value(paramt[0], paramt[1]);
-    // printf("%d   %d \n",paramt[0],paramt[1]);
-    WITH_HUM_COMP[2] = paramh[0];
-    WITH_HUM_COMP[3] = paramh[1];
-    WITH_HUM_COMP[4] = (int)crch;
-    WITH_HUM_COMP[5] = paramt[0];
-    WITH_HUM_COMP[6] = paramt[1];
-    WITH_HUM_COMP[7] = (int)crct;
-    SGP40_Write_NByte(WITH_HUM_COMP, 8);
-    DEV_Delay_ms(31);
-    return SGP40_ReadByte();
+    cmd[0] = SGP40_CMD_MEASURE_RAW[0];
+    cmd[1] = SGP40_CMD_MEASURE_RAW[1];
+    cmd[2] = h >> 8;
+    cmd[3] = h & 0xff;
+    cmd[4] = crc_value(cmd[2], cmd[3]);
+    cmd[5] = t >> 8;
+    cmd[6] = t & 0xff;
+    cmd[7] = crc_value(cmd[5], cmd[6]);
 }
 
-    
-uint32_t SGP40_MeasureVOC(float temp, float humi)
+bool SGP40_DecodeRaw(const uint8_t buf[3], uint16_t *sraw)
 {
+    if (crc_value(buf[0], buf[1]) != buf[2])
+        return false;
+    *sraw = (buf[0] << 8) | buf[1];
+    return true;
+}
 
-
+uint32_t SGP40_ProcessRaw(uint16_t sraw)
+{
     int32_t voc_index;
 
+    VocAlgorithm_process(&voc_algorithm_params, sraw, &voc_index);
+    return voc_index;
+}
+
+/*
+ * Warm restart. VocAlgorithm_set_states() restores the learned baseline but
+ * leaves the 45 s blackout, which is meant for a cold sensor; after a short
+ * interruption only warmup_s samples are discarded.
+ */
+void SGP40_GetStates(int32_t *state0, int32_t *state1)
+{
+    VocAlgorithm_get_states(&voc_algorithm_params, state0, state1);
+}
+
+void SGP40_RestoreStates(int32_t state0, int32_t state1, uint32_t warmup_s)
+{
+    VocAlgorithm_init(&voc_algorithm_params);
+    VocAlgorithm_set_states(&voc_algorithm_params, state0, state1);
+    if (warmup_s < (uint32_t)VocAlgorithm_INITIAL_BLACKOUT)
+        voc_algorithm_params.mUptime = (fix16_t)(((int32_t)VocAlgorithm_INITIAL_BLACKOUT - (int32_t)warmup_s) << 16);
+}
+
+/*
+ * Split-phase measurement, see SHTC3.c: the 31 ms conversion runs with the
+ * bus released.
+ */
+static uint32_t sgp40_start_us;
+
+void SGP40_Start_Measurement(float temp, float humi)
+{
+    SGP40_BuildMeasureCmd(temp, humi, WITH_HUM_COMP);
+    SGP40_Write_NByte(WITH_HUM_COMP, SGP40_MEAS_CMD_LEN);
+    sgp40_start_us = time_us_32();
+}
+
+bool SGP40_Poll(void)
+{
+    return (time_us_32() - sgp40_start_us) >= SGP40_MEAS_TIME_MS * 1000u;
+}
+
+bool SGP40_Fetch(uint16_t *sraw)
+{
+    uint8_t Rbuf[SGP40_RAW_LEN];
+    DEV_I2C_Read_nByte_Raw(SENSOR_I2C_PORT, SGP40_ADDR, Rbuf, SGP40_RAW_LEN);
+    return SGP40_DecodeRaw(Rbuf, sraw);
+}
+
+/*
+ * sgp40_turn_heater_off: the hot plate idles until the next measure_raw,
+ * which switches it back on.
+ */
+void SGP40_BuildHeaterOffCmd(uint8_t cmd[SGP40_CMD_LEN])
+{
+    cmd[0] = SGP40_CMD_HEATER_OFF[0];
+    cmd[1] = SGP40_CMD_HEATER_OFF[1];
+}
+
+void SGP40_HeaterOff(void)
+{
+    SGP40_Write_Byte(SGP40_CMD_HEATER_OFF[0], SGP40_CMD_HEATER_OFF[1]);
+}
+
+uint16_t SGP40_MeasureRaw(float temp, float humi)
+{
+    uint16_t sraw = 0;
+    SGP40_Start_Measurement(temp, humi);
+    DEV_Delay_ms(SGP40_MEAS_TIME_MS);
+    SGP40_Fetch(&sraw);
+    return sraw;
+}
+
+    
+uint32_t SGP40_MeasureVOC(float temp, float humi)
+{
     uint16_t sraw = SGP40_MeasureRaw(temp, humi);
     // printf("sraw = %d\r\n",sraw);
-    
-    VocAlgorithm_process(&voc_algorithm_params, sraw, &voc_index);
 
-    return voc_index;
+    return SGP40_ProcessRaw(sraw);
 }
@@ -29,10 +29,42 @@
 /***********  SGP40_TEST  ****************/
 
 #define SGP40_ADDR (0x59)
+#define SGP40_MEAS_CMD_LEN  (8)   // sgp40_measure_raw + humidity + CRC + temperature + CRC
+#define SGP40_MEAS_TIME_MS  (31)  // measure_raw conversion time
+#define SGP40_RAW_LEN       (3)   // SRAW_VOC + CRC
+#define SGP40_CMD_LEN       (2)   // plain command, e.g. heater off
+
+// One measurement per algorithm sample (VocAlgorithm_SAMPLING_INTERVAL)
+#define SGP40_SAMPLE_PERIOD_MS ((uint32_t)(VocAlgorithm_SAMPLING_INTERVAL * 1000. + 0.5))
+
+// Low-power profile: heater off between measurements (set from CMake). Each
+// sample then starts with a heat-up measurement whose result is dropped; the
+// kept one follows SGP40_HEATUP_MS later, on a hotplate back at temperature.
+// Only worth it with sampling intervals well above 1 s (CMake checks).
+#ifndef SGP40_LOW_POWER
+#define SGP40_LOW_POWER 0
+#endif
+#define SGP40_HEATUP_MS (170)
 
 uint8_t SGP40_init(void);
-uint16_t SGP40_MeasureRaw(float temp, float humi);
+uint16_t SGP40_MeasureRaw(float temp, float humi);   // blocking wrapper of Start/Fetch
 uint32_t SGP40_MeasureVOC(float temp, float humi);
+
+// Split-phase measurement: the bus is free during the conversion
+void SGP40_Start_Measurement(float temp, float humi);
+bool SGP40_Poll(void);                // true once SGP40_MEAS_TIME_MS has passed
+bool SGP40_Fetch(uint16_t *sraw);     // false on CRC error
+void SGP40_HeaterOff(void);           // idle until the next measurement
+
+// Split measurement for callers that run the bus themselves
+void SGP40_BuildMeasureCmd(float temp, float humi, uint8_t cmd[SGP40_MEAS_CMD_LEN]);
+bool SGP40_DecodeRaw(const uint8_t buf[SGP40_RAW_LEN], uint16_t *sraw);
+uint32_t SGP40_ProcessRaw(uint16_t sraw);  // feeds the VOC algorithm, returns the index
+void SGP40_BuildHeaterOffCmd(uint8_t cmd[SGP40_CMD_LEN]);
+
+// Warm restart: algorithm states survive a short interruption (< 10 min)
+void SGP40_GetStates(int32_t *state0, int32_t *state1);
+void SGP40_RestoreStates(int32_t state0, int32_t state1, uint32_t warmup_s);
 /***********  END  ****************/
 
 #endif
@@ -0,0 +1,222 @@
+/*
+ * RP2040 fix16 backend, see sensirion_fix16_fast.h.
+ */
+
+#include "sensirion_fix16.h"
+
+#if SGP40_FIX16_FAST
+
+#if PICO_ON_DEVICE
+#include "pico/divider.h"
+#include "hardware/interp.h"
+#endif
+
+/* log2(e) in Q30 */
+#define FIX16_LOG2E_Q30 1549082005
+
+/* 2^(i/256) in Q30, i = 0..256 */
+static const uint32_t exp2_table[257] = {
+    0x40000000, 0x402C6BE9, 0x4058F6A8, 0x4085A051, 0x40B268FA, 0x40DF50B8,
+    0x410C57A2, 0x41397DCC, 0x4166C34C, 0x41942839, 0x41C1ACA7, 0x41EF50AE,
+    0x421D1462, 0x424AF7DA, 0x4278FB2B, 0x42A71E6C, 0x42D561B4, 0x4303C518,
+    0x433248AE, 0x4360EC8D, 0x438FB0CB, 0x43BE957F, 0x43ED9AC0, 0x441CC0A3,
+    0x444C0740, 0x447B6EAD, 0x44AAF702, 0x44DAA054, 0x450A6ABB, 0x453A564D,
+    0x456A6323, 0x459A9152, 0x45CAE0F2, 0x45FB521A, 0x462BE4E2, 0x465C9961,
+    0x468D6FAE, 0x46BE67E0, 0x46EF8210, 0x4720BE55, 0x47521CC6, 0x47839D7B,
+    0x47B5408C, 0x47E70611, 0x4818EE22, 0x484AF8D6, 0x487D2646, 0x48AF768A,
+    0x48E1E9BA, 0x49147FEE, 0x4947393F, 0x497A15C4, 0x49AD1598, 0x49E038D0,
+    0x4A137F88, 0x4A46E9D6, 0x4A7A77D4, 0x4AAE299B, 0x4AE1FF43, 0x4B15F8E6,
+    0x4B4A169C, 0x4B7E587E, 0x4BB2BEA5, 0x4BE7492B, 0x4C1BF829, 0x4C50CBB8,
+    0x4C85C3F1, 0x4CBAE0EF, 0x4CF022CA, 0x4D25899C, 0x4D5B157E, 0x4D90C68B,
+    0x4DC69CDD, 0x4DFC988C, 0x4E32B9B4, 0x4E69006E, 0x4E9F6CD4, 0x4ED5FF00,
+    0x4F0CB70C, 0x4F439514, 0x4F7A9930, 0x4FB1C37C, 0x4FE91413, 0x50208B0E,
+    0x50582888, 0x508FEC9C, 0x50C7D765, 0x50FFE8FE, 0x51382182, 0x5170810B,
+    0x51A907B4, 0x51E1B59A, 0x521A8AD7, 0x52538786, 0x528CABC3, 0x52C5F7AA,
+    0x52FF6B55, 0x533906E0, 0x5372CA68, 0x53ACB607, 0x53E6C9DA, 0x542105FD,
+    0x545B6A8B, 0x5495F7A1, 0x54D0AD5A, 0x550B8BD4, 0x55469329, 0x5581C378,
+    0x55BD1CDB, 0x55F89F70, 0x56344B52, 0x567020A0, 0x56AC1F75, 0x56E847EF,
+    0x57249A29, 0x57611642, 0x579DBC57, 0x57DA8C83, 0x581786E6, 0x5854AB9B,
+    0x5891FAC1, 0x58CF7474, 0x590D18D3, 0x594AE7FB, 0x5988E209, 0x59C7071C,
+    0x5A055751, 0x5A43D2C6, 0x5A82799A, 0x5AC14BEA, 0x5B0049D4, 0x5B3F7377,
+    0x5B7EC8F2, 0x5BBE4A61, 0x5BFDF7E5, 0x5C3DD19C, 0x5C7DD7A4, 0x5CBE0A1C,
+    0x5CFE6923, 0x5D3EF4D7, 0x5D7FAD59, 0x5DC092C7, 0x5E01A53F, 0x5E42E4E3,
+    0x5E8451D0, 0x5EC5EC26, 0x5F07B405, 0x5F49A98C, 0x5F8BCCDB, 0x5FCE1E12,
+    0x60109D51, 0x60534AB7, 0x60962665, 0x60D9307B, 0x611C6919, 0x615FD05E,
+    0x61A3666D, 0x61E72B65, 0x622B1F66, 0x626F4292, 0x62B39509, 0x62F816EB,
+    0x633CC85B, 0x6381A978, 0x63C6BA64, 0x640BFB41, 0x64516C2E, 0x64970D4F,
+    0x64DCDEC3, 0x6522E0AD, 0x6569132F, 0x65AF766A, 0x65F60A7F, 0x663CCF92,
+    0x6683C5C3, 0x66CAED35, 0x6712460B, 0x6759D065, 0x67A18C68, 0x67E97A34,
+    0x683199ED, 0x6879EBB6, 0x68C26FB1, 0x690B2601, 0x69540EC9, 0x699D2A2C,
+    0x69E6784D, 0x6A2FF94F, 0x6A79AD56, 0x6AC39485, 0x6B0DAEFF, 0x6B57FCE9,
+    0x6BA27E65, 0x6BED3399, 0x6C381CA6, 0x6C8339B2, 0x6CCE8AE1, 0x6D1A1057,
+    0x6D65CA38, 0x6DB1B8A8, 0x6DFDDBCC, 0x6E4A33C9, 0x6E96C0C3, 0x6EE382DE,
+    0x6F307A41, 0x6F7DA710, 0x6FCB096F, 0x7018A185, 0x70666F76, 0x70B47368,
+    0x7102AD80, 0x71511DE4, 0x719FC4B9, 0x71EEA226, 0x723DB650, 0x728D015D,
+    0x72DC8374, 0x732C3CBA, 0x737C2D55, 0x73CC556D, 0x741CB528, 0x746D4CAC,
+    0x74BE1C20, 0x750F23AB, 0x75606374, 0x75B1DBA2, 0x76038C5B, 0x765575C8,
+    0x76A7980F, 0x76F9F359, 0x774C87CC, 0x779F5590, 0x77F25CCE, 0x78459DAC,
+    0x78991854, 0x78ECCCEC, 0x7940BB9E, 0x7994E492, 0x79E947EF, 0x7A3DE5DF,
+    0x7A92BE8B, 0x7AE7D21A, 0x7B3D20B6, 0x7B92AA88, 0x7BE86FBA, 0x7C3E7073,
+    0x7C94ACDE, 0x7CEB2523, 0x7D41D96E, 0x7D98C9E6, 0x7DEFF6B6, 0x7E476009,
+    0x7E9F0606, 0x7EF6E8DA, 0x7F4F08AE, 0x7FA765AD, 0x80000000,
+};
+
+/* Quotient and remainder in one hardware divider operation. */
+static inline uint32_t udivmod(uint32_t n, uint32_t d, uint32_t* rem) {
+#if PICO_ON_DEVICE
+    return divmod_u32u32_rem(n, d, rem);
+#else
+    *rem = n % d;
+    return n / d;
+#endif
+}
+
+/* base0 + (base1 - base0) * alpha / 256, alpha = 0..255 */
+static inline uint32_t blend(uint32_t base0, uint32_t base1, uint32_t alpha) {
+#if PICO_ON_DEVICE
+    static bool claimed;
+    if (!claimed) {
+        interp_claim_lane_mask(interp0, 0x3);
+        interp_config cfg = interp_default_config();
+        interp_config_set_blend(&cfg, true);
+        interp_set_config(interp0, 0, &cfg);
+        cfg = interp_default_config();
+        interp_set_config(interp0, 1, &cfg);
+        claimed = true;
+    }
+    interp0->base[0] = base0;
+    interp0->base[1] = base1;
+    interp0->accum[1] = alpha;
+    return interp0->peek[1];
+#else
+    return base0 + (((base1 - base0) * alpha) >> 8);
+#endif
+}
+
+/*
+ * floor(r * 2^16 / d) and its remainder, for quotients that fit 32 bits.
+ * Each step shifts in as many quotient bits as the remainder has headroom,
+ * so a divisor below 2^16 takes two divisions.
+ */
+static uint32_t udiv_q16(uint32_t r, uint32_t d, uint32_t* rem_out) {
+    uint32_t rem;
+    uint32_t q = udivmod(r, d, &rem);
+    int bits = 16;
+
+    while (bits > 0) {
+        if (rem == 0) {
+            q <<= bits;
+            break;
+        }
+        int s = __builtin_clz(rem);
+        if (s > bits)
+            s = bits;
+        q = (q << s) + udivmod(rem << s, d, &rem);
+        bits -= s;
+    }
+    *rem_out = rem;
+    return q;
+}
+
+/* floor(sqrt(n)), Newton from a power of two above the root */
+static uint32_t isqrt32(uint32_t n) {
+    if (n < 2)
+        return n;
+
+    uint32_t rem;
+    uint32_t y = 1u << ((33 - __builtin_clz(n)) >> 1);
+    for (;;) {
+        uint32_t z = (y + udivmod(n, y, &rem)) >> 1;
+        if (z >= y)
+            return y;
+        y = z;
+    }
+}
+
+int32_t fix16_fast_div(int32_t a, int32_t b) {
+    if (b == 0)
+        return FIX16_MINIMUM;
+
+    uint32_t remainder = (a >= 0) ? (uint32_t)a : -(uint32_t)a;
+    uint32_t divider = (b >= 0) ? (uint32_t)b : -(uint32_t)b;
+
+#ifndef FIXMATH_NO_OVERFLOW
+    if (((uint64_t)divider << 15) < remainder)
+        return FIX16_OVERFLOW;
+#endif
+
+    uint32_t rem;
+    uint32_t quotient = udiv_q16(remainder, divider, &rem);
+
+#ifndef FIXMATH_NO_ROUNDING
+    if (rem >= divider - rem)
+        quotient++;
+#endif
+
+    int32_t result = (int32_t)quotient;
+    if ((a ^ b) & 0x80000000) {
+#ifndef FIXMATH_NO_OVERFLOW
+        if (result == (int32_t)FIX16_MINIMUM)
+            return FIX16_OVERFLOW;
+#endif
+        result = -result;
+    }
+    return result;
+}
+
+int32_t fix16_fast_sqrt(int32_t x) {
+    // Like the reference, x is taken as unsigned
+    uint32_t n = (uint32_t)x;
+
+    if (n < 0x10000) {
+        uint32_t num = n << 16;
+        uint32_t y = isqrt32(num);
+#ifndef FIXMATH_NO_ROUNDING
+        if (num - y * y > y)
+            y++;
+#endif
+        return (int32_t)y;
+    }
+
+    // Root of the normalised value, scaled up, is good to 8 bits; one
+    // Newton step on n * 2^16 brings it to within one of the result.
+    uint64_t num = (uint64_t)n << 16;
+    int e = __builtin_clz(n) & ~1;
+    uint32_t y = isqrt32(n << e) << (8 - (e >> 1));
+    uint32_t rem;
+    y = (y + udiv_q16(n, y, &rem)) >> 1;
+    while ((uint64_t)y * y > num)
+        y--;
+    while ((uint64_t)(y + 1) * (y + 1) <= num)
+        y++;
+
+#ifndef FIXMATH_NO_ROUNDING
+    if (num - (uint64_t)y * y > y)
+        y++;
+#endif
+    return (int32_t)y;
+}
+
+int32_t fix16_fast_exp(int32_t x) {
+    // Same saturation limits as the reference
+    if (x >= 681391) // F16(10.3972)
+        return FIX16_MAXIMUM;
+    if (x <= -772243) // F16(-11.7835)
+        return 0;
+
+    // y = x * log2(e) in Q16; 2^y = 2^k * 2^(i/256 + alpha/65536)
+    int32_t y = (int32_t)(((int64_t)x * FIX16_LOG2E_Q30 + (1 << 29)) >> 30);
+    int32_t k = y >> 16;
+    uint32_t i = ((uint32_t)y >> 8) & 0xFF;
+    uint32_t v = blend(exp2_table[i], exp2_table[i + 1], (uint32_t)y & 0xFF);
+
+    // v is Q30; the result is Q16 scaled by 2^k, k in [-17, 14]
+    int s = 14 - k;
+    if (s >= 32)
+        return 0;
+    if (s == 0)
+        return (v > FIX16_MAXIMUM) ? FIX16_MAXIMUM : (int32_t)v;
+    return (int32_t)((v + (1u << (s - 1))) >> s);
+}
+
+#endif /* SGP40_FIX16_FAST */
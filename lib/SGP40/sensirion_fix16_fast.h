@@ -0,0 +1,45 @@
+/*
+ * Alternative fix16 backend for sensirion_voc_algorithm.c on the RP2040.
+ *
+ * The reference fix16_div/fix16_sqrt/fix16_exp work bit by bit. With
+ * SGP40_FIX16_FAST set (CMake option of the same name) the algorithm uses
+ * these instead:
+ *
+ *   fix16_fast_div   long division in 32-bit steps on the SIO hardware
+ *                    divider (pico/divider.h). Bit-exact with the reference,
+ *                    including rounding and overflow results.
+ *   fix16_fast_sqrt  integer Newton iteration on the hardware divider, then
+ *                    an exact correction step; always rounds to nearest.
+ *                    Bit-exact with the reference below 16384.0. Above it
+ *                    the reference's second pass can overflow its rounding
+ *                    step and return one LSB low (~0.03 % of inputs); this
+ *                    one is then one LSB higher.
+ *   fix16_fast_exp   exp(x) = 2^(x*log2(e)) with a 257-entry 2^(i/256)
+ *                    table, linearly interpolated by INTERP0 in blend mode.
+ *                    Not bit-exact: the reference truncates x to 1/512 and
+ *                    is off by up to 0.2 % (up to 127 LSB below 1.0); this
+ *                    one stays within 2.2e-5 relative above 1.0 and 1 LSB
+ *                    below, so it differs from the reference by the
+ *                    reference's own error.
+ *
+ * Fed the same SRAW trace, both backends give VOC indices at most 1 apart.
+ *
+ * INTERP0 of the calling core is claimed on first use. Off the device (host
+ * builds) the divider and the interpolator are emulated in C with the same
+ * results.
+ */
+
+#ifndef SENSIRION_FIX16_FAST_H
+#define SENSIRION_FIX16_FAST_H
+
+#include "sensirion_arch_config.h"
+
+#ifndef SGP40_FIX16_FAST
+#define SGP40_FIX16_FAST 0
+#endif
+
+int32_t fix16_fast_div(int32_t a, int32_t b);
+int32_t fix16_fast_sqrt(int32_t x);
+int32_t fix16_fast_exp(int32_t x);
+
+#endif /* SENSIRION_FIX16_FAST_H */
@@ -43,7 +43,11 @@ typedef int32_t fix16_t;
 #define F16(x)                                                                 \
   ((fix16_t)(((x) >= 0) ? ((x)*65536.0 + 0.5) : ((x)*65536.0 - 0.5)))
 
+/* Seconds between samples; every time constant below is scaled by it.
+ * Override from the build (SGP40_SAMPLING_INTERVAL_S in lib/SGP40). */
+#ifndef VocAlgorithm_SAMPLING_INTERVAL
 #define VocAlgorithm_SAMPLING_INTERVAL (1.)
+#endif
 #define VocAlgorithm_INITIAL_BLACKOUT (45.)
 #define VocAlgorithm_VOC_INDEX_GAIN (230.)
 #define VocAlgorithm_SRAW_STD_INITIAL (50.)
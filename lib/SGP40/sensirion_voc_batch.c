@@ -0,0 +1,359 @@
+/*
+ * Batch VOC algorithm, see sensirion_voc_batch.h.
+ *
+ * Each stage below mirrors the function of the same name in
+ * sensirion_voc_algorithm.c, with the VocAlgorithmParams fields replaced by
+ * per-lane arrays. The sigmoid parameters that the scalar version keeps in
+ * its state are always set right before use, so here they are arguments.
+ */
+
+#include "sensirion_voc_batch.h"
+#include "sensirion_fix16.h"
+
+#include <string.h>
+
+/* Lane count is padded to this many lanes and arrays aligned to it */
+#define VOC_BATCH_ALIGN 64
+
+static fix16_t* alloc_lanes(uint8_t** cursor, size_t bytes) {
+    fix16_t* p = (fix16_t*)*cursor;
+    *cursor += (bytes + VOC_BATCH_ALIGN - 1) & ~(size_t)(VOC_BATCH_ALIGN - 1);
+    return p;
+}
+
+VocBatch* VocBatch_create(size_t lanes) {
+    VocBatch* b = calloc(1, sizeof(*b));
+    if (!b)
+        return NULL;
+
+    size_t padded = (lanes + VOC_BATCH_ALIGN - 1) & ~(size_t)(VOC_BATCH_ALIGN - 1);
+    size_t words = padded * sizeof(fix16_t);
+    size_t bytes = padded;
+    size_t total = 16 * words + 3 * bytes + VOC_BATCH_ALIGN;
+
+    b->mem = calloc(1, total);
+    if (!b->mem) {
+        free(b);
+        return NULL;
+    }
+    uint8_t* cur = (uint8_t*)(((uintptr_t)b->mem + VOC_BATCH_ALIGN - 1) &
+                              ~(uintptr_t)(VOC_BATCH_ALIGN - 1));
+
+    b->lanes = lanes;
+    b->uptime = alloc_lanes(&cur, words);
+    b->sraw = alloc_lanes(&cur, words);
+    b->voc_index = alloc_lanes(&cur, words);
+    b->mve_mean = alloc_lanes(&cur, words);
+    b->mve_sraw_offset = alloc_lanes(&cur, words);
+    b->mve_std = alloc_lanes(&cur, words);
+    b->mve_gamma_mean = alloc_lanes(&cur, words);
+    b->mve_gamma_variance = alloc_lanes(&cur, words);
+    b->mve_uptime_gamma = alloc_lanes(&cur, words);
+    b->mve_uptime_gating = alloc_lanes(&cur, words);
+    b->mve_gating_duration_minutes = alloc_lanes(&cur, words);
+    b->mox_sraw_std = alloc_lanes(&cur, words);
+    b->mox_sraw_mean = alloc_lanes(&cur, words);
+    b->lp_x1 = alloc_lanes(&cur, words);
+    b->lp_x2 = alloc_lanes(&cur, words);
+    b->lp_x3 = alloc_lanes(&cur, words);
+    b->mve_initialized = (uint8_t*)alloc_lanes(&cur, bytes);
+    b->lp_initialized = (uint8_t*)alloc_lanes(&cur, bytes);
+    b->active = (uint8_t*)alloc_lanes(&cur, bytes);
+
+    /* VocAlgorithm_init() and VocAlgorithm__init_instances() */
+    b->voc_index_offset = F16(VocAlgorithm_VOC_INDEX_OFFSET_DEFAULT);
+    b->gating_max_duration_minutes =
+        F16(VocAlgorithm_GATING_MAX_DURATION_MINUTES);
+    b->mve_gamma =
+        (fix16_div(F16((VocAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING *
+                        (VocAlgorithm_SAMPLING_INTERVAL / 3600.))),
+                   (F16(VocAlgorithm_TAU_MEAN_VARIANCE_HOURS) +
+                    F16((VocAlgorithm_SAMPLING_INTERVAL / 3600.)))));
+    b->mve_gamma_initial_mean =
+        F16(((VocAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING *
+              VocAlgorithm_SAMPLING_INTERVAL) /
+             (VocAlgorithm_TAU_INITIAL_MEAN + VocAlgorithm_SAMPLING_INTERVAL)));
+    b->mve_gamma_initial_variance = F16(
+        ((VocAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING *
+          VocAlgorithm_SAMPLING_INTERVAL) /
+         (VocAlgorithm_TAU_INITIAL_VARIANCE + VocAlgorithm_SAMPLING_INTERVAL)));
+    b->lp_a1 =
+        F16((VocAlgorithm_SAMPLING_INTERVAL /
+             (VocAlgorithm_LP_TAU_FAST + VocAlgorithm_SAMPLING_INTERVAL)));
+    b->lp_a2 =
+        F16((VocAlgorithm_SAMPLING_INTERVAL /
+             (VocAlgorithm_LP_TAU_SLOW + VocAlgorithm_SAMPLING_INTERVAL)));
+
+    for (size_t i = 0; i < lanes; i++) {
+        b->mve_std[i] = F16(VocAlgorithm_SRAW_STD_INITIAL);
+        b->mox_sraw_std[i] = b->mve_std[i];
+    }
+    return b;
+}
+
+void VocBatch_free(VocBatch* batch) {
+    if (batch) {
+        free(batch->mem);
+        free(batch);
+    }
+}
+
+void VocBatch_set_states(VocBatch* b, size_t lane, int32_t state0,
+                         int32_t state1) {
+
+    b->mve_mean[lane] = state0;
+    b->mve_std[lane] = state1;
+    b->mve_uptime_gamma[lane] = F16(VocAlgorithm_PERSISTENCE_UPTIME_GAMMA);
+    b->mve_initialized[lane] = true;
+    b->sraw[lane] = state0;
+}
+
+void VocBatch_get_states(const VocBatch* b, size_t lane, int32_t* state0,
+                         int32_t* state1) {
+
+    *state0 = b->mve_mean[lane] + b->mve_sraw_offset[lane];
+    *state1 = b->mve_std[lane];
+}
+
+static inline fix16_t mve_sigmoid(fix16_t L, fix16_t X0, fix16_t K,
+                                  fix16_t sample) {
+
+    fix16_t x = (fix16_mul(K, (sample - X0)));
+    if ((x < F16(-50.))) {
+        return L;
+    } else if ((x > F16(50.))) {
+        return F16(0.);
+    } else {
+        return (fix16_div(L, (F16(1.) + fix16_exp(x))));
+    }
+}
+
+static inline fix16_t mox_model(fix16_t sraw, fix16_t sraw_mean,
+                                fix16_t sraw_std) {
+
+    return (fix16_mul(
+        (fix16_div((sraw - sraw_mean),
+                   (-(sraw_std + F16(VocAlgorithm_SRAW_STD_BONUS))))),
+        F16(VocAlgorithm_VOC_INDEX_GAIN)));
+}
+
+static inline fix16_t sigmoid_scaled(fix16_t sample, fix16_t offset) {
+
+    fix16_t x = (fix16_mul(F16(VocAlgorithm_SIGMOID_K),
+                           (sample - F16(VocAlgorithm_SIGMOID_X0))));
+    if ((x < F16(-50.))) {
+        return F16(VocAlgorithm_SIGMOID_L);
+    } else if ((x > F16(50.))) {
+        return F16(0.);
+    } else if ((sample >= F16(0.))) {
+        fix16_t shift = (fix16_div(
+            (F16(VocAlgorithm_SIGMOID_L) - (fix16_mul(F16(5.), offset))),
+            F16(4.)));
+        return ((fix16_div((F16(VocAlgorithm_SIGMOID_L) + shift),
+                           (F16(1.) + fix16_exp(x)))) -
+                shift);
+    } else {
+        return (fix16_mul(
+            (fix16_div(offset, F16(VocAlgorithm_VOC_INDEX_OFFSET_DEFAULT))),
+            (fix16_div(F16(VocAlgorithm_SIGMOID_L),
+                       (F16(1.) + fix16_exp(x))))));
+    }
+}
+
+/* VocAlgorithm__mean_variance_estimator___calculate_gamma() for one lane */
+static void mve_calculate_gamma(VocBatch* b, size_t i,
+                                fix16_t voc_index_from_prior) {
+
+    fix16_t uptime_limit = F16((VocAlgorithm_MEAN_VARIANCE_ESTIMATOR__FIX16_MAX -
+                                VocAlgorithm_SAMPLING_INTERVAL));
+    if ((b->mve_uptime_gamma[i] < uptime_limit)) {
+        b->mve_uptime_gamma[i] += F16(VocAlgorithm_SAMPLING_INTERVAL);
+    }
+    if ((b->mve_uptime_gating[i] < uptime_limit)) {
+        b->mve_uptime_gating[i] += F16(VocAlgorithm_SAMPLING_INTERVAL);
+    }
+
+    fix16_t sigmoid_gamma_mean =
+        mve_sigmoid(F16(1.), F16(VocAlgorithm_INIT_DURATION_MEAN),
+                    F16(VocAlgorithm_INIT_TRANSITION_MEAN),
+                    b->mve_uptime_gamma[i]);
+    fix16_t gamma_mean =
+        (b->mve_gamma + (fix16_mul((b->mve_gamma_initial_mean - b->mve_gamma),
+                                   sigmoid_gamma_mean)));
+    fix16_t gating_threshold_mean =
+        (F16(VocAlgorithm_GATING_THRESHOLD) +
+         (fix16_mul(F16((VocAlgorithm_GATING_THRESHOLD_INITIAL -
+                         VocAlgorithm_GATING_THRESHOLD)),
+                    mve_sigmoid(F16(1.), F16(VocAlgorithm_INIT_DURATION_MEAN),
+                                F16(VocAlgorithm_INIT_TRANSITION_MEAN),
+                                b->mve_uptime_gating[i]))));
+    fix16_t sigmoid_gating_mean =
+        mve_sigmoid(F16(1.), gating_threshold_mean,
+                    F16(VocAlgorithm_GATING_THRESHOLD_TRANSITION),
+                    voc_index_from_prior);
+    b->mve_gamma_mean[i] = (fix16_mul(sigmoid_gating_mean, gamma_mean));
+
+    fix16_t sigmoid_gamma_variance =
+        mve_sigmoid(F16(1.), F16(VocAlgorithm_INIT_DURATION_VARIANCE),
+                    F16(VocAlgorithm_INIT_TRANSITION_VARIANCE),
+                    b->mve_uptime_gamma[i]);
+    fix16_t gamma_variance =
+        (b->mve_gamma +
+         (fix16_mul((b->mve_gamma_initial_variance - b->mve_gamma),
+                    (sigmoid_gamma_variance - sigmoid_gamma_mean))));
+    fix16_t gating_threshold_variance =
+        (F16(VocAlgorithm_GATING_THRESHOLD) +
+         (fix16_mul(F16((VocAlgorithm_GATING_THRESHOLD_INITIAL -
+                         VocAlgorithm_GATING_THRESHOLD)),
+                    mve_sigmoid(F16(1.),
+                                F16(VocAlgorithm_INIT_DURATION_VARIANCE),
+                                F16(VocAlgorithm_INIT_TRANSITION_VARIANCE),
+                                b->mve_uptime_gating[i]))));
+    fix16_t sigmoid_gating_variance =
+        mve_sigmoid(F16(1.), gating_threshold_variance,
+                    F16(VocAlgorithm_GATING_THRESHOLD_TRANSITION),
+                    voc_index_from_prior);
+    b->mve_gamma_variance[i] =
+        (fix16_mul(sigmoid_gating_variance, gamma_variance));
+
+    b->mve_gating_duration_minutes[i] =
+        (b->mve_gating_duration_minutes[i] +
+         (fix16_mul(F16((VocAlgorithm_SAMPLING_INTERVAL / 60.)),
+                    ((fix16_mul((F16(1.) - sigmoid_gating_mean),
+                                F16((1. + VocAlgorithm_GATING_MAX_RATIO)))) -
+                     F16(VocAlgorithm_GATING_MAX_RATIO)))));
+    if ((b->mve_gating_duration_minutes[i] < F16(0.))) {
+        b->mve_gating_duration_minutes[i] = F16(0.);
+    }
+    if ((b->mve_gating_duration_minutes[i] > b->gating_max_duration_minutes)) {
+        b->mve_uptime_gating[i] = F16(0.);
+    }
+}
+
+/* VocAlgorithm__mean_variance_estimator__process() for one lane */
+static void mve_process(VocBatch* b, size_t i, fix16_t sraw,
+                        fix16_t voc_index_from_prior) {
+
+    if (!b->mve_initialized[i]) {
+        b->mve_initialized[i] = true;
+        b->mve_sraw_offset[i] = sraw;
+        b->mve_mean[i] = F16(0.);
+        return;
+    }
+    if (((b->mve_mean[i] >= F16(100.)) || (b->mve_mean[i] <= F16(-100.)))) {
+        b->mve_sraw_offset[i] = (b->mve_sraw_offset[i] + b->mve_mean[i]);
+        b->mve_mean[i] = F16(0.);
+    }
+    sraw = (sraw - b->mve_sraw_offset[i]);
+    mve_calculate_gamma(b, i, voc_index_from_prior);
+
+    fix16_t delta_sgp = (fix16_div(
+        (sraw - b->mve_mean[i]),
+        F16(VocAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING)));
+    fix16_t c = (delta_sgp < F16(0.)) ? (b->mve_std[i] - delta_sgp)
+                                      : (b->mve_std[i] + delta_sgp);
+    fix16_t additional_scaling = (c > F16(1440.)) ? F16(4.) : F16(1.);
+    fix16_t std = b->mve_std[i];
+    b->mve_std[i] = (fix16_mul(
+        fix16_sqrt((fix16_mul(
+            additional_scaling,
+            (F16(VocAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING) -
+             b->mve_gamma_variance[i])))),
+        fix16_sqrt((
+            (fix16_mul(
+                std,
+                (fix16_div(
+                    std,
+                    (fix16_mul(
+                        F16(VocAlgorithm_MEAN_VARIANCE_ESTIMATOR__GAMMA_SCALING),
+                        additional_scaling)))))) +
+            (fix16_mul((fix16_div((fix16_mul(b->mve_gamma_variance[i],
+                                             delta_sgp)),
+                                  additional_scaling)),
+                       delta_sgp))))));
+    b->mve_mean[i] =
+        (b->mve_mean[i] + (fix16_mul(b->mve_gamma_mean[i], delta_sgp)));
+}
+
+void VocBatch_process(VocBatch* b, const int32_t* sraw_in,
+                      int32_t* voc_index_out) {
+
+    const size_t n = b->lanes;
+
+    /* Blackout and input clamping */
+    for (size_t i = 0; i < n; i++) {
+        uint8_t active = b->uptime[i] > F16(VocAlgorithm_INITIAL_BLACKOUT);
+        int32_t sraw = sraw_in[i];
+        b->active[i] = active;
+        if (!active)
+            b->uptime[i] += F16(VocAlgorithm_SAMPLING_INTERVAL);
+        if (active && sraw > 0 && sraw < 65000) {
+            sraw = (sraw < 20001) ? 20001 : (sraw > 52767) ? 52767 : sraw;
+            b->sraw[i] = fix16_from_int(sraw - 20000);
+        }
+    }
+
+    /* MOX model and scaled sigmoid */
+    for (size_t i = 0; i < n; i++) {
+        if (b->active[i]) {
+            b->voc_index[i] = sigmoid_scaled(
+                mox_model(b->sraw[i], b->mox_sraw_mean[i], b->mox_sraw_std[i]),
+                b->voc_index_offset);
+        }
+    }
+
+    /* Adaptive low-pass, first the two fixed filters */
+    for (size_t i = 0; i < n; i++) {
+        if (b->active[i] && !b->lp_initialized[i]) {
+            b->lp_x1[i] = b->voc_index[i];
+            b->lp_x2[i] = b->voc_index[i];
+            b->lp_x3[i] = b->voc_index[i];
+            b->lp_initialized[i] = true;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (b->active[i]) {
+            fix16_t sample = b->voc_index[i];
+            b->lp_x1[i] = ((fix16_mul((F16(1.) - b->lp_a1), b->lp_x1[i])) +
+                           (fix16_mul(b->lp_a1, sample)));
+            b->lp_x2[i] = ((fix16_mul((F16(1.) - b->lp_a2), b->lp_x2[i])) +
+                           (fix16_mul(b->lp_a2, sample)));
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (b->active[i]) {
+            fix16_t abs_delta = (b->lp_x1[i] - b->lp_x2[i]);
+            if ((abs_delta < F16(0.))) {
+                abs_delta = (-abs_delta);
+            }
+            fix16_t F1 =
+                fix16_exp((fix16_mul(F16(VocAlgorithm_LP_ALPHA), abs_delta)));
+            fix16_t tau_a =
+                ((fix16_mul(F16((VocAlgorithm_LP_TAU_SLOW -
+                                 VocAlgorithm_LP_TAU_FAST)),
+                            F1)) +
+                 F16(VocAlgorithm_LP_TAU_FAST));
+            fix16_t a3 = (fix16_div(F16(VocAlgorithm_SAMPLING_INTERVAL),
+                                    (F16(VocAlgorithm_SAMPLING_INTERVAL) + tau_a)));
+            b->lp_x3[i] = ((fix16_mul((F16(1.) - a3), b->lp_x3[i])) +
+                           (fix16_mul(a3, b->voc_index[i])));
+            b->voc_index[i] = b->lp_x3[i];
+            if ((b->voc_index[i] < F16(0.5))) {
+                b->voc_index[i] = F16(0.5);
+            }
+        }
+    }
+
+    /* Mean/variance estimator, then the MOX model follows it */
+    for (size_t i = 0; i < n; i++) {
+        if (b->active[i] && b->sraw[i] > F16(0.)) {
+            mve_process(b, i, b->sraw[i], b->voc_index[i]);
+            b->mox_sraw_std[i] = b->mve_std[i];
+            b->mox_sraw_mean[i] = b->mve_mean[i] + b->mve_sraw_offset[i];
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        voc_index_out[i] = fix16_cast_to_int((b->voc_index[i] + F16(0.5)));
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * Batch variant of the Sensirion VOC algorithm for host-side backfill.
+ *
+ * VocBatch runs many independent sensor streams ("lanes") in lockstep: every
+ * VocBatch_process() call feeds one SRAW sample per lane. The state is kept
+ * as one array per field (structure of arrays), and each algorithm stage is a
+ * loop over all lanes, so the compiler can vectorise the branch-free parts
+ * (uptime, clamping, the low-pass filters).
+ *
+ * Every lane computes exactly what VocAlgorithm_process() computes with the
+ * default tuning, using the same fix16 primitives (sensirion_fix16.h). Build
+ * with the same SGP40_FIX16_FAST and VocAlgorithm_SAMPLING_INTERVAL as the
+ * firmware to get the device's indices bit for bit.
+ *
+ * Not part of the firmware; see tools/voc_backfill.
+ */
+
+#ifndef SENSIRION_VOC_BATCH_H
+#define SENSIRION_VOC_BATCH_H
+
+#include "sensirion_voc_algorithm.h"
+
+typedef struct {
+    size_t lanes;
+
+    /* Per-lane state, one array per VocAlgorithmParams field */
+    fix16_t* uptime;
+    fix16_t* sraw;
+    fix16_t* voc_index;
+    uint8_t* mve_initialized;
+    fix16_t* mve_mean;
+    fix16_t* mve_sraw_offset;
+    fix16_t* mve_std;
+    fix16_t* mve_gamma_mean;
+    fix16_t* mve_gamma_variance;
+    fix16_t* mve_uptime_gamma;
+    fix16_t* mve_uptime_gating;
+    fix16_t* mve_gating_duration_minutes;
+    fix16_t* mox_sraw_std;
+    fix16_t* mox_sraw_mean;
+    uint8_t* lp_initialized;
+    fix16_t* lp_x1;
+    fix16_t* lp_x2;
+    fix16_t* lp_x3;
+
+    /* Scratch for one step */
+    uint8_t* active;
+
+    /* Shared by all lanes (default tuning, as set by VocAlgorithm_init) */
+    fix16_t voc_index_offset;
+    fix16_t gating_max_duration_minutes;
+    fix16_t mve_gamma;
+    fix16_t mve_gamma_initial_mean;
+    fix16_t mve_gamma_initial_variance;
+    fix16_t lp_a1;
+    fix16_t lp_a2;
+
+    void* mem;
+} VocBatch;
+
+/**
+ * Allocate a batch of `lanes` streams, each in the state VocAlgorithm_init()
+ * leaves behind. Returns NULL if out of memory.
+ */
+VocBatch* VocBatch_create(size_t lanes);
+
+void VocBatch_free(VocBatch* batch);
+
+/**
+ * Equivalent of VocAlgorithm_set_states() for one lane, e.g. to continue
+ * from a device snapshot.
+ */
+void VocBatch_set_states(VocBatch* batch, size_t lane, int32_t state0,
+                         int32_t state1);
+
+void VocBatch_get_states(const VocBatch* batch, size_t lane, int32_t* state0,
+                         int32_t* state1);
+
+/**
+ * Process one sample per lane: sraw[lane] in, voc_index[lane] out.
+ */
+void VocBatch_process(VocBatch* batch, const int32_t* sraw,
+                      int32_t* voc_index);
+
+#endif /* SENSIRION_VOC_BATCH_H */
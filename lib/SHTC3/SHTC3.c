@@ -10,7 +10,7 @@ bool SHTC3_Write_Word(uint16_t Data)
 }
 bool SHTC3_Read(uint8_t *pData, uint8_t Len)
 {
-    i2c_read_blocking(SENSOR_I2C_PORT, SHTC3_I2C_ADDR, pData, Len, false);
+    DEV_I2C_Read_nByte_Raw(SENSOR_I2C_PORT, SHTC3_I2C_ADDR, pData, Len);
     return true;
 }
 
@@ -76,26 +76,13 @@ bool SHTC3_Init()
     return true;
     // self.read_id();
 }
-bool SHTC3_Measurement(float *temp, float *hum)
+bool SHTC3_Decode(const uint8_t *buffer, float *temp, float *hum)
 {
-    uint8_t buffer[10];
     uint8_t temp_data_crc, hum_data_crc;
     uint16_t temp_data, hum_data;
-    // uint16_t command =SHTC3_MEAS_ALL[SHTC3_STRETCH_MEAS][SHTC3_LOWPOWER_MEAS][SHTC3_HUM_FRIST_MEAS];
-    uint16_t command = SHTC3_REG_NORMAL_T_F;
-    SHTC3_Write_Word(command);
-    if (SHTC3_LOWPOWER_MEAS)
-    {
-        DEV_Delay_ms(2);
-    }
-    else
-    {
-        DEV_Delay_ms(14);
-    }
 
-    SHTC3_Read(buffer, 6);
-    temp_data_crc = SHTC3_crc8((buffer + SHTC3_HUM_FRIST_MEAS * 3), 2);
-    hum_data_crc = SHTC3_crc8((buffer + 3 - SHTC3_HUM_FRIST_MEAS * 3), 2);
+    temp_data_crc = SHTC3_crc8((uint8_t *)(buffer + SHTC3_HUM_FRIST_MEAS * 3), 2);
+    hum_data_crc = SHTC3_crc8((uint8_t *)(buffer + 3 - SHTC3_HUM_FRIST_MEAS * 3), 2);
 
     if (temp_data_crc == buffer[3 * (SHTC3_HUM_FRIST_MEAS + 1) - 1] && hum_data_crc == buffer[3 * (2 - SHTC3_HUM_FRIST_MEAS) - 1])
     {
@@ -106,11 +93,41 @@ bool SHTC3_Measurement(float *temp, float *hum)
         return true;
     }
     printf("temp_data_crc = %x ,get_crc = %x\r\n", temp_data_crc, buffer[3 * (SHTC3_HUM_FRIST_MEAS + 1) - 1]);
-    temp_data = (buffer[0] << 8) + buffer[1];
-    hum_data =( buffer[3] << 8 )+ buffer[4];
-    printf("\r\n 123 temp = %x ,hum = %x\r\n\r\n", temp_data, hum_data);
+    return false;
+}
+/*
+ * Split-phase measurement: Start sends the command and returns, the sensor
+ * converts on its own (the bus is free meanwhile), Poll says when the
+ * result is due and Fetch reads and checks it.
+ */
+static uint32_t shtc3_start_us;
 
+bool SHTC3_Start_Measurement(void)
+{
+    // uint16_t command =SHTC3_MEAS_ALL[SHTC3_STRETCH_MEAS][SHTC3_LOWPOWER_MEAS][SHTC3_HUM_FRIST_MEAS];
+    SHTC3_Write_Word(SHTC3_MEAS_CMD);
+    shtc3_start_us = time_us_32();
+    return true;
+}
+bool SHTC3_Poll(void)
+{
+    return (time_us_32() - shtc3_start_us) >= SHTC3_MEAS_TIME_MS * 1000u;
+}
+bool SHTC3_Fetch(float *temp, float *hum)
+{
+    uint8_t buffer[6];
+    SHTC3_Read(buffer, 6);
+    return SHTC3_Decode(buffer, temp, hum);
+}
+bool SHTC3_Measurement(float *temp, float *hum)
+{
+    SHTC3_Start_Measurement();
+    DEV_Delay_ms(SHTC3_MEAS_TIME_MS);
+    if (SHTC3_Fetch(temp, hum))
+    {
+        return true;
+    }
     *temp = 1;
     *hum = 1;
     return false;
-}
\ No newline at end of file
+}
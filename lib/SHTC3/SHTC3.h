@@ -42,13 +42,21 @@
 #define SHTC3_LOWPOWER_MEAS  (0)
 #define SHTC3_STRETCH_MEAS   (0)
 
+// Measurement command and conversion wait matching the settings above
+#define SHTC3_MEAS_CMD       (SHTC3_LOWPOWER_MEAS ? SHTC3_REG_LOWPOWER_T_F : SHTC3_REG_NORMAL_T_F)
+#define SHTC3_MEAS_TIME_MS   (SHTC3_LOWPOWER_MEAS ? 2 : 14)
+
 
 bool SHTC3_Init(void);
 bool SHTC3_Sleep(void);
 bool SHTC3_Wake_Up(void);
 bool SHTC3_Reset(void);
 int16_t SHTC3_Read_Id(void);
-bool SHTC3_Measurement(float *temp,float *hum);
+bool SHTC3_Measurement(float *temp,float *hum);   // blocking wrapper of the three below
+bool SHTC3_Start_Measurement(void);
+bool SHTC3_Poll(void);                            // true once SHTC3_MEAS_TIME_MS has passed
+bool SHTC3_Fetch(float *temp, float *hum);
+bool SHTC3_Decode(const uint8_t *buffer, float *temp, float *hum); // 6 bytes read after SHTC3_MEAS_CMD
 uint8_t SHTC3_crc8(uint8_t *data, uint16_t len);
 
 #endif
@@ -2,17 +2,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <errno.h>
+#include <malloc.h>
 
 /* Pico SDK */
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h" // For Wi-Fi
-#include "hardware/adc.h"    // For ADC
 
 /* FreeRTOS */
 #include "FreeRTOS.h"
 #include "task.h"
-#include "semphr.h" // For Mutexes
 
 /* Waveshare Libs (Hardware Init) */
 #include "DEV_Config.h"
@@ -22,30 +22,22 @@
 #include "SGP40.h"
 #include "QMI8658.h"
 
-/* Network (lwIP) */
-#include "lwip/netdb.h"
-#include "lwip/sockets.h"
-#include "lwip/errno.h"
-#include "lwip/inet.h"
-
-/* mbedTLS (no desktop net_sockets!) */
-#include "mbedtls/ssl.h"
-#include "mbedtls/entropy.h"
-#include "mbedtls/ctr_drbg.h"
-#include "mbedtls/x509_crt.h"
-#include "mbedtls/error.h"
-
-/* Map “net_* failed” error codes for builds without MBEDTLS_NET_C.
- * Values match mbedTLS 2.28.x so error strings remain meaningful via mbedtls_strerror().
- */
-#ifndef MBEDTLS_ERR_NET_SEND_FAILED
-#define MBEDTLS_ERR_NET_SEND_FAILED    -0x004E
-#endif
-
-#ifndef MBEDTLS_ERR_NET_RECV_FAILED
-#define MBEDTLS_ERR_NET_RECV_FAILED    -0x004C
-#endif
-
+/* App modules */
+#include "sensor_data.h"
+#include "sensor_history.h"
+#include "adc_engine.h"
+#include "i2c_bus.h"
+#include "imu_stream.h"
+#include "imu_irq.h"
+#include "imu_fusion.h"
+#include "wall_clock.h"
+#include "voc_state.h"
+#include "flash_store.h"
+#include "uplink.h"
+#include "https_client.h"
+#include "mqtt_client.h"
+#include "coap_client.h"
+#include "metrics_server.h"
 
 /* ====================================================================
    --- Wi-Fi / API constants (use real values in your setup) ---
@@ -57,336 +49,847 @@ static const char WIFI_PASSWORD[] = "test-password";
 static const char API_HOST[]      = "your-api-host.com";
 static const char API_PATH[]      = "/your/api/path";
 
-/* Sensor Defines */
-#define LIGHT_SENSOR_PIN 26 // ADC 0
-#define SOUND_SENSOR_PIN 27 // ADC 1
+/* Uplink transport: HTTPS POSTs to API_HOST (https_client.h), or with
+ * API_MQTT QoS 1 publishes over one long-lived TLS connection to MQTT_HOST
+ * (mqtt_client.h), on topic MQTT_TOPIC/<encoding>, e.g. sensors/pico-w/cbor,
+ * or with API_COAP confirmable CoAP POSTs to COAP_HOST/COAP_PATH over UDP,
+ * DTLS-protected unless API_COAP_DTLS is 0 (coap_client.h) */
+#ifndef API_MQTT
+#define API_MQTT 0
+#endif
+#ifndef API_COAP
+#define API_COAP 0
+#endif
+#ifndef API_COAP_DTLS
+#define API_COAP_DTLS 1
+#endif
+#if API_MQTT && API_COAP
+#error "API_MQTT and API_COAP select different uplink transports; pick one"
+#endif
+#if API_MQTT
+static const char MQTT_HOST[]      = "your-mqtt-host.com";
+static const char MQTT_PORT[]      = "8883";
+static const char MQTT_CLIENT_ID[] = "pico-w-sensors";
+static const char MQTT_TOPIC[]     = "sensors/pico-w";
+#define MQTT_KEEPALIVE_S 60u
+#endif
+#if API_COAP
+static const char COAP_HOST[] = "your-coap-host.com";
+#if API_COAP_DTLS
+static const char COAP_PORT[] = "5684";
+#else
+static const char COAP_PORT[] = "5683";
+#endif
+static const char COAP_PATH[] = "sensors/pico-w";
+#endif
+
+/* With API_RADIO_DUTY the API task leaves the Wi-Fi network between
+ * uploads and joins it again when a batch is due, as a battery-powered
+ * deployment would. Radio-on time is then measured per wake, from the join
+ * request until the CYW43 link is down again, so HTTPS and API_COAP builds
+ * can be compared on the same batches. Not with API_MQTT, which keeps a
+ * connection open; the metrics server only answers while the link is up.
+ * Without it the link stays up and its up time is tracked instead. */
+#ifndef API_RADIO_DUTY
+#define API_RADIO_DUTY 0
+#endif
+#if API_RADIO_DUTY && API_MQTT
+#error "API_RADIO_DUTY needs a transport without a standing connection (HTTPS or API_COAP)"
+#endif
+/* Longest wait for the join and DHCP, and for the link to go down */
+#define API_RADIO_JOIN_MS  15000u
+#define API_RADIO_LEAVE_MS 1000u
+/* Backlog posts per wake, after the due batch */
+#define API_RADIO_DRAIN_POSTS 8u
 
-/* RTOS Handles */
-static SemaphoreHandle_t i2c_mutex;             // Protects I2C bus
-static SemaphoreHandle_t g_sensor_data_mutex;   // Protects g_sensor_data struct
+/* Uplink batching (uplink.h) is polled at API_POLL_MS; stats every API_STATS_PERIOD_MS */
+#define API_POLL_MS         1000u
+#define API_STATS_PERIOD_MS 30000u
+#define API_TASK_STACK_WORDS 8192u
 
-/* Global struct for all sensor data */
-typedef struct {
-    float     temp;
-    float     hum;
-    uint32_t  voc;
-    float     acc[3];
-    float     gyro[3];
-    uint16_t  light; // 0-4095
-    uint16_t  sound; // 0-4095
-} SensorData_t;
-
-/* Global sensor data */
-static SensorData_t g_sensor_data = {0};
+/* Light (ADC0, GPIO26), sound (ADC1, GPIO27) and MCU temperature (ADC4) are
+ * sampled by adc_engine.c */
+
+/* The sensor I2C bus is owned by the bus manager task (i2c_bus.c). */
+
+/* Sensor data is published lock-free through sensor_data.h (SensorData_t). */
 
 /* ====================================================================
-   --- TLS helpers: BIO callbacks using lwIP sockets (blocking) ---
+   --- FreeRTOS Tasks (sensors unchanged except small hygiene) ---
    ==================================================================== */
 
-typedef struct {
-    int fd; // lwIP socket fd
-} tls_net_ctx_t;
-
-static int tls_net_send(void *ctx, const unsigned char *buf, size_t len) {
-    tls_net_ctx_t *c = (tls_net_ctx_t *)ctx;
-    int ret = lwip_write(c->fd, buf, (int)len);
-    if (ret < 0) {
-        // Map EWOULDBLOCK/AGAIN to WANT_WRITE if using non-blocking.
-        if (errno == EWOULDBLOCK || errno == EAGAIN) return MBEDTLS_ERR_SSL_WANT_WRITE;
-        return MBEDTLS_ERR_NET_SEND_FAILED;
-    }
-    return ret;
+static inline uint32_t now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
 }
 
-static int tls_net_recv(void *ctx, unsigned char *buf, size_t len) {
-    tls_net_ctx_t *c = (tls_net_ctx_t *)ctx;
-    int ret = lwip_read(c->fd, buf, (int)len);
-    if (ret < 0) {
-        if (errno == EWOULDBLOCK || errno == EAGAIN) return MBEDTLS_ERR_SSL_WANT_READ;
-        return MBEDTLS_ERR_NET_RECV_FAILED;
-    }
-    if (ret == 0) {
-        // Peer closed connection
-        return 0; 
+void vSHTC3Task(void *pvParameters) {
+    (void)pvParameters;
+    static const uint8_t cmd[2] = { SHTC3_MEAS_CMD >> 8, SHTC3_MEAS_CMD & 0xff };
+    uint8_t rx[6];
+    I2cTxn_t txn = {
+        .addr = SHTC3_I2C_ADDR, .wbuf = cmd, .wlen = sizeof(cmd),
+        .rbuf = rx, .rlen = sizeof(rx),
+        .delay_ms = SHTC3_MEAS_TIME_MS, .prio = I2C_PRIO_NORMAL,
+    };
+    float local_temp, local_hum;
+    for (;;) {
+        if (i2c_bus_transfer(&txn) == (int)sizeof(rx) &&
+            SHTC3_Decode(rx, &local_temp, &local_hum)) {
+            uint32_t t = now_ms();
+            sensor_data_publish_temp_hum(local_temp, local_hum);
+            sensor_history_push(SENSOR_CH_TEMP, t, local_temp);
+            sensor_history_push(SENSOR_CH_HUM,  t, local_hum);
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
     }
-    return ret;
 }
 
-/* Resolve host and connect TCP socket (IPv4/IPv6) */
-static int tcp_connect_lwip(const char *host, const char *port) {
-    struct addrinfo hints = {0}, *res = NULL, *rp = NULL;
-    hints.ai_family   = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
+/* VOC sampling schedule, read by the API task */
+static struct {
+    uint32_t samples;
+    uint32_t late;     // period overran, next sample taken immediately
+} s_voc_sched;
 
-    int err = getaddrinfo(host, port, &hints, &res);
-    if (err != 0 || !res) {
-        printf("getaddrinfo failed: %d\n", err);
-        return -1;
+/* The VOC algorithm advances its clock by VocAlgorithm_SAMPLING_INTERVAL per
+ * sample, so measurements run on an absolute schedule at exactly that rate. */
+void vSGP40Task(void *pvParameters) {
+    (void)pvParameters;
+    uint8_t cmd[SGP40_MEAS_CMD_LEN];
+    uint8_t rx[SGP40_RAW_LEN];
+    I2cTxn_t txn = {
+        .addr = SGP40_ADDR, .wbuf = cmd, .wlen = sizeof(cmd),
+        .rbuf = rx, .rlen = sizeof(rx),
+        .delay_ms = SGP40_MEAS_TIME_MS, .prio = I2C_PRIO_LOW,
+    };
+    SGP40_BuildMeasureCmd(25, 50, cmd); // static T/H for now
+#if SGP40_LOW_POWER
+    uint8_t off_cmd[SGP40_CMD_LEN];
+    I2cTxn_t off_txn = {
+        .addr = SGP40_ADDR, .wbuf = off_cmd, .wlen = sizeof(off_cmd),
+        .prio = I2C_PRIO_LOW,
+    };
+    SGP40_BuildHeaterOffCmd(off_cmd);
+#endif
+    if (voc_state_restore()) {
+        printf("VOC: algorithm state restored, skipping the learning phase\n");
     }
-
-    int fd = -1;
-    for (rp = res; rp != NULL; rp = rp->ai_next) {
-        fd = lwip_socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-        if (fd < 0) continue;
-
-        if (lwip_connect(fd, rp->ai_addr, (socklen_t)rp->ai_addrlen) == 0) {
-            break; // connected
+    const TickType_t period = pdMS_TO_TICKS(SGP40_SAMPLE_PERIOD_MS);
+    TickType_t last_wake = xTaskGetTickCount();
+    for (;;) {
+        uint16_t sraw;
+#if SGP40_LOW_POWER
+        // The heater was off: this measurement only heats the hotplate up,
+        // the one kept is taken SGP40_HEATUP_MS after it started
+        TickType_t heat_start = xTaskGetTickCount();
+        i2c_bus_transfer(&txn);
+        xTaskDelayUntil(&heat_start, pdMS_TO_TICKS(SGP40_HEATUP_MS));
+#endif
+        if (i2c_bus_transfer(&txn) == (int)sizeof(rx) && SGP40_DecodeRaw(rx, &sraw)) {
+            uint32_t voc_index = SGP40_ProcessRaw(sraw);
+            sensor_data_publish_voc(voc_index);
+            sensor_history_push(SENSOR_CH_VOC, now_ms(), (float)voc_index);
+            voc_state_poll();
         }
-        lwip_close(fd);
-        fd = -1;
-    }
-    freeaddrinfo(res);
+#if SGP40_LOW_POWER
+        i2c_bus_transfer(&off_txn);
+#endif
+        bool on_time = xTaskDelayUntil(&last_wake, period) == pdTRUE;
 
-    if (fd < 0) {
-        printf("connect() failed\n");
+        taskENTER_CRITICAL();
+        s_voc_sched.samples++;
+        if (!on_time) s_voc_sched.late++;
+        taskEXIT_CRITICAL();
     }
-    return fd;
 }
 
-/* Optional: pretty-print mbedTLS error */
-static void print_mbedtls_err(const char *where, int err) {
-    char buf[128];
-    mbedtls_strerror(err, buf, sizeof(buf));
-    printf("%s: -0x%04x (%s)\n", where, (unsigned)(-err), buf);
+/* Runs in the I2C bus task with the bus held: status, CTRL9 handshake, burst */
+typedef struct {
+    uint8_t       *buf;
+    uint16_t       max;
+    unsigned char  status;
+} ImuFifoDrain_t;
+
+static int imu_fifo_drain(void *ctx) {
+    ImuFifoDrain_t *d = (ImuFifoDrain_t *)ctx;
+    return QMI8658_read_fifo(d->buf, d->max, &d->status);
 }
 
-/* ====================================================================
-   --- HTTPS POST using mbedTLS over lwIP socket (no mbedtls_net_*) ---
-   ==================================================================== */
-static void https_post(const char *host, const char *path, const char *json_payload) {
-    int ret = 0;
-    tls_net_ctx_t net_ctx = { .fd = -1 };
-
-    mbedtls_ssl_context ssl;
-    mbedtls_ssl_config conf;
-    mbedtls_x509_crt cacert;
-    mbedtls_ctr_drbg_context ctr_drbg;
-    mbedtls_entropy_context entropy;
-
-    char request_buf[1024];
-    char response_buf[1024];
-    const char *pers = "pico_w_https_client";
-
-    printf("Starting HTTPS POST to %s%s\n", host, path);
-
-    // Init TLS objects
-    mbedtls_ssl_init(&ssl);
-    mbedtls_ssl_config_init(&conf);
-    mbedtls_x509_crt_init(&cacert);
-    mbedtls_ctr_drbg_init(&ctr_drbg);
-    mbedtls_entropy_init(&entropy);
-
-    // Seed DRBG
-    if ((ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
-                                     (const unsigned char *)pers, strlen(pers))) != 0) {
-        print_mbedtls_err("ctr_drbg_seed", ret);
-        goto cleanup;
-    }
+/* Wake-on-motion: once the latest gyro reading of every drain has stayed
+ * below IMU_STILL_DPS for IMU_STILL_MS, streaming stops and the sensor
+ * waits in its low-power accelerometer mode; motion on INT1 restarts it. */
+#ifndef IMU_STILL_MS
+#define IMU_STILL_MS  60000u
+#endif
+#ifndef IMU_STILL_DPS
+#define IMU_STILL_DPS 3.0f
+#endif
 
-    // Load CA certs if you have them; otherwise keep VERIFY_OPTIONAL for now.
-    // Example: mbedtls_x509_crt_parse(&cacert, ca_pem, ca_pem_len);
+static bool s_imu_wom_ok;  // INT1 wired up (imu_irq_init() succeeded)
+
+/* Read by the API task */
+static struct {
+    uint32_t sleeps;
+    uint32_t asleep_ms;       // completed sleeps
+    uint32_t since_ms;        // start of the current sleep
+    bool     asleep;
+} s_imu_wom;
+
+/* In the I2C bus task with the bus held, like the drain */
+static int imu_sleep(void *ctx) {
+    (void)ctx;
+    QMI8658_config_interrupts(QMI8658_CTRL1_INT1_ENABLE); // no watermark while asleep
+    return QMI8658_enableWakeOnMotion() ? 0 : PICO_ERROR_TIMEOUT;
+}
 
-    if ((ret = mbedtls_ssl_config_defaults(&conf,
-                                           MBEDTLS_SSL_IS_CLIENT,
-                                           MBEDTLS_SSL_TRANSPORT_STREAM,
-                                           MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
-        print_mbedtls_err("ssl_config_defaults", ret);
-        goto cleanup;
+static int imu_wake(void *ctx) {
+    (void)ctx;
+    if (!QMI8658_disableWakeOnMotion() ||
+        !QMI8658_config_fifo(IMU_FIFO_WATERMARK, QMI8658_FifoSize_128, QMI8658_FifoMode_Stream)) {
+        return PICO_ERROR_TIMEOUT;
     }
+    QMI8658_config_interrupts(QMI8658_CTRL1_INT1_ENABLE | QMI8658_CTRL1_INT2_ENABLE);
+    return 0;
+}
 
-    // For first bring-up you can do OPTIONAL; for production use REQUIRED and real CA.
-    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
-    mbedtls_ssl_conf_ca_chain(&conf, &cacert, NULL);
-    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
-
-    if ((ret = mbedtls_ssl_setup(&ssl, &conf)) != 0) {
-        print_mbedtls_err("ssl_setup", ret);
-        goto cleanup;
+/* Fusion cost, read by the API task */
+static struct {
+    uint32_t updates;
+    uint64_t busy_us;
+} s_fusion_cost;
+
+/* Feed every new stream sample to the filter, then publish the result */
+static void imu_orientation_step(ImuFusion_t *f, ImuStreamCursor_t *cur, uint32_t t_ms) {
+    const ImuRawSample_t *span;
+    size_t n;
+    uint32_t updates = 0;
+    uint32_t t0 = time_us_32();
+
+    ImuStreamStats_t st;
+    imu_stream_get_stats(&st);
+    if (st.period_us * 100u > f->period_us * 101u || st.period_us * 101u < f->period_us * 100u) {
+        imu_fusion_set_period(f, st.period_us);
     }
-
-    if ((ret = mbedtls_ssl_set_hostname(&ssl, host)) != 0) {
-        print_mbedtls_err("ssl_set_hostname", ret);
-        goto cleanup;
+    while ((n = imu_stream_peek(cur, &span)) > 0) {
+        for (size_t i = 0; i < n; i++) imu_fusion_update(f, span[i].acc, span[i].gyro);
+        imu_stream_release(cur, n);
+        updates += (uint32_t)n;
     }
+    uint32_t busy = time_us_32() - t0;
+
+    ImuEuler_t e;
+    imu_fusion_euler(f, &e);
+    float quat[4], euler[3] = { e.roll_cdeg / 100.f, e.pitch_cdeg / 100.f, e.yaw_cdeg / 100.f };
+    for (int i = 0; i < 4; i++) quat[i] = (float)f->q[i] / (float)IMU_FUSION_Q30_ONE;
+    sensor_data_publish_orientation(quat, euler);
+    sensor_history_push(SENSOR_CH_ROLL,  t_ms, euler[0]);
+    sensor_history_push(SENSOR_CH_PITCH, t_ms, euler[1]);
+    sensor_history_push(SENSOR_CH_YAW,   t_ms, euler[2]);
+
+    taskENTER_CRITICAL();
+    s_fusion_cost.updates += updates;
+    s_fusion_cost.busy_us += busy;
+    taskEXIT_CRITICAL();
+}
 
-    // TCP connect
-    net_ctx.fd = tcp_connect_lwip(host, "443");
-    if (net_ctx.fd < 0) goto cleanup;
-
-    // BIO: plug our send/recv
-    mbedtls_ssl_set_bio(&ssl, &net_ctx, tls_net_send, tls_net_recv, NULL);
+void vQMI8658Task(void *pvParameters) {
+    (void)pvParameters;
+    static uint8_t fifo[128 * QMI8658_FIFO_FRAME_BYTES]; // whole sensor FIFO
+    static ImuFusion_t fusion;
+    ImuFifoDrain_t drain = { .buf = fifo, .max = sizeof(fifo) };
+    I2cTxn_t txn = { .exec = imu_fifo_drain, .exec_ctx = &drain, .prio = I2C_PRIO_HIGH };
+    I2cTxn_t pm_txn = { .prio = I2C_PRIO_HIGH };
+    bool asleep = false, wake_failed = false;
+    uint32_t still_since = now_ms();
+    ImuStreamCursor_t cur;
+    unsigned short acc_lsb, gyro_lsb;
+    float local_acc[3];
+    float local_gyro[3];
+
+    QMI8658_get_sensitivity(&acc_lsb, &gyro_lsb);
+    imu_fusion_init(&fusion, acc_lsb, gyro_lsb, IMU_STREAM_NOMINAL_PERIOD_US);
+    imu_stream_cursor_init(&cur, false);
+    for (;;) {
+        if (asleep) {
+            /* Only INT1 is enabled; a failed wake is retried at the poll rate */
+            uint32_t ev = imu_irq_wait(wake_failed ? pdMS_TO_TICKS(IMU_FIFO_POLL_MS) : portMAX_DELAY);
+            if (!(ev & IMU_IRQ_EV_MOTION) && !wake_failed) continue;
+            pm_txn.exec = imu_wake;
+            wake_failed = i2c_bus_transfer(&pm_txn) < 0;
+            if (wake_failed) continue;
+
+            asleep = false;
+            still_since = now_ms();
+            imu_stream_resume();
+            taskENTER_CRITICAL();
+            s_imu_wom.asleep_ms += still_since - s_imu_wom.since_ms;
+            s_imu_wom.asleep = false;
+            taskEXIT_CRITICAL();
+            continue;
+        }
 
-    // Handshake
-    while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
-        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-            print_mbedtls_err("ssl_handshake", ret);
-            goto cleanup;
+        /* INT2 = FIFO watermark; the timeout only covers a missed edge.
+         * INT1 is wake-on-motion, which is not armed while streaming. */
+        uint32_t ev = imu_irq_wait(pdMS_TO_TICKS(IMU_FIFO_POLL_MS));
+        if (ev == IMU_IRQ_EV_MOTION) continue;
+
+        /* < 0: bus error or CTRL9 timeout (nothing read); the FIFO keeps
+         * the samples, or flags the overflow, for the next drain */
+        int bytes = i2c_bus_transfer(&txn);
+        uint32_t t_us = time_us_32();
+        if (bytes >= QMI8658_FIFO_FRAME_BYTES) {
+            size_t frames = (size_t)bytes / QMI8658_FIFO_FRAME_BYTES;
+            size_t anchor = frames - 1;
+            /* The watermark edge is the moment frame IMU_FIFO_WATERMARK-1 landed */
+            if ((ev & IMU_IRQ_EV_DATA) && frames >= IMU_FIFO_WATERMARK) {
+                anchor = IMU_FIFO_WATERMARK - 1;
+                t_us = (uint32_t)imu_irq_timestamp(IMU_IRQ_INT2);
+            }
+            imu_stream_push_frames(fifo, frames, anchor, t_us,
+                                   (drain.status & QMI8658_FIFO_STATUS_OVFLOW) != 0);
+
+            /* The latest frame feeds the "current value" consumers */
+            uint32_t t = now_ms();
+            QMI8658_decode_xyz(&fifo[(frames - 1) * QMI8658_FIFO_FRAME_BYTES], local_acc, local_gyro);
+            sensor_data_publish_imu(local_acc, local_gyro);
+            for (int i = 0; i < 3; i++) {
+                sensor_history_push((SensorChannel_t)(SENSOR_CH_ACC_X + i),  t, local_acc[i]);
+                sensor_history_push((SensorChannel_t)(SENSOR_CH_GYRO_X + i), t, local_gyro[i]);
+            }
+            imu_orientation_step(&fusion, &cur, t);
+
+            for (int i = 0; i < 3; i++) {
+                if (fabsf(local_gyro[i]) >= IMU_STILL_DPS) still_since = t;
+            }
+            if (s_imu_wom_ok && t - still_since >= IMU_STILL_MS) {
+                pm_txn.exec = imu_sleep;
+                if (i2c_bus_transfer(&pm_txn) < 0) {
+                    // Not armed: go back to streaming rather than sleep deaf
+                    pm_txn.exec = imu_wake;
+                    i2c_bus_transfer(&pm_txn);
+                    still_since = t;
+                    continue;
+                }
+                asleep = true;
+                taskENTER_CRITICAL();
+                s_imu_wom.sleeps++;
+                s_imu_wom.since_ms = now_ms();
+                s_imu_wom.asleep = true;
+                taskEXIT_CRITICAL();
+            }
         }
     }
+}
 
-    // Build HTTP request
-    const int payload_len = (int)strlen(json_payload);
-    int n = snprintf(request_buf, sizeof(request_buf),
-                     "POST %s HTTP/1.1\r\n"
-                     "Host: %s\r\n"
-                     "Content-Type: application/json\r\n"
-                     "Content-Length: %d\r\n"
-                     "Connection: close\r\n"
-                     "\r\n"
-                     "%s",
-                     path, host, payload_len, json_payload);
-    if (n < 0 || n >= (int)sizeof(request_buf)) {
-        printf("Request too big\n");
-        goto cleanup;
-    }
+/* Request bodies for https_client_post(), mqtt_client_publish() and
+ * coap_client_post(): the
+ * pending uplink batch, or the oldest records of the flash log */
+static bool uplink_body(ByteSink_t *out, void *arg) {
+    (void)arg;
+    return uplink_encode(out);
+}
 
-    // Send
-    ret = mbedtls_ssl_write(&ssl, (const unsigned char *)request_buf, (size_t)n);
-    if (ret <= 0) {
-        print_mbedtls_err("ssl_write", ret);
-        goto cleanup;
-    }
+static bool backlog_body(ByteSink_t *out, void *arg) {
+    (void)arg;
+    return uplink_encode_backlog(out);
+}
 
-    // Read (single chunk)
-    memset(response_buf, 0, sizeof(response_buf));
-    ret = mbedtls_ssl_read(&ssl, (unsigned char *)response_buf, sizeof(response_buf) - 1);
-    if (ret <= 0) {
-        if (ret == 0) printf("... Server closed connection\n");
-        else print_mbedtls_err("ssl_read", ret);
-    } else {
-        printf("... Received %d bytes:\n--- (BEGIN RESPONSE) ---\n%s\n--- (END RESPONSE) ---\n", ret, response_buf);
-    }
+#if API_MQTT
+static MqttClient_t s_mqtt;
+
+static bool uplink_transport_init(void) {
+    static const MqttConnectOpts_t opts = {
+        .client_id   = MQTT_CLIENT_ID,
+        .keepalive_s = MQTT_KEEPALIVE_S,
+    };
+    const MqttTransport_t *tp = mqtt_tls_transport(MQTT_HOST, MQTT_PORT);
+    if (tp == NULL) return false;
+    mqtt_client_init(&s_mqtt, tp, &opts);
+    return true;
+}
 
-cleanup:
-    if (net_ctx.fd >= 0) lwip_close(net_ctx.fd);
-    mbedtls_ssl_free(&ssl);
-    mbedtls_ssl_config_free(&conf);
-    mbedtls_x509_crt_free(&cacert);
-    mbedtls_ctr_drbg_free(&ctr_drbg);
-    mbedtls_entropy_free(&entropy);
+/* Publish one uplink body; true once the broker has acknowledged it.
+ * Anything short of a PUBACK leaves the records to the uplink (flash log),
+ * so the window is given up rather than sent again on the next connect.
+ * MQTT has no content negotiation: the encoding is in the topic. */
+static bool post_uplink(HttpsBodyFn body, const char *what) {
+    char topic[MQTT_CLIENT_TOPIC_MAX + 1];
+    snprintf(topic, sizeof(topic), "%s/%s", MQTT_TOPIC, uplink_codec_get(uplink_get_encoding())->name);
+    bool ok = mqtt_client_publish(&s_mqtt, topic, body, NULL) &&
+              mqtt_client_flush(&s_mqtt, MQTT_CLIENT_ACK_TIMEOUT_MS);
+    if (!ok) mqtt_client_discard(&s_mqtt);
+    printf("Published %u byte %s %s to %s: %s\n", (unsigned)uplink_encoded_len(),
+           uplink_content_type(), what, topic, ok ? "ok" : "failed");
+    return ok;
 }
 
-/* ====================================================================
-   --- FreeRTOS Tasks (sensors unchanged except small hygiene) ---
-   ==================================================================== */
+/* Publish up to a window of backlog batches, then wait for their PUBACKs
+ * once: one round trip per MQTT_CLIENT_INFLIGHT batches instead of one per
+ * batch. True once all of them are acknowledged; otherwise the group is
+ * given up and its records stay in the flash log. */
+static bool post_backlog(void) {
+    char topic[MQTT_CLIENT_TOPIC_MAX + 1];
+    snprintf(topic, sizeof(topic), "%s/%s", MQTT_TOPIC, uplink_codec_get(uplink_get_encoding())->name);
+    unsigned n = 0;
+    bool ok;
+    do {
+        ok = mqtt_client_publish(&s_mqtt, topic, backlog_body, NULL);
+    } while (ok && ++n < MQTT_CLIENT_INFLIGHT && uplink_drain_next());
+    ok = ok && mqtt_client_flush(&s_mqtt, MQTT_CLIENT_ACK_TIMEOUT_MS);
+    if (!ok) mqtt_client_discard(&s_mqtt);
+    printf("Published %u %s backlog batches to %s: %s\n", n, uplink_content_type(), topic,
+           ok ? "ok" : "failed");
+    return ok;
+}
+#elif API_COAP
+static CoapClient_t s_coap;
+
+static bool uplink_transport_init(void) {
+    const CoapTransport_t *tp = coap_udp_transport(COAP_HOST, COAP_PORT, API_COAP_DTLS);
+    if (tp == NULL) return false;
+    coap_client_init(&s_coap, tp);
+    return true;
+}
 
-void vLightSensorTask(void *pvParameters) {
-    (void)pvParameters;
-    for (;;) {
-        adc_select_input(0); // ADC0 (GPIO26)
-        uint16_t light_val = adc_read();
-        if (xSemaphoreTake(g_sensor_data_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            g_sensor_data.light = light_val;
-            xSemaphoreGive(g_sensor_data_mutex);
-        }
-        vTaskDelay(pdMS_TO_TICKS(100));
+/* POST one uplink body; true on a 2.xx response. The encoding travels as
+ * the CoAP Content-Format, and 4.15 falls back to JSON as with HTTPS. */
+static bool post_uplink(HttpsBodyFn body, const char *what) {
+    const UplinkEncoder_t *enc = uplink_codec_get(uplink_get_encoding());
+    int code = coap_client_post(&s_coap, COAP_PATH, enc->coap_format, body, NULL);
+    if (code == 415 && uplink_get_encoding() != UPLINK_ENC_JSON) {
+        printf("CoAP server rejected %s, switching to JSON\n", uplink_content_type());
+        uplink_set_encoding(UPLINK_ENC_JSON);
+        enc  = uplink_codec_get(UPLINK_ENC_JSON);
+        code = coap_client_post(&s_coap, COAP_PATH, enc->coap_format, body, NULL);
     }
+    printf("Sent %u byte %s %s to %s: %d\n", (unsigned)uplink_encoded_len(),
+           uplink_content_type(), what, COAP_PATH, code);
+    return code >= 200 && code < 300;
+}
+#else
+static bool uplink_transport_init(void) {
+    return https_client_init(API_HOST, "443");
 }
 
-void vSoundSensorTask(void *pvParameters) {
-    (void)pvParameters;
-    for (;;) {
-        adc_select_input(1); // ADC1 (GPIO27)
-        uint16_t sound_val = adc_read();
-        if (xSemaphoreTake(g_sensor_data_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            g_sensor_data.sound = sound_val;
-            xSemaphoreGive(g_sensor_data_mutex);
-        }
-        vTaskDelay(pdMS_TO_TICKS(100));
+/* Post one uplink body; true on a 2xx status */
+static bool post_uplink(HttpsBodyFn body, const char *what) {
+    int status = https_client_post(API_PATH, uplink_content_type(), body, NULL);
+    if (status == 415 && uplink_get_encoding() != UPLINK_ENC_JSON) {
+        // Backend does not take this encoding: fall back to JSON for good
+        printf("API rejected %s, switching to JSON\n", uplink_content_type());
+        uplink_set_encoding(UPLINK_ENC_JSON);
+        status = https_client_post(API_PATH, uplink_content_type(), body, NULL);
     }
+    printf("Sent %u byte %s %s to API: %d\n", (unsigned)uplink_encoded_len(),
+           uplink_content_type(), what, status);
+    return status >= 200 && status < 300;
 }
+#endif
 
-void vSHTC3Task(void *pvParameters) {
-    (void)pvParameters;
-    float local_temp = 0.f, local_hum = 0.f;
-    for (;;) {
-        if (xSemaphoreTake(i2c_mutex, portMAX_DELAY) == pdTRUE) {
-            SHTC3_Measurement(&local_temp, &local_hum);
-            xSemaphoreGive(i2c_mutex);
-        }
-        if (xSemaphoreTake(g_sensor_data_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            g_sensor_data.temp = local_temp;
-            g_sensor_data.hum  = local_hum;
-            xSemaphoreGive(g_sensor_data_mutex);
-        }
-        vTaskDelay(pdMS_TO_TICKS(100));
+#if !API_MQTT
+static bool post_backlog(void) {
+    return post_uplink(backlog_body, "backlog batch");
+}
+#endif
+
+/* Radio use of the uplink: time spent posting (with MQTT including the wait
+ * for the PUBACK) and the CYW43 link's up periods. */
+static struct {
+    uint32_t uploads;
+    uint64_t post_us;
+    uint32_t post_us_max;
+    bool     link_up;
+    uint64_t link_since_us;  // start of the current up period (or wake)
+    uint64_t link_us;        // finished up periods
+    uint32_t link_downs;
+    uint32_t wakes;          // API_RADIO_DUTY: join to link down
+    uint32_t join_failures;
+    uint64_t join_us;        // join request to link up (association, DHCP)
+    uint64_t on_us;          // join request to link down
+    uint32_t on_us_max;
+} s_radio;
+
+/* Joined with an address: cyw43_wifi_link_status() stops at CYW43_LINK_JOIN */
+static bool wifi_link_up(void) {
+    return cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) == CYW43_LINK_UP;
+}
+
+/* Link state as seen at each poll of an always-on link */
+static void radio_track(bool up) {
+    uint64_t t = time_us_64();
+    if (up == s_radio.link_up) return;
+    if (up) {
+        s_radio.link_since_us = t;
+    } else {
+        s_radio.link_us += t - s_radio.link_since_us;
+        s_radio.link_downs++;
     }
+    s_radio.link_up = up;
 }
 
-void vSGP40Task(void *pvParameters) {
-    (void)pvParameters;
-    uint32_t voc_index = 0;
-    for (;;) {
-        if (xSemaphoreTake(i2c_mutex, portMAX_DELAY) == pdTRUE) {
-            voc_index = SGP40_MeasureVOC(25, 50); // static T/H for now
-            xSemaphoreGive(i2c_mutex);
+#if API_RADIO_DUTY
+/* Join and wait for an address; false if that fails. The radio counts as
+ * on from the request until radio_down(), either way. */
+static bool radio_up(void) {
+    uint64_t t0 = time_us_64();
+    s_radio.link_since_us = t0;
+    if (cyw43_arch_wifi_connect_async(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK) == 0) {
+        while (time_us_64() - t0 < API_RADIO_JOIN_MS * 1000ull) {
+            int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+            if (status == CYW43_LINK_UP) {
+                s_radio.join_us += time_us_64() - t0;
+                s_radio.link_up  = true;
+                return true;
+            }
+            if (status < 0) break;  // failed, no network, bad auth
+            vTaskDelay(pdMS_TO_TICKS(10));
         }
-        if (xSemaphoreTake(g_sensor_data_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            g_sensor_data.voc = voc_index;
-            xSemaphoreGive(g_sensor_data_mutex);
-        }
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
+    s_radio.join_failures++;
+    return false;
 }
 
-void vQMI8658Task(void *pvParameters) {
-    (void)pvParameters;
-    float local_acc[3]  = {0};
-    float local_gyro[3] = {0};
-    unsigned int tim_count = 0;
-    for (;;) {
-        if (xSemaphoreTake(i2c_mutex, portMAX_DELAY) == pdTRUE) {
-            QMI8658_read_xyz(local_acc, local_gyro, &tim_count);
-            xSemaphoreGive(i2c_mutex);
-        }
-        if (xSemaphoreTake(g_sensor_data_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            memcpy(g_sensor_data.acc,  local_acc,  sizeof(local_acc));
-            memcpy(g_sensor_data.gyro, local_gyro, sizeof(local_gyro));
-            xSemaphoreGive(g_sensor_data_mutex);
-        }
-        vTaskDelay(pdMS_TO_TICKS(100));
+/* Close the transport, leave, and wait for the link to go down */
+static void radio_down(void) {
+#if API_COAP
+    coap_client_close(&s_coap);   // the next open resumes the DTLS session
+#else
+    https_client_close();
+#endif
+    cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+    uint64_t t0 = time_us_64();
+    while (wifi_link_up() && time_us_64() - t0 < API_RADIO_LEAVE_MS * 1000ull) {
+        vTaskDelay(pdMS_TO_TICKS(1));
     }
+    uint32_t us = (uint32_t)(time_us_64() - s_radio.link_since_us);
+    s_radio.wakes++;
+    s_radio.on_us += us;
+    if (us > s_radio.on_us_max) s_radio.on_us_max = us;
+    if (s_radio.link_up) s_radio.link_downs++;
+    s_radio.link_up = false;
+}
+#endif
+
+static void upload_time(uint64_t t0) {
+    uint32_t us = (uint32_t)(time_us_64() - t0);
+    s_radio.uploads++;
+    s_radio.post_us += us;
+    if (us > s_radio.post_us_max) s_radio.post_us_max = us;
+}
+
+static bool upload(HttpsBodyFn body, const char *what) {
+    uint64_t t0 = time_us_64();
+    bool ok = post_uplink(body, what);
+    upload_time(t0);
+    return ok;
+}
+
+/* The oldest flash log records: one post, or with MQTT a window of them */
+static bool upload_backlog(void) {
+    uint64_t t0 = time_us_64();
+    bool ok = post_backlog();
+    upload_time(t0);
+    return ok;
 }
 
 void vAPISendTask(void *pvParameters) {
     (void)pvParameters;
-    static char json_buffer[1024];
-    SensorData_t local_data;
 
-    // Wait until Wi-Fi is up
-    while (cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA) != CYW43_LINK_UP) {
+    // Wait until Wi-Fi is up, keeping what is sampled meanwhile in the flash log
+    uplink_init();
+    while (!wifi_link_up()) {
         printf("API Task waiting for Wi-Fi...\n");
         vTaskDelay(pdMS_TO_TICKS(1000));
+        uint32_t t = now_ms();
+        uplink_collect(t);
+        if (uplink_flush_due(t)) uplink_flush_done(false, t);
     }
     printf("API Task: Wi-Fi connected. Starting send loop.\n");
+    wall_clock_start();
+    while (!uplink_transport_init()) {
+        vTaskDelay(pdMS_TO_TICKS(API_POLL_MS));
+    }
+#if API_RADIO_DUTY
+    // Stay joined until SNTP has answered (or a join's worth of time), then leave
+    for (uint32_t t0 = now_ms(); !wall_clock_valid() && now_ms() - t0 < API_RADIO_JOIN_MS;) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+#else
+    radio_track(true);
+#endif
 
+    uint32_t next_stats_ms = now_ms() + API_STATS_PERIOD_MS;
     for (;;) {
-        vTaskDelay(pdMS_TO_TICKS(30000)); // every 30s
+        vTaskDelay(pdMS_TO_TICKS(API_POLL_MS));
+
+        uint32_t t = now_ms();
+        uplink_collect(t);
+#if API_RADIO_DUTY
+        if (uplink_flush_due(t) || uplink_drain_due(t)) {
+            if (radio_up()) {
+                if (uplink_flush_due(t)) uplink_flush_done(upload(uplink_body, "batch"), now_ms());
+                // Catch up on the backlog while the radio is on anyway
+                for (unsigned n = 0; n < API_RADIO_DRAIN_POSTS && uplink_drain_due(now_ms()); n++) {
+                    uplink_drain_done(upload_backlog(), now_ms());
+                }
+            } else if (uplink_flush_due(t)) {
+                uplink_flush_done(false, t);
+            }
+            radio_down();
+        }
+#else
+        bool link_up = wifi_link_up();
+        radio_track(link_up);
+#if API_MQTT
+        // Acks, keep-alive pings and reconnects for the window
+        if (link_up) mqtt_client_poll(&s_mqtt);
+#endif
+        if (uplink_flush_due(t)) {
+            if (link_up) {
+                bool ok = upload(uplink_body, "batch");
+                uplink_flush_done(ok, now_ms());
+            } else {
+                // No point waiting for DNS/connect timeouts: straight to the flash log
+                uplink_flush_done(false, t);
+            }
+        } else if (link_up && uplink_drain_due(t)) {
+            // Catching up after an outage: one large batch (MQTT: a window of them) from flash per poll
+            bool ok = upload_backlog();
+            uplink_drain_done(ok, now_ms());
+        }
+#endif
+
+        if ((int32_t)(t - next_stats_ms) < 0) continue;
+        next_stats_ms = t + API_STATS_PERIOD_MS;
+
+        UplinkStats_t up;
+        HttpsClientStats_t net;
+        uplink_get_stats(&up);
+        https_client_get_stats(&net);
+        uint32_t air     = net.tx_bytes + net.rx_bytes;
+        uint32_t full_hs = net.full_handshakes;
+#if API_MQTT
+        MqttClientStats_t mq;
+        MqttTlsStats_t mtls;
+        mqtt_client_get_stats(&s_mqtt, &mq);
+        mqtt_tls_get_stats(&mtls);
+        air     += mtls.tx_bytes + mtls.rx_bytes;
+        full_hs += mtls.handshakes - mtls.resumed;
+#elif API_COAP
+        CoapClientStats_t co;
+        CoapUdpStats_t cudp;
+        coap_client_get_stats(&s_coap, &co);
+        coap_udp_get_stats(&cudp);
+        air     += cudp.tx_bytes + cudp.rx_bytes;
+        full_hs += cudp.handshakes - cudp.resumed;
+#endif
+        if (up.records_sent > 0) {
+            printf("Uplink: %lu samples in %lu batches (%lu failed, %lu pending, %lu dropped), "
+                   "%lu B/sample on air (%lu B/sample payload), %lu.%03lu full handshakes/sample\n",
+                   (unsigned long)up.records_sent, (unsigned long)up.batches,
+                   (unsigned long)up.failures, (unsigned long)up.pending, (unsigned long)up.dropped,
+                   (unsigned long)(air / up.records_sent),
+                   (unsigned long)(up.payload_bytes / up.records_sent),
+                   (unsigned long)(full_hs / up.records_sent),
+                   (unsigned long)((uint64_t)full_hs * 1000u / up.records_sent % 1000u));
+        }
+        if (s_radio.uploads > 0) {
+            // Compare builds (HTTPS, API_MQTT, API_COAP) on the same batches
+            printf("Radio: %lu uploads, posting avg %lu ms max %lu ms\n", (unsigned long)s_radio.uploads,
+                   (unsigned long)(s_radio.post_us / s_radio.uploads / 1000u),
+                   (unsigned long)(s_radio.post_us_max / 1000u));
+#if API_RADIO_DUTY
+            if (s_radio.wakes > 0) {
+                printf("Radio: %lu wakes (%lu joins failed), link up to down avg %lu ms max %lu ms "
+                       "(join + DHCP avg %lu ms), %lu us on per sample\n",
+                       (unsigned long)s_radio.wakes, (unsigned long)s_radio.join_failures,
+                       (unsigned long)(s_radio.on_us / s_radio.wakes / 1000u),
+                       (unsigned long)(s_radio.on_us_max / 1000u),
+                       (unsigned long)(s_radio.wakes > s_radio.join_failures ?
+                                       s_radio.join_us / (s_radio.wakes - s_radio.join_failures) / 1000u : 0),
+                       (unsigned long)(up.records_sent ? s_radio.on_us / up.records_sent : 0));
+            }
+#else
+            uint64_t link_us = s_radio.link_us + (s_radio.link_up ? time_us_64() - s_radio.link_since_us : 0);
+            printf("Radio: link up %lu s of %lu s (%lu drops), always on: per upload only posting "
+                   "time is known (build with API_RADIO_DUTY to measure it)\n",
+                   (unsigned long)(link_us / 1000000u), (unsigned long)(time_us_64() / 1000000u),
+                   (unsigned long)s_radio.link_downs);
+#endif
+        }
+        if (up.log.capacity > 0) {
+            printf("Uplink log: %lu of %lu records used (%lu%%), %lu samples stored, %lu drained "
+                   "(%lu samples/s), %lu records dropped, %lu erases, %lu flash failures\n",
+                   (unsigned long)up.log.used, (unsigned long)up.log.capacity,
+                   (unsigned long)(up.log.used * 100u / up.log.capacity),
+                   (unsigned long)up.spilled, (unsigned long)up.drained,
+                   (unsigned long)(up.drain_us ? (uint64_t)up.drained * 1000000u / up.drain_us : 0),
+                   (unsigned long)up.log.dropped, (unsigned long)up.log.erases,
+                   (unsigned long)up.log.failures);
+        }
+        if (up.encoded_records > 0) {
+            printf("Uplink encoding %s: %lu us/record\n", uplink_content_type(),
+                   (unsigned long)(up.encode_us / up.encoded_records));
+        }
+
+        // Peak RAM of the uplink path: task stack, libc heap (mbedTLS) and the static buffers
+        struct mallinfo mi = mallinfo();
+        printf("RAM: API stack peak %lu of %lu B, libc heap peak %lu B, FreeRTOS heap min free %lu B, "
+               "HTTPS buffers %lu B\n",
+               (unsigned long)((API_TASK_STACK_WORDS - uxTaskGetStackHighWaterMark(NULL)) * sizeof(StackType_t)),
+               (unsigned long)(API_TASK_STACK_WORDS * sizeof(StackType_t)),
+               (unsigned long)mi.arena,
+               (unsigned long)xPortGetMinimumEverFreeHeapSize(),
+               (unsigned long)net.buffer_bytes);
+        if (net.posts + net.failures > 0) {
+            printf("HTTPS: %lu posts (%lu failed), %lu connects, %lu reused, %lu retried, "
+                   "post avg %lu ms max %lu ms\n",
+                   (unsigned long)net.posts, (unsigned long)net.failures,
+                   (unsigned long)net.connects, (unsigned long)net.reused, (unsigned long)net.retries,
+                   (unsigned long)(net.post_us / (net.posts + net.failures) / 1000u),
+                   (unsigned long)(net.post_us_max / 1000u));
+            printf("HTTPS: largest body %lu B, %lu chunked\n",
+                   (unsigned long)net.body_bytes_max, (unsigned long)net.chunked_posts);
+            printf("TLS: %lu full handshakes (avg %lu ms), %lu resumed (avg %lu ms), %lu refused, "
+                   "%lu sessions saved%s\n",
+                   (unsigned long)net.full_handshakes,
+                   (unsigned long)(net.full_handshakes ? net.full_hs_us / net.full_handshakes / 1000u : 0),
+                   (unsigned long)net.resumed_handshakes,
+                   (unsigned long)(net.resumed_handshakes ? net.resumed_hs_us / net.resumed_handshakes / 1000u : 0),
+                   (unsigned long)net.resume_refused, (unsigned long)net.sessions_saved,
+                   net.session_from_flash ? ", first from flash" : "");
+        }
+#if API_MQTT
+        if (mq.publishes + mq.failures + mq.connect_failures > 0) {
+            printf("MQTT: %lu publishes (%lu refused), %lu acked (avg %lu ms, max %lu ms), "
+                   "%lu in flight (max %lu), %lu retransmitted, %lu discarded unacked, %lu waited for the window\n",
+                   (unsigned long)mq.publishes, (unsigned long)mq.failures, (unsigned long)mq.acked,
+                   (unsigned long)(mq.acked ? mq.ack_ms / mq.acked : 0), (unsigned long)mq.ack_ms_max,
+                   (unsigned long)mq.inflight, (unsigned long)mq.inflight_max,
+                   (unsigned long)mq.retransmits, (unsigned long)mq.discarded,
+                   (unsigned long)mq.window_waits);
+            printf("MQTT: %lu connects (%lu failed, last refusal %u, %lu sessions resumed), %lu pings, "
+                   "%lu ping / %lu ack timeouts, window %lu B\n",
+                   (unsigned long)mq.connects, (unsigned long)mq.connect_failures,
+                   (unsigned)mq.last_refusal, (unsigned long)mq.sessions_resumed,
+                   (unsigned long)mq.pings, (unsigned long)mq.ping_timeouts,
+                   (unsigned long)mq.ack_timeouts, (unsigned long)sizeof(s_mqtt.slots));
+            printf("TLS (MQTT): %lu handshakes (%lu resumed, avg %lu ms), %lu B sent, %lu B received\n",
+                   (unsigned long)mtls.handshakes, (unsigned long)mtls.resumed,
+                   (unsigned long)(mtls.handshakes ? mtls.hs_us / mtls.handshakes / 1000u : 0),
+                   (unsigned long)mtls.tx_bytes, (unsigned long)mtls.rx_bytes);
+        }
+#elif API_COAP
+        if (co.posts + co.failures > 0) {
+            printf("CoAP: %lu posts (%lu failed, last %u), %lu blocks of %u B, %lu retransmitted, "
+                   "%lu timeouts, %lu separate, %lu resets, post avg %lu ms max %lu ms\n",
+                   (unsigned long)co.posts, (unsigned long)co.failures, (unsigned)co.last_code,
+                   (unsigned long)co.blocks, (unsigned)co.block_size, (unsigned long)co.retransmits,
+                   (unsigned long)co.timeouts, (unsigned long)co.separate, (unsigned long)co.resets,
+                   (unsigned long)(co.post_ms / (co.posts + co.failures)), (unsigned long)co.post_ms_max);
+            printf("%s (CoAP): %lu handshakes (%lu resumed, avg %lu ms), %lu/%lu datagrams, "
+                   "%lu B sent, %lu B received\n", API_COAP_DTLS ? "DTLS" : "UDP",
+                   (unsigned long)cudp.handshakes, (unsigned long)cudp.resumed,
+                   (unsigned long)(cudp.handshakes ? cudp.hs_us / cudp.handshakes / 1000u : 0),
+                   (unsigned long)cudp.datagrams_tx, (unsigned long)cudp.datagrams_rx,
+                   (unsigned long)cudp.tx_bytes, (unsigned long)cudp.rx_bytes);
+        }
+#endif
 
-        if (xSemaphoreTake(g_sensor_data_mutex, portMAX_DELAY) == pdTRUE) {
-            memcpy(&local_data, &g_sensor_data, sizeof(SensorData_t));
-            xSemaphoreGive(g_sensor_data_mutex);
+        MetricsServerStats_t ms;
+        metrics_server_get_stats(&ms);
+        if (ms.scrapes + ms.not_found + ms.errors > 0) {
+            printf("Metrics: %lu scrapes (%lu not found, %lu failed), last %lu B, avg %lu ms max %lu ms\n",
+                   (unsigned long)ms.scrapes, (unsigned long)ms.not_found, (unsigned long)ms.errors,
+                   (unsigned long)ms.last_bytes,
+                   (unsigned long)(ms.scrapes ? ms.scrape_us / ms.scrapes / 1000u : 0),
+                   (unsigned long)(ms.scrape_us_max / 1000u));
         }
 
-        // Build JSON
-        snprintf(json_buffer, sizeof(json_buffer),
-                 "{"
-                 "\"temperature\":%.2f,"
-                 "\"humidity\":%.2f,"
-                 "\"voc\":%lu,"
-                 "\"light\":%u,"
-                 "\"sound\":%u,"
-                 "\"accelerometer\":{\"x\":%.2f,\"y\":%.2f,\"z\":%.2f},"
-                 "\"gyroscope\":{\"x\":%.2f,\"y\":%.2f,\"z\":%.2f}"
-                 "}",
-                 local_data.temp, local_data.hum,
-                 (unsigned long)local_data.voc,
-                 (unsigned)local_data.light, (unsigned)local_data.sound,
-                 local_data.acc[0], local_data.acc[1], local_data.acc[2],
-                 local_data.gyro[0], local_data.gyro[1], local_data.gyro[2]);
-
-        printf("Sending JSON to API:\n%s\n", json_buffer);
-        https_post(API_HOST, API_PATH, json_buffer);
+        AdcEngineStats_t adc;
+        adc_engine_get_stats(&adc);
+        if (adc.uptime_us > 0) {
+            printf("ADC: %lu windows, %lu dropped, task %lu.%02lu%% CPU, irq %lu.%02lu%% CPU\n",
+                   (unsigned long)adc.windows, (unsigned long)adc.dropped_windows,
+                   (unsigned long)(adc.busy_us * 100 / adc.uptime_us),
+                   (unsigned long)(adc.busy_us * 10000 / adc.uptime_us % 100),
+                   (unsigned long)(adc.irq_us * 100 / adc.uptime_us),
+                   (unsigned long)(adc.irq_us * 10000 / adc.uptime_us % 100));
+        }
+
+        I2cBusStats_t bus;
+        i2c_bus_get_stats(&bus);
+        for (int p = 0; p < I2C_PRIO_COUNT; p++) {
+            if (bus.completed[p] == 0) continue;
+            printf("I2C prio %d: %lu done, depth %lu (max %lu), wait avg %lu us max %lu us\n", p,
+                   (unsigned long)bus.completed[p],
+                   (unsigned long)bus.queue_depth[p], (unsigned long)bus.queue_depth_max[p],
+                   (unsigned long)(bus.wait_us_total[p] / bus.completed[p]),
+                   (unsigned long)bus.wait_us_max[p]);
+        }
+        printf("I2C: %lu errors, %lu max deferred, bus busy %lu ms\n",
+               (unsigned long)bus.errors, (unsigned long)bus.deferred_max,
+               (unsigned long)(bus.bus_busy_us / 1000));
+
+        ImuStreamStats_t imu;
+        imu_stream_get_stats(&imu);
+        printf("IMU: %lu samples in %lu drains (max %lu), %lu FIFO overflows, period %lu us\n",
+               (unsigned long)imu.samples, (unsigned long)imu.batches,
+               (unsigned long)imu.max_batch, (unsigned long)imu.fifo_overflows,
+               (unsigned long)imu.period_us);
+
+        uint32_t fus_n;
+        uint64_t fus_us;
+        taskENTER_CRITICAL();
+        fus_n  = s_fusion_cost.updates;
+        fus_us = s_fusion_cost.busy_us;
+        taskEXIT_CRITICAL();
+        if (fus_n > 0) {
+            printf("Fusion: %lu updates, %lu.%02lu us/update\n", (unsigned long)fus_n,
+                   (unsigned long)(fus_us / fus_n), (unsigned long)(fus_us * 100 / fus_n % 100));
+        }
+
+        ImuIrqStats_t irq;
+        imu_irq_get_stats(&irq);
+        printf("IMU IRQ: INT1 %lu, INT2 %lu (%lu coalesced), wake latency max %lu us\n",
+               (unsigned long)irq.edges[IMU_IRQ_INT1], (unsigned long)irq.edges[IMU_IRQ_INT2],
+               (unsigned long)irq.coalesced[IMU_IRQ_INT2], (unsigned long)irq.wake_us_max);
+
+        uint32_t wom_sleeps, wom_ms;
+        bool wom_asleep;
+        taskENTER_CRITICAL();
+        wom_sleeps = s_imu_wom.sleeps;
+        wom_asleep = s_imu_wom.asleep;
+        wom_ms     = s_imu_wom.asleep_ms + (wom_asleep ? now_ms() - s_imu_wom.since_ms : 0);
+        taskEXIT_CRITICAL();
+        printf("IMU WoM: %lu sleeps, %lu s asleep%s\n", (unsigned long)wom_sleeps,
+               (unsigned long)(wom_ms / 1000u), wom_asleep ? " (asleep now)" : "");
+
+        VocStateStats_t voc;
+        FlashStoreStats_t fls;
+        voc_state_get_stats(&voc);
+        flash_store_get_stats(&fls);
+        uint32_t voc_samples, voc_late;
+        taskENTER_CRITICAL();
+        voc_samples = s_voc_sched.samples;
+        voc_late    = s_voc_sched.late;
+        taskEXIT_CRITICAL();
+        printf("VOC: %lu samples every %lu ms, %lu late, heater %s\n",
+               (unsigned long)voc_samples, (unsigned long)SGP40_SAMPLE_PERIOD_MS,
+               (unsigned long)voc_late, SGP40_LOW_POWER ? "off between samples" : "always on");
+        printf("VOC state: %s (age %lu s), %lu saves, %lu failed; flash %lu writes, %lu erases\n",
+               voc.restored ? "restored" : "cold start", (unsigned long)voc.restored_age_s,
+               (unsigned long)voc.saves, (unsigned long)voc.save_failures,
+               (unsigned long)fls.writes, (unsigned long)fls.erases);
+
+        DEV_I2C_Stats dma_i2c;
+        DEV_I2C_Get_Stats(SENSOR_I2C_PORT, &dma_i2c);
+        if (dma_i2c.bus_us > 0) {
+            printf("I2C DMA: %lu xfers, %lu bytes, %lu aborts, %lu timeouts, CPU %lu us of %lu us on the bus\n",
+                   (unsigned long)dma_i2c.transfers, (unsigned long)dma_i2c.bytes,
+                   (unsigned long)dma_i2c.aborts, (unsigned long)dma_i2c.timeouts,
+                   (unsigned long)dma_i2c.cpu_us, (unsigned long)dma_i2c.bus_us);
+        }
     }
 }
 
@@ -415,32 +918,50 @@ int main(void) {
     }
     printf("DEV_Module_Init OK\r\n");
 
-    // ADC init
-    adc_init();
-    adc_gpio_init(LIGHT_SENSOR_PIN);
-    adc_gpio_init(SOUND_SENSOR_PIN);
-
-    // Mutexes
-    i2c_mutex           = xSemaphoreCreateMutex();
-    g_sensor_data_mutex = xSemaphoreCreateMutex();
-
-    // I2C sensors init (protected)
-    xSemaphoreTake(i2c_mutex, portMAX_DELAY);
+    // I2C sensors init (scheduler not running yet, so the bus is ours)
     SHTC3_Init();
     SGP40_init();
     QMI8658_init();
-    xSemaphoreGive(i2c_mutex);
+    if (!QMI8658_config_fifo(IMU_FIFO_WATERMARK, QMI8658_FifoSize_128, QMI8658_FifoMode_Stream)) {
+        printf("QMI8658 FIFO reset not acknowledged\r\n");
+    }
+    QMI8658_config_interrupts(QMI8658_CTRL1_INT1_ENABLE | QMI8658_CTRL1_INT2_ENABLE);
     printf("I2C Sensors Init OK\r\n");
 
+    // State records in flash (VOC algorithm, TLS session); scanned before any task reads them
+    flash_store_init();
+
+    // Sensor I2C bus manager; above the sensor tasks so queued reads start promptly
+    if (!i2c_bus_init(4)) {
+        printf("I2C bus manager init failed\n");
+    }
+
     // Tasks
     xTaskCreate(vSHTC3Task,       "SHTC3Task",   256,  NULL, 1, NULL);
     xTaskCreate(vSGP40Task,       "SGP40Task",   256,  NULL, 1, NULL);
-    xTaskCreate(vQMI8658Task,     "QMI8658Task", 256,  NULL, 1, NULL);
-    xTaskCreate(vLightSensorTask, "LightTask",   256,  NULL, 1, NULL);
-    xTaskCreate(vSoundSensorTask, "SoundTask",   256,  NULL, 1, NULL);
+    // IMU: woken by the FIFO watermark; shares priority with the API task so
+    // a long TLS handshake cannot starve it past the FIFO depth
+    TaskHandle_t imu_task = NULL;
+    xTaskCreate(vQMI8658Task,     "QMI8658Task", 256,  NULL, 3, &imu_task);
+    s_imu_wom_ok = imu_irq_init(imu_task);
+    if (!s_imu_wom_ok) {
+        printf("IMU interrupt init failed\n");
+    }
+
+    // Light + sound + MCU temp: DMA-fed ADC engine (creates its own task)
+    if (!adc_engine_start(ADC_ENGINE_RATE_HZ, 2)) {
+        printf("ADC engine init failed\n");
+    }
 
     // HTTPS task needs bigger stack
-    xTaskCreate(vAPISendTask,     "APITask",    8192,  NULL, 3, NULL);
+    xTaskCreate(vAPISendTask,     "APITask",    API_TASK_STACK_WORDS, NULL, 3, NULL);
+
+    // Prometheus /metrics on port METRICS_SERVER_PORT. Below the sensors
+    // (SHTC3 and SGP40 are at 1), next to the idle task, which yields to
+    // it: rendering a scrape must not delay the 1 Hz VOC sampling
+    if (!metrics_server_start(tskIDLE_PRIORITY)) {
+        printf("Metrics server init failed\n");
+    }
 
     printf("Starting Scheduler...\n");
     vTaskStartScheduler();
@@ -0,0 +1,218 @@
+/* src/adc_engine.c — see adc_engine.h.
+ *
+ * Two DMA channels are chained to each other, so the hardware alternates
+ * between buffers with no CPU involvement. The IRQ only re-arms the write
+ * address of the channel that just finished and wakes the task. The task
+ * always processes the newest complete buffer; if it ever falls a whole
+ * window behind, the skipped windows are counted in dropped_windows, so
+ * the CPU cost per window stays fixed.
+ *
+ * Decimators keep their accumulators across windows, so an output rate does
+ * not have to divide the window length.
+ */
+#include "adc_engine.h"
+
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "sensor_data.h"
+#include "sensor_history.h"
+
+#define ADC_LIGHT_PIN     26 // ADC 0
+#define ADC_SOUND_PIN     27 // ADC 1
+#define ADC_TEMP_INPUT    4  // internal temperature sensor
+#define ADC_BUF_WORDS     (ADC_CH_COUNT * ADC_ENGINE_WINDOW_SAMPLES)
+
+typedef struct {
+    uint32_t decim;  // raw samples per output
+    uint32_t acc;
+    uint32_t count;
+} AdcDecimator_t;
+
+static uint16_t s_buf[2][ADC_BUF_WORDS] __attribute__((aligned(4)));
+static int      s_dma[2] = { -1, -1 };
+static TaskHandle_t s_task;
+static AdcDecimator_t s_decim[ADC_CH_COUNT];
+
+/* Written by the IRQ only */
+static volatile uint32_t s_filled;   // buffers completed since start
+static volatile uint64_t s_irq_us;
+
+static AdcEngineStats_t s_stats;
+
+static void adc_dma_irq_handler(void) {
+    uint32_t t0 = time_us_32();
+    BaseType_t woken = pdFALSE;
+
+    for (int i = 0; i < 2; i++) {
+        if (dma_channel_get_irq0_status((uint)s_dma[i])) {
+            dma_channel_acknowledge_irq0((uint)s_dma[i]);
+            dma_channel_set_write_addr((uint)s_dma[i], s_buf[i], false);
+            s_filled++;
+            vTaskNotifyGiveFromISR(s_task, &woken);
+        }
+    }
+    s_irq_us += time_us_32() - t0;
+    portYIELD_FROM_ISR(woken);
+}
+
+static void dma_setup(void) {
+    for (int i = 0; i < 2; i++) {
+        s_dma[i] = (int)dma_claim_unused_channel(true);
+    }
+    for (int i = 0; i < 2; i++) {
+        dma_channel_config c = dma_channel_get_default_config((uint)s_dma[i]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, true);
+        channel_config_set_dreq(&c, DREQ_ADC);
+        channel_config_set_chain_to(&c, (uint)s_dma[i ^ 1]);
+        dma_channel_configure((uint)s_dma[i], &c, s_buf[i], &adc_hw->fifo,
+                              ADC_BUF_WORDS, false);
+        dma_channel_set_irq0_enabled((uint)s_dma[i], true);
+    }
+    irq_add_shared_handler(DMA_IRQ_0, adc_dma_irq_handler,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+
+static void adc_setup(uint32_t rate_hz) {
+    adc_init();
+    adc_gpio_init(ADC_LIGHT_PIN);
+    adc_gpio_init(ADC_SOUND_PIN);
+    adc_set_temp_sensor_enabled(true);
+    adc_select_input(0); // round-robin starts at the lowest input
+    adc_set_round_robin((1u << 0) | (1u << 1) | (1u << ADC_TEMP_INPUT));
+    adc_fifo_setup(true,   // write conversions to the FIFO
+                   true,   // DREQ for DMA
+                   1,      // DREQ as soon as one sample is there
+                   false,  // no error bit (keeps samples 12-bit)
+                   false); // no byte shift
+    /* ADC clock is 48 MHz; one conversion every (1 + div) cycles */
+    adc_set_clkdiv(48000000.f / (float)(rate_hz * ADC_CH_COUNT) - 1.f);
+}
+
+/* RP2040 datasheet 4.9.5: T = 27 - (V - 0.706) / 0.001721 */
+static float mcu_temp_from_raw(uint32_t raw) {
+    float v = (float)raw * (3.3f / 4096.f);
+    return 27.f - (v - 0.706f) / 0.001721f;
+}
+
+static void stream_emit(AdcChannel_t ch, uint32_t t_ms, uint32_t raw) {
+    switch (ch) {
+    case ADC_CH_LIGHT:
+        sensor_data_publish_light((uint16_t)raw);
+        sensor_history_push(SENSOR_CH_LIGHT, t_ms, (float)raw);
+        break;
+    case ADC_CH_MCU_TEMP:
+        sensor_history_push(SENSOR_CH_MCU_TEMP, t_ms, mcu_temp_from_raw(raw));
+        break;
+    default:
+        break;
+    }
+}
+
+/* Boxcar decimation of one de-interleaved channel. t_end_ms is the time of
+ * the last sample in the window; earlier outputs are back-dated from it. */
+static uint32_t decimate(AdcChannel_t ch, const uint16_t *buf, uint32_t rate_hz, uint32_t t_end_ms) {
+    AdcDecimator_t *d = &s_decim[ch];
+    uint32_t emitted = 0;
+
+    for (uint32_t i = 0; i < ADC_ENGINE_WINDOW_SAMPLES; i++) {
+        d->acc += buf[i * ADC_CH_COUNT + ch] & 0x0FFFu;
+        if (++d->count == d->decim) {
+            uint32_t age_ms = (ADC_ENGINE_WINDOW_SAMPLES - 1u - i) * 1000u / rate_hz;
+            stream_emit(ch, t_end_ms - age_ms, d->acc / d->decim);
+            d->acc = 0;
+            d->count = 0;
+            emitted++;
+        }
+    }
+    return emitted;
+}
+
+static void vAdcEngineTask(void *pvParameters) {
+    (void)pvParameters;
+    SoundLeq_t leq;
+    uint32_t processed = 0;
+    uint32_t rate_hz = s_stats.rate_hz;
+    uint64_t started_us = time_us_64();
+    uint32_t leq_start_ms = to_ms_since_boot(get_absolute_time());
+
+    sound_leq_reset(&leq);
+    dma_channel_start((uint)s_dma[0]);
+    adc_run(true);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint32_t t0 = time_us_32();
+        uint32_t filled = s_filled;
+        if (filled == processed) continue;
+
+        /* Buffers alternate 0,1,0,... so the newest one is (filled - 1) & 1 */
+        const uint16_t *buf = s_buf[(filled - 1u) & 1u];
+        uint32_t dropped = filled - processed - 1u;
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        uint32_t out[ADC_CH_COUNT] = {0};
+        processed = filled;
+
+        out[ADC_CH_LIGHT]    = decimate(ADC_CH_LIGHT, buf, rate_hz, now);
+        out[ADC_CH_MCU_TEMP] = decimate(ADC_CH_MCU_TEMP, buf, rate_hz, now);
+
+        SoundWindow_t w;
+        sound_level_window(&buf[ADC_CH_SOUND], ADC_ENGINE_WINDOW_SAMPLES, ADC_CH_COUNT, &w);
+        sound_leq_add(&leq, &w);
+
+        int32_t leq_cdb = -1;
+        if (now - leq_start_ms >= ADC_SOUND_LEQ_PERIOD_MS) {
+            leq_cdb = sound_leq_cdb(&leq);
+            sound_leq_reset(&leq);
+            leq_start_ms = now;
+            /* `sound` and its history carry Leq in 0.1 dB re 1 LSB */
+            uint16_t leq_ddb = (uint16_t)((leq_cdb + 5) / 10);
+            sensor_data_publish_sound(leq_ddb);
+            sensor_history_push(SENSOR_CH_SOUND, now, (float)leq_ddb);
+            out[ADC_CH_SOUND] = 1;
+        }
+
+        uint32_t busy = time_us_32() - t0;
+        taskENTER_CRITICAL();
+        s_stats.windows++;
+        s_stats.dropped_windows += dropped;
+        for (int ch = 0; ch < ADC_CH_COUNT; ch++) s_stats.outputs[ch] += out[ch];
+        s_stats.busy_us         += busy;
+        s_stats.irq_us           = s_irq_us;
+        s_stats.uptime_us        = time_us_64() - started_us;
+        s_stats.sound_last       = w;
+        if (leq_cdb >= 0) s_stats.sound_leq_cdb = leq_cdb;
+        taskEXIT_CRITICAL();
+    }
+}
+
+bool adc_engine_start(uint32_t rate_hz, unsigned task_priority) {
+    if (rate_hz == 0) rate_hz = ADC_ENGINE_RATE_HZ;
+    /* 500 ksps ADC limit shared by all inputs */
+    if (rate_hz * ADC_CH_COUNT > 500000u) return false;
+    if (rate_hz < ADC_LIGHT_RATE_HZ || rate_hz < ADC_MCU_TEMP_RATE_HZ) return false;
+
+    s_stats.rate_hz = rate_hz;
+    s_decim[ADC_CH_LIGHT].decim    = rate_hz / ADC_LIGHT_RATE_HZ;
+    s_decim[ADC_CH_MCU_TEMP].decim = rate_hz / ADC_MCU_TEMP_RATE_HZ;
+    if (xTaskCreate(vAdcEngineTask, "ADCTask", 512, NULL, task_priority, &s_task) != pdPASS) {
+        return false;
+    }
+    adc_setup(rate_hz);
+    dma_setup();
+    return true;
+}
+
+void adc_engine_get_stats(AdcEngineStats_t *out) {
+    taskENTER_CRITICAL();
+    *out = s_stats;
+    taskEXIT_CRITICAL();
+}
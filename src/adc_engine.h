@@ -0,0 +1,70 @@
+/* src/adc_engine.h — single owner of the RP2040 ADC.
+ *
+ * The ADC free-runs in hardware round-robin over every configured input
+ * (light on ADC0/GPIO26, sound on ADC1/GPIO27, the internal temperature
+ * sensor on ADC4). Two chained DMA channels move the FIFO into ping-pong
+ * buffers; one task de-interleaves each full buffer and feeds per-channel
+ * streams:
+ *   - light and MCU temperature are boxcar-decimated to their own output
+ *     rate and pushed to sensor_history (plus sensor_data for light);
+ *   - sound is analysed per window (RMS/peak/level) and published as Leq.
+ * Nothing else may call adc_select_input()/adc_read().
+ */
+#ifndef ADC_ENGINE_H
+#define ADC_ENGINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sound_level.h"
+
+/* Raw conversion rate per input; the ADC runs at this times ADC_CH_COUNT. */
+#ifndef ADC_ENGINE_RATE_HZ
+#define ADC_ENGINE_RATE_HZ 16000u
+#endif
+
+/* Samples per input per window / ping-pong buffer (64 ms at 16 kHz). */
+#ifndef ADC_ENGINE_WINDOW_SAMPLES
+#define ADC_ENGINE_WINDOW_SAMPLES 1024u
+#endif
+
+/* Decimated output rates of the slow channels. */
+#ifndef ADC_LIGHT_RATE_HZ
+#define ADC_LIGHT_RATE_HZ 10u
+#endif
+#ifndef ADC_MCU_TEMP_RATE_HZ
+#define ADC_MCU_TEMP_RATE_HZ 1u
+#endif
+
+/* Leq integration period for the published `sound` value. */
+#ifndef ADC_SOUND_LEQ_PERIOD_MS
+#define ADC_SOUND_LEQ_PERIOD_MS 1000u
+#endif
+
+/* Round-robin slots, in ADC input order. */
+typedef enum {
+    ADC_CH_LIGHT = 0,   // ADC0
+    ADC_CH_SOUND,       // ADC1
+    ADC_CH_MCU_TEMP,    // ADC4 (internal sensor)
+    ADC_CH_COUNT
+} AdcChannel_t;
+
+typedef struct {
+    uint32_t      rate_hz;                 // raw rate per input
+    uint32_t      windows;                 // windows processed
+    uint32_t      dropped_windows;         // windows overwritten before they were processed
+    uint32_t      outputs[ADC_CH_COUNT];   // samples emitted per stream
+    uint64_t      busy_us;                 // task time spent processing windows
+    uint64_t      irq_us;                  // time spent in the DMA IRQ handler
+    uint64_t      uptime_us;               // engine running time, for busy/irq load
+    SoundWindow_t sound_last;              // most recent sound window
+    int32_t       sound_leq_cdb;           // last published Leq, 0.01 dB
+} AdcEngineStats_t;
+
+/* Configure ADC + DMA and create the engine task, which starts the capture
+ * once the scheduler runs. rate_hz = 0 selects ADC_ENGINE_RATE_HZ. */
+bool adc_engine_start(uint32_t rate_hz, unsigned task_priority);
+
+void adc_engine_get_stats(AdcEngineStats_t *out);
+
+#endif /* ADC_ENGINE_H */
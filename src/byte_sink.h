@@ -0,0 +1,25 @@
+/* src/byte_sink.h — a window of bytes that is drained as it fills.
+ *
+ * A producer writes at buf + len (at most cap - len bytes) and advances
+ * len. When the next piece does not fit it calls flush(), which hands
+ * buf[0, len) on (e.g. to mbedtls_ssl_write) and resets len to 0. A flush
+ * that sends fixed-size blocks may instead keep a tail shorter than a block
+ * at the start of buf. A sink with no flush is a plain fixed buffer: the
+ * producer stops when it is full.
+ */
+#ifndef BYTE_SINK_H
+#define BYTE_SINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ByteSink {
+    uint8_t *buf;
+    size_t   cap;
+    size_t   len;
+    bool   (*flush)(struct ByteSink *sink);  // false aborts the producer
+    void    *ctx;
+} ByteSink_t;
+
+#endif /* BYTE_SINK_H */
@@ -0,0 +1,387 @@
+/* src/coap_client.c — see coap_client.h.
+ *
+ * Each request (one Block1 block) is built in c->tx behind a fresh message
+ * id and token and kept there for its retransmissions. A fresh token per
+ * block keeps a late duplicate of one block's separate response from being
+ * taken as the answer to the next.
+ */
+#include "coap_client.h"
+
+#include <string.h>
+
+#define COAP_VERSION   1u
+#define TYPE_CON       0u
+#define TYPE_NON       1u
+#define TYPE_ACK       2u
+#define TYPE_RST       3u
+
+/* Codes: class << 5 | detail */
+#define CODE_EMPTY     0x00u
+#define CODE_POST      0x02u
+#define CODE_CONTINUE  0x5Fu  // 2.31
+#define CODE_CLASS_RESPONSE 2u
+
+#define OPT_URI_PATH       11u
+#define OPT_CONTENT_FORMAT 12u
+#define OPT_BLOCK1         27u
+#define PAYLOAD_MARKER     0xFFu
+
+#define TOKEN_LEN 4u
+
+_Static_assert(COAP_CLIENT_BLOCK_SIZE >= 16u && COAP_CLIENT_BLOCK_SIZE <= 1024u &&
+               (COAP_CLIENT_BLOCK_SIZE & (COAP_CLIENT_BLOCK_SIZE - 1u)) == 0,
+               "Block1 sizes are powers of two from 16 to 1024");
+
+/* A received message, as far as the client cares */
+typedef struct {
+    uint8_t  type;
+    uint8_t  code;
+    uint16_t mid;
+    uint8_t  tkl;
+    uint32_t token;       // if tkl == TOKEN_LEN
+    bool     has_block1;
+    uint32_t block1;      // NUM << 4 | M << 3 | SZX
+} Msg_t;
+
+/* State of one post */
+typedef struct {
+    CoapClient_t *c;
+    const char   *path;
+    uint16_t      format;
+    size_t        block;     // current block size
+    size_t        offset;    // body bytes acknowledged
+    int           code;      // response that ended the post early, -1 if none
+    bool          lost;      // no response; the transport is suspect
+} PostCtx_t;
+
+static uint32_t next_rand(CoapClient_t *c) {
+    uint32_t x = c->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return c->rng = x;
+}
+
+static unsigned szx_of(size_t block) {
+    unsigned szx = 0;
+    while ((16u << szx) < block) szx++;
+    return szx;
+}
+
+static int code_number(uint8_t code) {
+    return (code >> 5) * 100 + (code & 0x1Fu);
+}
+
+/* ====================================================================
+   --- Encoding ---
+   ==================================================================== */
+
+/* Option delta or length nibble, with its extended bytes at *ext */
+static uint8_t put_nibble(uint8_t *ext, size_t *n, uint32_t v) {
+    if (v < 13u) return (uint8_t)v;
+    if (v < 269u) {
+        ext[(*n)++] = (uint8_t)(v - 13u);
+        return 13u;
+    }
+    ext[(*n)++] = (uint8_t)((v - 269u) >> 8);
+    ext[(*n)++] = (uint8_t)(v - 269u);
+    return 14u;
+}
+
+static size_t put_option(uint8_t *p, uint16_t *last, uint16_t num, const uint8_t *val, size_t len) {
+    uint8_t ext[4];
+    size_t  n = 0;
+    uint8_t d = put_nibble(ext, &n, (uint32_t)(num - *last));
+    uint8_t l = put_nibble(ext, &n, (uint32_t)len);
+    p[0] = (uint8_t)(d << 4 | l);
+    memcpy(p + 1, ext, n);
+    memcpy(p + 1 + n, val, len);
+    *last = num;
+    return 1u + n + len;
+}
+
+/* Unsigned option value in its shortest big-endian form (0: no bytes) */
+static size_t put_uint_option(uint8_t *p, uint16_t *last, uint16_t num, uint32_t v) {
+    uint8_t b[4];
+    size_t  len = 0;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if (len > 0 || (v >> shift) != 0) b[len++] = (uint8_t)(v >> shift);
+    }
+    return put_option(p, last, num, b, len);
+}
+
+/* POST header and options into c->tx; returns their length */
+static size_t build_request(PostCtx_t *p, uint16_t mid, uint32_t token, bool block1,
+                            uint32_t num, bool more) {
+    uint8_t *m = p->c->tx;
+    uint16_t last = 0;
+    size_t   n = 0;
+
+    m[n++] = (uint8_t)(COAP_VERSION << 6 | TYPE_CON << 4 | TOKEN_LEN);
+    m[n++] = CODE_POST;
+    m[n++] = (uint8_t)(mid >> 8);
+    m[n++] = (uint8_t)mid;
+    for (unsigned i = 0; i < TOKEN_LEN; i++) m[n++] = (uint8_t)(token >> (24 - 8 * i));
+
+    for (const char *seg = p->path; *seg != '\0';) {
+        size_t len = strcspn(seg, "/");
+        if (len > 0) n += put_option(&m[n], &last, OPT_URI_PATH, (const uint8_t *)seg, len);
+        seg += len;
+        if (*seg == '/') seg++;
+    }
+    n += put_uint_option(&m[n], &last, OPT_CONTENT_FORMAT, p->format);
+    if (block1) {
+        uint32_t v = num << 4 | (more ? 0x08u : 0u) | szx_of(p->block);
+        n += put_uint_option(&m[n], &last, OPT_BLOCK1, v);
+    }
+    return n;
+}
+
+/* ====================================================================
+   --- Decoding ---
+   ==================================================================== */
+
+static bool get_ext(const uint8_t *m, size_t len, size_t *i, uint32_t *v) {
+    if (*v == 13u) {
+        if (*i + 1u > len) return false;
+        *v = 13u + m[*i];
+        *i += 1u;
+    } else if (*v == 14u) {
+        if (*i + 2u > len) return false;
+        *v = 269u + ((uint32_t)m[*i] << 8 | m[*i + 1u]);
+        *i += 2u;
+    } else if (*v == 15u) {
+        return false;
+    }
+    return true;
+}
+
+static bool parse(const uint8_t *m, size_t len, Msg_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (len < 4u || (m[0] >> 6) != COAP_VERSION) return false;
+    out->type = (uint8_t)((m[0] >> 4) & 3u);
+    out->tkl  = (uint8_t)(m[0] & 0x0Fu);
+    out->code = m[1];
+    out->mid  = (uint16_t)(m[2] << 8 | m[3]);
+    if (out->tkl > 8u || 4u + out->tkl > len) return false;
+    for (unsigned i = 0; out->tkl == TOKEN_LEN && i < TOKEN_LEN; i++) {
+        out->token = out->token << 8 | m[4u + i];
+    }
+
+    size_t   i = 4u + out->tkl;
+    uint32_t num = 0;
+    while (i < len && m[i] != PAYLOAD_MARKER) {
+        uint32_t delta = m[i] >> 4, olen = m[i] & 0x0Fu;
+        i++;
+        if (!get_ext(m, len, &i, &delta) || !get_ext(m, len, &i, &olen) || olen > len - i) return false;
+        num += delta;
+        if (num == OPT_BLOCK1 && olen <= 3u) {
+            out->has_block1 = true;
+            for (uint32_t k = 0; k < olen; k++) out->block1 = out->block1 << 8 | m[i + k];
+        }
+        i += olen;
+    }
+    return true;
+}
+
+/* ====================================================================
+   --- Exchange ---
+   ==================================================================== */
+
+static bool send_msg(CoapClient_t *c, const uint8_t *buf, size_t len) {
+    if (!c->tp->send(c->tp->ctx, buf, len)) return false;
+    c->stats.tx_bytes += (uint32_t)len;
+    return true;
+}
+
+/* Empty ACK (or RST) for a confirmable message from the server */
+static void send_empty(CoapClient_t *c, uint8_t type, uint16_t mid) {
+    uint8_t m[4] = { (uint8_t)(COAP_VERSION << 6 | type << 4), CODE_EMPTY, (uint8_t)(mid >> 8), (uint8_t)mid };
+    send_msg(c, m, sizeof(m));
+}
+
+/* Send the len bytes in c->tx as a confirmable request and wait for its
+ * response. False if none came (p->lost is set). */
+static bool request(PostCtx_t *p, size_t len, uint16_t mid, uint32_t token, Msg_t *resp) {
+    CoapClient_t *c = p->c;
+    const CoapTransport_t *tp = c->tp;
+    uint32_t timeout = COAP_CLIENT_ACK_TIMEOUT_MS +
+                       next_rand(c) % (COAP_CLIENT_ACK_TIMEOUT_MS / 2u + 1u);
+    uint32_t deadline = tp->now_ms() + timeout;
+    unsigned retries = 0;
+    bool     acked = false;  // empty ACK: the response comes separately
+
+    c->stats.blocks++;
+    if (!send_msg(c, c->tx, len)) goto lost;
+    for (;;) {
+        uint32_t now = tp->now_ms();
+        if ((int32_t)(deadline - now) <= 0) {
+            if (acked || retries == COAP_CLIENT_MAX_RETRANSMIT) {
+                c->stats.timeouts++;
+                goto lost;
+            }
+            retries++;
+            timeout *= 2u;
+            deadline = now + timeout;
+            c->stats.retransmits++;
+            if (!send_msg(c, c->tx, len)) goto lost;
+            continue;
+        }
+
+        int n = tp->recv(tp->ctx, c->rx, sizeof(c->rx), deadline - now);
+        if (n < 0) goto lost;
+        if (n == 0) continue;
+        c->stats.rx_bytes += (uint32_t)n;
+
+        Msg_t m;
+        if (!parse(c->rx, (size_t)n, &m)) continue;
+        bool ours = m.tkl == TOKEN_LEN && m.token == token;
+        if ((m.type == TYPE_ACK || m.type == TYPE_RST) && m.mid == mid) {
+            if (m.type == TYPE_RST) {
+                c->stats.resets++;
+                goto lost;
+            }
+            if (m.code == CODE_EMPTY) {
+                acked    = true;
+                deadline = tp->now_ms() + COAP_CLIENT_RESPONSE_TIMEOUT_MS;
+                continue;
+            }
+            if (!ours) continue;
+            *resp = m;
+            return true;
+        }
+        if (m.type == TYPE_CON || m.type == TYPE_NON) {
+            // Separate responses are acknowledged even when they are late
+            // duplicates; anything else from the server is refused
+            bool response = (m.code >> 5) >= CODE_CLASS_RESPONSE;
+            if (m.type == TYPE_CON) send_empty(c, response ? TYPE_ACK : TYPE_RST, m.mid);
+            if (!response || !ours) continue;
+            c->stats.separate++;
+            *resp = m;
+            return true;
+        }
+    }
+
+lost:
+    p->lost = true;
+    return false;
+}
+
+/* Send one block of the body and wait for its response. An intermediate
+ * block must get 2.31 Continue; anything else ends the post with that
+ * code. True if the post goes on (or, for the last block, got an answer). */
+static bool send_block(PostCtx_t *p, const uint8_t *data, size_t len, bool more) {
+    CoapClient_t *c = p->c;
+    bool     block1 = more || p->offset > 0;
+    uint16_t mid    = c->next_mid++;
+    uint32_t token  = next_rand(c);
+    size_t   n      = build_request(p, mid, token, block1, (uint32_t)(p->offset / p->block), more);
+    Msg_t    resp;
+
+    if (len > 0) {
+        c->tx[n++] = PAYLOAD_MARKER;
+        memcpy(&c->tx[n], data, len);
+        n += len;
+    }
+    if (!request(p, n, mid, token, &resp)) return false;
+
+    if (more && resp.code != CODE_CONTINUE) {
+        p->code = code_number(resp.code);
+        return false;
+    }
+    p->offset += len;
+    c->stats.payload_bytes += (uint32_t)len;
+    if (!more) {
+        p->code = code_number(resp.code);
+    } else if (resp.has_block1 && (16u << (resp.block1 & 7u)) < p->block) {
+        // The server wants smaller blocks; the offset stays a multiple
+        p->block = 16u << (resp.block1 & 7u);
+        c->stats.block_size = (uint16_t)p->block;
+    }
+    return true;
+}
+
+/* Window flush: send every full block, keep the tail */
+static bool window_flush(ByteSink_t *sink) {
+    PostCtx_t *p = (PostCtx_t *)sink->ctx;
+    size_t sent = 0;
+    while (sink->len - sent >= p->block) {
+        size_t block = p->block;
+        if (!send_block(p, sink->buf + sent, block, true)) return false;
+        sent += block;
+    }
+    memmove(sink->buf, sink->buf + sent, sink->len - sent);
+    sink->len -= sent;
+    return sent > 0;
+}
+
+/* ==================================================================== */
+
+void coap_client_init(CoapClient_t *c, const CoapTransport_t *tp) {
+    memset(c, 0, sizeof(*c));
+    c->tp  = tp;
+    c->rng = tp->now_ms() * 2654435761u | 1u;
+    c->next_mid = (uint16_t)next_rand(c);
+    c->stats.block_size = COAP_CLIENT_BLOCK_SIZE;
+}
+
+int coap_client_post(CoapClient_t *c, const char *path, uint16_t content_format,
+                     CoapBodyFn body, void *arg) {
+    uint32_t t0 = c->tp->now_ms();
+    PostCtx_t p = {
+        .c = c, .path = path, .format = content_format, .block = c->stats.block_size, .code = -1,
+    };
+
+    if (strlen(path) > COAP_CLIENT_PATH_MAX) {
+        c->stats.failures++;
+        return -1;
+    }
+    if (!c->open) {
+        if (!c->tp->open(c->tp->ctx)) {
+            c->stats.failures++;
+            return -1;
+        }
+        c->open = true;
+        c->stats.opens++;
+    }
+    // Only for this post: the limit may be lifted by the next response
+    size_t max = c->tp->max_datagram ? c->tp->max_datagram(c->tp->ctx) : 0;
+    while (max > 0 && p.block > 16u && COAP_CLIENT_HDR_MAX + p.block > max) p.block /= 2u;
+
+    ByteSink_t out = {
+        .buf = c->window, .cap = sizeof(c->window), .len = 0, .flush = window_flush, .ctx = &p,
+    };
+    if (body(&out, arg) && p.code < 0 && !p.lost) {
+        // Full blocks first, so the last one (never empty) goes out with M = 0
+        bool   ok  = true;
+        size_t off = 0;
+        while (ok && out.len - off > p.block) {
+            size_t block = p.block;
+            ok   = send_block(&p, out.buf + off, block, true);
+            off += block;
+        }
+        if (ok) send_block(&p, out.buf + off, out.len - off, false);
+    }
+
+    if (p.lost) coap_client_close(c);
+    if (p.code < 0) {
+        c->stats.failures++;
+    } else {
+        c->stats.posts++;
+        c->stats.last_code = (uint16_t)p.code;
+    }
+    uint32_t ms = c->tp->now_ms() - t0;
+    c->stats.post_ms += ms;
+    if (ms > c->stats.post_ms_max) c->stats.post_ms_max = ms;
+    return p.code;
+}
+
+void coap_client_close(CoapClient_t *c) {
+    if (!c->open) return;
+    c->tp->close(c->tp->ctx);
+    c->open = false;
+}
+
+void coap_client_get_stats(const CoapClient_t *c, CoapClientStats_t *out) {
+    *out = c->stats;
+}
@@ -0,0 +1,154 @@
+/* src/coap_client.h — CoAP (RFC 7252) POST client with block-wise uploads.
+ *
+ * An uplink for battery-powered deployments: each batch is one
+ * confirmable POST over UDP, so there is no TCP handshake, no TLS record
+ * stream to keep alive and nothing to tear down. The radio is busy for
+ * the datagrams of the exchange and their acknowledgements only.
+ *
+ * A body larger than COAP_CLIENT_BLOCK_SIZE goes out block-wise (Block1,
+ * RFC 7959). The producer writes into a window of two blocks; every full
+ * block is sent as its own confirmable request as soon as it is complete
+ * and must be answered with 2.31 Continue before the next one. A server
+ * asking for smaller blocks (a smaller SZX in its Block1) gets them from
+ * the next block on. The last block is answered with the final response.
+ * Batches of any size therefore stream through a fixed buffer.
+ *
+ * Every request is retransmitted with exponential back-off (initial
+ * timeout COAP_CLIENT_ACK_TIMEOUT_MS, randomised by up to 1.5x, at most
+ * COAP_CLIENT_MAX_RETRANSMIT times) until it is acknowledged. Responses
+ * may be piggybacked on the ACK or sent separately after an empty ACK;
+ * a confirmable separate response is acknowledged.
+ *
+ * The datagrams go through a CoapTransport_t: coap_udp.c runs it over an
+ * lwIP UDP socket, optionally with DTLS 1.2 (mbedTLS); tools/coap_post
+ * over a POSIX socket. The client itself has no dependencies beyond libc.
+ * Not thread-safe; one task (the API task) owns a client.
+ */
+#ifndef COAP_CLIENT_H
+#define COAP_CLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte_sink.h"
+
+/* Block1 payload size: a power of two from 16 to 1024. 1024 keeps a
+ * datagram (with the CoAP header and DTLS overhead) within 1152 bytes. */
+#ifndef COAP_CLIENT_BLOCK_SIZE
+#define COAP_CLIENT_BLOCK_SIZE 1024u
+#endif
+#ifndef COAP_CLIENT_PATH_MAX
+#define COAP_CLIENT_PATH_MAX 64u
+#endif
+/* RFC 7252 transmission parameters */
+#ifndef COAP_CLIENT_ACK_TIMEOUT_MS
+#define COAP_CLIENT_ACK_TIMEOUT_MS 2000u
+#endif
+#ifndef COAP_CLIENT_MAX_RETRANSMIT
+#define COAP_CLIENT_MAX_RETRANSMIT 4u
+#endif
+/* Wait for a separate response after an empty ACK */
+#ifndef COAP_CLIENT_RESPONSE_TIMEOUT_MS
+#define COAP_CLIENT_RESPONSE_TIMEOUT_MS 10000u
+#endif
+
+/* Header, token and options in front of a block */
+#define COAP_CLIENT_HDR_MAX (4u + 8u + COAP_CLIENT_PATH_MAX + 16u + 16u)
+
+typedef struct {
+    /* Set up the socket (and the DTLS session); false if that fails */
+    bool (*open)(void *ctx);
+    void (*close)(void *ctx);
+    /* Send one datagram; false on error */
+    bool (*send)(void *ctx, const uint8_t *buf, size_t len);
+    /* Receive one datagram, waiting up to timeout_ms. Returns its length,
+     * 0 if none arrived, < 0 if the transport failed. */
+    int  (*recv)(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms);
+    /* Largest datagram send() takes right now, 0 if it sets no limit; may
+     * be NULL. Each post starts with the largest block that fits. */
+    size_t (*max_datagram)(void *ctx);
+    uint32_t (*now_ms)(void);
+    void *ctx;
+} CoapTransport_t;
+
+typedef struct {
+    uint32_t posts;             // final response received
+    uint32_t failures;          // no final response (timeouts, reset, transport)
+    uint32_t blocks;            // requests, i.e. Block1 blocks (1 for a small body)
+    uint32_t retransmits;
+    uint32_t timeouts;          // requests given up after MAX_RETRANSMIT
+    uint32_t separate;          // responses that came after an empty ACK
+    uint32_t resets;            // RST from the server
+    uint32_t opens;             // transport (re)opened
+    uint16_t last_code;         // class * 100 + detail, 0 if none
+    uint16_t block_size;        // current Block1 size
+    uint64_t post_ms;           // total time in coap_client_post()
+    uint32_t post_ms_max;
+    uint32_t payload_bytes;     // body bytes acknowledged
+    uint32_t tx_bytes;          // CoAP message bytes, retransmissions included
+    uint32_t rx_bytes;
+} CoapClientStats_t;
+
+typedef struct {
+    const CoapTransport_t *tp;
+    bool      open;
+    uint16_t  next_mid;
+    uint32_t  next_token;
+    uint32_t  rng;             // retransmission jitter
+    CoapClientStats_t stats;
+    uint8_t   tx[COAP_CLIENT_HDR_MAX + COAP_CLIENT_BLOCK_SIZE];
+    uint8_t   rx[64 + COAP_CLIENT_HDR_MAX];  // responses carry options and a short diagnostic at most
+    uint8_t   window[2u * COAP_CLIENT_BLOCK_SIZE];
+} CoapClient_t;
+
+/* Writes the request body into out, a window that sends every full block
+ * as it fills (ByteSink_t); false aborts the post. */
+typedef bool (*CoapBodyFn)(ByteSink_t *out, void *arg);
+
+/* Does not touch the transport yet. */
+void coap_client_init(CoapClient_t *c, const CoapTransport_t *tp);
+
+/* Confirmable POST of the body produced by body(out, arg) to path (e.g.
+ * "sensors/pico-w") with the given Content-Format. Opens the transport if
+ * needed. Returns the response code as class * 100 + detail (e.g. 204 for
+ * 2.04 Changed, 415 for 4.15), or -1 if no response came; the transport
+ * is then closed, so the next post starts a new DTLS session. */
+int coap_client_post(CoapClient_t *c, const char *path, uint16_t content_format,
+                     CoapBodyFn body, void *arg);
+
+void coap_client_close(CoapClient_t *c);
+
+void coap_client_get_stats(const CoapClient_t *c, CoapClientStats_t *out);
+
+/* ====================================================================
+   --- lwIP UDP, optionally DTLS (coap_udp.c) ---
+   ==================================================================== */
+
+/* DTLS handshake flight timeouts (doubling from min to max) */
+#ifndef COAP_DTLS_HS_TIMEOUT_MIN_MS
+#define COAP_DTLS_HS_TIMEOUT_MIN_MS 1000u
+#endif
+#ifndef COAP_DTLS_HS_TIMEOUT_MAX_MS
+#define COAP_DTLS_HS_TIMEOUT_MAX_MS 16000u
+#endif
+
+typedef struct {
+    uint32_t handshakes;     // DTLS only
+    uint32_t resumed;        // handshakes that resumed the last session
+    uint64_t hs_us;          // total time in handshakes
+    uint32_t datagrams_tx;   // UDP datagrams (DTLS records included)
+    uint32_t datagrams_rx;
+    uint32_t tx_bytes;       // UDP payload bytes
+    uint32_t rx_bytes;
+} CoapUdpStats_t;
+
+/* Transport to host:port (5683 plain, 5684 DTLS). With dtls, seed the
+ * DRBG and build the DTLS config; each open resumes the session of the
+ * previous one when the server allows it. Returns NULL on failure. Call
+ * once. */
+const CoapTransport_t *coap_udp_transport(const char *host, const char *port, bool dtls);
+
+void coap_udp_get_stats(CoapUdpStats_t *out);
+
+#endif /* COAP_CLIENT_H */
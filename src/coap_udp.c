@@ -0,0 +1,258 @@
+/* src/coap_udp.c — CoAP transport over lwIP UDP, optionally DTLS 1.2.
+ *
+ * Plain datagrams go straight to a connected UDP socket (tls_net.h). With
+ * DTLS the same socket carries an mbedTLS datagram session: each CoAP
+ * message is one record in one datagram, handshake flights are
+ * retransmitted on the timer below (MBEDTLS_TIMING_C is not built), and
+ * the session of each handshake is offered on the next open, so a reopen
+ * after a lost session is normally an abbreviated handshake.
+ */
+#include "coap_client.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+
+#include "tls_net.h"
+
+/* Set up once by coap_udp_transport(), owned by the API task */
+static bool                     s_dtls;
+static mbedtls_ssl_context      s_ssl;
+static mbedtls_ssl_config       s_conf;
+static mbedtls_x509_crt         s_cacert;
+static mbedtls_ctr_drbg_context s_ctr_drbg;
+static mbedtls_entropy_context  s_entropy;
+static mbedtls_ssl_session      s_session;
+static bool                     s_have_session;
+static bool                     s_cert_verified;  // set by the verify callback
+static TlsNet_t                 s_net = TLS_NET_INIT;
+static char                     s_host[64];
+static char                     s_port[8];
+static CoapUdpStats_t           s_stats;
+
+/* mbedtls_ssl_set_timer_cb(): intermediate and final deadlines */
+static struct {
+    uint64_t int_us;
+    uint64_t fin_us;   // 0: cancelled
+} s_timer;
+
+static void timer_set(void *ctx, uint32_t int_ms, uint32_t fin_ms) {
+    (void)ctx;
+    uint64_t now = time_us_64();
+    s_timer.int_us = now + (uint64_t)int_ms * 1000u;
+    s_timer.fin_us = fin_ms ? now + (uint64_t)fin_ms * 1000u : 0;
+}
+
+static int timer_get(void *ctx) {
+    (void)ctx;
+    if (s_timer.fin_us == 0) return -1;
+    uint64_t now = time_us_64();
+    if (now >= s_timer.fin_us) return 2;
+    if (now >= s_timer.int_us) return 1;
+    return 0;
+}
+
+/* BIO callbacks counting datagrams */
+static int bio_send(void *ctx, const unsigned char *buf, size_t len) {
+    int ret = tls_net_send(ctx, buf, len);
+    if (ret >= 0) s_stats.datagrams_tx++;
+    return ret;
+}
+
+static int bio_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout_ms) {
+    int ret = tls_net_recv_timeout(ctx, buf, len, timeout_ms);
+    if (ret >= 0) s_stats.datagrams_rx++;
+    return ret;
+}
+
+/* Only full handshakes see a certificate; the chain is left to authmode */
+static int verify_cb(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+    (void)ctx; (void)crt; (void)depth; (void)flags;
+    s_cert_verified = true;
+    return 0;
+}
+
+static void udp_close(void *ctx) {
+    (void)ctx;
+    // No close_notify: the server forgets idle DTLS sessions anyway
+    tls_net_close(&s_net);
+}
+
+static bool dtls_handshake(void *ctx) {
+    int ret;
+    bool offered = false;
+
+    if ((ret = mbedtls_ssl_session_reset(&s_ssl)) != 0) {
+        tls_print_err("ssl_session_reset", ret);
+        return false;
+    }
+    if (s_have_session) offered = mbedtls_ssl_set_session(&s_ssl, &s_session) == 0;
+    mbedtls_ssl_set_bio(&s_ssl, &s_net, bio_send, NULL, bio_recv_timeout);
+
+    uint64_t t0 = time_us_64();
+    s_cert_verified = false;
+    while ((ret = mbedtls_ssl_handshake(&s_ssl)) != 0) {
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+        tls_print_err("dtls_handshake", ret);
+        udp_close(ctx);
+        // Offer nothing next time, in case the server choked on the session
+        if (offered) s_have_session = false;
+        return false;
+    }
+    uint64_t us = time_us_64() - t0;
+    s_stats.handshakes++;
+    s_stats.hs_us += us;
+    if (!s_cert_verified) s_stats.resumed++;
+    printf("CoAP: %s DTLS handshake in %lu ms\n", s_cert_verified ? "full" : "resumed",
+           (unsigned long)(us / 1000u));
+
+    mbedtls_ssl_session_free(&s_session);
+    mbedtls_ssl_session_init(&s_session);
+    s_have_session = mbedtls_ssl_get_session(&s_ssl, &s_session) == 0;
+    return true;
+}
+
+static bool udp_open(void *ctx) {
+    printf("CoAP: %s to %s:%s\n", s_dtls ? "DTLS" : "UDP", s_host, s_port);
+    if (!tls_net_connect_udp(&s_net, s_host, s_port, COAP_CLIENT_ACK_TIMEOUT_MS)) return false;
+    return !s_dtls || dtls_handshake(ctx);
+}
+
+static bool udp_send(void *ctx, const uint8_t *buf, size_t len) {
+    (void)ctx;
+    int ret;
+    if (!s_dtls) {
+        ret = bio_send(&s_net, buf, len);
+        return ret == (int)len;
+    }
+    do {
+        ret = mbedtls_ssl_write(&s_ssl, buf, len);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    if (ret != (int)len) {
+        tls_print_err("dtls_write", ret);
+        return false;
+    }
+    return true;
+}
+
+static int udp_recv(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms) {
+    (void)ctx;
+    int ret;
+    if (timeout_ms == 0) timeout_ms = 1;  // 0 would wait forever
+    if (!s_dtls) {
+        ret = bio_recv_timeout(&s_net, buf, len, timeout_ms);
+        if (ret == MBEDTLS_ERR_SSL_TIMEOUT) return 0;
+        return ret < 0 ? -1 : ret;
+    }
+
+    mbedtls_ssl_conf_read_timeout(&s_conf, timeout_ms);
+    do {
+        ret = mbedtls_ssl_read(&s_ssl, buf, len);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    if (ret == MBEDTLS_ERR_SSL_TIMEOUT) return 0;
+    if (ret <= 0) {
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) tls_print_err("dtls_read", ret);
+        return -1;
+    }
+    // One record is one message: drop what did not fit
+    uint8_t sink[32];
+    while (mbedtls_ssl_get_bytes_avail(&s_ssl) > 0 && mbedtls_ssl_read(&s_ssl, sink, sizeof(sink)) > 0) {
+    }
+    return ret;
+}
+
+/* Room for one record. After two retransmitted flights mbedTLS cuts the
+ * MTU of the handshake to 508 bytes (RFC 6347 4.1.1.1); a client that
+ * sent the last flight (a resumed handshake) keeps it until the server's
+ * first record, so the first request of the session must be smaller. */
+static size_t udp_max_datagram(void *ctx) {
+    (void)ctx;
+    if (!s_dtls) return 0;
+    int max = mbedtls_ssl_get_max_out_record_payload(&s_ssl);
+    return max > 0 ? (size_t)max : 0;
+}
+
+static uint32_t udp_now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+static const CoapTransport_t s_transport = {
+    .open         = udp_open,
+    .close        = udp_close,
+    .send         = udp_send,
+    .recv         = udp_recv,
+    .max_datagram = udp_max_datagram,
+    .now_ms       = udp_now_ms,
+    .ctx          = NULL,
+};
+
+const CoapTransport_t *coap_udp_transport(const char *host, const char *port, bool dtls) {
+    const char *pers = "pico_w_coap_client";
+    int ret;
+
+    snprintf(s_host, sizeof(s_host), "%s", host);
+    snprintf(s_port, sizeof(s_port), "%s", port);
+    s_dtls = dtls;
+    if (!dtls) return &s_transport;
+
+    mbedtls_ssl_init(&s_ssl);
+    mbedtls_ssl_config_init(&s_conf);
+    mbedtls_x509_crt_init(&s_cacert);
+    mbedtls_ctr_drbg_init(&s_ctr_drbg);
+    mbedtls_entropy_init(&s_entropy);
+    mbedtls_ssl_session_init(&s_session);
+
+    if ((ret = mbedtls_ctr_drbg_seed(&s_ctr_drbg, mbedtls_entropy_func, &s_entropy,
+                                     (const unsigned char *)pers, strlen(pers))) != 0) {
+        tls_print_err("ctr_drbg_seed", ret);
+        goto fail;
+    }
+    if ((ret = mbedtls_ssl_config_defaults(&s_conf,
+                                           MBEDTLS_SSL_IS_CLIENT,
+                                           MBEDTLS_SSL_TRANSPORT_DATAGRAM,
+                                           MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
+        tls_print_err("ssl_config_defaults", ret);
+        goto fail;
+    }
+
+    // As in https_client.c: OPTIONAL until a CA is loaded into s_cacert
+    mbedtls_ssl_conf_authmode(&s_conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+    mbedtls_ssl_conf_ca_chain(&s_conf, &s_cacert, NULL);
+    mbedtls_ssl_conf_rng(&s_conf, mbedtls_ctr_drbg_random, &s_ctr_drbg);
+    mbedtls_ssl_conf_verify(&s_conf, verify_cb, NULL);
+    mbedtls_ssl_conf_session_tickets(&s_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+    mbedtls_ssl_conf_handshake_timeout(&s_conf, COAP_DTLS_HS_TIMEOUT_MIN_MS, COAP_DTLS_HS_TIMEOUT_MAX_MS);
+
+    if ((ret = mbedtls_ssl_setup(&s_ssl, &s_conf)) != 0) {
+        tls_print_err("ssl_setup", ret);
+        goto fail;
+    }
+    if ((ret = mbedtls_ssl_set_hostname(&s_ssl, s_host)) != 0) {
+        tls_print_err("ssl_set_hostname", ret);
+        goto fail;
+    }
+    mbedtls_ssl_set_timer_cb(&s_ssl, NULL, timer_set, timer_get);
+    // Handshake messages (certificates) are fragmented to fit the path
+    mbedtls_ssl_set_mtu(&s_ssl, 1280);
+    return &s_transport;
+
+fail:
+    mbedtls_ssl_free(&s_ssl);
+    mbedtls_ssl_config_free(&s_conf);
+    mbedtls_x509_crt_free(&s_cacert);
+    mbedtls_ctr_drbg_free(&s_ctr_drbg);
+    mbedtls_entropy_free(&s_entropy);
+    return NULL;
+}
+
+void coap_udp_get_stats(CoapUdpStats_t *out) {
+    *out = s_stats;
+    out->tx_bytes = s_net.tx_bytes;
+    out->rx_bytes = s_net.rx_bytes;
+}
@@ -0,0 +1,235 @@
+/* src/flash_log.c — see flash_log.h.
+ *
+ * Erased flash reads 0xFF, so a blank page never has a valid magic. Pages
+ * of consecutive records follow each other around the ring, except that a
+ * page dirtied by a failed or interrupted program is skipped up to the
+ * next sector boundary (it can only be reused after an erase).
+ */
+#include "flash_log.h"
+
+#include <string.h>
+
+#define FL_MAGIC 0x474F4C46u  // "FLOG"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t len;
+    uint16_t flags;
+    uint32_t crc;
+} FlHeader_t;
+
+_Static_assert(sizeof(FlHeader_t) + FLASH_LOG_MAX_PAYLOAD == FLASH_LOG_PAGE_SIZE,
+               "FLASH_LOG_MAX_PAYLOAD must fill exactly one page");
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n) {
+    while (n--) {
+        crc ^= *p++;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return crc;
+}
+
+/* flags is left out: it changes when the record is consumed */
+static uint32_t record_crc(const FlHeader_t *h) {
+    uint32_t crc = 0xFFFFFFFFu;
+    crc = crc32_update(crc, (const uint8_t *)&h->seq, sizeof(h->seq) + sizeof(h->len));
+    crc = crc32_update(crc, (const uint8_t *)(h + 1), h->len);
+    return ~crc;
+}
+
+static const FlHeader_t *page_hdr(const FlashLog_t *log, uint32_t page) {
+    return (const FlHeader_t *)(log->ops->base + page * FLASH_LOG_PAGE_SIZE);
+}
+
+static bool page_valid(const FlashLog_t *log, uint32_t page) {
+    const FlHeader_t *h = page_hdr(log, page);
+    return h->magic == FL_MAGIC && h->len <= FLASH_LOG_MAX_PAYLOAD && h->crc == record_crc(h);
+}
+
+static bool page_blank(const FlashLog_t *log, uint32_t page) {
+    const uint8_t *p = log->ops->base + page * FLASH_LOG_PAGE_SIZE;
+    for (unsigned i = 0; i < FLASH_LOG_PAGE_SIZE; i++) {
+        if (p[i] != 0xFFu) return false;
+    }
+    return true;
+}
+
+/* seq a is newer than seq b */
+static bool newer(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;
+}
+
+/* The page holding record seq, at or after page (skipping at most the rest
+ * of a sector of dirty pages); pages if there is none. */
+static uint32_t find_page(const FlashLog_t *log, uint32_t page, uint32_t seq) {
+    for (uint32_t k = 0; k < FLASH_LOG_PAGES_PER_SECTOR + 1u; k++) {
+        uint32_t p = (page + k) % log->pages;
+        if (page_hdr(log, p)->seq == seq && page_valid(log, p)) return p;
+    }
+    return log->pages;
+}
+
+/* Point the tail at the oldest record from tail_seq on that is still in
+ * the region; the ones before it are dropped. */
+static void seek_tail(FlashLog_t *log) {
+    uint32_t best = log->pages, best_dist = log->head_seq - log->tail_seq;
+    for (uint32_t p = 0; p < log->pages; p++) {
+        uint32_t dist = page_hdr(log, p)->seq - log->tail_seq;
+        if (dist < best_dist && page_valid(log, p)) {
+            best      = p;
+            best_dist = dist;
+        }
+    }
+    log->stats.dropped += best_dist;
+    log->tail_seq      += best_dist;
+    log->tail           = (best < log->pages) ? best : log->head;
+}
+
+/* Point the tail at record tail_seq, searching from page */
+static void set_tail(FlashLog_t *log, uint32_t page) {
+    log->tail = (log->tail_seq == log->head_seq) ? log->head : find_page(log, page, log->tail_seq);
+    if (log->tail == log->pages) seek_tail(log);
+}
+
+void flash_log_init(FlashLog_t *log, const FlashLogOps_t *ops) {
+    memset(log, 0, sizeof(*log));
+    log->ops   = ops;
+    log->pages = ops->sectors * FLASH_LOG_PAGES_PER_SECTOR;
+    log->stats.capacity = log->pages;
+
+    int32_t newest = -1;
+    for (uint32_t p = 0; p < log->pages; p++) {
+        if (!page_valid(log, p)) continue;
+        if (newest < 0 || newer(page_hdr(log, p)->seq, page_hdr(log, (uint32_t)newest)->seq)) {
+            newest = (int32_t)p;
+        }
+    }
+    if (newest < 0) {
+        log->head_seq = log->tail_seq = 1u;
+        return;
+    }
+    log->head     = ((uint32_t)newest + 1u) % log->pages;
+    log->head_seq = page_hdr(log, (uint32_t)newest)->seq + 1u;
+
+    /* Tail: the oldest surviving record, or the one after the newest mark */
+    uint32_t oldest = log->head_seq, mark = 0;
+    bool marked = false;
+    for (uint32_t p = 0; p < log->pages; p++) {
+        if (!page_valid(log, p)) continue;
+        const FlHeader_t *h = page_hdr(log, p);
+        if (newer(oldest, h->seq)) oldest = h->seq;
+        if ((h->flags & FLASH_LOG_FLAG_CONSUMED) == 0 && (!marked || newer(h->seq, mark))) {
+            mark   = h->seq;
+            marked = true;
+        }
+    }
+    log->tail_seq = (marked && newer(mark + 1u, oldest)) ? mark + 1u : oldest;
+    seek_tail(log);
+    log->stats.dropped = 0;  // not this boot's doing
+}
+
+/* The head is about to erase sector: drop the records still in it */
+static void drop_sector(FlashLog_t *log, uint32_t sector) {
+    while (log->tail_seq != log->head_seq && log->tail / FLASH_LOG_PAGES_PER_SECTOR == sector) {
+        log->tail_seq++;
+        log->stats.dropped++;
+        set_tail(log, (log->tail + 1u) % log->pages);
+    }
+}
+
+bool flash_log_append(FlashLog_t *log, const void *data, size_t len) {
+    if (len > FLASH_LOG_MAX_PAYLOAD) return false;
+
+    uint32_t page = log->head;
+    while (page % FLASH_LOG_PAGES_PER_SECTOR != 0u && !page_blank(log, page)) {
+        page = (page + 1u) % log->pages;
+    }
+    if (page % FLASH_LOG_PAGES_PER_SECTOR == 0u) {
+        uint32_t sector = page / FLASH_LOG_PAGES_PER_SECTOR;
+        drop_sector(log, sector);
+        if (log->tail_seq == log->head_seq) log->tail = page;
+        log->stats.erases++;
+        if (!log->ops->erase(sector * FLASH_LOG_SECTOR_SIZE)) {
+            log->stats.failures++;
+            log->head = (page + 1u) % log->pages;  // try the next sector next time
+            return false;
+        }
+    }
+
+    FlHeader_t *h = (FlHeader_t *)log->page;
+    memset(log->page, 0xFF, sizeof(log->page));
+    h->magic = FL_MAGIC;
+    h->seq   = log->head_seq;
+    h->len   = (uint16_t)len;
+    memcpy(h + 1, data, len);
+    h->crc   = record_crc(h);
+
+    log->head = (page + 1u) % log->pages;
+    if (!log->ops->program(page * FLASH_LOG_PAGE_SIZE, log->page)) {
+        log->stats.failures++;
+        return false;
+    }
+    if (log->tail_seq == log->head_seq) log->tail = page;
+    log->head_seq++;
+    log->stats.appended++;
+    return true;
+}
+
+uint32_t flash_log_count(const FlashLog_t *log) {
+    return log->head_seq - log->tail_seq;
+}
+
+void flash_log_iter(const FlashLog_t *log, FlashLogIter_t *it) {
+    it->page = log->tail;
+    it->seq  = log->tail_seq;
+}
+
+const uint8_t *flash_log_next(const FlashLog_t *log, FlashLogIter_t *it, size_t *len) {
+    if (it->seq == log->head_seq || it->page >= log->pages) return NULL;
+
+    uint32_t page = (it->seq == log->tail_seq) ? log->tail : find_page(log, it->page, it->seq);
+    if (page >= log->pages || !page_valid(log, page)) return NULL;
+
+    const FlHeader_t *h = page_hdr(log, page);
+    it->page = (page + 1u) % log->pages;
+    it->seq++;
+    *len = h->len;
+    return (const uint8_t *)(h + 1);
+}
+
+bool flash_log_consume(FlashLog_t *log, uint32_t n) {
+    uint32_t count = flash_log_count(log);
+    if (n > count) n = count;
+    if (n == 0) return true;
+
+    uint32_t last = log->tail;
+    for (uint32_t k = 1; k < n && last < log->pages; k++) {
+        last = find_page(log, (last + 1u) % log->pages, log->tail_seq + k);
+    }
+    log->tail_seq += n;
+    log->stats.consumed += n;
+    if (last >= log->pages) {
+        set_tail(log, log->tail);
+        return false;
+    }
+    set_tail(log, (last + 1u) % log->pages);
+
+    /* Reprogram the page with only the flag bit cleared: 0xFF bytes leave
+     * NOR flash untouched */
+    FlHeader_t *h = (FlHeader_t *)log->page;
+    memset(log->page, 0xFF, sizeof(log->page));
+    h->flags = (uint16_t)~FLASH_LOG_FLAG_CONSUMED;
+    if (!log->ops->program(last * FLASH_LOG_PAGE_SIZE, log->page)) {
+        log->stats.failures++;
+        return false;
+    }
+    return true;
+}
+
+void flash_log_get_stats(const FlashLog_t *log, FlashLogStats_t *out) {
+    *out      = log->stats;
+    out->used = flash_log_count(log);
+}
@@ -0,0 +1,114 @@
+/* src/flash_log.h — append-only record log in a reserved flash region.
+ *
+ * A store-and-forward queue that survives resets: records (up to
+ * FLASH_LOG_MAX_PAYLOAD bytes, one flash page each) are appended at the
+ * head and consumed oldest first from the tail. The region is a ring of
+ * sectors; a sector is erased when the head enters it, so every sector is
+ * erased once per lap of the ring (sector-level wear levelling). If the
+ * head catches up with the tail, the oldest sector of records is dropped,
+ * so a full log holds between (sectors - 1) and sectors pages of records.
+ *
+ * Page layout:
+ *   magic | seq | len | flags | crc32(seq, len, payload) | payload...
+ * seq counts appended records. flags starts out 0xFFFF; consuming records
+ * reprograms the newest consumed page with FLASH_LOG_FLAG_CONSUMED cleared
+ * (NOR flash can clear bits without an erase), so the tail is recovered
+ * after a reset as "after the newest marked page". A reset between a send
+ * and its mark re-sends those records (at-least-once). A page torn by a
+ * reset fails its CRC and is skipped.
+ *
+ * The flash itself is reached through FlashLogOps_t: flash_log_pico.c maps
+ * it onto the RP2040's XIP flash, tools/flash_log_sim onto a simulated NOR
+ * array. The module is not thread-safe; one task owns a log.
+ */
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Erase and program units (RP2040 QSPI flash) */
+#define FLASH_LOG_SECTOR_SIZE 4096u
+#define FLASH_LOG_PAGE_SIZE   256u
+#define FLASH_LOG_PAGES_PER_SECTOR (FLASH_LOG_SECTOR_SIZE / FLASH_LOG_PAGE_SIZE)
+
+/* Largest payload that fits one page (page minus header) */
+#define FLASH_LOG_MAX_PAYLOAD (FLASH_LOG_PAGE_SIZE - 16u)
+
+#define FLASH_LOG_FLAG_CONSUMED 0x0001u
+
+typedef struct {
+    const uint8_t *base;      // the region, readable in place (memory-mapped)
+    uint32_t       sectors;   // size of the region, at least 2
+    /* Erase one sector / program one page at a byte offset into the
+     * region. False if the operation failed or did not verify. */
+    bool (*erase)(uint32_t offset);
+    bool (*program)(uint32_t offset, const uint8_t *page);
+} FlashLogOps_t;
+
+typedef struct {
+    uint32_t capacity;   // pages in the region
+    uint32_t used;       // unconsumed records
+    uint32_t appended;   // since init
+    uint32_t consumed;
+    uint32_t dropped;    // overwritten before they were consumed
+    uint32_t erases;
+    uint32_t failures;   // erase/program failures
+} FlashLogStats_t;
+
+typedef struct {
+    const FlashLogOps_t *ops;
+    uint32_t pages;      // in the region
+    uint32_t head;       // page the next record goes to
+    uint32_t head_seq;   // seq of the next record
+    uint32_t tail;       // oldest unconsumed record's page
+    uint32_t tail_seq;   // == head_seq when empty
+    FlashLogStats_t stats;
+    uint8_t  page[FLASH_LOG_PAGE_SIZE];
+} FlashLog_t;
+
+/* Scan the region and recover head and tail. */
+void flash_log_init(FlashLog_t *log, const FlashLogOps_t *ops);
+
+/* Append one record. False if it is too long or the flash write failed. */
+bool flash_log_append(FlashLog_t *log, const void *data, size_t len);
+
+/* Number of unconsumed records */
+uint32_t flash_log_count(const FlashLog_t *log);
+
+/* Reading position; records are read in place from the mapped flash */
+typedef struct {
+    uint32_t page;
+    uint32_t seq;
+} FlashLogIter_t;
+
+/* Start at the oldest unconsumed record */
+void flash_log_iter(const FlashLog_t *log, FlashLogIter_t *it);
+
+/* The record at it, advancing it; NULL at the head or if the page no
+ * longer checks out. Valid until the next append. */
+const uint8_t *flash_log_next(const FlashLog_t *log, FlashLogIter_t *it, size_t *len);
+
+/* Mark the n oldest records consumed. False if the mark could not be
+ * written; the records are consumed for this boot either way. */
+bool flash_log_consume(FlashLog_t *log, uint32_t n);
+
+void flash_log_get_stats(const FlashLog_t *log, FlashLogStats_t *out);
+
+/* ====================================================================
+   --- RP2040 flash (flash_log_pico.c) ---
+   ==================================================================== */
+
+/* Region just below the flash_store.h sectors. The default 128 sectors
+ * (512 KiB) must stay clear of the program image; see flash_log_pico_ops(). */
+#ifndef FLASH_LOG_SECTORS
+#define FLASH_LOG_SECTORS 128u
+#endif
+
+/* Ops for the region, or NULL if it overlaps the program image. Erase and
+ * program run through flash_safe_execute() with interrupts off (~45 ms per
+ * erase, ~1 ms per page), like flash_store.h. */
+const FlashLogOps_t *flash_log_pico_ops(void);
+
+#endif /* FLASH_LOG_H */
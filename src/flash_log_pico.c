@@ -0,0 +1,69 @@
+/* src/flash_log_pico.c — FlashLogOps_t on the RP2040's XIP flash. */
+#include "flash_log.h"
+
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+
+#include "flash_store.h"
+
+#define FL_OFFSET     (PICO_FLASH_SIZE_BYTES - (FLASH_STORE_SECTORS + FLASH_LOG_SECTORS) * FLASH_SECTOR_SIZE)
+#define FL_TIMEOUT_MS 100u
+
+_Static_assert(FLASH_LOG_SECTOR_SIZE == FLASH_SECTOR_SIZE && FLASH_LOG_PAGE_SIZE == FLASH_PAGE_SIZE,
+               "flash_log.h geometry must match the flash");
+_Static_assert(FLASH_LOG_SECTORS >= 2, "FLASH_LOG_SECTORS must be at least 2");
+
+extern char __flash_binary_end;
+
+typedef struct {
+    uint32_t       offset;  // into the region
+    bool           erase;   // else program one page
+    const uint8_t *page;
+} FlFlashOp_t;
+
+/* Runs with interrupts off and XIP disabled; the flash_range_* calls are in RAM. */
+static void fl_flash_op(void *param) {
+    const FlFlashOp_t *op = (const FlFlashOp_t *)param;
+    if (op->erase) {
+        flash_range_erase(FL_OFFSET + op->offset, FLASH_SECTOR_SIZE);
+    } else {
+        flash_range_program(FL_OFFSET + op->offset, op->page, FLASH_PAGE_SIZE);
+    }
+}
+
+static bool fl_erase(uint32_t offset) {
+    FlFlashOp_t op = { .offset = offset, .erase = true };
+    if (flash_safe_execute(fl_flash_op, &op, FL_TIMEOUT_MS) != PICO_OK) return false;
+
+    const uint32_t *w = (const uint32_t *)(uintptr_t)(XIP_BASE + FL_OFFSET + offset);
+    for (unsigned i = 0; i < FLASH_SECTOR_SIZE / 4u; i++) {
+        if (w[i] != 0xFFFFFFFFu) return false;
+    }
+    return true;
+}
+
+/* Bytes left at 0xFF are not programmed (a consumed mark only clears a
+ * flag), so only the others are verified. */
+static bool fl_program(uint32_t offset, const uint8_t *page) {
+    FlFlashOp_t op = { .offset = offset, .erase = false, .page = page };
+    if (flash_safe_execute(fl_flash_op, &op, FL_TIMEOUT_MS) != PICO_OK) return false;
+
+    const uint8_t *p = (const uint8_t *)(uintptr_t)(XIP_BASE + FL_OFFSET + offset);
+    for (unsigned i = 0; i < FLASH_PAGE_SIZE; i++) {
+        if (page[i] != 0xFFu && p[i] != page[i]) return false;
+    }
+    return true;
+}
+
+static const FlashLogOps_t s_ops = {
+    .base    = (const uint8_t *)(uintptr_t)(XIP_BASE + FL_OFFSET),
+    .sectors = FLASH_LOG_SECTORS,
+    .erase   = fl_erase,
+    .program = fl_program,
+};
+
+const FlashLogOps_t *flash_log_pico_ops(void) {
+    if ((uintptr_t)&__flash_binary_end > XIP_BASE + FL_OFFSET) return NULL;
+    return &s_ops;
+}
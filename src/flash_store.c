@@ -0,0 +1,177 @@
+/* src/flash_store.c — see flash_store.h.
+ *
+ * Slot layout (one FLASH_PAGE_SIZE page):
+ *   magic | seq | tag | len | reserved | crc32(seq..payload) | payload...
+ * Erased flash reads 0xFF, so an empty slot never has a valid magic.
+ */
+#include "flash_store.h"
+
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#define FS_MAGIC            0x52534C46u // "FLSR"
+#define FS_SLOTS_PER_SECTOR (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+#define FS_SLOTS            (FLASH_STORE_SECTORS * FS_SLOTS_PER_SECTOR)
+#define FS_OFFSET           (PICO_FLASH_SIZE_BYTES - FLASH_STORE_SECTORS * FLASH_SECTOR_SIZE)
+#define FS_TIMEOUT_MS       100u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t tag;
+    uint16_t len;
+    uint16_t reserved;
+    uint32_t crc;
+} FsHeader_t;
+
+_Static_assert(sizeof(FsHeader_t) + FLASH_STORE_MAX_PAYLOAD == FLASH_PAGE_SIZE,
+               "FLASH_STORE_MAX_PAYLOAD must fill exactly one page");
+/* Entering a sector erases it, so the newest record must live in another */
+_Static_assert(FLASH_STORE_SECTORS >= 2, "FLASH_STORE_SECTORS must be at least 2");
+
+typedef struct {
+    uint32_t       offset;  // of the page to program
+    bool           erase;   // erase its sector first
+    const uint8_t *page;
+} FsFlashOp_t;
+
+/* Guarded by s_lock (records are written by more than one task) */
+static SemaphoreHandle_t s_lock;
+static int     s_latest = -1;
+static uint8_t s_page[FLASH_PAGE_SIZE];
+
+static FlashStoreStats_t s_stats;
+
+static const FsHeader_t *slot_hdr(unsigned slot) {
+    return (const FsHeader_t *)(uintptr_t)(XIP_BASE + FS_OFFSET + slot * FLASH_PAGE_SIZE);
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n) {
+    while (n--) {
+        crc ^= *p++;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return crc;
+}
+
+static uint32_t record_crc(const FsHeader_t *h) {
+    uint32_t crc = 0xFFFFFFFFu;
+    crc = crc32_update(crc, (const uint8_t *)&h->seq, offsetof(FsHeader_t, crc) - offsetof(FsHeader_t, seq));
+    crc = crc32_update(crc, (const uint8_t *)(h + 1), h->len);
+    return ~crc;
+}
+
+static bool slot_valid(unsigned slot) {
+    const FsHeader_t *h = slot_hdr(slot);
+    return h->magic == FS_MAGIC && h->len <= FLASH_STORE_MAX_PAYLOAD && h->crc == record_crc(h);
+}
+
+static bool slot_blank(unsigned slot) {
+    const uint32_t *w = (const uint32_t *)slot_hdr(slot);
+    for (unsigned i = 0; i < FLASH_PAGE_SIZE / 4u; i++) {
+        if (w[i] != 0xFFFFFFFFu) return false;
+    }
+    return true;
+}
+
+/* Runs with interrupts off and XIP disabled; the flash_range_* calls are in RAM. */
+static void fs_flash_op(void *param) {
+    const FsFlashOp_t *op = (const FsFlashOp_t *)param;
+    if (op->erase) {
+        flash_range_erase(op->offset & ~(uint32_t)(FLASH_SECTOR_SIZE - 1u), FLASH_SECTOR_SIZE);
+    }
+    flash_range_program(op->offset, op->page, FLASH_PAGE_SIZE);
+}
+
+void flash_store_init(void) {
+    if (s_lock == NULL) s_lock = xSemaphoreCreateMutex();
+    s_latest = -1;
+    for (unsigned slot = 0; slot < FS_SLOTS; slot++) {
+        if (!slot_valid(slot)) continue;
+        if (s_latest < 0 || (int32_t)(slot_hdr(slot)->seq - slot_hdr((unsigned)s_latest)->seq) > 0) {
+            s_latest = (int)slot;
+        }
+    }
+    s_stats.seq = (s_latest >= 0) ? slot_hdr((unsigned)s_latest)->seq : 0;
+}
+
+int flash_store_read(uint32_t tag, void *buf, size_t cap) {
+    int best = -1;
+    int len  = -1;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (unsigned slot = 0; slot < FS_SLOTS; slot++) {
+        if (slot_hdr(slot)->tag != tag || !slot_valid(slot)) continue;
+        if (best < 0 || (int32_t)(slot_hdr(slot)->seq - slot_hdr((unsigned)best)->seq) > 0) {
+            best = (int)slot;
+        }
+    }
+    if (best >= 0) {
+        const FsHeader_t *h = slot_hdr((unsigned)best);
+        if (h->len <= cap) {
+            memcpy(buf, h + 1, h->len);
+            len = h->len;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return len;
+}
+
+bool flash_store_write(uint32_t tag, const void *data, size_t len) {
+    if (len > FLASH_STORE_MAX_PAYLOAD) return false;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    unsigned slot = (s_latest < 0) ? 0u : ((unsigned)s_latest + 1u) % FS_SLOTS;
+    /* A slot dirtied by an interrupted write can only be reused after its
+     * sector is erased, so move on to the next sector boundary. */
+    while (slot % FS_SLOTS_PER_SECTOR != 0u && !slot_blank(slot)) {
+        slot = (slot + 1u) % FS_SLOTS;
+    }
+
+    FsHeader_t *h = (FsHeader_t *)s_page;
+    memset(s_page, 0xFF, sizeof(s_page));
+    h->magic    = FS_MAGIC;
+    h->seq      = s_stats.seq + 1u;
+    h->tag      = tag;
+    h->len      = (uint16_t)len;
+    h->reserved = 0xFFFFu;
+    memcpy(h + 1, data, len);
+    h->crc      = record_crc(h);
+
+    FsFlashOp_t op = {
+        .offset = FS_OFFSET + slot * FLASH_PAGE_SIZE,
+        .erase  = (slot % FS_SLOTS_PER_SECTOR) == 0u,
+        .page   = s_page,
+    };
+    bool ok = flash_safe_execute(fs_flash_op, &op, FS_TIMEOUT_MS) == PICO_OK &&
+              memcmp(slot_hdr(slot), s_page, FLASH_PAGE_SIZE) == 0;
+
+    taskENTER_CRITICAL();
+    if (ok) {
+        s_stats.writes++;
+        if (op.erase) s_stats.erases++;
+        s_stats.seq = h->seq;
+    } else {
+        s_stats.failures++;
+    }
+    taskEXIT_CRITICAL();
+
+    if (ok) s_latest = (int)slot;
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+void flash_store_get_stats(FlashStoreStats_t *out) {
+    taskENTER_CRITICAL();
+    *out = s_stats;
+    taskEXIT_CRITICAL();
+}
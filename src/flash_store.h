@@ -0,0 +1,54 @@
+/* src/flash_store.h — small wear-levelled state record in on-chip flash.
+ *
+ * The last FLASH_STORE_SECTORS sectors of flash are used as a ring of
+ * page-sized slots. Every write programs the next slot (erasing a sector
+ * only when the ring enters it), so each sector is erased once per
+ * (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE) writes. A record carries a sequence
+ * number and a CRC-32; on read the newest valid record wins, so a write
+ * interrupted by a reset only ever loses that write.
+ *
+ * Erase and program run through flash_safe_execute(), i.e. with interrupts
+ * off for the duration (~45 ms for an erase, ~1 ms for a page). Call from a
+ * task that can afford that, not from time-critical paths.
+ *
+ * Every write takes the oldest slot whatever its tag, so a record survives
+ * at least (FLASH_STORE_SECTORS - 1) * 16 later writes of any tag. Reads and writes may come
+ * from several tasks; they are serialised by a mutex.
+ */
+#ifndef FLASH_STORE_H
+#define FLASH_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Region at the very end of flash. Keep clear of anything else placed
+ * there (e.g. the BTstack bank if Bluetooth is ever enabled). */
+#ifndef FLASH_STORE_SECTORS
+#define FLASH_STORE_SECTORS 2u
+#endif
+
+/* Largest payload that fits one slot (page minus header). */
+#define FLASH_STORE_MAX_PAYLOAD (256u - 20u)
+
+typedef struct {
+    uint32_t writes;
+    uint32_t erases;
+    uint32_t failures;  // flash_safe_execute() refused or verify failed
+    uint32_t seq;       // sequence number of the newest record
+} FlashStoreStats_t;
+
+/* Scan the region for the newest record. Call once from main() before the
+ * scheduler starts, before any read/write. */
+void flash_store_init(void);
+
+/* Copy the newest record with this tag into buf. Returns its length, or
+ * -1 if there is none (or it is larger than cap). */
+int  flash_store_read(uint32_t tag, void *buf, size_t cap);
+
+/* Append a record; it becomes the newest. */
+bool flash_store_write(uint32_t tag, const void *data, size_t len);
+
+void flash_store_get_stats(FlashStoreStats_t *out);
+
+#endif /* FLASH_STORE_H */
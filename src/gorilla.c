@@ -0,0 +1,188 @@
+/* src/gorilla.c — see gorilla.h (encoder). */
+#include "gorilla.h"
+
+#include <math.h>
+#include <string.h>
+
+/* A record is assembled here, after the encoder's pending bits, and only
+ * copied out once it is known to fit. */
+typedef struct {
+    uint8_t b[GORILLA_RECORD_MAX + 1u];
+    size_t  n;  // bits
+} Bits_t;
+
+static const float s_pow10[GORILLA_FMT_FIXED_MAX + 1] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f,
+    1e8f, 1e9f, 1e10f, 1e11f, 1e12f, 1e13f, 1e14f,
+};
+
+/* Append the low nbits of v, MSB first */
+static void put(Bits_t *w, uint64_t v, unsigned nbits) {
+    while (nbits > 0) {
+        unsigned used = (unsigned)(w->n & 7u);
+        unsigned take = 8u - used;
+        if (take > nbits) take = nbits;
+        if (used == 0) w->b[w->n >> 3] = 0;
+        uint8_t chunk = (uint8_t)((v >> (nbits - take)) & ((1u << take) - 1u));
+        w->b[w->n >> 3] |= (uint8_t)(chunk << (8u - used - take));
+        w->n  += take;
+        nbits -= take;
+    }
+}
+
+static void put_varint(Bits_t *w, int64_t x) {
+    uint64_t u = ((uint64_t)x << 1) ^ (uint64_t)(x >> 63);  // zigzag
+    while (u >= 0x80u) {
+        put(w, (u & 0x7Fu) | 0x80u, 8);
+        u >>= 7;
+    }
+    put(w, u, 8);
+}
+
+static uint32_t pattern(uint8_t fmt, float value) {
+    uint32_t bits;
+    if (fmt == GORILLA_FMT_FLOAT) {
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    float scaled = value * s_pow10[fmt];
+    int32_t iv;
+    if (!(scaled == scaled))            iv = 0;  // NaN
+    else if (scaled >= 2147483520.0f)   iv = INT32_MAX;
+    else if (scaled <= -2147483648.0f)  iv = INT32_MIN;
+    else                                iv = (int32_t)lroundf(scaled);
+    return (uint32_t)iv;
+}
+
+static int64_t integer(float value) {
+    if (!(value == value)) return 0;
+    if (value >= 9.2e18f)  return INT64_MAX;
+    if (value <= -9.2e18f) return INT64_MIN;
+    return (int64_t)llroundf(value);
+}
+
+uint8_t gorilla_ch_bits(unsigned channels) {
+    uint8_t bits = 1;
+    while ((1u << bits) - 1u < channels) bits++;
+    return bits;
+}
+
+size_t gorilla_enc_begin(GorillaEnc_t *enc, uint8_t ch_bits, uint8_t *buf, size_t cap) {
+    if (cap < GORILLA_HEADER_LEN) return 0;
+    memset(enc, 0, sizeof(*enc));
+    enc->ch_bits = ch_bits;
+    buf[0] = 'G';
+    buf[1] = 'R';
+    buf[2] = GORILLA_VERSION;
+    buf[3] = ch_bits;
+    return GORILLA_HEADER_LEN;
+}
+
+size_t gorilla_enc_record(GorillaEnc_t *enc, uint8_t ch, uint8_t fmt, const char *name,
+                          uint64_t t_ms, bool unix_time, float value, uint8_t *buf, size_t cap) {
+    if (ch >= GORILLA_ENC_CHANNELS || ch >= (1u << enc->ch_bits) - 1u) return 0;
+
+    GorillaSeries_t s = enc->series[ch];
+    Bits_t w;
+
+    w.b[0] = enc->pending;
+    w.n    = enc->pending_bits;
+    put(&w, ch, enc->ch_bits);
+
+    if (!s.started) {
+        size_t name_len = strlen(name);
+        if (name_len > GORILLA_NAME_MAX) name_len = GORILLA_NAME_MAX;
+        if (fmt > GORILLA_FMT_FIXED_MAX) fmt = GORILLA_FMT_FLOAT;
+
+        put(&w, fmt, 4);
+        put(&w, unix_time, 1);
+        put(&w, name_len, 5);
+        for (size_t i = 0; i < name_len; i++) put(&w, (uint8_t)name[i], 8);
+        put(&w, t_ms, 64);
+        if (fmt == GORILLA_FMT_INT) {
+            s.ival = integer(value);
+            put_varint(&w, s.ival);
+        } else {
+            s.bits = pattern(fmt, value);
+            put(&w, s.bits, 32);
+        }
+        s.started   = true;
+        s.fmt       = fmt;
+        s.unix_time = unix_time;
+        s.t         = t_ms;
+        s.delta     = 0;
+        s.window    = false;
+    } else {
+        int64_t delta = (int64_t)(t_ms - s.t);
+        int64_t dod   = (int64_t)((uint64_t)delta - (uint64_t)s.delta);
+        if (dod == 0) {
+            put(&w, 0x0u, 1);
+        } else if (dod >= -64 && dod <= 63) {
+            put(&w, 0x2u, 2);
+            put(&w, (uint64_t)dod, 7);
+        } else if (dod >= -256 && dod <= 255) {
+            put(&w, 0x6u, 3);
+            put(&w, (uint64_t)dod, 9);
+        } else if (dod >= -524288 && dod <= 524287) {
+            put(&w, 0xEu, 4);
+            put(&w, (uint64_t)dod, 20);
+        } else {
+            put(&w, 0xFu, 4);
+            put(&w, (uint64_t)dod, 64);
+        }
+        s.t     = t_ms;
+        s.delta = delta;
+
+        if (s.fmt == GORILLA_FMT_INT) {
+            int64_t iv = integer(value);
+            put_varint(&w, (int64_t)((uint64_t)iv - (uint64_t)s.ival));  // wraps
+            s.ival = iv;
+        } else {
+            uint32_t cur = pattern(s.fmt, value);
+            uint32_t x   = cur ^ s.bits;
+            if (x == 0) {
+                put(&w, 0x0u, 1);
+            } else {
+                uint8_t lead  = (uint8_t)__builtin_clz(x);
+                uint8_t trail = (uint8_t)__builtin_ctz(x);
+                if (s.window && lead >= s.lead && trail >= s.trail) {
+                    put(&w, 0x2u, 2);
+                    put(&w, x >> s.trail, 32u - s.lead - s.trail);
+                } else {
+                    unsigned len = 32u - lead - trail;
+                    put(&w, 0x3u, 2);
+                    put(&w, lead, 5);
+                    put(&w, len - 1u, 5);
+                    put(&w, x >> trail, len);
+                    s.lead   = lead;
+                    s.trail  = trail;
+                    s.window = true;
+                }
+            }
+            s.bits = cur;
+        }
+    }
+
+    size_t bytes = w.n >> 3;
+    if (bytes > cap) return (size_t)-1;
+    memcpy(buf, w.b, bytes);
+    enc->pending      = (w.n & 7u) ? w.b[bytes] : 0;
+    enc->pending_bits = (uint8_t)(w.n & 7u);
+    enc->series[ch]   = s;
+    return bytes;
+}
+
+size_t gorilla_enc_end(GorillaEnc_t *enc, uint8_t *buf, size_t cap) {
+    Bits_t w;
+
+    w.b[0] = enc->pending;
+    w.n    = enc->pending_bits;
+    put(&w, (1u << enc->ch_bits) - 1u, enc->ch_bits);
+
+    size_t bytes = (w.n + 7u) >> 3;
+    if (bytes > cap) return (size_t)-1;
+    memcpy(buf, w.b, bytes);
+    enc->pending      = 0;
+    enc->pending_bits = 0;
+    return bytes;
+}
@@ -0,0 +1,128 @@
+/* src/gorilla.h — Gorilla-style compression of interleaved time series.
+ *
+ * After Pelkonen et al., "Gorilla: A Fast, Scalable, In-Memory Time Series
+ * Database" (VLDB 2015), adapted to several channels in one bit stream and
+ * to per-channel value formats:
+ *
+ *   stream  := 'G' 'R' version(1) ch_bits | record* | end | zero padding
+ *   record  := ch[ch_bits] (definition | sample)
+ *   end     := ch = 2^ch_bits - 1
+ *
+ * The first record of a channel is its definition, with the first sample:
+ *
+ *   fmt[4] unix[1] name_len[5] name[8*name_len] t[64] value
+ *
+ *   fmt 15    float: value is the IEEE-754 single, 32 bits
+ *   fmt 1..14 fixed point with fmt decimals: round(v * 10^fmt) as int32
+ *   fmt 0     integer: round(v) as a zigzag varint (8-bit groups)
+ *
+ * Later records of the channel carry
+ *
+ *   timestamp  delta-of-delta D of the ms timestamps:
+ *                '0' (D = 0) | '10' D[7] | '110' D[9] | '1110' D[20] | '1111' D[64]
+ *   value      float / fixed: XOR with the previous 32-bit pattern:
+ *                '0' (same) | '10' bits in the previous window |
+ *                '11' leading[5] (length-1)[5] bits
+ *              integer: zigzag varint of the difference to the previous value
+ *
+ * All fields are written MSB first. Slowly changing channels sampled at a
+ * fixed period cost a couple of bits of timestamp and a few bits of value
+ * per record. The encoder is portable C with no allocation; the decoder
+ * (gorilla_decode.c) is kept out of the firmware and used by the host tools.
+ */
+#ifndef GORILLA_H
+#define GORILLA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define GORILLA_VERSION      1u
+#define GORILLA_HEADER_LEN   4u
+#define GORILLA_MAX_CHANNELS 63u   // ch_bits <= 6
+#define GORILLA_NAME_MAX     31u
+
+/* Value formats (fmt field) */
+#define GORILLA_FMT_INT      0
+#define GORILLA_FMT_FIXED_MAX 14
+#define GORILLA_FMT_FLOAT    15
+
+/* Largest encoded record, and the end marker plus padding */
+#define GORILLA_RECORD_MAX   ((6u + 4u + 1u + 5u + 8u * GORILLA_NAME_MAX + 64u + 80u + 7u) / 8u + 1u)
+#define GORILLA_END_MAX      2u
+
+/* Channels the encoder keeps state for (the decoder handles all of them) */
+#ifndef GORILLA_ENC_CHANNELS
+#define GORILLA_ENC_CHANNELS 15u
+#endif
+
+typedef struct {
+    uint64_t t;         // previous timestamp
+    int64_t  delta;     // previous timestamp delta
+    int64_t  ival;      // previous integer value
+    uint32_t bits;      // previous float/fixed pattern
+    uint8_t  fmt;
+    uint8_t  lead;      // XOR window of the previous value
+    uint8_t  trail;
+    bool     window;    // lead/trail valid
+    bool     started;
+    bool     unix_time;
+} GorillaSeries_t;
+
+typedef struct {
+    uint8_t         ch_bits;
+    uint8_t         pending;       // bits not yet written out (< 8), MSB first
+    uint8_t         pending_bits;
+    GorillaSeries_t series[GORILLA_ENC_CHANNELS];
+} GorillaEnc_t;
+
+/* Bits needed for channel numbers 0..channels-1 plus the end marker */
+uint8_t gorilla_ch_bits(unsigned channels);
+
+/* Start a stream; writes the header. Returns bytes written (0 if cap is too
+ * small). */
+size_t gorilla_enc_begin(GorillaEnc_t *enc, uint8_t ch_bits, uint8_t *buf, size_t cap);
+
+/* Append one sample of channel ch (< GORILLA_ENC_CHANNELS and < 2^ch_bits
+ * - 1; other channels are dropped, returning 0). fmt and name are used
+ * on the channel's first record only; all records of a channel must share
+ * unix_time. Returns the complete bytes written to buf (possibly 0); if
+ * they do not fit in cap, returns (size_t)-1 and leaves the encoder as it
+ * was, so the record can be retried after the caller has made room. */
+size_t gorilla_enc_record(GorillaEnc_t *enc, uint8_t ch, uint8_t fmt, const char *name,
+                          uint64_t t_ms, bool unix_time, float value, uint8_t *buf, size_t cap);
+
+/* Write the end marker and the last partial byte. Returns bytes written,
+ * or (size_t)-1 if they do not fit. */
+size_t gorilla_enc_end(GorillaEnc_t *enc, uint8_t *buf, size_t cap);
+
+/* ====================================================================
+   --- Reference decoder (gorilla_decode.c, host only) ---
+   ==================================================================== */
+
+typedef struct {
+    uint8_t     ch;
+    const char *name;
+    uint8_t     fmt;
+    uint64_t    t_ms;
+    bool        unix_time;
+    double      value;     // exact for every format
+} GorillaSample_t;
+
+typedef struct {
+    const uint8_t  *buf;
+    size_t          len;
+    size_t          bit;
+    uint8_t         ch_bits;
+    GorillaSeries_t series[GORILLA_MAX_CHANNELS];
+    char            names[GORILLA_MAX_CHANNELS][GORILLA_NAME_MAX + 1u];
+} GorillaDec_t;
+
+/* Check the header. False if buf is not a stream this decoder knows. */
+bool gorilla_dec_init(GorillaDec_t *dec, const uint8_t *buf, size_t len);
+
+/* Next sample: 1 on success, 0 at the end marker, -1 if the stream is
+ * truncated or malformed. */
+int  gorilla_dec_next(GorillaDec_t *dec, GorillaSample_t *out);
+
+#endif /* GORILLA_H */
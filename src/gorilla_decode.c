@@ -0,0 +1,154 @@
+/* src/gorilla_decode.c — reference decoder for gorilla.h streams.
+ *
+ * Not part of the firmware; built by tools/gorilla_decode and
+ * tools/uplink_codec_bench for the ingest side.
+ */
+#include "gorilla.h"
+
+#include <string.h>
+
+static const double s_pow10[GORILLA_FMT_FIXED_MAX + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+    1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14,
+};
+
+/* Read nbits (<= 64) MSB first; false if the stream ends first */
+static bool get(GorillaDec_t *d, unsigned nbits, uint64_t *out) {
+    uint64_t v = 0;
+    if (d->bit + nbits > d->len * 8u) return false;
+    while (nbits > 0) {
+        unsigned used  = (unsigned)(d->bit & 7u);
+        unsigned take  = 8u - used;
+        if (take > nbits) take = nbits;
+        uint8_t  byte  = d->buf[d->bit >> 3];
+        uint8_t  chunk = (uint8_t)((byte >> (8u - used - take)) & ((1u << take) - 1u));
+        v = (v << take) | chunk;
+        d->bit += take;
+        nbits  -= take;
+    }
+    *out = v;
+    return true;
+}
+
+static int64_t sign_extend(uint64_t v, unsigned nbits) {
+    uint64_t m = 1ull << (nbits - 1u);
+    return (int64_t)((v ^ m) - m);
+}
+
+static bool get_varint(GorillaDec_t *d, int64_t *out) {
+    uint64_t u = 0, byte;
+    for (unsigned shift = 0; shift < 70u; shift += 7u) {
+        if (!get(d, 8, &byte)) return false;
+        u |= (byte & 0x7Fu) << shift;
+        if ((byte & 0x80u) == 0) {
+            *out = (int64_t)(u >> 1) ^ -(int64_t)(u & 1u);  // zigzag
+            return true;
+        }
+    }
+    return false;
+}
+
+static double value_of(const GorillaSeries_t *s) {
+    if (s->fmt == GORILLA_FMT_INT) return (double)s->ival;
+    if (s->fmt == GORILLA_FMT_FLOAT) {
+        float f;
+        memcpy(&f, &s->bits, sizeof(f));
+        return (double)f;
+    }
+    return (double)(int32_t)s->bits / s_pow10[s->fmt];
+}
+
+bool gorilla_dec_init(GorillaDec_t *dec, const uint8_t *buf, size_t len) {
+    memset(dec, 0, sizeof(*dec));
+    if (len < GORILLA_HEADER_LEN || buf[0] != 'G' || buf[1] != 'R' || buf[2] != GORILLA_VERSION ||
+        buf[3] < 1u || buf[3] > 6u) {
+        return false;
+    }
+    dec->buf     = buf;
+    dec->len     = len;
+    dec->bit     = GORILLA_HEADER_LEN * 8u;
+    dec->ch_bits = buf[3];
+    return true;
+}
+
+int gorilla_dec_next(GorillaDec_t *dec, GorillaSample_t *out) {
+    uint64_t v;
+
+    if (!get(dec, dec->ch_bits, &v)) return -1;
+    if (v == (1u << dec->ch_bits) - 1u) return 0;
+    if (v >= GORILLA_MAX_CHANNELS) return -1;
+
+    uint8_t ch = (uint8_t)v;
+    GorillaSeries_t *s = &dec->series[ch];
+
+    if (!s->started) {
+        uint64_t fmt, unix_time, name_len;
+        if (!get(dec, 4, &fmt) || !get(dec, 1, &unix_time) || !get(dec, 5, &name_len)) return -1;
+        for (uint64_t i = 0; i < name_len; i++) {
+            if (!get(dec, 8, &v)) return -1;
+            dec->names[ch][i] = (char)v;
+        }
+        dec->names[ch][name_len] = '\0';
+        if (!get(dec, 64, &s->t)) return -1;
+        if (fmt == GORILLA_FMT_INT) {
+            if (!get_varint(dec, &s->ival)) return -1;
+        } else {
+            if (!get(dec, 32, &v)) return -1;
+            s->bits = (uint32_t)v;
+        }
+        s->started   = true;
+        s->fmt       = (uint8_t)fmt;
+        s->unix_time = unix_time != 0;
+        s->delta     = 0;
+        s->window    = false;
+    } else {
+        /* Delta-of-delta: '0' | '10' 7 | '110' 9 | '1110' 20 | '1111' 64 */
+        static const unsigned widths[5] = { 0, 7, 9, 20, 64 };
+        unsigned prefix = 0;
+        while (prefix < 4u) {
+            if (!get(dec, 1, &v)) return -1;
+            if (v == 0) break;
+            prefix++;
+        }
+        int64_t dod = 0;
+        if (prefix > 0) {
+            if (!get(dec, widths[prefix], &v)) return -1;
+            dod = sign_extend(v, widths[prefix]);
+        }
+        s->delta = (int64_t)((uint64_t)s->delta + (uint64_t)dod);
+        s->t     += (uint64_t)s->delta;
+
+        if (s->fmt == GORILLA_FMT_INT) {
+            int64_t diff;
+            if (!get_varint(dec, &diff)) return -1;
+            s->ival = (int64_t)((uint64_t)s->ival + (uint64_t)diff);
+        } else {
+            if (!get(dec, 1, &v)) return -1;
+            if (v != 0) {
+                uint64_t ctl, x;
+                if (!get(dec, 1, &ctl)) return -1;
+                if (ctl != 0) {
+                    uint64_t lead, len;
+                    if (!get(dec, 5, &lead) || !get(dec, 5, &len)) return -1;
+                    len += 1u;
+                    if (lead + len > 32u) return -1;
+                    s->lead   = (uint8_t)lead;
+                    s->trail  = (uint8_t)(32u - lead - len);
+                    s->window = true;
+                } else if (!s->window) {
+                    return -1;
+                }
+                if (!get(dec, 32u - s->lead - s->trail, &x)) return -1;
+                s->bits ^= (uint32_t)(x << s->trail);
+            }
+        }
+    }
+
+    out->ch        = ch;
+    out->name      = dec->names[ch];
+    out->fmt       = s->fmt;
+    out->t_ms      = s->t;
+    out->unix_time = s->unix_time;
+    out->value     = value_of(s);
+    return 1;
+}
@@ -0,0 +1,553 @@
+/* src/https_client.c — see https_client.h. */
+#include "https_client.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "pico/stdlib.h"
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+
+#include "flash_store.h"
+#include "tls_net.h"
+#include "wall_clock.h"
+
+#define SESSION_TAG 0x31534C54u // "TLS1"
+
+/* Set up once by https_client_init(), owned by the API task */
+static mbedtls_ssl_context      s_ssl;
+static mbedtls_ssl_config       s_conf;
+static mbedtls_x509_crt         s_cacert;
+static mbedtls_ctr_drbg_context s_ctr_drbg;
+static mbedtls_entropy_context  s_entropy;
+static TlsNet_t                 s_net = TLS_NET_INIT;
+static bool                     s_ready;
+static bool                     s_connected;
+static uint32_t                 s_last_used_ms;
+static char                     s_host[64];
+static char                     s_port[8];
+
+/* Session offered on the next reconnect */
+static mbedtls_ssl_session      s_session;
+static bool                     s_have_session;
+static bool                     s_cert_verified;  // set by the verify callback
+#if HTTPS_CLIENT_SESSION_FLASH
+static bool                     s_flash_checked;
+static uint32_t                 s_session_saved_unix;
+static unsigned char            s_session_buf[FLASH_STORE_MAX_PAYLOAD];
+#endif
+
+/* Request buffer: [ headers | chunk size ][ body window ][ chunk end | last chunk ]
+ * Headers and the chunk-size line are placed right before the window, so a
+ * window goes out with one mbedtls_ssl_write() and the body is never copied. */
+#define HDR_MAX      256u
+#define CHUNK_HEAD   8u   // "590\r\n"
+#define CHUNK_TAIL   7u   // "\r\n" "0\r\n\r\n"
+#define BODY_OFF     (HDR_MAX + CHUNK_HEAD)
+
+static uint8_t     s_tx[BODY_OFF + HTTPS_CLIENT_CHUNK_LEN + CHUNK_TAIL];
+static char        s_headers[HDR_MAX];
+static char        s_prefix[HDR_MAX];  // "POST <path> HTTP/1.1\r\nHost: ...\r\n...", built once per path
+static size_t      s_prefix_len;
+static const char *s_prefix_path;
+static char        s_response[1024];   // response headers (the body is discarded)
+
+typedef struct {
+    const char *content_type;
+    size_t      body_bytes;
+    bool        started;  // headers sent (the body is chunked)
+    bool        failed;
+} StreamCtx_t;
+
+static HttpsClientStats_t s_stats;
+
+static inline uint32_t now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+/* ====================================================================
+   --- Connection management ---
+   ==================================================================== */
+
+static void drop(bool graceful) {
+    if (!s_connected) return;
+    if (graceful) mbedtls_ssl_close_notify(&s_ssl);
+    tls_net_close(&s_net);
+    s_connected = false;
+}
+
+/* ====================================================================
+   --- Session cache (RAM, optionally flash) ---
+   ==================================================================== */
+
+/* Only full handshakes see a certificate; the chain is left to authmode */
+static int verify_cb(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+    (void)ctx; (void)crt; (void)depth; (void)flags;
+    s_cert_verified = true;
+    return 0;
+}
+
+static void session_forget(void) {
+    mbedtls_ssl_session_free(&s_session);
+    mbedtls_ssl_session_init(&s_session);
+    s_have_session = false;
+}
+
+#if HTTPS_CLIENT_SESSION_FLASH
+/* Record: unix_s (4 bytes) | mbedtls_ssl_session_save() output.
+ * Needs the wall clock for the age check, so it is tried on the first
+ * connect after SNTP has answered. */
+static void session_load_flash(void) {
+    uint32_t now = wall_clock_unix();
+    uint32_t saved;
+
+    if (s_flash_checked || now == 0) return;
+    s_flash_checked = true;
+
+    int len = flash_store_read(SESSION_TAG, s_session_buf, sizeof(s_session_buf));
+    if (len <= 4) return;
+    memcpy(&saved, s_session_buf, 4);
+    if (now - saved > HTTPS_CLIENT_SESSION_MAX_AGE_S) return;
+    if (mbedtls_ssl_session_load(&s_session, s_session_buf + 4, (size_t)len - 4u) != 0) {
+        session_forget();
+        return;
+    }
+    s_have_session             = true;
+    s_session_saved_unix       = saved;
+    s_stats.session_from_flash = true;
+}
+
+static void session_save_flash(void) {
+    uint32_t now = wall_clock_unix();
+    size_t olen = 0;
+    if (now == 0 || (s_session_saved_unix != 0 && now - s_session_saved_unix < HTTPS_CLIENT_SESSION_SAVE_S)) return;
+    int ret = mbedtls_ssl_session_save(&s_session, s_session_buf + 4, sizeof(s_session_buf) - 4u, &olen);
+    if (ret != 0) {
+        // A long ticket may not fit one flash_store record; RAM resumption still works
+        if (ret != MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL) tls_print_err("ssl_session_save", ret);
+        s_session_saved_unix = now;
+        return;
+    }
+    memcpy(s_session_buf, &now, 4);
+    if (flash_store_write(SESSION_TAG, s_session_buf, olen + 4u)) s_stats.sessions_saved++;
+    s_session_saved_unix = now;
+}
+#endif
+
+/* Remember the session of the handshake that just completed */
+static void session_store(bool resumed) {
+    mbedtls_ssl_session_free(&s_session);
+    mbedtls_ssl_session_init(&s_session);
+    s_have_session = mbedtls_ssl_get_session(&s_ssl, &s_session) == 0;
+#if HTTPS_CLIENT_SESSION_FLASH
+    if (s_have_session && !resumed) session_save_flash();
+#else
+    (void)resumed;
+#endif
+}
+
+/* ====================================================================
+   --- Connect + handshake ---
+   ==================================================================== */
+
+static int handshake(bool *resumed) {
+    int ret;
+    uint64_t t0 = time_us_64();
+
+    s_cert_verified = false;
+    while ((ret = mbedtls_ssl_handshake(&s_ssl)) != 0) {
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) return ret;
+    }
+
+    uint64_t us = time_us_64() - t0;
+    *resumed = !s_cert_verified;
+    if (*resumed) {
+        s_stats.resumed_handshakes++;
+        s_stats.resumed_hs_us += us;
+    } else {
+        s_stats.full_handshakes++;
+        s_stats.full_hs_us += us;
+    }
+    printf("HTTPS: %s handshake in %lu ms\n", *resumed ? "resumed" : "full", (unsigned long)(us / 1000u));
+    return 0;
+}
+
+static bool connect_tls(void) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int ret;
+        bool offered = false, resumed = false;
+
+        printf("HTTPS: connecting to %s:%s\n", s_host, s_port);
+        if ((ret = mbedtls_ssl_session_reset(&s_ssl)) != 0) {
+            tls_print_err("ssl_session_reset", ret);
+            return false;
+        }
+#if HTTPS_CLIENT_SESSION_FLASH
+        if (!s_have_session) session_load_flash();
+#endif
+        if (s_have_session) {
+            offered = mbedtls_ssl_set_session(&s_ssl, &s_session) == 0;
+            if (!offered) session_forget();
+        }
+
+        if (!tls_net_connect(&s_net, s_host, s_port, HTTPS_CLIENT_RECV_TIMEOUT_MS)) return false;
+        s_connected = true;
+        s_stats.connects++;
+
+        // BIO: plug our send/recv
+        mbedtls_ssl_set_bio(&s_ssl, &s_net, tls_net_send, tls_net_recv, NULL);
+
+        if ((ret = handshake(&resumed)) == 0) {
+            if (offered && !resumed) s_stats.resume_refused++;
+            session_store(resumed);
+            return true;
+        }
+        tls_print_err("ssl_handshake", ret);
+        drop(false);
+        // Some servers abort instead of declining a stale session: go full once
+        if (!offered) return false;
+        session_forget();
+    }
+    return false;
+}
+
+/* ====================================================================
+   --- One request/response exchange on the open connection ---
+   ==================================================================== */
+
+static bool write_all(const void *buf, size_t len) {
+    const unsigned char *p = (const unsigned char *)buf;
+    size_t off = 0;
+    while (off < len) {
+        int ret = mbedtls_ssl_write(&s_ssl, p + off, len - off);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+        if (ret <= 0) {
+            tls_print_err("ssl_write", ret);
+            return false;
+        }
+        off += (size_t)ret;
+    }
+    return true;
+}
+
+static int read_some(unsigned char *buf, size_t len) {
+    int ret;
+    do {
+        ret = mbedtls_ssl_read(&s_ssl, buf, len);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    return ret;
+}
+
+/* Read the response headers and discard the body so the connection is left
+ * at the start of the next response. Returns the HTTP status, or -1.
+ * *got_any tells whether any response bytes arrived; *keep whether the
+ * connection can carry another request. */
+static int read_response(bool *got_any, bool *keep) {
+    size_t have = 0;
+    char *eoh = NULL;
+
+    *got_any = false;
+    *keep    = false;
+    while (eoh == NULL) {
+        if (have == sizeof(s_response) - 1u) {
+            printf("HTTPS: response headers too long\n");
+            return -1;
+        }
+        int ret = read_some((unsigned char *)s_response + have, sizeof(s_response) - 1u - have);
+        if (ret <= 0) {
+            if (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) printf("... Server closed connection\n");
+            else tls_print_err("ssl_read", ret);
+            return -1;
+        }
+        *got_any = true;
+        have += (size_t)ret;
+        s_response[have] = '\0';
+        eoh = strstr(s_response, "\r\n\r\n");
+    }
+
+    /* Status line: HTTP/1.x NNN ... */
+    if (strncmp(s_response, "HTTP/1.", 7) != 0 || have < 12) return -1;
+    int status = atoi(&s_response[9]);
+    bool keep_alive = s_response[7] == '1';  // HTTP/1.1 defaults to keep-alive
+
+    long content_length = -1;
+    bool chunked = false;
+    *eoh = '\0';
+    for (char *line = strstr(s_response, "\r\n"); line != NULL; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            content_length = strtol(line + 15, NULL, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char *v = line + 11;
+            while (*v == ' ') v++;
+            keep_alive = strncasecmp(v, "close", 5) != 0;
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            chunked = true;
+        }
+    }
+
+    /* Body bytes that came in with the headers */
+    long body_have = (long)(have - (size_t)(eoh + 4 - s_response));
+
+    if (status == 204 || status == 304) content_length = 0;
+    if (chunked || content_length < 0 || body_have > content_length) {
+        // Cannot find the end of the body: use the connection only once
+        keep_alive = false;
+    } else {
+        long left = content_length - body_have;
+        while (left > 0) {
+            size_t want = left < (long)sizeof(s_response) ? (size_t)left : sizeof(s_response);
+            int ret = read_some((unsigned char *)s_response, want);
+            if (ret <= 0) {
+                keep_alive = false;
+                break;
+            }
+            left -= ret;
+        }
+    }
+
+    *keep = keep_alive;
+    return status;
+}
+
+static size_t put_str(char *p, const char *str) {
+    size_t n = strlen(str);
+    memcpy(p, str, n);
+    return n;
+}
+
+static size_t put_uint(char *p, uint32_t v, uint32_t base) {
+    char tmp[10];
+    size_t n = 0;
+    do {
+        tmp[n++] = "0123456789abcdef"[v % base];
+        v /= base;
+    } while (v != 0);
+    for (size_t i = 0; i < n; i++) p[i] = tmp[n - 1u - i];
+    return n;
+}
+
+static bool build_prefix(const char *path) {
+    if (path == s_prefix_path) return true;
+    int n = snprintf(s_prefix, sizeof(s_prefix),
+                     "POST %s HTTP/1.1\r\n"
+                     "Host: %s\r\n"
+                     "Connection: keep-alive\r\n",
+                     path, s_host);
+    if (n < 0 || n >= (int)sizeof(s_prefix)) {
+        printf("Request too big\n");
+        s_prefix_path = NULL;
+        return false;
+    }
+    s_prefix_len  = (size_t)n;
+    s_prefix_path = path;
+    return true;
+}
+
+/* Prefix + Content-Type + Content-Length, or chunked if content_length < 0 */
+static size_t build_headers(const char *content_type, long content_length) {
+    char *p = s_headers;
+    if (s_prefix_len + strlen(content_type) + 64u > sizeof(s_headers)) return 0;
+    memcpy(p, s_prefix, s_prefix_len);
+    p += s_prefix_len;
+    p += put_str(p, "Content-Type: ");
+    p += put_str(p, content_type);
+    if (content_length >= 0) {
+        p += put_str(p, "\r\nContent-Length: ");
+        p += put_uint(p, (uint32_t)content_length, 10);
+    } else {
+        p += put_str(p, "\r\nTransfer-Encoding: chunked");
+    }
+    p += put_str(p, "\r\n\r\n");
+    return (size_t)(p - s_headers);
+}
+
+/* Send the body window (len bytes at s_tx + BODY_OFF) with whatever framing
+ * goes around it. A body that ends within the first window is sent with a
+ * Content-Length; anything longer as chunks of one window each. */
+static bool stream_send(StreamCtx_t *c, size_t len, bool last) {
+    uint8_t *start = s_tx + BODY_OFF;
+    uint8_t *end   = start + len;
+    size_t   hdr_len;
+
+    if (!c->started && last) {
+        if ((hdr_len = build_headers(c->content_type, (long)len)) == 0) return false;
+    } else {
+        if (len > 0) {
+            char head[CHUNK_HEAD];
+            size_t n = put_uint(head, (uint32_t)len, 16);
+            n += put_str(&head[n], "\r\n");
+            start -= n;
+            memcpy(start, head, n);
+            end += put_str((char *)end, "\r\n");
+        }
+        if (last) end += put_str((char *)end, "0\r\n\r\n");
+        hdr_len = c->started ? 0 : build_headers(c->content_type, -1);
+        if (!c->started && hdr_len == 0) return false;
+    }
+    start -= hdr_len;
+    memcpy(start, s_headers, hdr_len);
+
+    c->started     = true;
+    c->body_bytes += len;
+    return write_all(start, (size_t)(end - start));
+}
+
+static bool stream_flush(ByteSink_t *sink) {
+    StreamCtx_t *c = (StreamCtx_t *)sink->ctx;
+    if (!stream_send(c, sink->len, false)) {
+        c->failed = true;
+        return false;
+    }
+    sink->len = 0;
+    return true;
+}
+
+static int exchange(const char *path, const char *content_type, HttpsBodyFn body, void *arg,
+                    bool *got_any, bool *keep) {
+    *got_any = false;
+    *keep    = false;
+
+    if (!build_prefix(path)) return -1;
+
+    StreamCtx_t c = { .content_type = content_type };
+    ByteSink_t sink = {
+        .buf = s_tx + BODY_OFF, .cap = HTTPS_CLIENT_CHUNK_LEN, .len = 0,
+        .flush = stream_flush, .ctx = &c,
+    };
+    bool chunked;
+    if (!body(&sink, arg) || c.failed) return -1;
+    chunked = c.started;
+    if (!stream_send(&c, sink.len, true)) return -1;
+
+    if (chunked) s_stats.chunked_posts++;
+    if (c.body_bytes > s_stats.body_bytes_max) s_stats.body_bytes_max = (uint32_t)c.body_bytes;
+
+    return read_response(got_any, keep);
+}
+
+/* ==================================================================== */
+
+bool https_client_init(const char *host, const char *port) {
+    const char *pers = "pico_w_https_client";
+    int ret;
+
+    if (s_ready) return true;
+
+    snprintf(s_host, sizeof(s_host), "%s", host);
+    snprintf(s_port, sizeof(s_port), "%s", port);
+
+    // Init TLS objects
+    mbedtls_ssl_init(&s_ssl);
+    mbedtls_ssl_config_init(&s_conf);
+    mbedtls_x509_crt_init(&s_cacert);
+    mbedtls_ctr_drbg_init(&s_ctr_drbg);
+    mbedtls_entropy_init(&s_entropy);
+    mbedtls_ssl_session_init(&s_session);
+
+    // Seed DRBG
+    if ((ret = mbedtls_ctr_drbg_seed(&s_ctr_drbg, mbedtls_entropy_func, &s_entropy,
+                                     (const unsigned char *)pers, strlen(pers))) != 0) {
+        tls_print_err("ctr_drbg_seed", ret);
+        goto fail;
+    }
+
+    // Load CA certs if you have them; otherwise keep VERIFY_OPTIONAL for now.
+    // Example: mbedtls_x509_crt_parse(&s_cacert, ca_pem, ca_pem_len);
+
+    if ((ret = mbedtls_ssl_config_defaults(&s_conf,
+                                           MBEDTLS_SSL_IS_CLIENT,
+                                           MBEDTLS_SSL_TRANSPORT_STREAM,
+                                           MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
+        tls_print_err("ssl_config_defaults", ret);
+        goto fail;
+    }
+
+    // For first bring-up you can do OPTIONAL; for production use REQUIRED and real CA.
+    mbedtls_ssl_conf_authmode(&s_conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+    mbedtls_ssl_conf_ca_chain(&s_conf, &s_cacert, NULL);
+    mbedtls_ssl_conf_rng(&s_conf, mbedtls_ctr_drbg_random, &s_ctr_drbg);
+    mbedtls_ssl_conf_verify(&s_conf, verify_cb, NULL);
+    mbedtls_ssl_conf_session_tickets(&s_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+
+    if ((ret = mbedtls_ssl_setup(&s_ssl, &s_conf)) != 0) {
+        tls_print_err("ssl_setup", ret);
+        goto fail;
+    }
+
+    // Kept across mbedtls_ssl_session_reset()
+    if ((ret = mbedtls_ssl_set_hostname(&s_ssl, s_host)) != 0) {
+        tls_print_err("ssl_set_hostname", ret);
+        goto fail;
+    }
+
+    s_ready = true;
+    return true;
+
+fail:
+    mbedtls_ssl_free(&s_ssl);
+    mbedtls_ssl_config_free(&s_conf);
+    mbedtls_x509_crt_free(&s_cacert);
+    mbedtls_ctr_drbg_free(&s_ctr_drbg);
+    mbedtls_entropy_free(&s_entropy);
+    return false;
+}
+
+int https_client_post(const char *path, const char *content_type, HttpsBodyFn body, void *arg) {
+    if (!s_ready) return -1;
+
+    uint64_t t0 = time_us_64();
+    int status = -1;
+
+    // Anything readable between responses means the peer closed (or sent an alert)
+    if (s_connected && (now_ms() - s_last_used_ms >= HTTPS_CLIENT_IDLE_MS || tls_net_readable(&s_net))) {
+        drop(false);
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = s_connected;
+        bool got_any, keep;
+
+        if (!reused && !connect_tls()) break;
+        if (reused) s_stats.reused++;
+
+        status = exchange(path, content_type, body, arg, &got_any, &keep);
+        if (status >= 0) {
+            if (!keep) drop(true);
+            break;
+        }
+        drop(false);
+        // A stale keep-alive connection fails before any response arrives
+        if (!reused || got_any) break;
+        s_stats.retries++;
+    }
+    s_last_used_ms = now_ms();
+
+    uint32_t us = (uint32_t)(time_us_64() - t0);
+    s_stats.post_us += us;
+    if (us > s_stats.post_us_max) s_stats.post_us_max = us;
+    s_stats.last_status = status > 0 ? status : 0;
+    if (status < 0) {
+        s_stats.failures++;
+        return -1;
+    }
+    s_stats.posts++;
+    printf("HTTPS: %d in %lu ms\n", status, (unsigned long)(us / 1000u));
+    return status;
+}
+
+void https_client_close(void) {
+    drop(true);
+}
+
+void https_client_get_stats(HttpsClientStats_t *out) {
+    *out = s_stats;
+    out->tx_bytes     = s_net.tx_bytes;
+    out->rx_bytes     = s_net.rx_bytes;
+    out->buffer_bytes = (uint32_t)(sizeof(s_tx) + sizeof(s_headers) + sizeof(s_prefix) + sizeof(s_response));
+}
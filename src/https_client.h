@@ -0,0 +1,112 @@
+/* src/https_client.h — long-lived HTTPS client (mbedTLS over lwIP sockets).
+ *
+ * Entropy, CTR-DRBG, the SSL config and the SSL context are set up once by
+ * https_client_init(). The TLS connection is opened on the first post and
+ * kept open across posts with HTTP/1.1 keep-alive, so a post normally costs
+ * one request/response round trip instead of DNS + TCP + a full handshake.
+ *
+ * The connection is dropped when the server answers "Connection: close",
+ * when a response cannot be framed (no Content-Length), on any transport
+ * error, or after HTTPS_CLIENT_IDLE_MS without a post. The next post then
+ * reconnects. A post on a reused connection that the server had already
+ * closed is retried once on a fresh connection, provided no response bytes
+ * were received.
+ *
+ * Every reconnect offers the session of the last handshake (session ID or
+ * session ticket), so the server can resume it with an abbreviated
+ * handshake: no certificate, no ECDHE, no signature check. If the server
+ * declines, the same handshake simply completes in full; if a handshake
+ * that offered a session fails, the session is forgotten and one full
+ * handshake is tried at once. A handshake counts as resumed when it did not
+ * verify a certificate. With HTTPS_CLIENT_SESSION_FLASH the session is also
+ * kept in flash_store so resumption works across reboots.
+ *
+ * The request body is produced through a ByteSink_t (byte_sink.h) whose
+ * window is HTTPS_CLIENT_CHUNK_LEN bytes of the request buffer. A body that
+ * fits one window goes out with a Content-Length, together with the headers
+ * in one TLS record; a longer one is sent with chunked transfer coding, one
+ * chunk per window as it fills. The body size is therefore not bounded by
+ * any buffer.
+ *
+ * Owned by a single task (the API task).
+ */
+#ifndef HTTPS_CLIENT_H
+#define HTTPS_CLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte_sink.h"
+
+/* Close the connection after this long without a post. Keep it below the
+ * server's keep-alive timeout (nginx: 75 s) to avoid racing its close. */
+#ifndef HTTPS_CLIENT_IDLE_MS
+#define HTTPS_CLIENT_IDLE_MS 70000u
+#endif
+/* Socket receive timeout for responses */
+#ifndef HTTPS_CLIENT_RECV_TIMEOUT_MS
+#define HTTPS_CLIENT_RECV_TIMEOUT_MS 10000u
+#endif
+
+/* Body window. 1424 + chunk framing (7) + AES-GCM record overhead (29) is
+ * one 1460-byte TCP segment per TLS record. */
+#ifndef HTTPS_CLIENT_CHUNK_LEN
+#define HTTPS_CLIENT_CHUNK_LEN 1424u
+#endif
+
+/* Keep the last session in flash. The record holds the session's master
+ * secret, so this is off by default. */
+#ifndef HTTPS_CLIENT_SESSION_FLASH
+#define HTTPS_CLIENT_SESSION_FLASH 0
+#endif
+/* Ignore a flash session older than this (servers expire them anyway) */
+#ifndef HTTPS_CLIENT_SESSION_MAX_AGE_S
+#define HTTPS_CLIENT_SESSION_MAX_AGE_S (12u * 3600u)
+#endif
+/* Minimum spacing of session writes to flash */
+#ifndef HTTPS_CLIENT_SESSION_SAVE_S
+#define HTTPS_CLIENT_SESSION_SAVE_S 900u
+#endif
+
+typedef struct {
+    uint32_t posts;              // completed with any HTTP status
+    uint32_t failures;           // no usable response
+    uint32_t connects;           // TCP connections opened
+    uint32_t reused;             // posts sent on an already open connection
+    uint32_t retries;            // stale keep-alive connections retried
+    uint32_t full_handshakes;
+    uint32_t resumed_handshakes;
+    uint32_t resume_refused;     // session offered, server did a full handshake
+    uint64_t full_hs_us;         // total time in full handshakes
+    uint64_t resumed_hs_us;      // total time in resumed handshakes
+    uint32_t sessions_saved;     // to flash
+    bool     session_from_flash; // the first session came from flash
+    uint32_t tx_bytes;           // TLS bytes on the TCP socket
+    uint32_t rx_bytes;
+    uint64_t post_us;            // total time in https_client_post()
+    uint32_t post_us_max;
+    int      last_status;        // HTTP status of the last response, 0 if none
+    uint32_t chunked_posts;      // bodies longer than one window
+    uint32_t body_bytes_max;
+    uint32_t buffer_bytes;       // static request/response buffers
+} HttpsClientStats_t;
+
+/* Seed the DRBG and build the TLS config for host:port. Call once. */
+bool https_client_init(const char *host, const char *port);
+
+/* Writes the whole request body to out (flushing as needed); false aborts
+ * the request. Called again from the start if the post is retried. */
+typedef bool (*HttpsBodyFn)(ByteSink_t *out, void *arg);
+
+/* POST the body produced by body(out, arg) to path. path must stay valid
+ * (the request line is cached per path). Returns the HTTP status, or -1 if
+ * there was no usable response. */
+int  https_client_post(const char *path, const char *content_type, HttpsBodyFn body, void *arg);
+
+/* Close the connection now (sends close_notify). */
+void https_client_close(void);
+
+void https_client_get_stats(HttpsClientStats_t *out);
+
+#endif /* HTTPS_CLIENT_H */
@@ -0,0 +1,199 @@
+/* src/i2c_bus.c — see i2c_bus.h.
+ *
+ * Scheduling: a delayed read that has come due always runs first (its
+ * sensor is holding a result), then the head of the highest non-empty
+ * priority queue. A transaction with a delay only leaves its queue when a
+ * deferred slot is free; lower priorities may overtake it meanwhile.
+ */
+#include "i2c_bus.h"
+
+#include "pico/stdlib.h"
+
+#include "queue.h"
+
+#include "DEV_Config.h" // SENSOR_I2C_PORT, DMA transfers
+
+static QueueHandle_t s_queue[I2C_PRIO_COUNT];
+static TaskHandle_t  s_task;
+
+/* Owned by the bus task */
+static I2cTxn_t *s_deferred[I2C_BUS_MAX_DEFERRED];
+static unsigned  s_n_deferred;
+
+static I2cBusStats_t s_stats;
+
+static inline bool time_reached(uint32_t now, uint32_t due) {
+    return (int32_t)(now - due) >= 0;
+}
+
+static void account_busy(uint32_t since_us) {
+    uint32_t dt = time_us_32() - since_us;
+    taskENTER_CRITICAL();
+    s_stats.bus_busy_us += dt;
+    taskEXIT_CRITICAL();
+}
+
+static void txn_complete(I2cTxn_t *t, int result) {
+    TaskHandle_t h = t->notify; // t may go out of scope once done is seen
+    bool err = result < 0;
+
+    taskENTER_CRITICAL();
+    s_stats.completed[t->prio]++;
+    if (err) s_stats.errors++;
+    taskEXIT_CRITICAL();
+
+    t->result = result;
+    __sync_synchronize();
+    t->done = true;
+    xTaskNotifyGiveIndexed(h, I2C_BUS_NOTIFY_INDEX);
+}
+
+static void txn_read(I2cTxn_t *t) {
+    uint32_t t0 = time_us_32();
+    int r = DEV_I2C_Xfer(SENSOR_I2C_PORT, t->addr, NULL, 0, t->rbuf, t->rlen);
+    account_busy(t0);
+    txn_complete(t, r);
+}
+
+/* Write phase, then either the read, a deferred read, or completion. */
+static void txn_start(I2cTxn_t *t) {
+    uint32_t now = time_us_32();
+    uint32_t wait = now - t->t_submit_us;
+    t->t_start_us = now;
+
+    taskENTER_CRITICAL();
+    s_stats.queue_depth[t->prio]--;
+    s_stats.wait_us_total[t->prio] += wait;
+    if (wait > s_stats.wait_us_max[t->prio]) s_stats.wait_us_max[t->prio] = wait;
+    taskEXIT_CRITICAL();
+
+    if (t->exec) {
+        int r = t->exec(t->exec_ctx);
+        account_busy(now);
+        txn_complete(t, r);
+        return;
+    }
+    if (t->wlen && t->rlen && t->nostop && !t->delay_ms) {
+        /* register read: write, repeated start, read in one DMA transfer */
+        int r = DEV_I2C_Xfer(SENSOR_I2C_PORT, t->addr, t->wbuf, t->wlen, t->rbuf, t->rlen);
+        account_busy(now);
+        txn_complete(t, r);
+        return;
+    }
+    if (t->wlen) {
+        int w = DEV_I2C_Xfer(SENSOR_I2C_PORT, t->addr, t->wbuf, t->wlen, NULL, 0);
+        account_busy(now);
+        if (w < 0 || t->rlen == 0) {
+            txn_complete(t, w);
+            return;
+        }
+    }
+    if (t->delay_ms) {
+        t->t_ready_us = time_us_32() + t->delay_ms * 1000u;
+        s_deferred[s_n_deferred++] = t;
+        taskENTER_CRITICAL();
+        if (s_n_deferred > s_stats.deferred_max) s_stats.deferred_max = s_n_deferred;
+        taskEXIT_CRITICAL();
+        return;
+    }
+    txn_read(t);
+}
+
+/* Earliest deferred transaction, or -1. */
+static int deferred_next(void) {
+    int best = -1;
+    for (unsigned i = 0; i < s_n_deferred; i++) {
+        if (best < 0 || (int32_t)(s_deferred[i]->t_ready_us - s_deferred[best]->t_ready_us) < 0) {
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+static I2cTxn_t *queued_next(void) {
+    I2cTxn_t *t;
+    for (int p = 0; p < I2C_PRIO_COUNT; p++) {
+        if (xQueuePeek(s_queue[p], &t, 0) != pdTRUE) continue;
+        if (!t->exec && t->delay_ms && s_n_deferred == I2C_BUS_MAX_DEFERRED) continue;
+        xQueueReceive(s_queue[p], &t, 0);
+        return t;
+    }
+    return NULL;
+}
+
+static void vI2cBusTask(void *pvParameters) {
+    (void)pvParameters;
+    for (;;) {
+        int d = deferred_next();
+        if (d >= 0 && time_reached(time_us_32(), s_deferred[d]->t_ready_us)) {
+            I2cTxn_t *t = s_deferred[d];
+            s_deferred[d] = s_deferred[--s_n_deferred];
+            txn_read(t);
+            continue;
+        }
+
+        I2cTxn_t *t = queued_next();
+        if (t) {
+            txn_start(t);
+            continue;
+        }
+
+        /* Idle: sleep until a submission or the next deferred read */
+        TickType_t timeout = portMAX_DELAY;
+        if (d >= 0) {
+            uint32_t left_us = s_deferred[d]->t_ready_us - time_us_32();
+            if ((int32_t)left_us < 0) left_us = 0;
+            timeout = pdMS_TO_TICKS((left_us + 999u) / 1000u);
+            if (timeout == 0) timeout = 1;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout);
+    }
+}
+
+bool i2c_bus_init(unsigned task_priority) {
+    for (int p = 0; p < I2C_PRIO_COUNT; p++) {
+        s_queue[p] = xQueueCreate(I2C_BUS_QUEUE_LEN, sizeof(I2cTxn_t *));
+        if (!s_queue[p]) return false;
+    }
+    return xTaskCreate(vI2cBusTask, "I2CBusTask", 256, NULL, task_priority, &s_task) == pdPASS;
+}
+
+bool i2c_bus_submit(I2cTxn_t *t) {
+    t->done        = false;
+    t->result      = 0;
+    t->notify      = xTaskGetCurrentTaskHandle();
+    t->t_submit_us = time_us_32();
+
+    /* Count first so the bus task can never see a negative depth */
+    taskENTER_CRITICAL();
+    uint32_t depth = ++s_stats.queue_depth[t->prio];
+    if (depth > s_stats.queue_depth_max[t->prio]) s_stats.queue_depth_max[t->prio] = depth;
+    taskEXIT_CRITICAL();
+
+    if (xQueueSend(s_queue[t->prio], &t, 0) != pdTRUE) {
+        taskENTER_CRITICAL();
+        s_stats.queue_depth[t->prio]--;
+        taskEXIT_CRITICAL();
+        return false;
+    }
+    xTaskNotifyGive(s_task);
+    return true;
+}
+
+int i2c_bus_wait(I2cTxn_t *t) {
+    while (!t->done) {
+        ulTaskNotifyTakeIndexed(I2C_BUS_NOTIFY_INDEX, pdFALSE, portMAX_DELAY);
+    }
+    return t->result;
+}
+
+int i2c_bus_transfer(I2cTxn_t *t) {
+    if (!i2c_bus_submit(t)) return PICO_ERROR_GENERIC;
+    return i2c_bus_wait(t);
+}
+
+void i2c_bus_get_stats(I2cBusStats_t *out) {
+    taskENTER_CRITICAL();
+    *out = s_stats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,103 @@
+/* src/i2c_bus.h — single owner task for SENSOR_I2C_PORT.
+ *
+ * Sensor tasks no longer touch the bus themselves. They describe a
+ * transaction (write, optional delay, read) and hand it to the bus manager,
+ * which executes queued transactions in priority order and notifies the
+ * submitter on completion. While a transaction waits out its delay (e.g. the
+ * 31 ms SGP40 measurement), the bus is free and other transactions run, so
+ * an IMU read is never stuck behind a slow conversion.
+ *
+ * Transfers go through the DMA I2C layer in DEV_Config.c, so the manager
+ * sleeps while the bus moves bytes. Only the bus manager may touch
+ * SENSOR_I2C_PORT once the scheduler runs; before that, driver init code
+ * may use the DEV_I2C_* helpers directly.
+ */
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Transactions whose delay is still running; beyond this, new delayed
+ * transactions wait in their queue until a slot frees up. */
+#ifndef I2C_BUS_MAX_DEFERRED
+#define I2C_BUS_MAX_DEFERRED 4
+#endif
+
+/* Queue depth per priority level. */
+#ifndef I2C_BUS_QUEUE_LEN
+#define I2C_BUS_QUEUE_LEN 8
+#endif
+
+/* Task notification slot used for completions, so the submitter's default
+ * slot stays free for its own events (see FreeRTOSConfig.h). Slot 2 is
+ * DEV_I2C_NOTIFY_INDEX, used by the bus manager itself. */
+#define I2C_BUS_NOTIFY_INDEX 1
+
+typedef enum {
+    I2C_PRIO_HIGH = 0,  // latency-sensitive (IMU)
+    I2C_PRIO_NORMAL,
+    I2C_PRIO_LOW,       // slow environmental sensors
+    I2C_PRIO_COUNT
+} I2cBusPrio_t;
+
+/* One bus transaction. Buffers must stay valid until completion.
+ * Either phase may be empty (wlen == 0 or rlen == 0). */
+typedef struct {
+    uint8_t        addr;      // 7-bit address
+    const uint8_t *wbuf;
+    size_t         wlen;
+    uint8_t       *rbuf;
+    size_t         rlen;
+    uint32_t       delay_ms;  // between write and read; bus released meanwhile
+    bool           nostop;    // repeated start between write and read (delay_ms must be 0)
+    I2cBusPrio_t   prio;
+
+    /* Multi-step sequences (e.g. a FIFO drain handshake): if exec is set the
+     * manager calls exec(exec_ctx) from its own task with the bus held, and
+     * the return value becomes the result. wbuf/rbuf/delay are ignored. */
+    int          (*exec)(void *ctx);
+    void          *exec_ctx;
+
+    /* Filled in by the bus manager */
+    volatile bool  done;
+    int            result;    // bytes read (or written if rlen == 0), <0 = PICO_ERROR_*
+    TaskHandle_t   notify;    // submitter, set by i2c_bus_submit()
+    uint32_t       t_submit_us;
+    uint32_t       t_start_us;
+    uint32_t       t_ready_us; // delayed read due
+} I2cTxn_t;
+
+typedef struct {
+    uint32_t completed[I2C_PRIO_COUNT];
+    uint32_t errors;
+    uint32_t queue_depth[I2C_PRIO_COUNT];     // current
+    uint32_t queue_depth_max[I2C_PRIO_COUNT]; // high-water mark
+    uint64_t wait_us_total[I2C_PRIO_COUNT];   // submit -> first bus access
+    uint32_t wait_us_max[I2C_PRIO_COUNT];
+    uint32_t deferred_max;                    // concurrent delayed transactions
+    uint64_t bus_busy_us;                     // time the bus was actually in use
+} I2cBusStats_t;
+
+/* Create the bus manager task. Call before vTaskStartScheduler(). */
+bool i2c_bus_init(unsigned task_priority);
+
+/* Queue a transaction; false if its priority queue is full. The calling
+ * task is notified on I2C_BUS_NOTIFY_INDEX when it completes, so it may
+ * have several transactions in flight. */
+bool i2c_bus_submit(I2cTxn_t *t);
+
+/* Block until a submitted transaction completes; returns t->result. Bus
+ * timeouts bound the wait, so there is no separate timeout here. */
+int  i2c_bus_wait(I2cTxn_t *t);
+
+/* submit + wait; PICO_ERROR_GENERIC if the queue is full. */
+int  i2c_bus_transfer(I2cTxn_t *t);
+
+void i2c_bus_get_stats(I2cBusStats_t *out);
+
+#endif /* I2C_BUS_H */
@@ -0,0 +1,183 @@
+/* src/imu_fusion.c — see imu_fusion.h.
+ *
+ * Per sample (Mahony et al. 2008, in half-angle form):
+ *   v  = gravity direction predicted by q
+ *   e  = a_measured x v                  (only if |a| is close to 1 g)
+ *   h  = (gyro + Kp e + Ki int(e)) dt/2  (half-angle rotation this step)
+ *   q += q * (0, h), then renormalise
+ * Renormalisation uses one first-order Newton step, q *= (3 - |q|^2) / 2,
+ * which is exact enough because |q| only drifts by ~h^2 per step.
+ */
+#include "imu_fusion.h"
+
+#define DEG2RAD 0.017453292519943295f
+#define Q30F    1073741824.0f        // 2^30
+#define Q46F    70368744177664.0f    // 2^46
+#define Q50F    1125899906842624.0f  // 2^50
+
+/* atan(2^-i) as binary angles (2^32 = one turn) */
+static const uint32_t s_atan_tab[24] = {
+    0x20000000, 0x12e4051e, 0x09fb385b, 0x051111d4, 0x028b0d43, 0x0145d7e1,
+    0x00a2f61e, 0x00517c55, 0x0028be53, 0x00145f2f, 0x000a2f98, 0x000517cc,
+    0x00028be6, 0x000145f3, 0x0000a2fa, 0x0000517d, 0x000028be, 0x0000145f,
+    0x00000a30, 0x00000518, 0x0000028c, 0x00000146, 0x000000a3, 0x00000051,
+};
+
+static inline int32_t mul30(int32_t a, int32_t b) {
+    return (int32_t)(((int64_t)a * b) >> 30);
+}
+
+static uint32_t isqrt32(uint32_t v) {
+    uint32_t r = 0, bit = 1u << 30;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+static uint32_t isqrt64(uint64_t v) {
+    uint64_t r = 0, bit = 1ull << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)r;
+}
+
+void imu_fusion_init(ImuFusion_t *f, float acc_lsb_per_g, float gyro_lsb_per_dps, uint32_t period_us) {
+    float lo = acc_lsb_per_g * (1.f - IMU_FUSION_ACC_GATE);
+    float hi = acc_lsb_per_g * (1.f + IMU_FUSION_ACC_GATE);
+
+    f->q[0] = IMU_FUSION_Q30_ONE;
+    f->q[1] = f->q[2] = f->q[3] = 0;
+    for (int i = 0; i < 3; i++) f->bias[i] = 0;
+    f->acc_lsb_per_g    = acc_lsb_per_g;
+    f->gyro_lsb_per_dps = gyro_lsb_per_dps;
+    f->acc_lo2 = (uint32_t)(lo * lo);
+    f->acc_hi2 = (hi * hi < 4294967295.f) ? (uint32_t)(hi * hi) : UINT32_MAX;
+    f->updates = 0;
+    imu_fusion_set_period(f, period_us);
+}
+
+void imu_fusion_set_period(ImuFusion_t *f, uint32_t period_us) {
+    float dt = (float)period_us * 1e-6f;
+
+    f->period_us = period_us;
+    f->k_gyro = (int64_t)(0.5f * dt * DEG2RAD / f->gyro_lsb_per_dps * Q46F);
+    f->k_p    = (int32_t)(0.5f * dt * IMU_FUSION_KP * Q30F);
+    f->k_i    = (int32_t)(0.5f * dt * dt * IMU_FUSION_KI * Q50F);
+}
+
+void imu_fusion_update(ImuFusion_t *f, const int16_t acc[3], const int16_t gyro[3]) {
+    int32_t q0 = f->q[0], q1 = f->q[1], q2 = f->q[2], q3 = f->q[3];
+    int32_t h[3];
+
+    for (int i = 0; i < 3; i++) {
+        h[i] = (int32_t)(((int64_t)gyro[i] * f->k_gyro) >> 16); // Q46 -> Q30
+    }
+
+    uint32_t n2 = (uint32_t)((int32_t)acc[0] * acc[0]) + (uint32_t)((int32_t)acc[1] * acc[1]) +
+                  (uint32_t)((int32_t)acc[2] * acc[2]);
+    if (n2 >= f->acc_lo2 && n2 <= f->acc_hi2 && n2 != 0) {
+        /* |acc| <= n, so a[i] stays within +/-2^30 */
+        int32_t inv = (int32_t)((1u << 30) / isqrt32(n2));
+        int32_t ax = acc[0] * inv, ay = acc[1] * inv, az = acc[2] * inv;
+
+        int32_t vx = 2 * (mul30(q1, q3) - mul30(q0, q2));
+        int32_t vy = 2 * (mul30(q0, q1) + mul30(q2, q3));
+        int32_t vz = mul30(q0, q0) - mul30(q1, q1) - mul30(q2, q2) + mul30(q3, q3);
+
+        int32_t e[3] = {
+            mul30(ay, vz) - mul30(az, vy),
+            mul30(az, vx) - mul30(ax, vz),
+            mul30(ax, vy) - mul30(ay, vx),
+        };
+        for (int i = 0; i < 3; i++) {
+            f->bias[i] += ((int64_t)e[i] * f->k_i) >> 30;
+            h[i] += mul30(e[i], f->k_p);
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        h[i] += (int32_t)(f->bias[i] >> 20); // Q50 -> Q30
+    }
+
+    int32_t d0 = -mul30(q1, h[0]) - mul30(q2, h[1]) - mul30(q3, h[2]);
+    int32_t d1 =  mul30(q0, h[0]) + mul30(q2, h[2]) - mul30(q3, h[1]);
+    int32_t d2 =  mul30(q0, h[1]) - mul30(q1, h[2]) + mul30(q3, h[0]);
+    int32_t d3 =  mul30(q0, h[2]) + mul30(q1, h[1]) - mul30(q2, h[0]);
+    q0 += d0;
+    q1 += d1;
+    q2 += d2;
+    q3 += d3;
+
+    int32_t norm2 = mul30(q0, q0) + mul30(q1, q1) + mul30(q2, q2) + mul30(q3, q3);
+    int32_t k = IMU_FUSION_Q30_ONE + ((IMU_FUSION_Q30_ONE - norm2) >> 1);
+    f->q[0] = mul30(q0, k);
+    f->q[1] = mul30(q1, k);
+    f->q[2] = mul30(q2, k);
+    f->q[3] = mul30(q3, k);
+    f->updates++;
+}
+
+/* CORDIC vectoring: rotate (x, y) onto the x axis, summing the angles. */
+uint32_t imu_fusion_atan2(int32_t y, int32_t x) {
+    uint32_t angle = 0;
+
+    if (x == 0 && y == 0) return 0;
+    x >>= 1; // headroom for the ~1.65x CORDIC gain
+    y >>= 1;
+    if (x < 0) {
+        angle = 0x80000000u;
+        x = -x;
+        y = -y;
+    }
+    for (int i = 0; i < 24; i++) {
+        int32_t xs = x >> i, ys = y >> i;
+        if (y > 0) {
+            x += ys;
+            y -= xs;
+            angle += s_atan_tab[i];
+        } else {
+            x -= ys;
+            y += xs;
+            angle -= s_atan_tab[i];
+        }
+    }
+    return angle;
+}
+
+static int32_t bam_to_cdeg(uint32_t bam) {
+    return (int32_t)(((int64_t)(int32_t)bam * 36000) >> 32);
+}
+
+void imu_fusion_euler(const ImuFusion_t *f, ImuEuler_t *out) {
+    int32_t q0 = f->q[0], q1 = f->q[1], q2 = f->q[2], q3 = f->q[3];
+
+    int32_t sr = 2 * (mul30(q0, q1) + mul30(q2, q3));
+    int32_t cr = IMU_FUSION_Q30_ONE - 2 * (mul30(q1, q1) + mul30(q2, q2));
+    out->roll_cdeg = bam_to_cdeg(imu_fusion_atan2(sr, cr));
+
+    /* asin(s) = atan2(s, sqrt(1 - s^2)) */
+    int32_t sp = 2 * (mul30(q0, q2) - mul30(q3, q1));
+    if (sp >  IMU_FUSION_Q30_ONE) sp =  IMU_FUSION_Q30_ONE;
+    if (sp < -IMU_FUSION_Q30_ONE) sp = -IMU_FUSION_Q30_ONE;
+    int32_t cp = (int32_t)isqrt64((1ull << 60) - (uint64_t)((int64_t)sp * sp));
+    out->pitch_cdeg = bam_to_cdeg(imu_fusion_atan2(sp, cp));
+
+    int32_t sy = 2 * (mul30(q0, q3) + mul30(q1, q2));
+    int32_t cy = IMU_FUSION_Q30_ONE - 2 * (mul30(q2, q2) + mul30(q3, q3));
+    out->yaw_cdeg = bam_to_cdeg(imu_fusion_atan2(sy, cy));
+}
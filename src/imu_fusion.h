@@ -0,0 +1,70 @@
+/* src/imu_fusion.h — fixed-point Mahony orientation filter.
+ *
+ * The RP2040 has no FPU, so the per-sample path is integer only: the
+ * quaternion is kept in Q30, gyro counts are turned into a half-angle step
+ * with one precomputed 64-bit scale, and the accelerometer correction uses
+ * a 32-bit reciprocal (hardware divider) instead of a float normalisation.
+ * Floats are only used when gains or the sample period change, and Euler
+ * angles are computed on demand (CORDIC atan2), not per sample.
+ *
+ * Input is raw counts as produced by QMI8658_decode_xyz_raw(); the caller
+ * passes the configured sensitivities once at init.
+ */
+#ifndef IMU_FUSION_H
+#define IMU_FUSION_H
+
+#include <stdint.h>
+
+/* Proportional / integral gains (1/s). Ki > 0 estimates gyro bias. */
+#ifndef IMU_FUSION_KP
+#define IMU_FUSION_KP 1.0f
+#endif
+#ifndef IMU_FUSION_KI
+#define IMU_FUSION_KI 0.01f
+#endif
+
+/* Accelerometer correction is skipped when |a| is outside 1 g +/- this
+ * fraction (linear acceleration would tilt the estimate). */
+#ifndef IMU_FUSION_ACC_GATE
+#define IMU_FUSION_ACC_GATE 0.25f
+#endif
+
+#define IMU_FUSION_Q30_ONE (1 << 30)
+
+typedef struct {
+    int32_t q[4];         // w x y z, Q30, unit norm
+
+    /* Constants derived by imu_fusion_set_period() */
+    int64_t k_gyro;       // counts -> half-angle per sample, Q46
+    int32_t k_p;          // Kp * dt / 2, Q30
+    int32_t k_i;          // Ki * dt * dt / 2, Q50 (tiny)
+    int64_t bias[3];      // integral term, half-angle per sample, Q50
+    uint32_t acc_lo2;     // gate on |a|^2 in counts^2
+    uint32_t acc_hi2;
+
+    float   gyro_lsb_per_dps;
+    float   acc_lsb_per_g;
+    uint32_t period_us;
+    uint32_t updates;
+} ImuFusion_t;
+
+typedef struct {
+    int32_t roll_cdeg;    // 0.01 degree units
+    int32_t pitch_cdeg;
+    int32_t yaw_cdeg;
+} ImuEuler_t;
+
+void imu_fusion_init(ImuFusion_t *f, float acc_lsb_per_g, float gyro_lsb_per_dps, uint32_t period_us);
+
+/* Re-derive the per-sample constants when the measured period drifts. */
+void imu_fusion_set_period(ImuFusion_t *f, uint32_t period_us);
+
+/* One sample of raw counts. */
+void imu_fusion_update(ImuFusion_t *f, const int16_t acc[3], const int16_t gyro[3]);
+
+void imu_fusion_euler(const ImuFusion_t *f, ImuEuler_t *out);
+
+/* Binary angle (2^32 = one turn) of the vector (x, y), like atan2(y, x). */
+uint32_t imu_fusion_atan2(int32_t y, int32_t x);
+
+#endif /* IMU_FUSION_H */
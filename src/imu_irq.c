@@ -0,0 +1,90 @@
+/* src/imu_irq.c — see imu_irq.h.
+ *
+ * Edge-triggered: a FIFO watermark line stays high while the FIFO is above
+ * the watermark, so a level interrupt would fire continuously until the
+ * task has drained it. The flip side is that an edge is only seen once; the
+ * task must drain until the condition clears (or poll as a fallback).
+ */
+#include "imu_irq.h"
+
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+
+#include "DEV_Config.h" // IMU_INT1_PIN, IMU_INT2_PIN
+
+static const uint     s_pin[IMU_IRQ_LINES] = { IMU_INT1_PIN, IMU_INT2_PIN };
+static const uint32_t s_ev[IMU_IRQ_LINES]  = { IMU_IRQ_EV_MOTION, IMU_IRQ_EV_DATA };
+
+static TaskHandle_t s_task;
+
+/* Written by the ISR; the task reads them with interrupts masked */
+static volatile uint64_t s_ts[IMU_IRQ_LINES];
+static volatile uint32_t s_pending;
+
+static ImuIrqStats_t s_stats;
+
+static void imu_gpio_irq_handler(void) {
+    BaseType_t woken = pdFALSE;
+    uint64_t now = time_us_64();
+
+    for (int i = 0; i < IMU_IRQ_LINES; i++) {
+        if (!(gpio_get_irq_event_mask(s_pin[i]) & GPIO_IRQ_EDGE_RISE)) continue;
+        gpio_acknowledge_irq(s_pin[i], GPIO_IRQ_EDGE_RISE);
+
+        s_ts[i] = now;
+        s_stats.edges[i]++;
+        if (s_pending & s_ev[i]) s_stats.coalesced[i]++;
+        s_pending |= s_ev[i];
+        xTaskNotifyFromISR(s_task, s_ev[i], eSetBits, &woken);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+bool imu_irq_init(TaskHandle_t task) {
+    if (!task) return false;
+    s_task = task;
+
+    for (int i = 0; i < IMU_IRQ_LINES; i++) {
+        gpio_init(s_pin[i]);
+        gpio_set_dir(s_pin[i], GPIO_IN);
+        gpio_pull_down(s_pin[i]); // INT is push-pull, active high; keep it quiet if unwired
+    }
+    gpio_add_raw_irq_handler_masked((1u << IMU_INT1_PIN) | (1u << IMU_INT2_PIN),
+                                    imu_gpio_irq_handler);
+    for (int i = 0; i < IMU_IRQ_LINES; i++) {
+        gpio_set_irq_enabled(s_pin[i], GPIO_IRQ_EDGE_RISE, true);
+    }
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    return true;
+}
+
+uint64_t imu_irq_timestamp(ImuIrqLine_t line) {
+    taskENTER_CRITICAL();
+    uint64_t t = s_ts[line];
+    taskEXIT_CRITICAL();
+    return t;
+}
+
+uint32_t imu_irq_wait(TickType_t timeout) {
+    uint32_t bits = 0;
+
+    if (xTaskNotifyWait(0, UINT32_MAX, &bits, timeout) != pdTRUE) return 0;
+
+    uint64_t now = time_us_64();
+    taskENTER_CRITICAL();
+    s_pending &= ~bits;
+    for (int i = 0; i < IMU_IRQ_LINES; i++) {
+        if (!(bits & s_ev[i])) continue;
+        uint32_t lat = (uint32_t)(now - s_ts[i]);
+        if (lat > s_stats.wake_us_max) s_stats.wake_us_max = lat;
+    }
+    taskEXIT_CRITICAL();
+    return bits;
+}
+
+void imu_irq_get_stats(ImuIrqStats_t *out) {
+    taskENTER_CRITICAL();
+    *out = s_stats;
+    taskEXIT_CRITICAL();
+}
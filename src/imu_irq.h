@@ -0,0 +1,53 @@
+/* src/imu_irq.h — QMI8658 INT1/INT2 lines as task events.
+ *
+ * The GPIO ISR does no bus work: it latches time_us_64() for the line that
+ * fired and sets an event bit in the owning task's default notification
+ * slot. The task waits with xTaskNotifyWait() and reads the sensor through
+ * the I2C bus manager. What each line signals is set in the sensor
+ * (QMI8658_config_interrupts()); the wiring used here is:
+ *
+ *   INT1  wake-on-motion (QMI8658_enableWakeOnMotion() routes it to INT1),
+ *         armed by the IMU task while the board lies still
+ *   INT2  FIFO watermark, or data-ready when the FIFO is bypassed
+ *
+ * Pins are IMU_INT1_PIN / IMU_INT2_PIN in DEV_Config.h.
+ */
+#ifndef IMU_IRQ_H
+#define IMU_IRQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Notification bits delivered to the task */
+#define IMU_IRQ_EV_MOTION  (1u << 0)  // INT1
+#define IMU_IRQ_EV_DATA    (1u << 1)  // INT2: FIFO watermark / data ready
+
+typedef enum {
+    IMU_IRQ_INT1 = 0,
+    IMU_IRQ_INT2,
+    IMU_IRQ_LINES
+} ImuIrqLine_t;
+
+typedef struct {
+    uint32_t edges[IMU_IRQ_LINES];     // interrupts taken
+    uint32_t coalesced[IMU_IRQ_LINES]; // edges while the previous event was still pending
+    uint32_t wake_us_max;              // ISR -> task wake-up latency, worst case
+} ImuIrqStats_t;
+
+/* Configure both pins as rising-edge interrupts that notify `task`.
+ * Call before vTaskStartScheduler(), after the sensor is configured. */
+bool imu_irq_init(TaskHandle_t task);
+
+/* time_us_64() of the most recent edge on `line` (0 = never). */
+uint64_t imu_irq_timestamp(ImuIrqLine_t line);
+
+/* Wait up to `timeout` for events; returns the IMU_IRQ_EV_* bits that were
+ * pending (0 on timeout). Call only from the task given to imu_irq_init(). */
+uint32_t imu_irq_wait(TickType_t timeout);
+
+void imu_irq_get_stats(ImuIrqStats_t *out);
+
+#endif /* IMU_IRQ_H */
@@ -0,0 +1,113 @@
+/* src/imu_stream.c — see imu_stream.h; ring semantics as in sensor_history.c. */
+#include "imu_stream.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "QMI8658.h"
+
+#define IMU_MASK     (IMU_STREAM_CAPACITY - 1u)
+#define IMU_READABLE (IMU_STREAM_CAPACITY - 1u)
+
+_Static_assert((IMU_STREAM_CAPACITY & IMU_MASK) == 0,
+               "IMU_STREAM_CAPACITY must be a power of two");
+
+static ImuRawSample_t s_buf[IMU_STREAM_CAPACITY];
+static uint32_t       s_head;
+
+/* Producer-only period estimator state: the previous anchor */
+static uint32_t s_prev_t_us;
+static uint32_t s_prev_idx;  // its absolute sample index
+static bool     s_have_prev;
+
+static ImuStreamStats_t s_stats = { .period_us = IMU_STREAM_NOMINAL_PERIOD_US };
+
+void imu_stream_push_frames(const uint8_t *frames, size_t n, size_t anchor,
+                            uint32_t t_anchor_us, bool overflow) {
+    uint32_t period = s_stats.period_us;
+    uint32_t h = s_head;
+
+    if (n == 0) return;
+    if (anchor >= n) anchor = n - 1u;
+    uint32_t idx = h + (uint32_t)anchor;
+
+    /* Without loss, the sample count between two anchors is exact; an
+     * overflowed drain dropped an unknown number, so it is not used. */
+    if (s_have_prev && !overflow && idx != s_prev_idx) {
+        uint32_t measured = (t_anchor_us - s_prev_t_us) / (idx - s_prev_idx);
+        period += ((int32_t)(measured - period)) / 8;
+    }
+    s_prev_t_us = t_anchor_us;
+    s_prev_idx  = idx;
+    s_have_prev = true;
+
+    for (size_t i = 0; i < n; i++) {
+        ImuRawSample_t *s = &s_buf[(h + i) & IMU_MASK];
+        s->t_us = t_anchor_us + ((int32_t)i - (int32_t)anchor) * (int32_t)period;
+        QMI8658_decode_xyz_raw(&frames[i * QMI8658_FIFO_FRAME_BYTES], s->acc, s->gyro);
+    }
+    __atomic_store_n(&s_head, h + (uint32_t)n, __ATOMIC_RELEASE);
+
+    taskENTER_CRITICAL();
+    s_stats.batches++;
+    s_stats.samples += (uint32_t)n;
+    if (overflow) s_stats.fifo_overflows++;
+    if (n > s_stats.max_batch) s_stats.max_batch = (uint32_t)n;
+    s_stats.period_us = period;
+    taskEXIT_CRITICAL();
+}
+
+void imu_stream_resume(void) {
+    s_have_prev = false;
+}
+
+uint32_t imu_stream_count(void) {
+    return __atomic_load_n(&s_head, __ATOMIC_ACQUIRE);
+}
+
+void imu_stream_cursor_init(ImuStreamCursor_t *cur, bool from_oldest) {
+    uint32_t head = imu_stream_count();
+
+    cur->overruns = 0;
+    if (from_oldest && head > IMU_READABLE) {
+        cur->tail = head - IMU_READABLE;
+    } else {
+        cur->tail = from_oldest ? 0u : head;
+    }
+}
+
+size_t imu_stream_peek(ImuStreamCursor_t *cur, const ImuRawSample_t **span) {
+    uint32_t head  = imu_stream_count();
+    uint32_t avail = head - cur->tail;
+
+    if (avail > IMU_READABLE) {
+        cur->overruns += avail - IMU_READABLE;
+        cur->tail      = head - IMU_READABLE;
+        avail          = IMU_READABLE;
+    }
+
+    uint32_t slot   = cur->tail & IMU_MASK;
+    uint32_t to_end = IMU_STREAM_CAPACITY - slot;
+
+    *span = &s_buf[slot];
+    return (avail < to_end) ? avail : to_end;
+}
+
+bool imu_stream_release(ImuStreamCursor_t *cur, size_t n) {
+    uint32_t lag = imu_stream_count() - cur->tail;
+    bool     ok  = true;
+
+    if (lag > IMU_READABLE) {
+        uint32_t lost = lag - IMU_READABLE;
+        cur->overruns += (lost < n) ? lost : (uint32_t)n;
+        ok = false;
+    }
+    cur->tail += (uint32_t)n;
+    return ok;
+}
+
+void imu_stream_get_stats(ImuStreamStats_t *out) {
+    taskENTER_CRITICAL();
+    *out = s_stats;
+    taskEXIT_CRITICAL();
+}
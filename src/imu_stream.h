@@ -0,0 +1,74 @@
+/* src/imu_stream.h — full-rate raw IMU samples from the QMI8658 FIFO.
+ *
+ * The IMU task drains the sensor FIFO in bursts (one bus transaction per
+ * drain) and pushes every frame here, dated from one anchor frame whose
+ * time is known (the watermark frame, stamped by the INT2 ISR) using the
+ * measured sample period. Same single-producer / cursor-per-consumer
+ * scheme as sensor_history: the producer never waits, slow consumers see
+ * overruns.
+ */
+#ifndef IMU_STREAM_H
+#define IMU_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Raw samples kept; must be a power of two (1024 is ~1.1 s at 1 kHz ODR). */
+#ifndef IMU_STREAM_CAPACITY
+#define IMU_STREAM_CAPACITY 1024u
+#endif
+
+/* Acquisition: FIFO watermark (ODR samples) and the fallback drain period
+ * used when no watermark interrupt arrives (unwired INT2, missed edge). The
+ * 128-sample FIFO lasts ~140 ms at 1 kHz, so 50 ms leaves ample margin. */
+#ifndef IMU_FIFO_WATERMARK
+#define IMU_FIFO_WATERMARK 64u
+#endif
+#ifndef IMU_FIFO_POLL_MS
+#define IMU_FIFO_POLL_MS 50u
+#endif
+
+/* Sample period assumed until the first two drains measure it. */
+#ifndef IMU_STREAM_NOMINAL_PERIOD_US
+#define IMU_STREAM_NOMINAL_PERIOD_US 1000u
+#endif
+
+typedef struct {
+    uint32_t t_us;     // time_us_32() at the sample (back-dated)
+    int16_t  acc[3];   // raw counts, see QMI8658 range
+    int16_t  gyro[3];
+} ImuRawSample_t;
+
+typedef struct {
+    uint32_t tail;
+    uint32_t overruns;
+} ImuStreamCursor_t;
+
+typedef struct {
+    uint32_t batches;
+    uint32_t samples;
+    uint32_t fifo_overflows;  // drains that found the sensor FIFO overflowed
+    uint32_t max_batch;
+    uint32_t period_us;       // current sample period estimate
+} ImuStreamStats_t;
+
+/* Producer: n FIFO frames (QMI8658_FIFO_FRAME_BYTES each); frame `anchor`
+ * (< n) was taken at t_anchor_us. overflow = the FIFO lost samples before
+ * this drain. */
+void imu_stream_push_frames(const uint8_t *frames, size_t n, size_t anchor,
+                            uint32_t t_anchor_us, bool overflow);
+
+/* Producer: acquisition restarts after a pause (wake-on-motion); the first
+ * anchor after it does not update the period estimate. */
+void imu_stream_resume(void);
+
+uint32_t imu_stream_count(void);
+
+void   imu_stream_cursor_init(ImuStreamCursor_t *cur, bool from_oldest);
+size_t imu_stream_peek(ImuStreamCursor_t *cur, const ImuRawSample_t **span);
+bool   imu_stream_release(ImuStreamCursor_t *cur, size_t n);
+
+void imu_stream_get_stats(ImuStreamStats_t *out);
+
+#endif /* IMU_STREAM_H */
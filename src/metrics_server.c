@@ -0,0 +1,425 @@
+/* src/metrics_server.c — see metrics_server.h.
+ *
+ * Lines are printed straight into the output window with vsnprintf(); a
+ * line that does not fit flushes the window and is printed again. After
+ * the first socket error every further line is skipped, so the exporters
+ * below never check results.
+ */
+#include "metrics_server.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/sockets.h"
+
+#include "byte_sink.h"
+#include "sensor_data.h"
+#include "sensor_history.h"
+#include "adc_engine.h"
+#include "i2c_bus.h"
+#include "imu_stream.h"
+#include "flash_store.h"
+#include "uplink.h"
+
+typedef struct {
+    int      fd;
+    bool     failed;
+    uint32_t bytes;
+} Conn_t;
+
+/* Aggregates of one channel's retained history */
+typedef struct {
+    uint32_t n;
+    float    min, max, last;
+    double   sum;
+    uint32_t t_first, t_last;
+} ChannelAgg_t;
+
+static char    s_req[METRICS_SERVER_REQ_LEN];
+static uint8_t s_out[METRICS_SERVER_WINDOW];
+static MetricsServerStats_t s_stats;
+
+static const char s_hdr_ok[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+    "Connection: close\r\n\r\n";
+static const char s_hdr_404[] =
+    "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n"
+    "Only /metrics is served here\n";
+static const char s_hdr_400[] =
+    "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n";
+
+/* ====================================================================
+   --- Output window ---
+   ==================================================================== */
+
+static bool write_all(Conn_t *c, const void *buf, size_t len) {
+    const uint8_t *p = (const uint8_t *)buf;
+    while (len > 0) {
+        int n = lwip_write(c->fd, p, len);
+        if (n <= 0) return false;
+        p   += n;
+        len -= (size_t)n;
+        c->bytes += (uint32_t)n;
+    }
+    return true;
+}
+
+static bool window_flush(ByteSink_t *sink) {
+    Conn_t *c = (Conn_t *)sink->ctx;
+    if (c->failed || !write_all(c, sink->buf, sink->len)) {
+        c->failed = true;
+        return false;
+    }
+    sink->len = 0;
+    return true;
+}
+
+static void emit(ByteSink_t *out, const char *fmt, ...) {
+    Conn_t *c = (Conn_t *)out->ctx;
+    for (int pass = 0; pass < 2 && !c->failed; pass++) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf((char *)out->buf + out->len, out->cap - out->len, fmt, ap);
+        va_end(ap);
+        if (n >= 0 && (size_t)n < out->cap - out->len) {
+            out->len += (size_t)n;
+            return;
+        }
+        if (n < 0 || pass == 1 || !out->flush(out)) break;
+    }
+    c->failed = true;  // longer than the window
+}
+
+/* One metric family: HELP and TYPE, then its samples */
+static void family(ByteSink_t *out, const char *name, const char *type, const char *help) {
+    emit(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void sample_u(ByteSink_t *out, const char *name, const char *label, const char *value, uint64_t v) {
+    if (label) emit(out, "%s{%s=\"%s\"} %llu\n", name, label, value, (unsigned long long)v);
+    else       emit(out, "%s %llu\n", name, (unsigned long long)v);
+}
+
+static void sample_f(ByteSink_t *out, const char *name, const char *label, const char *value, double v) {
+    const char *special = isnan(v) ? "NaN" : isinf(v) ? (v > 0 ? "+Inf" : "-Inf") : NULL;
+    if (special) {
+        if (label) emit(out, "%s{%s=\"%s\"} %s\n", name, label, value, special);
+        else       emit(out, "%s %s\n", name, special);
+    } else {
+        if (label) emit(out, "%s{%s=\"%s\"} %.6g\n", name, label, value, v);
+        else       emit(out, "%s %.6g\n", name, v);
+    }
+}
+
+/* Family with a single unlabelled sample */
+static void counter(ByteSink_t *out, const char *name, const char *help, uint64_t v) {
+    family(out, name, "counter", help);
+    sample_u(out, name, NULL, NULL, v);
+}
+
+static void gauge(ByteSink_t *out, const char *name, const char *help, double v) {
+    family(out, name, "gauge", help);
+    sample_f(out, name, NULL, NULL, v);
+}
+
+/* ====================================================================
+   --- Exporters ---
+   ==================================================================== */
+
+static void export_latest(ByteSink_t *out) {
+    static const char *const axes[3]   = { "x", "y", "z" };
+    static const char *const angles[3] = { "roll", "pitch", "yaw" };
+    static const char *const groups[SENSOR_FIELD_COUNT] = {
+        [SENSOR_FIELD_TEMP_HUM]    = "temp_hum",
+        [SENSOR_FIELD_VOC]         = "voc",
+        [SENSOR_FIELD_IMU]         = "imu",
+        [SENSOR_FIELD_ORIENTATION] = "orientation",
+        [SENSOR_FIELD_LIGHT]       = "light",
+        [SENSOR_FIELD_SOUND]       = "sound",
+    };
+    SensorData_t d;
+    SensorDataSeq_t seq;
+    sensor_data_snapshot(&d, &seq);
+
+    family(out, "pico_sensor_updates_total", "counter", "Publications of each sensor_data field group");
+    for (int f = 0; f < SENSOR_FIELD_COUNT; f++) {
+        sample_u(out, "pico_sensor_updates_total", "group", groups[f], seq.seq[f]);
+    }
+    /* Groups never written are left out rather than exported as 0 */
+    if (seq.seq[SENSOR_FIELD_TEMP_HUM]) {
+        gauge(out, "pico_sensor_temperature_celsius", "SHTC3 temperature", d.temp);
+        gauge(out, "pico_sensor_humidity_percent", "SHTC3 relative humidity", d.hum);
+    }
+    if (seq.seq[SENSOR_FIELD_VOC]) {
+        gauge(out, "pico_sensor_voc_index", "SGP40 VOC index", d.voc);
+    }
+    if (seq.seq[SENSOR_FIELD_IMU]) {
+        family(out, "pico_sensor_acceleration", "gauge", "QMI8658 acceleration per axis (driver units)");
+        for (int i = 0; i < 3; i++) sample_f(out, "pico_sensor_acceleration", "axis", axes[i], d.acc[i]);
+        family(out, "pico_sensor_angular_rate", "gauge", "QMI8658 angular rate per axis (driver units)");
+        for (int i = 0; i < 3; i++) sample_f(out, "pico_sensor_angular_rate", "axis", axes[i], d.gyro[i]);
+    }
+    if (seq.seq[SENSOR_FIELD_ORIENTATION]) {
+        family(out, "pico_sensor_orientation_degrees", "gauge", "Fused orientation (Euler angles)");
+        for (int i = 0; i < 3; i++) {
+            sample_f(out, "pico_sensor_orientation_degrees", "angle", angles[i], d.euler[i]);
+        }
+    }
+    if (seq.seq[SENSOR_FIELD_LIGHT]) {
+        gauge(out, "pico_sensor_light_raw", "Light sensor ADC reading (0-4095)", d.light);
+    }
+    if (seq.seq[SENSOR_FIELD_SOUND]) {
+        gauge(out, "pico_sensor_sound_leq_db", "Sound Leq, dB re 1 ADC LSB RMS", d.sound / 10.0);
+    }
+}
+
+/* Read the retained samples in place; a sample the producer overwrote
+ * meanwhile may count towards the aggregates, which is harmless here. */
+static void channel_agg(SensorChannel_t ch, ChannelAgg_t *a) {
+    SensorHistoryCursor_t cur;
+    const SensorSample_t *span;
+    size_t n;
+
+    memset(a, 0, sizeof(*a));
+    sensor_history_cursor_init(&cur, ch, true);
+    while ((n = sensor_history_peek(&cur, &span)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            float v = span[i].value;
+            if (a->n == 0) {
+                a->min = a->max = v;
+                a->t_first = span[i].t_ms;
+            }
+            if (v < a->min) a->min = v;
+            if (v > a->max) a->max = v;
+            a->sum   += v;
+            a->last   = v;
+            a->t_last = span[i].t_ms;
+            a->n++;
+        }
+        sensor_history_release(&cur, n);
+    }
+}
+
+static void export_history(ByteSink_t *out) {
+    ChannelAgg_t agg[SENSOR_CH_COUNT];
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+
+    for (int ch = 0; ch < SENSOR_CH_COUNT; ch++) channel_agg((SensorChannel_t)ch, &agg[ch]);
+
+    family(out, "pico_history_samples_total", "counter", "Samples pushed to each history channel");
+    for (int ch = 0; ch < SENSOR_CH_COUNT; ch++) {
+        sample_u(out, "pico_history_samples_total", "channel", sensor_channel_name((SensorChannel_t)ch),
+                 sensor_history_count((SensorChannel_t)ch));
+    }
+    family(out, "pico_history_window_samples", "gauge", "Samples retained in each history ring");
+    for (int ch = 0; ch < SENSOR_CH_COUNT; ch++) {
+        sample_u(out, "pico_history_window_samples", "channel", sensor_channel_name((SensorChannel_t)ch),
+                 agg[ch].n);
+    }
+
+    /* Aggregates over the retained window, for channels that have one */
+    static const struct {
+        const char *name, *help;
+    } stat[] = {
+        { "pico_history_window_seconds", "Time covered by the retained samples" },
+        { "pico_history_min",            "Smallest retained sample" },
+        { "pico_history_max",            "Largest retained sample" },
+        { "pico_history_mean",           "Mean of the retained samples" },
+        { "pico_history_last",           "Newest sample" },
+        { "pico_history_age_seconds",    "Age of the newest sample" },
+    };
+    for (size_t s = 0; s < sizeof(stat) / sizeof(stat[0]); s++) {
+        family(out, stat[s].name, "gauge", stat[s].help);
+        for (int ch = 0; ch < SENSOR_CH_COUNT; ch++) {
+            const ChannelAgg_t *a = &agg[ch];
+            double v;
+            if (a->n == 0) continue;
+            switch (s) {
+            case 0:  v = (a->t_last - a->t_first) / 1000.0; break;
+            case 1:  v = a->min; break;
+            case 2:  v = a->max; break;
+            case 3:  v = a->sum / a->n; break;
+            case 4:  v = a->last; break;
+            default: v = (now - a->t_last) / 1000.0; break;
+            }
+            sample_f(out, stat[s].name, "channel", sensor_channel_name((SensorChannel_t)ch), v);
+        }
+    }
+}
+
+static void export_counters(ByteSink_t *out) {
+    static const char *const prio[I2C_PRIO_COUNT] = { "0", "1", "2" };
+    UplinkStats_t up;
+    AdcEngineStats_t adc;
+    I2cBusStats_t bus;
+    ImuStreamStats_t imu;
+    FlashStoreStats_t fs;
+    MetricsServerStats_t ms;
+
+    uplink_get_stats(&up);
+    adc_engine_get_stats(&adc);
+    i2c_bus_get_stats(&bus);
+    imu_stream_get_stats(&imu);
+    flash_store_get_stats(&fs);
+    metrics_server_get_stats(&ms);
+
+    gauge(out, "pico_uptime_seconds", "Time since boot", to_ms_since_boot(get_absolute_time()) / 1000.0);
+    gauge(out, "pico_heap_free_bytes", "FreeRTOS heap free", xPortGetFreeHeapSize());
+    gauge(out, "pico_heap_min_free_bytes", "FreeRTOS heap low-water mark", xPortGetMinimumEverFreeHeapSize());
+
+    counter(out, "pico_uplink_batches_total", "Uplink batches posted", up.batches);
+    counter(out, "pico_uplink_failures_total", "Uplink posts that failed", up.failures);
+    counter(out, "pico_uplink_records_total", "Samples delivered by the uplink", up.records_sent);
+    counter(out, "pico_uplink_payload_bytes_total", "Encoded bytes of delivered batches", up.payload_bytes);
+    counter(out, "pico_uplink_dropped_total", "Samples lost to history overruns", up.dropped);
+    gauge(out, "pico_uplink_pending_records", "Samples waiting in the batch", up.pending);
+    counter(out, "pico_uplink_spilled_total", "Samples moved to the flash log", up.spilled);
+    counter(out, "pico_uplink_drained_total", "Samples posted from the flash log", up.drained);
+    if (up.log.capacity > 0) {
+        gauge(out, "pico_uplink_log_used_records", "Unsent records in the flash log", up.log.used);
+        gauge(out, "pico_uplink_log_capacity_records", "Flash log size", up.log.capacity);
+        counter(out, "pico_uplink_log_dropped_total", "Flash log records overwritten unsent", up.log.dropped);
+    }
+
+    counter(out, "pico_adc_windows_total", "ADC engine windows processed", adc.windows);
+    counter(out, "pico_adc_dropped_windows_total", "ADC windows overwritten unprocessed", adc.dropped_windows);
+
+    family(out, "pico_i2c_transactions_total", "counter", "I2C transactions completed per priority");
+    for (int p = 0; p < I2C_PRIO_COUNT; p++) {
+        sample_u(out, "pico_i2c_transactions_total", "prio", prio[p], bus.completed[p]);
+    }
+    counter(out, "pico_i2c_errors_total", "I2C transactions that failed", bus.errors);
+
+    counter(out, "pico_imu_samples_total", "Raw IMU samples drained from the FIFO", imu.samples);
+    counter(out, "pico_imu_fifo_overflows_total", "IMU FIFO overflows", imu.fifo_overflows);
+
+    counter(out, "pico_flash_store_writes_total", "flash_store records written", fs.writes);
+    counter(out, "pico_flash_store_failures_total", "flash_store write failures", fs.failures);
+
+    counter(out, "pico_metrics_scrapes_total", "Previous /metrics responses", ms.scrapes);
+    counter(out, "pico_metrics_errors_total", "Failed metrics requests", ms.errors);
+    gauge(out, "pico_metrics_last_response_bytes", "Size of the previous /metrics response", ms.last_bytes);
+}
+
+/* ====================================================================
+   --- Connection ---
+   ==================================================================== */
+
+/* Read the request line into s_req and the rest of the request up to the
+ * blank line into nothing. False on a timeout or error. */
+static bool read_request(Conn_t *c) {
+    static const char eoh[] = "\r\n\r\n";
+    size_t have = 0, matched = 0;
+    char buf[64];
+
+    while (matched < 4u) {
+        int n = lwip_read(c->fd, buf, sizeof(buf));
+        if (n <= 0) return false;
+        for (int i = 0; i < n && matched < 4u; i++) {
+            if (have < sizeof(s_req) - 1u) s_req[have++] = buf[i];
+            matched = (buf[i] == eoh[matched]) ? matched + 1u : (buf[i] == '\r') ? 1u : 0u;
+        }
+    }
+    s_req[have] = '\0';
+    return true;
+}
+
+static void serve(int fd) {
+    Conn_t c = { .fd = fd };
+    uint64_t t0 = time_us_64();
+    bool scraped = false, not_found = false;
+
+    if (!read_request(&c)) {
+        c.failed = true;
+    } else if (strncmp(s_req, "GET ", 4) != 0) {
+        write_all(&c, s_hdr_400, sizeof(s_hdr_400) - 1u);
+    } else if (strncmp(s_req + 4, "/metrics", 8) != 0 || (s_req[12] != ' ' && s_req[12] != '?')) {
+        not_found = write_all(&c, s_hdr_404, sizeof(s_hdr_404) - 1u);
+        c.failed  = !not_found;
+    } else {
+        ByteSink_t out = {
+            .buf = s_out, .cap = sizeof(s_out), .len = 0, .flush = window_flush, .ctx = &c,
+        };
+        c.failed = !write_all(&c, s_hdr_ok, sizeof(s_hdr_ok) - 1u);
+        export_latest(&out);
+        export_history(&out);
+        export_counters(&out);
+        if (out.len > 0) window_flush(&out);
+        scraped = !c.failed;
+    }
+
+    uint32_t us = (uint32_t)(time_us_64() - t0);
+    taskENTER_CRITICAL();
+    s_stats.bytes += c.bytes;
+    if (scraped) {
+        s_stats.scrapes++;
+        s_stats.last_bytes = c.bytes;
+        s_stats.scrape_us += us;
+        if (us > s_stats.scrape_us_max) s_stats.scrape_us_max = us;
+    } else if (not_found) {
+        s_stats.not_found++;
+    } else {
+        s_stats.errors++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+static int listen_socket(void) {
+    struct sockaddr_in addr = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(METRICS_SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    int fd = lwip_socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (lwip_bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || lwip_listen(fd, 1) != 0) {
+        lwip_close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void vMetricsTask(void *pvParameters) {
+    (void)pvParameters;
+    const struct timeval tv = {
+        .tv_sec  = METRICS_SERVER_IO_TIMEOUT_MS / 1000u,
+        .tv_usec = (METRICS_SERVER_IO_TIMEOUT_MS % 1000u) * 1000u,
+    };
+    int lfd = -1;
+
+    for (;;) {
+        if (lfd < 0 && (lfd = listen_socket()) < 0) {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+        int fd = lwip_accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            lwip_close(lfd);
+            lfd = -1;
+            continue;
+        }
+        lwip_setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        lwip_setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        serve(fd);
+        lwip_close(fd);
+    }
+}
+
+bool metrics_server_start(unsigned task_priority) {
+    return xTaskCreate(vMetricsTask, "MetricsTask", METRICS_SERVER_STACK_WORDS, NULL,
+                       task_priority, NULL) == pdPASS;
+}
+
+void metrics_server_get_stats(MetricsServerStats_t *out) {
+    taskENTER_CRITICAL();
+    *out = s_stats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,66 @@
+/* src/metrics_server.h — Prometheus /metrics endpoint on lwIP.
+ *
+ * A task of its own serves GET /metrics on METRICS_SERVER_PORT in the
+ * Prometheus text exposition format (version 0.0.4), for pull-based
+ * monitoring next to the pushed uplink:
+ *
+ *   - the latest readings, read through the sensor_data.h latch;
+ *   - per-channel aggregates (min, max, mean, last, age) over the samples
+ *     still held in sensor_history, read in place through cursors of the
+ *     scrape's own;
+ *   - the internal counters of the uplink, ADC engine, I2C bus, IMU
+ *     stream, flash store, the FreeRTOS heap and this server.
+ *
+ * No sensor data is copied under a lock: the latch and the history rings
+ * are lock-free for readers, and only the small stats structs are copied
+ * in a critical section, as everywhere else.
+ *
+ * Memory is fixed: one connection at a time (others wait in the listen
+ * backlog), a METRICS_SERVER_REQ_LEN request buffer and a
+ * METRICS_SERVER_WINDOW output window. The response is written into the
+ * window line by line and the window goes to the socket whenever the next
+ * line does not fit, so its size does not depend on how much is exported.
+ * The response has no Content-Length; it ends when the connection closes.
+ * Socket timeouts keep a stalled client from holding the server.
+ */
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef METRICS_SERVER_PORT
+#define METRICS_SERVER_PORT 9100
+#endif
+/* Output window; the longest line must fit */
+#ifndef METRICS_SERVER_WINDOW
+#define METRICS_SERVER_WINDOW 512u
+#endif
+/* Request bytes kept (the request line; headers are read and discarded) */
+#ifndef METRICS_SERVER_REQ_LEN
+#define METRICS_SERVER_REQ_LEN 128u
+#endif
+/* Receive and send timeout per socket operation */
+#ifndef METRICS_SERVER_IO_TIMEOUT_MS
+#define METRICS_SERVER_IO_TIMEOUT_MS 3000u
+#endif
+#ifndef METRICS_SERVER_STACK_WORDS
+#define METRICS_SERVER_STACK_WORDS 1024u
+#endif
+
+typedef struct {
+    uint32_t scrapes;        // /metrics responses sent in full
+    uint32_t not_found;      // requests for anything else
+    uint32_t errors;         // bad requests, socket errors and timeouts
+    uint32_t bytes;          // response bytes sent
+    uint32_t last_bytes;     // size of the last /metrics response
+    uint64_t scrape_us;      // total time generating and sending responses
+    uint32_t scrape_us_max;
+} MetricsServerStats_t;
+
+/* Create the server task; it listens once lwIP is up. */
+bool metrics_server_start(unsigned task_priority);
+
+void metrics_server_get_stats(MetricsServerStats_t *out);
+
+#endif /* METRICS_SERVER_H */
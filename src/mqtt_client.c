@@ -0,0 +1,403 @@
+/* src/mqtt_client.c — see mqtt_client.h.
+ *
+ * A PUBLISH is built in its slot in place: the payload is encoded at a
+ * fixed offset behind the longest possible fixed header and the topic,
+ * then the fixed header is written right in front of the variable header
+ * once the remaining length is known. A retransmission only sets the DUP
+ * bit in the first byte.
+ */
+#include "mqtt_client.h"
+
+#include <string.h>
+
+/* Control packet types (first byte) */
+#define PKT_CONNECT    0x10u
+#define PKT_CONNACK    0x20u
+#define PKT_PUBLISH_Q1 0x32u
+#define PKT_PUBACK     0x40u
+#define PKT_PINGREQ    0xC0u
+#define PKT_PINGRESP   0xD0u
+#define PKT_DISCONNECT 0xE0u
+#define PUBLISH_DUP    0x08u
+
+/* Fixed header of a PUBLISH: type + up to 2 bytes of remaining length */
+#define PUB_HDR_MAX 3u
+
+_Static_assert(MQTT_CLIENT_SLOT_LEN < 16384u, "a PUBLISH must fit a 2-byte remaining length");
+_Static_assert(PUB_HDR_MAX + 2u + MQTT_CLIENT_TOPIC_MAX + 2u < MQTT_CLIENT_SLOT_LEN,
+               "no room for a payload in a slot");
+
+static size_t put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+    return 2;
+}
+
+static size_t put_str(uint8_t *p, const char *s, size_t n) {
+    put_u16(p, (uint16_t)n);
+    memcpy(p + 2, s, n);
+    return 2u + n;
+}
+
+static size_t varint_len(uint32_t v) {
+    size_t n = 1;
+    while (v >= 0x80u) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static size_t put_varint(uint8_t *p, uint32_t v) {
+    size_t n = 0;
+    do {
+        uint8_t b = (uint8_t)(v & 0x7Fu);
+        v >>= 7;
+        p[n++] = v ? (uint8_t)(b | 0x80u) : b;
+    } while (v != 0);
+    return n;
+}
+
+static uint32_t now(const MqttClient_t *c) {
+    return c->tp->now_ms();
+}
+
+static void drop(MqttClient_t *c) {
+    if (!c->connected) return;
+    c->tp->close(c->tp->ctx);
+    c->connected    = false;
+    c->ping_pending = false;
+    c->rx_len       = 0;
+    c->rx_skip      = 0;
+}
+
+static bool send_packet(MqttClient_t *c, const uint8_t *buf, size_t len) {
+    if (!c->connected) return false;
+    if (!c->tp->send(c->tp->ctx, buf, len)) {
+        drop(c);
+        return false;
+    }
+    c->stats.tx_bytes += (uint32_t)len;
+    c->last_tx_ms      = now(c);
+    return true;
+}
+
+static uint32_t inflight(const MqttClient_t *c) {
+    uint32_t n = 0;
+    for (unsigned i = 0; i < MQTT_CLIENT_INFLIGHT; i++) n += c->slots[i].id != 0;
+    return n;
+}
+
+/* p is one whole packet; the ones handled have a 1-byte remaining length */
+static void handle_packet(MqttClient_t *c, const uint8_t *p, size_t len, int *connack) {
+    switch (p[0] & 0xF0u) {
+    case PKT_CONNACK:
+        // flags: session present; then the return code
+        if (len == 4 && connack) *connack = (p[2] & 1u) << 8 | p[3];
+        break;
+    case PKT_PUBACK: {
+        if (len != 4) break;
+        uint16_t id = (uint16_t)(p[2] << 8 | p[3]);
+        for (unsigned i = 0; i < MQTT_CLIENT_INFLIGHT; i++) {
+            MqttSlot_t *s = &c->slots[i];
+            if (s->id != id || id == 0) continue;
+            uint32_t ms = now(c) - s->first_ms;
+            s->id = 0;
+            c->stats.acked++;
+            c->stats.ack_ms += ms;
+            if (ms > c->stats.ack_ms_max) c->stats.ack_ms_max = ms;
+            break;
+        }
+        break;
+    }
+    case PKT_PINGRESP:
+        c->ping_pending = false;
+        break;
+    default:
+        // Nothing else is expected by a client that does not subscribe
+        break;
+    }
+}
+
+/* Read once (waiting up to timeout_ms) and handle the complete packets.
+ * Returns the bytes read, 0 if none, < 0 if the connection was dropped. */
+static int pump(MqttClient_t *c, uint32_t timeout_ms, int *connack) {
+    if (!c->connected) return -1;
+
+    int n;
+    if (c->rx_skip > 0) {
+        uint8_t junk[64];
+        size_t want = c->rx_skip < sizeof(junk) ? c->rx_skip : sizeof(junk);
+        n = c->tp->recv(c->tp->ctx, junk, want, timeout_ms);
+        if (n > 0) c->rx_skip -= (uint32_t)n;
+    } else {
+        n = c->tp->recv(c->tp->ctx, c->rx + c->rx_len, sizeof(c->rx) - c->rx_len, timeout_ms);
+        if (n > 0) c->rx_len += (uint32_t)n;
+    }
+    if (n < 0) {
+        drop(c);
+        return -1;
+    }
+    c->stats.rx_bytes += (uint32_t)n;
+
+    /* Type byte, remaining length (1..4 bytes), rest */
+    while (c->rx_len >= 2u) {
+        uint32_t rem = 0, i = 1;
+        for (;; i++) {
+            if (i >= c->rx_len) return n;   // length incomplete
+            if (i > 4u) {                   // malformed
+                drop(c);
+                return -1;
+            }
+            rem |= (uint32_t)(c->rx[i] & 0x7Fu) << (7u * (i - 1u));
+            if ((c->rx[i] & 0x80u) == 0) break;
+        }
+        uint32_t total = i + 1u + rem;
+        if (total > sizeof(c->rx)) {
+            c->rx_skip = total - c->rx_len;
+            c->rx_len  = 0;
+            break;
+        }
+        if (c->rx_len < total) break;
+        handle_packet(c, c->rx, total, connack);
+        c->rx_len -= total;
+        memmove(c->rx, c->rx + total, c->rx_len);
+    }
+    return n;
+}
+
+/* Resend the window, oldest first */
+static void resend_window(MqttClient_t *c) {
+    MqttSlot_t *order[MQTT_CLIENT_INFLIGHT];
+    unsigned n = 0;
+    for (unsigned i = 0; i < MQTT_CLIENT_INFLIGHT; i++) {
+        MqttSlot_t *s = &c->slots[i];
+        if (s->id == 0) continue;
+        unsigned k = n++;
+        for (; k > 0 && (int32_t)(order[k - 1]->order - s->order) > 0; k--) order[k] = order[k - 1];
+        order[k] = s;
+    }
+    for (unsigned k = 0; k < n && c->connected; k++) {
+        MqttSlot_t *s = order[k];
+        s->buf[s->off] |= PUBLISH_DUP;
+        s->sent_ms = now(c);
+        if (send_packet(c, s->buf + s->off, s->len)) c->stats.retransmits++;
+    }
+}
+
+static bool send_connect(MqttClient_t *c) {
+    const MqttConnectOpts_t *o = &c->opts;
+    size_t id_len   = strlen(o->client_id);
+    size_t user_len = o->username ? strlen(o->username) : 0;
+    size_t pass_len = (o->username && o->password) ? strlen(o->password) : 0;
+    uint8_t pkt[256], *p = pkt;
+    uint8_t flags = 0;
+
+    // Variable header (10) + strings, behind at most 2 bytes of remaining length
+    uint32_t rem = 10u + 2u + (uint32_t)id_len;
+    if (o->username) {
+        flags |= 0x80u;
+        rem   += 2u + (uint32_t)user_len;
+    }
+    if (o->username && o->password) {
+        flags |= 0x40u;
+        rem   += 2u + (uint32_t)pass_len;
+    }
+    if (1u + varint_len(rem) + rem > sizeof(pkt)) return false;
+
+    *p++ = PKT_CONNECT;
+    p   += put_varint(p, rem);
+    p   += put_str(p, "MQTT", 4);
+    *p++ = 4;       // protocol level 3.1.1
+    *p++ = flags;   // clean session 0: the broker keeps our session
+    p   += put_u16(p, o->keepalive_s);
+    p   += put_str(p, o->client_id, id_len);
+    if (flags & 0x80u) p += put_str(p, o->username, user_len);
+    if (flags & 0x40u) p += put_str(p, o->password, pass_len);
+    return send_packet(c, pkt, (size_t)(p - pkt));
+}
+
+void mqtt_client_init(MqttClient_t *c, const MqttTransport_t *tp, const MqttConnectOpts_t *opts) {
+    memset(c, 0, sizeof(*c));
+    c->tp      = tp;
+    c->opts    = *opts;
+    c->next_id = 1;
+}
+
+bool mqtt_client_connect(MqttClient_t *c) {
+    if (c->connected) return true;
+
+    uint32_t t0 = now(c);
+    if (c->tried && t0 - c->attempt_ms < MQTT_CLIENT_RECONNECT_MS) return false;
+    c->tried      = true;
+    c->attempt_ms = t0;
+
+    if (!c->tp->open(c->tp->ctx)) {
+        c->stats.connect_failures++;
+        return false;
+    }
+    c->connected = true;
+
+    int connack = -1;
+    if (send_connect(c)) {
+        uint32_t waited;
+        while (connack < 0 && c->connected && (waited = now(c) - t0) < MQTT_CLIENT_ACK_TIMEOUT_MS) {
+            pump(c, MQTT_CLIENT_ACK_TIMEOUT_MS - waited, &connack);
+        }
+    }
+    if (connack < 0 || (connack & 0xFF) != 0) {
+        if (connack > 0) c->stats.last_refusal = (uint8_t)connack;
+        c->stats.connect_failures++;
+        drop(c);
+        return false;
+    }
+
+    c->session_present = (connack >> 8) != 0;
+    c->stats.connects++;
+    if (c->session_present) c->stats.sessions_resumed++;
+    resend_window(c);
+    return c->connected;
+}
+
+static MqttSlot_t *free_slot(MqttClient_t *c) {
+    for (unsigned i = 0; i < MQTT_CLIENT_INFLIGHT; i++) {
+        if (c->slots[i].id == 0) return &c->slots[i];
+    }
+    return NULL;
+}
+
+static uint16_t new_id(MqttClient_t *c) {
+    for (;;) {
+        uint16_t id = c->next_id++;
+        if (c->next_id == 0) c->next_id = 1;
+        bool used = false;
+        for (unsigned i = 0; i < MQTT_CLIENT_INFLIGHT; i++) used |= c->slots[i].id == id;
+        if (!used) return id;
+    }
+}
+
+/* Read acks until cond holds or timeout_ms passes */
+static bool wait_for(MqttClient_t *c, bool (*cond)(MqttClient_t *), uint32_t timeout_ms) {
+    uint32_t t0 = now(c), waited;
+    while (!cond(c)) {
+        if (!c->connected || (waited = now(c) - t0) >= timeout_ms) return false;
+        pump(c, timeout_ms - waited, NULL);
+    }
+    return true;
+}
+
+static bool have_slot(MqttClient_t *c) {
+    return free_slot(c) != NULL;
+}
+
+static bool window_empty(MqttClient_t *c) {
+    return inflight(c) == 0;
+}
+
+bool mqtt_client_publish(MqttClient_t *c, const char *topic, MqttBodyFn body, void *arg) {
+    size_t tlen = strlen(topic);
+    if (tlen == 0 || tlen > MQTT_CLIENT_TOPIC_MAX || !mqtt_client_connect(c)) {
+        c->stats.failures++;
+        return false;
+    }
+
+    while (pump(c, 0, NULL) > 0) {
+    }
+    if (!have_slot(c)) {
+        c->stats.window_waits++;
+        if (!wait_for(c, have_slot, MQTT_CLIENT_ACK_TIMEOUT_MS)) {
+            c->stats.failures++;
+            return false;
+        }
+    }
+
+    MqttSlot_t *s = free_slot(c);
+    size_t  var = 2u + tlen + 2u;   // topic, packet id
+    uint8_t *vh = s->buf + PUB_HDR_MAX;
+    ByteSink_t out = {
+        .buf = vh + var, .cap = MQTT_CLIENT_SLOT_LEN - PUB_HDR_MAX - var, .len = 0,
+    };
+    if (!body(&out, arg)) {
+        c->stats.failures++;
+        return false;
+    }
+
+    uint16_t id  = new_id(c);
+    uint32_t rem = (uint32_t)(var + out.len);
+    size_t   vl  = varint_len(rem);
+    put_str(vh, topic, tlen);
+    put_u16(vh + 2u + tlen, id);
+    s->off = (uint16_t)(PUB_HDR_MAX - 1u - vl);
+    s->buf[s->off] = PKT_PUBLISH_Q1;
+    put_varint(&s->buf[s->off + 1u], rem);
+    s->len      = (uint16_t)(1u + vl + rem);
+    s->id       = id;
+    s->order    = c->order++;
+    s->first_ms = s->sent_ms = now(c);
+
+    uint32_t n = inflight(c);
+    c->stats.publishes++;
+    c->stats.payload_bytes += (uint32_t)out.len;
+    if (n > c->stats.inflight_max) c->stats.inflight_max = n;
+
+    // Sent again after the reconnect if this fails
+    send_packet(c, s->buf + s->off, s->len);
+    return true;
+}
+
+void mqtt_client_poll(MqttClient_t *c) {
+    if (!c->connected) {
+        if (inflight(c) > 0) mqtt_client_connect(c);
+        return;
+    }
+    while (pump(c, 0, NULL) > 0) {
+    }
+    if (!c->connected) return;
+
+    uint32_t t = now(c);
+    if (c->ping_pending && t - c->ping_ms >= MQTT_CLIENT_ACK_TIMEOUT_MS) {
+        c->stats.ping_timeouts++;
+        drop(c);
+        return;
+    }
+    for (unsigned i = 0; i < MQTT_CLIENT_INFLIGHT; i++) {
+        const MqttSlot_t *s = &c->slots[i];
+        if (s->id != 0 && t - s->sent_ms >= MQTT_CLIENT_ACK_TIMEOUT_MS) {
+            // 3.1.1 resends only on a new connection
+            c->stats.ack_timeouts++;
+            drop(c);
+            return;
+        }
+    }
+    if (!c->ping_pending && c->opts.keepalive_s != 0 &&
+        t - c->last_tx_ms >= c->opts.keepalive_s * 750u) {
+        static const uint8_t pingreq[2] = { PKT_PINGREQ, 0 };
+        if (send_packet(c, pingreq, sizeof(pingreq))) {
+            c->ping_pending = true;
+            c->ping_ms      = t;
+            c->stats.pings++;
+        }
+    }
+}
+
+bool mqtt_client_flush(MqttClient_t *c, uint32_t timeout_ms) {
+    return wait_for(c, window_empty, timeout_ms);
+}
+
+uint32_t mqtt_client_discard(MqttClient_t *c) {
+    uint32_t n = inflight(c);
+    for (unsigned i = 0; i < MQTT_CLIENT_INFLIGHT; i++) c->slots[i].id = 0;
+    c->stats.discarded += n;
+    return n;
+}
+
+void mqtt_client_disconnect(MqttClient_t *c) {
+    static const uint8_t disconnect[2] = { PKT_DISCONNECT, 0 };
+    send_packet(c, disconnect, sizeof(disconnect));
+    drop(c);
+}
+
+void mqtt_client_get_stats(const MqttClient_t *c, MqttClientStats_t *out) {
+    *out = c->stats;
+    out->inflight = inflight(c);
+}
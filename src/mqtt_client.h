@@ -0,0 +1,192 @@
+/* src/mqtt_client.h — MQTT 3.1.1 publisher with a persistent session.
+ *
+ * A cheaper uplink than https_client.h: one long-lived connection to the
+ * broker carries every batch as a QoS 1 PUBLISH, i.e. a few bytes of
+ * framing and a 4-byte PUBACK instead of an HTTP request and response.
+ *
+ * Publishes are windowed: up to MQTT_CLIENT_INFLIGHT messages may be
+ * waiting for their PUBACK. Each one is kept, fully framed, in its own slot
+ * until acknowledged, so mqtt_client_publish() returns as soon as the
+ * message is written to the connection; only a full window makes it wait.
+ * The client connects with clean_session = 0 and a fixed client id, so the
+ * broker keeps the session across reconnects, and every unacknowledged
+ * slot is sent again (DUP set, same packet id) right after the next
+ * CONNACK: delivery is at-least-once for as long as the device stays up.
+ * A reset loses what is still in the window, so a caller that keeps its
+ * data elsewhere (the flash log of uplink.h) counts a message as delivered
+ * only once mqtt_client_flush() has seen its PUBACK, and otherwise takes
+ * it back with mqtt_client_discard() rather than sending it twice.
+ *
+ * mqtt_client_poll() keeps the connection alive: it reads PUBACKs and
+ * PINGRESPs as they arrive, sends PINGREQ after 3/4 of keepalive_s
+ * without traffic, drops the connection when a PINGRESP or the oldest PUBACK is
+ * MQTT_CLIENT_ACK_TIMEOUT_MS overdue, and reconnects (at most every
+ * MQTT_CLIENT_RECONNECT_MS) while messages are waiting.
+ *
+ * The bytes go through an MqttTransport_t: mqtt_tls.c runs it over
+ * mbedTLS on an lwIP socket (tls_net.h), tools/mqtt_pub over a plain POSIX
+ * socket. The client itself has no dependencies beyond libc. Not
+ * thread-safe; one task (the API task) owns a client.
+ */
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte_sink.h"
+
+/* PUBLISH packets waiting for their PUBACK */
+#ifndef MQTT_CLIENT_INFLIGHT
+#define MQTT_CLIENT_INFLIGHT 4u
+#endif
+/* One whole PUBLISH packet (header, topic, payload). 1424 + AES-GCM record
+ * overhead (29) is one 1460-byte TCP segment per message. */
+#ifndef MQTT_CLIENT_SLOT_LEN
+#define MQTT_CLIENT_SLOT_LEN 1424u
+#endif
+#ifndef MQTT_CLIENT_TOPIC_MAX
+#define MQTT_CLIENT_TOPIC_MAX 64u
+#endif
+/* CONNACK, PUBACK and PINGRESP deadline */
+#ifndef MQTT_CLIENT_ACK_TIMEOUT_MS
+#define MQTT_CLIENT_ACK_TIMEOUT_MS 10000u
+#endif
+/* Minimum spacing of connection attempts */
+#ifndef MQTT_CLIENT_RECONNECT_MS
+#define MQTT_CLIENT_RECONNECT_MS 10000u
+#endif
+
+typedef struct {
+    /* Connect to the broker (TCP and TLS); false if that fails */
+    bool (*open)(void *ctx);
+    void (*close)(void *ctx);
+    /* Write all len bytes; false on error */
+    bool (*send)(void *ctx, const uint8_t *buf, size_t len);
+    /* Read what is there, waiting up to timeout_ms (0: do not wait).
+     * Returns the bytes read, 0 if none arrived, < 0 if the connection
+     * is gone. */
+    int  (*recv)(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms);
+    uint32_t (*now_ms)(void);
+    void *ctx;
+} MqttTransport_t;
+
+typedef struct {
+    const char *client_id;   // identifies the session on the broker
+    const char *username;    // NULL: none
+    const char *password;    // NULL: none (needs a username)
+    uint16_t    keepalive_s;
+} MqttConnectOpts_t;
+
+typedef struct {
+    uint32_t connects;          // CONNACK accepted
+    uint32_t connect_failures;  // transport, refused (last_refusal) or no CONNACK
+    uint32_t sessions_resumed;  // CONNACK with session present
+    uint8_t  last_refusal;      // CONNACK return code, 0 if none
+    uint32_t publishes;         // accepted into the window
+    uint32_t failures;          // publishes refused (no connection, full window, too long)
+    uint32_t acked;             // PUBACKs for our messages
+    uint32_t retransmits;       // sent again with DUP after a reconnect
+    uint32_t discarded;         // dropped unacknowledged by mqtt_client_discard()
+    uint32_t window_waits;      // publishes that waited for a free slot
+    uint32_t inflight;          // unacknowledged now
+    uint32_t inflight_max;
+    uint64_t ack_ms;            // total time from first send to PUBACK
+    uint32_t ack_ms_max;
+    uint32_t pings;
+    uint32_t ping_timeouts;
+    uint32_t ack_timeouts;      // connections dropped for an overdue PUBACK
+    uint32_t payload_bytes;     // of publishes
+    uint32_t tx_bytes;          // MQTT packet bytes, retransmits included
+    uint32_t rx_bytes;
+} MqttClientStats_t;
+
+typedef struct {
+    uint32_t first_ms;  // first transmission, for the ack latency
+    uint32_t sent_ms;   // last transmission
+    uint32_t order;     // publish order, for retransmission
+    uint16_t id;        // packet identifier, 0 = free
+    uint16_t off;       // the packet is buf[off, off + len)
+    uint16_t len;
+    uint8_t  buf[MQTT_CLIENT_SLOT_LEN];
+} MqttSlot_t;
+
+typedef struct {
+    const MqttTransport_t *tp;
+    MqttConnectOpts_t opts;
+    bool      connected;
+    bool      ping_pending;
+    bool      tried;          // a connection attempt was made
+    bool      session_present;
+    uint16_t  next_id;
+    uint32_t  order;
+    uint32_t  last_tx_ms;     // for the keep-alive
+    uint32_t  ping_ms;
+    uint32_t  attempt_ms;     // last connection attempt
+    uint32_t  rx_len;         // bytes in rx
+    uint32_t  rx_skip;        // bytes left of a packet too long for rx
+    uint8_t   rx[16];         // only acks and CONNACK are expected
+    MqttClientStats_t stats;
+    MqttSlot_t slots[MQTT_CLIENT_INFLIGHT];
+} MqttClient_t;
+
+/* Writes the message payload into out, a plain buffer (no flush) of the
+ * space left in the slot; false aborts the publish. A producer that stops
+ * early on a full buffer publishes what fits. */
+typedef bool (*MqttBodyFn)(ByteSink_t *out, void *arg);
+
+/* The strings in opts must stay valid. Does not connect yet. */
+void mqtt_client_init(MqttClient_t *c, const MqttTransport_t *tp, const MqttConnectOpts_t *opts);
+
+/* Connect now if not connected (subject to MQTT_CLIENT_RECONNECT_MS),
+ * then resend the window. True if connected. */
+bool mqtt_client_connect(MqttClient_t *c);
+
+/* QoS 1 PUBLISH of the payload produced by body(out, arg) to topic.
+ * Connects if needed and waits up to MQTT_CLIENT_ACK_TIMEOUT_MS for a
+ * slot if the window is full. True once the message is in the window;
+ * false if it was not accepted. */
+bool mqtt_client_publish(MqttClient_t *c, const char *topic, MqttBodyFn body, void *arg);
+
+/* Handle incoming acks and the keep-alive without blocking. Call often
+ * (at least every keepalive_s / 2). */
+void mqtt_client_poll(MqttClient_t *c);
+
+/* Wait up to timeout_ms for the window to empty; true if it did. */
+bool mqtt_client_flush(MqttClient_t *c, uint32_t timeout_ms);
+
+/* Give up every unacknowledged message: they are not sent again. Returns
+ * how many there were. */
+uint32_t mqtt_client_discard(MqttClient_t *c);
+
+/* Send DISCONNECT and close. The window is kept for the next connect. */
+void mqtt_client_disconnect(MqttClient_t *c);
+
+void mqtt_client_get_stats(const MqttClient_t *c, MqttClientStats_t *out);
+
+/* ====================================================================
+   --- mbedTLS over lwIP (mqtt_tls.c) ---
+   ==================================================================== */
+
+/* Socket receive timeout while a TLS record is partly read */
+#ifndef MQTT_TLS_RECV_TIMEOUT_MS
+#define MQTT_TLS_RECV_TIMEOUT_MS 2000u
+#endif
+
+typedef struct {
+    uint32_t handshakes;
+    uint32_t resumed;        // handshakes that resumed the last session
+    uint64_t hs_us;          // total time in handshakes
+    uint32_t tx_bytes;       // TLS bytes on the TCP socket
+    uint32_t rx_bytes;
+} MqttTlsStats_t;
+
+/* Seed the DRBG and build the TLS config for host:port (8883). Returns the
+ * transport, or NULL on failure. Call once. Each open resumes the session
+ * of the previous connection when the broker allows it. */
+const MqttTransport_t *mqtt_tls_transport(const char *host, const char *port);
+
+void mqtt_tls_get_stats(MqttTlsStats_t *out);
+
+#endif /* MQTT_CLIENT_H */
@@ -0,0 +1,189 @@
+/* src/mqtt_tls.c — MQTT transport over mbedTLS and lwIP (mqtt_client.h).
+ *
+ * A TLS context of its own next to https_client.c's, on the same BIO glue
+ * (tls_net.h). The session of each handshake is offered on the next open,
+ * so a reconnect after a keep-alive timeout or a Wi-Fi drop is normally an
+ * abbreviated handshake.
+ */
+#include "mqtt_client.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+
+#include "tls_net.h"
+
+/* Set up once by mqtt_tls_transport(), owned by the API task */
+static mbedtls_ssl_context      s_ssl;
+static mbedtls_ssl_config       s_conf;
+static mbedtls_x509_crt         s_cacert;
+static mbedtls_ctr_drbg_context s_ctr_drbg;
+static mbedtls_entropy_context  s_entropy;
+static mbedtls_ssl_session      s_session;
+static bool                     s_have_session;
+static bool                     s_cert_verified;  // set by the verify callback
+static TlsNet_t                 s_net = TLS_NET_INIT;
+static char                     s_host[64];
+static char                     s_port[8];
+static MqttTlsStats_t           s_stats;
+
+/* Only full handshakes see a certificate; the chain is left to authmode */
+static int verify_cb(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+    (void)ctx; (void)crt; (void)depth; (void)flags;
+    s_cert_verified = true;
+    return 0;
+}
+
+static void tls_close(void *ctx) {
+    (void)ctx;
+    // No close_notify: the socket may be the reason for closing
+    tls_net_close(&s_net);
+}
+
+static bool tls_open(void *ctx) {
+    int ret;
+    bool offered = false;
+
+    printf("MQTT: connecting to %s:%s\n", s_host, s_port);
+    if ((ret = mbedtls_ssl_session_reset(&s_ssl)) != 0) {
+        tls_print_err("ssl_session_reset", ret);
+        return false;
+    }
+    if (s_have_session) offered = mbedtls_ssl_set_session(&s_ssl, &s_session) == 0;
+
+    if (!tls_net_connect(&s_net, s_host, s_port, MQTT_TLS_RECV_TIMEOUT_MS)) return false;
+    mbedtls_ssl_set_bio(&s_ssl, &s_net, tls_net_send, tls_net_recv, NULL);
+
+    uint64_t t0 = time_us_64();
+    s_cert_verified = false;
+    while ((ret = mbedtls_ssl_handshake(&s_ssl)) != 0) {
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+        tls_print_err("ssl_handshake", ret);
+        tls_close(ctx);
+        // Offer nothing next time, in case the server choked on the session
+        if (offered) s_have_session = false;
+        return false;
+    }
+    uint64_t us = time_us_64() - t0;
+    s_stats.handshakes++;
+    s_stats.hs_us += us;
+    if (!s_cert_verified) s_stats.resumed++;
+    printf("MQTT: %s handshake in %lu ms\n", s_cert_verified ? "full" : "resumed",
+           (unsigned long)(us / 1000u));
+
+    mbedtls_ssl_session_free(&s_session);
+    mbedtls_ssl_session_init(&s_session);
+    s_have_session = mbedtls_ssl_get_session(&s_ssl, &s_session) == 0;
+    return true;
+}
+
+static bool tls_send(void *ctx, const uint8_t *buf, size_t len) {
+    (void)ctx;
+    size_t off = 0;
+    while (off < len) {
+        int ret = mbedtls_ssl_write(&s_ssl, buf + off, len - off);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+        if (ret <= 0) {
+            tls_print_err("ssl_write", ret);
+            return false;
+        }
+        off += (size_t)ret;
+    }
+    return true;
+}
+
+static int tls_recv(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms) {
+    (void)ctx;
+    // Without a wait, only read if a record is buffered or bytes are on the socket
+    if (timeout_ms == 0 && mbedtls_ssl_get_bytes_avail(&s_ssl) == 0 && !tls_net_readable(&s_net)) return 0;
+    tls_net_set_timeout(&s_net, timeout_ms ? timeout_ms : MQTT_TLS_RECV_TIMEOUT_MS);
+
+    int ret;
+    do {
+        ret = mbedtls_ssl_read(&s_ssl, buf, len);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    if (ret == MBEDTLS_ERR_SSL_TIMEOUT) return 0;  // a partial record is kept for the next read
+    if (ret <= 0) {
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) tls_print_err("ssl_read", ret);
+        return -1;
+    }
+    return ret;
+}
+
+static uint32_t tls_now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+static const MqttTransport_t s_transport = {
+    .open   = tls_open,
+    .close  = tls_close,
+    .send   = tls_send,
+    .recv   = tls_recv,
+    .now_ms = tls_now_ms,
+    .ctx    = NULL,
+};
+
+const MqttTransport_t *mqtt_tls_transport(const char *host, const char *port) {
+    const char *pers = "pico_w_mqtt_client";
+    int ret;
+
+    snprintf(s_host, sizeof(s_host), "%s", host);
+    snprintf(s_port, sizeof(s_port), "%s", port);
+
+    mbedtls_ssl_init(&s_ssl);
+    mbedtls_ssl_config_init(&s_conf);
+    mbedtls_x509_crt_init(&s_cacert);
+    mbedtls_ctr_drbg_init(&s_ctr_drbg);
+    mbedtls_entropy_init(&s_entropy);
+    mbedtls_ssl_session_init(&s_session);
+
+    if ((ret = mbedtls_ctr_drbg_seed(&s_ctr_drbg, mbedtls_entropy_func, &s_entropy,
+                                     (const unsigned char *)pers, strlen(pers))) != 0) {
+        tls_print_err("ctr_drbg_seed", ret);
+        goto fail;
+    }
+    if ((ret = mbedtls_ssl_config_defaults(&s_conf,
+                                           MBEDTLS_SSL_IS_CLIENT,
+                                           MBEDTLS_SSL_TRANSPORT_STREAM,
+                                           MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
+        tls_print_err("ssl_config_defaults", ret);
+        goto fail;
+    }
+
+    // As in https_client.c: OPTIONAL until a CA is loaded into s_cacert
+    mbedtls_ssl_conf_authmode(&s_conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+    mbedtls_ssl_conf_ca_chain(&s_conf, &s_cacert, NULL);
+    mbedtls_ssl_conf_rng(&s_conf, mbedtls_ctr_drbg_random, &s_ctr_drbg);
+    mbedtls_ssl_conf_verify(&s_conf, verify_cb, NULL);
+    mbedtls_ssl_conf_session_tickets(&s_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+
+    if ((ret = mbedtls_ssl_setup(&s_ssl, &s_conf)) != 0) {
+        tls_print_err("ssl_setup", ret);
+        goto fail;
+    }
+    if ((ret = mbedtls_ssl_set_hostname(&s_ssl, s_host)) != 0) {
+        tls_print_err("ssl_set_hostname", ret);
+        goto fail;
+    }
+    return &s_transport;
+
+fail:
+    mbedtls_ssl_free(&s_ssl);
+    mbedtls_ssl_config_free(&s_conf);
+    mbedtls_x509_crt_free(&s_cacert);
+    mbedtls_ctr_drbg_free(&s_ctr_drbg);
+    mbedtls_entropy_free(&s_entropy);
+    return NULL;
+}
+
+void mqtt_tls_get_stats(MqttTlsStats_t *out) {
+    *out = s_stats;
+    out->tx_bytes = s_net.tx_bytes;
+    out->rx_bytes = s_net.rx_bytes;
+}
@@ -0,0 +1,112 @@
+/* src/sensor_data.c — double-buffered seqlock ("latch") for SensorData_t.
+ *
+ * Every field group owns a sequence counter. A publish bumps it twice:
+ *   odd  -> readers use copy[1] while the writer fills copy[0]
+ *   even -> readers use copy[0] while the writer fills copy[1]
+ * so a reader always has a copy that is not being written, and only retries
+ * when the writer ran in the middle of its read. Unlike a plain seqlock a
+ * high-priority reader can never spin on a preempted low-priority writer,
+ * which matters on the single-core scheduler used here.
+ */
+#include "sensor_data.h"
+
+#include <stddef.h>
+
+static SensorData_t s_copy[2];
+static uint32_t     s_seq[SENSOR_FIELD_COUNT];
+
+static void copy_group(SensorField_t field, SensorData_t *dst, const SensorData_t *src) {
+    switch (field) {
+    case SENSOR_FIELD_TEMP_HUM:
+        dst->temp = src->temp;
+        dst->hum  = src->hum;
+        break;
+    case SENSOR_FIELD_VOC:
+        dst->voc = src->voc;
+        break;
+    case SENSOR_FIELD_IMU:
+        for (int i = 0; i < 3; i++) {
+            dst->acc[i]  = src->acc[i];
+            dst->gyro[i] = src->gyro[i];
+        }
+        break;
+    case SENSOR_FIELD_ORIENTATION:
+        for (int i = 0; i < 4; i++) dst->quat[i] = src->quat[i];
+        for (int i = 0; i < 3; i++) dst->euler[i] = src->euler[i];
+        break;
+    case SENSOR_FIELD_LIGHT:
+        dst->light = src->light;
+        break;
+    case SENSOR_FIELD_SOUND:
+        dst->sound = src->sound;
+        break;
+    default:
+        break;
+    }
+}
+
+/* Single writer per field: the plain read of s_seq[field] is never racy. */
+static void latch_publish(SensorField_t field, const SensorData_t *value) {
+    for (int pass = 0; pass < 2; pass++) {
+        __atomic_store_n(&s_seq[field], s_seq[field] + 1, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        copy_group(field, &s_copy[pass], value);
+    }
+}
+
+static uint32_t latch_read(SensorField_t field, SensorData_t *out) {
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&s_seq[field], __ATOMIC_ACQUIRE);
+        copy_group(field, out, &s_copy[seq & 1u]);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&s_seq[field], __ATOMIC_RELAXED) != seq);
+    return seq >> 1; // two increments per publish
+}
+
+void sensor_data_publish_temp_hum(float temp, float hum) {
+    SensorData_t v = { .temp = temp, .hum = hum };
+    latch_publish(SENSOR_FIELD_TEMP_HUM, &v);
+}
+
+void sensor_data_publish_voc(uint32_t voc) {
+    SensorData_t v = { .voc = voc };
+    latch_publish(SENSOR_FIELD_VOC, &v);
+}
+
+void sensor_data_publish_imu(const float acc[3], const float gyro[3]) {
+    SensorData_t v = {
+        .acc  = { acc[0],  acc[1],  acc[2]  },
+        .gyro = { gyro[0], gyro[1], gyro[2] },
+    };
+    latch_publish(SENSOR_FIELD_IMU, &v);
+}
+
+void sensor_data_publish_orientation(const float quat[4], const float euler[3]) {
+    SensorData_t v = {
+        .quat  = { quat[0], quat[1], quat[2], quat[3] },
+        .euler = { euler[0], euler[1], euler[2] },
+    };
+    latch_publish(SENSOR_FIELD_ORIENTATION, &v);
+}
+
+void sensor_data_publish_light(uint16_t light) {
+    SensorData_t v = { .light = light };
+    latch_publish(SENSOR_FIELD_LIGHT, &v);
+}
+
+void sensor_data_publish_sound(uint16_t sound) {
+    SensorData_t v = { .sound = sound };
+    latch_publish(SENSOR_FIELD_SOUND, &v);
+}
+
+void sensor_data_snapshot(SensorData_t *out, SensorDataSeq_t *seq) {
+    for (int f = 0; f < SENSOR_FIELD_COUNT; f++) {
+        uint32_t n = latch_read((SensorField_t)f, out);
+        if (seq != NULL) seq->seq[f] = n;
+    }
+}
+
+uint32_t sensor_data_field_seq(SensorField_t field) {
+    return __atomic_load_n(&s_seq[field], __ATOMIC_ACQUIRE) >> 1;
+}
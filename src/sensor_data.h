@@ -0,0 +1,54 @@
+/* src/sensor_data.h — lock-free publication of the latest sensor readings.
+ *
+ * Each field group has exactly one writer task. Writers never block; readers
+ * get a consistent per-group snapshot without a kernel object (see
+ * sensor_data.c for the double-buffered seqlock scheme).
+ */
+#ifndef SENSOR_DATA_H
+#define SENSOR_DATA_H
+
+#include <stdint.h>
+
+/* Global struct for all sensor data */
+typedef struct {
+    float     temp;
+    float     hum;
+    uint32_t  voc;
+    float     acc[3];
+    float     gyro[3];
+    float     quat[4];  // orientation w x y z
+    float     euler[3]; // roll, pitch, yaw in degrees
+    uint16_t  light; // 0-4095
+    uint16_t  sound; // Leq, 0.1 dB re 1 ADC LSB RMS
+} SensorData_t;
+
+/* Field groups; each one is updated atomically by its single writer. */
+typedef enum {
+    SENSOR_FIELD_TEMP_HUM = 0,
+    SENSOR_FIELD_VOC,
+    SENSOR_FIELD_IMU,
+    SENSOR_FIELD_ORIENTATION,
+    SENSOR_FIELD_LIGHT,
+    SENSOR_FIELD_SOUND,
+    SENSOR_FIELD_COUNT
+} SensorField_t;
+
+/* Per-field "last updated" sequence numbers: how many times each group has
+ * been published since boot (0 = never written). */
+typedef struct {
+    uint32_t seq[SENSOR_FIELD_COUNT];
+} SensorDataSeq_t;
+
+/* Writers (one task per field group) */
+void sensor_data_publish_temp_hum(float temp, float hum);
+void sensor_data_publish_voc(uint32_t voc);
+void sensor_data_publish_imu(const float acc[3], const float gyro[3]);
+void sensor_data_publish_orientation(const float quat[4], const float euler[3]);
+void sensor_data_publish_light(uint16_t light);
+void sensor_data_publish_sound(uint16_t sound);
+
+/* Readers: consistent copy of every group; seq may be NULL. */
+void     sensor_data_snapshot(SensorData_t *out, SensorDataSeq_t *seq);
+uint32_t sensor_data_field_seq(SensorField_t field);
+
+#endif /* SENSOR_DATA_H */
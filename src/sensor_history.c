@@ -0,0 +1,101 @@
+/* src/sensor_history.c — single-producer / multi-consumer sample rings.
+ *
+ * head counts samples ever written and only moves forward; slot = index %
+ * capacity. While the producer writes index h it overwrites the slot of
+ * index h - capacity, so a consumer may only trust indices greater than
+ * head - capacity. That leaves capacity - 1 readable samples per ring.
+ */
+#include "sensor_history.h"
+
+#define HISTORY_MASK     (SENSOR_HISTORY_CAPACITY - 1u)
+#define HISTORY_READABLE (SENSOR_HISTORY_CAPACITY - 1u)
+
+_Static_assert((SENSOR_HISTORY_CAPACITY & HISTORY_MASK) == 0,
+               "SENSOR_HISTORY_CAPACITY must be a power of two");
+
+typedef struct {
+    SensorSample_t buf[SENSOR_HISTORY_CAPACITY];
+    uint32_t       head;
+} SensorRing_t;
+
+static SensorRing_t s_rings[SENSOR_CH_COUNT];
+
+static const char *const s_channel_names[SENSOR_CH_COUNT] = {
+    [SENSOR_CH_TEMP]   = "temperature",
+    [SENSOR_CH_HUM]    = "humidity",
+    [SENSOR_CH_VOC]    = "voc",
+    [SENSOR_CH_ACC_X]  = "acc_x",
+    [SENSOR_CH_ACC_Y]  = "acc_y",
+    [SENSOR_CH_ACC_Z]  = "acc_z",
+    [SENSOR_CH_GYRO_X] = "gyro_x",
+    [SENSOR_CH_GYRO_Y] = "gyro_y",
+    [SENSOR_CH_GYRO_Z] = "gyro_z",
+    [SENSOR_CH_LIGHT]  = "light",
+    [SENSOR_CH_SOUND]  = "sound",
+    [SENSOR_CH_MCU_TEMP] = "mcu_temp",
+    [SENSOR_CH_ROLL]   = "roll",
+    [SENSOR_CH_PITCH]  = "pitch",
+    [SENSOR_CH_YAW]    = "yaw",
+};
+
+void sensor_history_push(SensorChannel_t ch, uint32_t t_ms, float value) {
+    SensorRing_t *r = &s_rings[ch];
+    uint32_t h = r->head; // only this producer writes head
+
+    r->buf[h & HISTORY_MASK].t_ms  = t_ms;
+    r->buf[h & HISTORY_MASK].value = value;
+    __atomic_store_n(&r->head, h + 1u, __ATOMIC_RELEASE);
+}
+
+uint32_t sensor_history_count(SensorChannel_t ch) {
+    return __atomic_load_n(&s_rings[ch].head, __ATOMIC_ACQUIRE);
+}
+
+void sensor_history_cursor_init(SensorHistoryCursor_t *cur, SensorChannel_t ch, bool from_oldest) {
+    uint32_t head = sensor_history_count(ch);
+
+    cur->ch       = ch;
+    cur->overruns = 0;
+    if (from_oldest && head > HISTORY_READABLE) {
+        cur->tail = head - HISTORY_READABLE;
+    } else {
+        cur->tail = from_oldest ? 0u : head;
+    }
+}
+
+size_t sensor_history_peek(SensorHistoryCursor_t *cur, const SensorSample_t **span) {
+    SensorRing_t *r = &s_rings[cur->ch];
+    uint32_t head  = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    uint32_t avail = head - cur->tail;
+
+    if (avail > HISTORY_READABLE) {
+        cur->overruns += avail - HISTORY_READABLE;
+        cur->tail      = head - HISTORY_READABLE;
+        avail          = HISTORY_READABLE;
+    }
+
+    uint32_t slot   = cur->tail & HISTORY_MASK;
+    uint32_t to_end = SENSOR_HISTORY_CAPACITY - slot;
+
+    *span = &r->buf[slot];
+    return (avail < to_end) ? avail : to_end;
+}
+
+bool sensor_history_release(SensorHistoryCursor_t *cur, size_t n) {
+    uint32_t head = __atomic_load_n(&s_rings[cur->ch].head, __ATOMIC_ACQUIRE);
+    uint32_t lag  = head - cur->tail;
+    bool     ok   = true;
+
+    /* The oldest sample we just read is safe only while lag < capacity. */
+    if (lag > HISTORY_READABLE) {
+        uint32_t lost = lag - HISTORY_READABLE;
+        cur->overruns += (lost < n) ? lost : (uint32_t)n;
+        ok = false;
+    }
+    cur->tail += (uint32_t)n;
+    return ok;
+}
+
+const char *sensor_channel_name(SensorChannel_t ch) {
+    return (ch < SENSOR_CH_COUNT) ? s_channel_names[ch] : "unknown";
+}
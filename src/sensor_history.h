@@ -0,0 +1,76 @@
+/* src/sensor_history.h — per-channel timestamped sample history.
+ *
+ * One statically allocated ring of (timestamp, value) tuples per channel.
+ * Each channel has a single producer; any number of consumers (uplink,
+ * display, logger, ...) read it through their own cursor, which holds the
+ * read position and an overrun counter. The producer never waits for
+ * consumers: a consumer that falls more than a ring behind loses the oldest
+ * samples and sees its overrun counter grow.
+ */
+#ifndef SENSOR_HISTORY_H
+#define SENSOR_HISTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Samples kept per channel; must be a power of two. */
+#ifndef SENSOR_HISTORY_CAPACITY
+#define SENSOR_HISTORY_CAPACITY 128u
+#endif
+
+typedef enum {
+    SENSOR_CH_TEMP = 0,
+    SENSOR_CH_HUM,
+    SENSOR_CH_VOC,
+    SENSOR_CH_ACC_X,
+    SENSOR_CH_ACC_Y,
+    SENSOR_CH_ACC_Z,
+    SENSOR_CH_GYRO_X,
+    SENSOR_CH_GYRO_Y,
+    SENSOR_CH_GYRO_Z,
+    SENSOR_CH_LIGHT,
+    SENSOR_CH_SOUND,    // Leq in 0.1 dB, as SensorData_t.sound
+    SENSOR_CH_MCU_TEMP,
+    SENSOR_CH_ROLL,
+    SENSOR_CH_PITCH,
+    SENSOR_CH_YAW,
+    SENSOR_CH_COUNT
+} SensorChannel_t;
+
+typedef struct {
+    uint32_t t_ms;  // ms since boot
+    float    value;
+} SensorSample_t;
+
+/* Consumer-owned read state; one per (consumer, channel). */
+typedef struct {
+    SensorChannel_t ch;
+    uint32_t        tail;      // next sample index to read
+    uint32_t        overruns;  // samples lost because the consumer fell behind
+} SensorHistoryCursor_t;
+
+/* Producer side (single writer per channel). */
+void sensor_history_push(SensorChannel_t ch, uint32_t t_ms, float value);
+
+/* Total samples ever pushed to a channel. */
+uint32_t sensor_history_count(SensorChannel_t ch);
+
+/* Start a cursor either at the oldest retained sample or at "now". */
+void sensor_history_cursor_init(SensorHistoryCursor_t *cur, SensorChannel_t ch, bool from_oldest);
+
+/* Zero-copy read: points *span at the longest contiguous run of unread
+ * samples inside the ring and returns its length (0 if nothing is new).
+ * Call again after sensor_history_release() to get the part that wrapped.
+ */
+size_t sensor_history_peek(SensorHistoryCursor_t *cur, const SensorSample_t **span);
+
+/* Mark n peeked samples as consumed. Returns false if the producer lapped
+ * the cursor while the span was being read, i.e. some of those samples may
+ * have been overwritten; the loss is added to cur->overruns.
+ */
+bool sensor_history_release(SensorHistoryCursor_t *cur, size_t n);
+
+const char *sensor_channel_name(SensorChannel_t ch);
+
+#endif /* SENSOR_HISTORY_H */
@@ -0,0 +1,88 @@
+/* src/sound_level.c — see sound_level.h. */
+#include "sound_level.h"
+
+/* log2(x) in Q16 using the bit-by-bit squaring method (16 multiplies). */
+static uint32_t log2_q16(uint32_t x) {
+    uint32_t ipart = 31u - (uint32_t)__builtin_clz(x);
+    uint32_t y;    // mantissa in Q15, [1, 2)
+    uint32_t frac = 0;
+
+    y = (ipart >= 15) ? (x >> (ipart - 15)) : (x << (15 - ipart));
+    for (uint32_t bit = 1u << 15; bit; bit >>= 1) {
+        y = (y * y) >> 15;
+        if (y >= (2u << 15)) {
+            y >>= 1;
+            frac |= bit;
+        }
+    }
+    return (ipart << 16) | frac;
+}
+
+static uint32_t isqrt32(uint32_t x) {
+    uint32_t res = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= res + bit) {
+            x  -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+int32_t sound_level_cdb(uint32_t x) {
+    if (x == 0) return 0;
+    /* 1000 * log10(2) / 2^16 = 0.0045934 = 19728660 / 2^32 */
+    return (int32_t)(((uint64_t)log2_q16(x) * 19728660u + (1u << 31)) >> 32);
+}
+
+void sound_level_window(const uint16_t *samples, size_t n, size_t stride, SoundWindow_t *out) {
+    uint32_t sum = 0;
+    uint64_t sumsq = 0;
+    uint16_t lo = 0xFFFF, hi = 0;
+
+    if (n == 0) {
+        *out = (SoundWindow_t){0};
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t x = samples[i * stride] & 0x0FFFu;
+        sum   += x;
+        sumsq += x * x;
+        if (x < lo) lo = (uint16_t)x;
+        if (x > hi) hi = (uint16_t)x;
+    }
+
+    uint32_t mean = sum / (uint32_t)n;
+    /* Var = E[x^2] - E[x]^2; 12-bit samples keep this inside 32 bits. */
+    uint64_t ex2  = sumsq / n;
+    uint64_t m2   = (uint64_t)mean * mean;
+    uint32_t ms   = (ex2 > m2) ? (uint32_t)(ex2 - m2) : 0u;
+
+    out->mean        = (uint16_t)mean;
+    out->mean_square = ms;
+    out->rms         = (uint16_t)isqrt32(ms);
+    out->peak        = (uint16_t)((hi - mean > mean - lo) ? (hi - mean) : (mean - lo));
+    out->level_cdb   = (int16_t)sound_level_cdb(ms);
+}
+
+void sound_leq_reset(SoundLeq_t *leq) {
+    leq->energy  = 0;
+    leq->windows = 0;
+}
+
+void sound_leq_add(SoundLeq_t *leq, const SoundWindow_t *w) {
+    leq->energy += w->mean_square;
+    leq->windows++;
+}
+
+int32_t sound_leq_cdb(const SoundLeq_t *leq) {
+    if (leq->windows == 0) return 0;
+    return sound_level_cdb((uint32_t)(leq->energy / leq->windows));
+}
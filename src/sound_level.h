@@ -0,0 +1,37 @@
+/* src/sound_level.h — fixed-point loudness metrics for ADC audio windows.
+ *
+ * Integer-only (no soft-float): per-window RMS, peak and level, plus an
+ * equivalent continuous level (Leq) accumulated over several windows.
+ * Levels are in 0.01 dB relative to 1 ADC LSB RMS; a full-scale 12-bit sine
+ * is about 6320 (63.2 dB).
+ */
+#ifndef SOUND_LEVEL_H
+#define SOUND_LEVEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t mean_square; // AC power, LSB^2 (DC removed per window)
+    uint16_t rms;         // LSB
+    uint16_t peak;        // LSB, largest |x - mean|
+    uint16_t mean;        // DC offset of the window, LSB
+    int16_t  level_cdb;   // 10*log10(mean_square), 0.01 dB
+} SoundWindow_t;
+
+typedef struct {
+    uint64_t energy;      // sum of per-window mean squares
+    uint32_t windows;
+} SoundLeq_t;
+
+/* Analyse n samples read from samples[0], samples[stride], ... */
+void sound_level_window(const uint16_t *samples, size_t n, size_t stride, SoundWindow_t *out);
+
+void    sound_leq_reset(SoundLeq_t *leq);
+void    sound_leq_add(SoundLeq_t *leq, const SoundWindow_t *w);
+int32_t sound_leq_cdb(const SoundLeq_t *leq); // Leq in 0.01 dB, 0 if empty
+
+/* 1000*log10(x) for x >= 1 (i.e. 10*log10 in 0.01 dB); 0 for x == 0. */
+int32_t sound_level_cdb(uint32_t x);
+
+#endif /* SOUND_LEVEL_H */
@@ -0,0 +1,127 @@
+/* src/tls_net.c — see tls_net.h. */
+#include "tls_net.h"
+
+#include <stdio.h>
+#include <errno.h>
+
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+#include "lwip/errno.h"
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/error.h"
+
+/* Map “net_* failed” error codes for builds without MBEDTLS_NET_C.
+ * Values match mbedTLS 2.28.x so error strings remain meaningful via mbedtls_strerror().
+ */
+#ifndef MBEDTLS_ERR_NET_SEND_FAILED
+#define MBEDTLS_ERR_NET_SEND_FAILED    -0x004E
+#endif
+
+#ifndef MBEDTLS_ERR_NET_RECV_FAILED
+#define MBEDTLS_ERR_NET_RECV_FAILED    -0x004C
+#endif
+
+int tls_net_send(void *ctx, const unsigned char *buf, size_t len) {
+    TlsNet_t *c = (TlsNet_t *)ctx;
+    int ret = lwip_write(c->fd, buf, (int)len);
+    if (ret < 0) {
+        // Map EWOULDBLOCK/AGAIN to WANT_WRITE if using non-blocking.
+        if (errno == EWOULDBLOCK || errno == EAGAIN) return MBEDTLS_ERR_SSL_WANT_WRITE;
+        return MBEDTLS_ERR_NET_SEND_FAILED;
+    }
+    c->tx_bytes += (uint32_t)ret;
+    return ret;
+}
+
+int tls_net_recv(void *ctx, unsigned char *buf, size_t len) {
+    TlsNet_t *c = (TlsNet_t *)ctx;
+    int ret = lwip_read(c->fd, buf, (int)len);
+    if (ret < 0) {
+        // The socket is blocking, so EWOULDBLOCK means SO_RCVTIMEO expired.
+        if (errno == EWOULDBLOCK || errno == EAGAIN) return MBEDTLS_ERR_SSL_TIMEOUT;
+        return MBEDTLS_ERR_NET_RECV_FAILED;
+    }
+    if (ret == 0) {
+        // Peer closed connection
+        return 0;
+    }
+    c->rx_bytes += (uint32_t)ret;
+    return ret;
+}
+
+int tls_net_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout_ms) {
+    tls_net_set_timeout((TlsNet_t *)ctx, timeout_ms);
+    return tls_net_recv(ctx, buf, len);
+}
+
+/* Resolve host and connect a TCP or UDP socket (IPv4/IPv6) */
+static bool net_connect(TlsNet_t *net, const char *host, const char *port, int socktype,
+                        uint32_t recv_timeout_ms) {
+    struct addrinfo hints = {0}, *res = NULL, *rp = NULL;
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = socktype;
+
+    int err = getaddrinfo(host, port, &hints, &res);
+    if (err != 0 || !res) {
+        printf("getaddrinfo failed: %d\n", err);
+        return false;
+    }
+
+    int fd = -1;
+    for (rp = res; rp != NULL; rp = rp->ai_next) {
+        fd = lwip_socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if (fd < 0) continue;
+
+        if (lwip_connect(fd, rp->ai_addr, (socklen_t)rp->ai_addrlen) == 0) {
+            break; // connected
+        }
+        lwip_close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+
+    if (fd < 0) {
+        printf("connect() failed\n");
+        return false;
+    }
+    net->fd = fd;
+    tls_net_set_timeout(net, recv_timeout_ms);
+    return true;
+}
+
+bool tls_net_connect(TlsNet_t *net, const char *host, const char *port, uint32_t recv_timeout_ms) {
+    return net_connect(net, host, port, SOCK_STREAM, recv_timeout_ms);
+}
+
+bool tls_net_connect_udp(TlsNet_t *net, const char *host, const char *port, uint32_t recv_timeout_ms) {
+    return net_connect(net, host, port, SOCK_DGRAM, recv_timeout_ms);
+}
+
+void tls_net_set_timeout(TlsNet_t *net, uint32_t recv_timeout_ms) {
+    struct timeval tv = {
+        .tv_sec  = recv_timeout_ms / 1000u,
+        .tv_usec = (recv_timeout_ms % 1000u) * 1000u,
+    };
+    lwip_setsockopt(net->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+bool tls_net_readable(TlsNet_t *net) {
+    unsigned char c;
+    int ret = lwip_recv(net->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (ret < 0) return errno != EWOULDBLOCK && errno != EAGAIN;
+    return true;
+}
+
+void tls_net_close(TlsNet_t *net) {
+    if (net->fd < 0) return;
+    lwip_close(net->fd);
+    net->fd = -1;
+}
+
+/* Optional: pretty-print mbedTLS error */
+void tls_print_err(const char *where, int err) {
+    char buf[128];
+    mbedtls_strerror(err, buf, sizeof(buf));
+    printf("%s: -0x%04x (%s)\n", where, (unsigned)(-err), buf);
+}
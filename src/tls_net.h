@@ -0,0 +1,52 @@
+/* src/tls_net.h — mbedTLS BIO over a blocking lwIP socket.
+ *
+ * Shared by the uplink transports (https_client.c, mqtt_tls.c, coap_udp.c):
+ * each keeps its own SSL context and plugs a TlsNet_t into it with
+ *
+ *   mbedtls_ssl_set_bio(&ssl, &net, tls_net_send, tls_net_recv, NULL);
+ *
+ * or, for DTLS over a connected UDP socket, with tls_net_recv_timeout as
+ * the last callback. The receive timeout (SO_RCVTIMEO) surfaces as
+ * MBEDTLS_ERR_SSL_TIMEOUT.
+ */
+#ifndef TLS_NET_H
+#define TLS_NET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    int      fd;        // lwIP socket, -1 when closed
+    uint32_t tx_bytes;  // TLS bytes on the socket
+    uint32_t rx_bytes;
+} TlsNet_t;
+
+#define TLS_NET_INIT { .fd = -1 }
+
+/* Resolve host and connect (IPv4/IPv6), with recv_timeout_ms for reads.
+ * False if that fails. */
+bool tls_net_connect(TlsNet_t *net, const char *host, const char *port, uint32_t recv_timeout_ms);
+
+/* The same with a UDP socket: connect() only fixes the peer, so this fails
+ * on DNS errors alone. Each send is one datagram, each read returns one. */
+bool tls_net_connect_udp(TlsNet_t *net, const char *host, const char *port, uint32_t recv_timeout_ms);
+
+/* Change the read timeout of the open socket (0 = wait forever). */
+void tls_net_set_timeout(TlsNet_t *net, uint32_t recv_timeout_ms);
+
+/* True if the socket has bytes waiting (or the peer closed it); never blocks. */
+bool tls_net_readable(TlsNet_t *net);
+
+void tls_net_close(TlsNet_t *net);
+
+/* mbedtls_ssl_set_bio() callbacks; ctx is a TlsNet_t. */
+int tls_net_send(void *ctx, const unsigned char *buf, size_t len);
+int tls_net_recv(void *ctx, unsigned char *buf, size_t len);
+/* Read with a timeout (0 = wait forever), as DTLS needs for retransmissions. */
+int tls_net_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout_ms);
+
+/* Print an mbedTLS error code with its description. */
+void tls_print_err(const char *where, int err);
+
+#endif /* TLS_NET_H */
@@ -0,0 +1,479 @@
+/* src/uplink.c — see uplink.h. */
+#include "uplink.h"
+
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "flash_log.h"
+#include "sensor_history.h"
+#include "wall_clock.h"
+
+typedef struct {
+    uint32_t t_ms;
+    float    value;
+    uint8_t  ch;
+} UplinkRecord_t;
+
+_Static_assert(SENSOR_CH_COUNT <= UPLINK_CODEC_CHANNELS, "raise GORILLA_ENC_CHANNELS");
+
+/* Resolution each channel is sent at by the Gorilla encoding: decimals for
+ * fixed point, GORILLA_FMT_INT for counts and indices. The JSON encoding
+ * rounds everything to 2 decimals anyway. */
+static const uint8_t s_channel_fmt[SENSOR_CH_COUNT] = {
+    [SENSOR_CH_TEMP]     = 2,
+    [SENSOR_CH_HUM]      = 2,
+    [SENSOR_CH_VOC]      = GORILLA_FMT_INT,
+    [SENSOR_CH_ACC_X]    = 3,
+    [SENSOR_CH_ACC_Y]    = 3,
+    [SENSOR_CH_ACC_Z]    = 3,
+    [SENSOR_CH_GYRO_X]   = 2,
+    [SENSOR_CH_GYRO_Y]   = 2,
+    [SENSOR_CH_GYRO_Z]   = 2,
+    [SENSOR_CH_LIGHT]    = GORILLA_FMT_INT,
+    [SENSOR_CH_SOUND]    = GORILLA_FMT_INT,
+    [SENSOR_CH_MCU_TEMP] = 1,
+    [SENSOR_CH_ROLL]     = 1,
+    [SENSOR_CH_PITCH]    = 1,
+    [SENSOR_CH_YAW]      = 1,
+};
+
+/* A flash log record: a header, then UPLINK_LOG_SAMPLE_LEN bytes per sample
+ *   t0_ms u64 | boot_id u32 | unix_time u8 | count u8 | reserved u16
+ *   dt_ms i32 (from t0_ms) | value f32 | ch u8
+ * in native byte order (only this firmware reads it back). boot_id tells a
+ * later boot that boot-relative times are not its own. */
+#define UPLINK_LOG_HEAD_LEN    16u
+#define UPLINK_LOG_SAMPLE_LEN  9u
+#define UPLINK_LOG_PER_PAGE    ((FLASH_LOG_MAX_PAYLOAD - UPLINK_LOG_HEAD_LEN) / UPLINK_LOG_SAMPLE_LEN)
+
+/* Owned by the uplink task */
+static SensorHistoryCursor_t s_cur[SENSOR_CH_COUNT];
+static uint32_t       s_last_kept_ms[SENSOR_CH_COUNT];
+static bool           s_kept_any[SENSOR_CH_COUNT];
+static UplinkRecord_t s_batch[UPLINK_BATCH_MAX];
+static size_t         s_count;
+static uint32_t       s_first_ms;     // when the oldest pending record was collected
+static uint32_t       s_retry_at_ms;
+static bool           s_backoff;
+static UplinkEncoding_t s_encoding = UPLINK_ENCODING;
+static size_t         s_payload_len;      // bytes of the last uplink_encode()
+static size_t         s_payload_records;  // records in it
+
+/* Time spent in the sink's flush (i.e. sending) is not encode time */
+static bool         (*s_inner_flush)(ByteSink_t *sink);
+static uint64_t       s_flush_us;
+static size_t         s_flushed_bytes;
+
+#if UPLINK_LOG
+static FlashLog_t     s_log;
+static bool           s_log_ok;
+static uint32_t       s_boot_id;
+static uint32_t       s_drain_pages;   // whole log records up to the end of the last backlog batch
+static uint32_t       s_drain_part;    // samples of the log record after them in it
+static uint32_t       s_drain_from;    // whole log records in earlier batches of the group
+static uint32_t       s_drain_from_part;  // samples of the log record after them in those
+static uint32_t       s_drain_queued;  // batches put in the group by uplink_drain_next()
+static uint32_t       s_drain_records; // records and bytes in them
+static uint32_t       s_drain_bytes;
+static bool           s_drain_last;    // the last backlog batch is not in the group yet
+static bool           s_drain_open;    // encoded, outcome not reported yet
+static uint32_t       s_drain_skip;    // samples of the oldest log record already posted
+static uint32_t       s_drain_skip_seq;  // log seq s_drain_skip applies to
+static uint64_t       s_drain_t0_us;
+#endif
+
+static UplinkStats_t s_stats;
+
+void uplink_init(void) {
+    for (int ch = 0; ch < SENSOR_CH_COUNT; ch++) {
+        sensor_history_cursor_init(&s_cur[ch], (SensorChannel_t)ch, false);
+        s_kept_any[ch] = false;
+    }
+    s_count   = 0;
+    s_backoff = false;
+
+#if UPLINK_LOG
+    const FlashLogOps_t *ops = flash_log_pico_ops();
+    s_log_ok = ops != NULL;
+    if (s_log_ok) {
+        flash_log_init(&s_log, ops);
+        s_boot_id = s_log.head_seq;  // differs from every record of an earlier boot
+        taskENTER_CRITICAL();
+        flash_log_get_stats(&s_log, &s_stats.log);
+        taskEXIT_CRITICAL();
+    }
+#endif
+}
+
+void uplink_collect(uint32_t now_ms) {
+    uint32_t overruns = 0;
+
+    for (int ch = 0; ch < SENSOR_CH_COUNT && s_count < UPLINK_BATCH_MAX; ch++) {
+        SensorHistoryCursor_t *cur = &s_cur[ch];
+        const SensorSample_t *span;
+        size_t n;
+        uint32_t before = cur->overruns;
+
+        while (s_count < UPLINK_BATCH_MAX && (n = sensor_history_peek(cur, &span)) > 0) {
+            size_t used = 0;
+            for (; used < n && s_count < UPLINK_BATCH_MAX; used++) {
+                const SensorSample_t *smp = &span[used];
+                if (s_kept_any[ch] && smp->t_ms - s_last_kept_ms[ch] < UPLINK_CHANNEL_PERIOD_MS) continue;
+                if (s_count == 0) s_first_ms = now_ms;
+                s_batch[s_count++] = (UplinkRecord_t){ smp->t_ms, smp->value, (uint8_t)ch };
+                s_last_kept_ms[ch] = smp->t_ms;
+                s_kept_any[ch]     = true;
+            }
+            sensor_history_release(cur, used);
+        }
+        overruns += cur->overruns - before;
+    }
+
+    taskENTER_CRITICAL();
+    s_stats.dropped += overruns;
+    s_stats.pending  = (uint32_t)s_count;
+    taskEXIT_CRITICAL();
+}
+
+bool uplink_flush_due(uint32_t now_ms) {
+    if (s_count == 0) return false;
+    if (s_backoff && (int32_t)(now_ms - s_retry_at_ms) < 0) return false;
+    return s_count >= UPLINK_FLUSH_RECORDS || now_ms - s_first_ms >= UPLINK_FLUSH_AGE_MS;
+}
+
+static bool timed_flush(ByteSink_t *sink) {
+    uint64_t t0 = time_us_64();
+    size_t before = sink->len;
+    bool ok = s_inner_flush(sink);
+    s_flushed_bytes += before - sink->len;  // a block sink keeps its tail
+    s_flush_us += time_us_64() - t0;
+    return ok;
+}
+
+/* Around each encode: time the flushes separately */
+static uint64_t encode_start(ByteSink_t *out) {
+    s_inner_flush   = out->flush;
+    s_flush_us      = 0;
+    s_flushed_bytes = 0;
+    if (out->flush) out->flush = timed_flush;
+    return time_us_64();
+}
+
+static void encode_finish(ByteSink_t *out, uint64_t t0, size_t sent) {
+    out->flush = s_inner_flush;
+    uint32_t us = (uint32_t)(time_us_64() - t0 - s_flush_us);
+
+    s_payload_records = sent;
+    s_payload_len     = s_flushed_bytes + out->len;
+
+    taskENTER_CRITICAL();
+    s_stats.encodes++;
+    s_stats.encode_us += us;
+    s_stats.encoded_records += (uint32_t)sent;
+    taskEXIT_CRITICAL();
+}
+
+bool uplink_encode(ByteSink_t *out) {
+    const UplinkEncoder_t *enc = uplink_codec_get(s_encoding);
+    uint64_t t0 = encode_start(out);
+    size_t   sent = 0;
+    bool     ok;
+    /* One time base per batch, even if SNTP answers halfway through */
+    bool     unix_time = wall_clock_valid();
+
+    ok = uplink_codec_begin(enc, out);
+    for (size_t i = 0; ok && i < s_count; i++) {
+        const UplinkRecord_t *r = &s_batch[i];
+        UplinkCodecRecord_t rec = {
+            .name      = sensor_channel_name((SensorChannel_t)r->ch),
+            .ch        = r->ch,
+            .fmt       = s_channel_fmt[r->ch],
+            .t_ms      = unix_time ? wall_clock_unix_ms_at(r->t_ms) : r->t_ms,
+            .unix_time = unix_time,
+            .value     = r->value,
+        };
+        if (!uplink_codec_record(enc, out, &rec, i == 0)) {
+            /* A plain buffer is full: the rest waits for the next batch */
+            ok = out->flush == NULL && i > 0;
+            break;
+        }
+        sent = i + 1u;
+    }
+    ok = ok && uplink_codec_end(enc, out);
+
+    encode_finish(out, t0, sent);
+    return ok;
+}
+
+size_t uplink_encoded_len(void) {
+    return s_payload_len;
+}
+
+void uplink_set_encoding(UplinkEncoding_t enc) {
+    s_encoding = enc;
+}
+
+UplinkEncoding_t uplink_get_encoding(void) {
+    return s_encoding;
+}
+
+const char *uplink_content_type(void) {
+    return uplink_codec_get(s_encoding)->content_type;
+}
+
+#if UPLINK_LOG
+static void log_stats(void) {
+    taskENTER_CRITICAL();
+    flash_log_get_stats(&s_log, &s_stats.log);
+    taskEXIT_CRITICAL();
+}
+
+/* Move the pending batch into the flash log, UPLINK_LOG_PER_PAGE samples a
+ * record; returns the samples stored. */
+static size_t spill(void) {
+    uint8_t  rec[UPLINK_LOG_HEAD_LEN + UPLINK_LOG_PER_PAGE * UPLINK_LOG_SAMPLE_LEN];
+    bool     unix_time = wall_clock_valid();
+    size_t   done = 0;
+
+    while (done < s_count) {
+        size_t   n  = s_count - done < UPLINK_LOG_PER_PAGE ? s_count - done : UPLINK_LOG_PER_PAGE;
+        uint64_t t0 = unix_time ? wall_clock_unix_ms_at(s_batch[done].t_ms) : s_batch[done].t_ms;
+        uint8_t  flags[4] = { unix_time, (uint8_t)n, 0xFF, 0xFF };
+
+        memcpy(&rec[0], &t0, 8);
+        memcpy(&rec[8], &s_boot_id, 4);
+        memcpy(&rec[12], flags, 4);
+        for (size_t i = 0; i < n; i++) {
+            const UplinkRecord_t *r = &s_batch[done + i];
+            uint8_t *p  = &rec[UPLINK_LOG_HEAD_LEN + i * UPLINK_LOG_SAMPLE_LEN];
+            uint64_t t  = unix_time ? wall_clock_unix_ms_at(r->t_ms) : r->t_ms;
+            int32_t  dt = (int32_t)(t - t0);
+            memcpy(&p[0], &dt, 4);
+            memcpy(&p[4], &r->value, 4);
+            p[8] = r->ch;
+        }
+        if (!flash_log_append(&s_log, rec, UPLINK_LOG_HEAD_LEN + n * UPLINK_LOG_SAMPLE_LEN)) break;
+        done += n;
+    }
+
+    for (size_t i = done; i < s_count; i++) s_batch[i - done] = s_batch[i];
+    s_count -= done;
+    log_stats();
+    return done;
+}
+#endif
+
+void uplink_flush_done(bool ok, uint32_t now_ms) {
+    size_t sent = s_payload_records;
+    size_t spilled = 0;
+
+    if (ok) {
+        /* Keep whatever did not fit into a plain buffer */
+        for (size_t i = sent; i < s_count; i++) s_batch[i - sent] = s_batch[i];
+        s_count   -= sent;
+        s_first_ms = now_ms;
+        s_backoff  = false;
+    } else {
+        s_backoff     = true;
+        s_retry_at_ms = now_ms + UPLINK_RETRY_MS;
+#if UPLINK_LOG
+        /* Free the batch for new samples; the log is drained once posts
+         * succeed again */
+        if (s_log_ok) spilled = spill();
+        s_first_ms = now_ms;
+#endif
+    }
+
+    taskENTER_CRITICAL();
+    if (ok) {
+        s_stats.batches++;
+        s_stats.records_sent  += (uint32_t)sent;
+        s_stats.payload_bytes += (uint32_t)s_payload_len;
+    } else {
+        s_stats.failures++;
+        s_stats.spilled += (uint32_t)spilled;
+    }
+    s_stats.pending = (uint32_t)s_count;
+    taskEXIT_CRITICAL();
+}
+
+#if UPLINK_LOG
+bool uplink_drain_due(uint32_t now_ms) {
+    if (!s_log_ok || flash_log_count(&s_log) == 0) return false;
+    return !s_backoff || (int32_t)(now_ms - s_retry_at_ms) >= 0;
+}
+
+bool uplink_encode_backlog(ByteSink_t *out) {
+    const UplinkEncoder_t *enc = uplink_codec_get(s_encoding);
+    uint64_t t0 = encode_start(out);
+    size_t   sent = 0;
+    bool     ok, base_set = false, base_unix = false;
+    FlashLogIter_t it;
+    const uint8_t *p;
+    size_t len;
+
+    if (!s_drain_open) s_drain_t0_us = t0;  // else re-sent after a 415
+    s_drain_open  = true;
+    s_drain_last  = true;
+    s_drain_pages = s_drain_from;
+    s_drain_part  = 0;
+    flash_log_iter(&s_log, &it);
+    for (uint32_t k = 0; k < s_drain_from && flash_log_next(&s_log, &it, &len) != NULL; k++) {
+    }
+    ok = uplink_codec_begin(enc, out);
+    while (ok && s_drain_pages < s_drain_from + UPLINK_DRAIN_PAGES) {
+        /* Samples an earlier batch (of the group, or a smaller one posted
+         * before it) already took from the first record */
+        size_t from = 0;
+        if (s_drain_pages == s_drain_from) {
+            if (s_drain_queued > 0) {
+                from = s_drain_from_part;
+            } else if (it.seq == s_drain_skip_seq) {
+                from = s_drain_skip;
+            }
+        }
+        if ((p = flash_log_next(&s_log, &it, &len)) == NULL) break;
+
+        uint64_t t0_ms;
+        uint32_t boot_id;
+        size_t   n = p[13];
+        memcpy(&t0_ms, &p[0], 8);
+        memcpy(&boot_id, &p[8], 4);
+        if (len < UPLINK_LOG_HEAD_LEN + n * UPLINK_LOG_SAMPLE_LEN) {
+            s_drain_pages++;  // not ours: skip it
+            continue;
+        }
+
+        /* Boot-relative times of this boot can still be placed in Unix time */
+        bool unix_time = p[12] != 0;
+        bool convert   = !unix_time && boot_id == s_boot_id && wall_clock_valid();
+        if (convert) unix_time = true;
+        if (!base_set) {
+            base_unix = unix_time;
+            base_set  = true;
+        } else if (unix_time != base_unix) {
+            break;  // one time base per batch
+        }
+
+        size_t i;
+        for (i = from; i < n; i++) {
+            const uint8_t *smp = &p[UPLINK_LOG_HEAD_LEN + i * UPLINK_LOG_SAMPLE_LEN];
+            int32_t dt;
+            float   value;
+            uint8_t ch = smp[8];
+            memcpy(&dt, &smp[0], 4);
+            memcpy(&value, &smp[4], 4);
+            if (ch >= SENSOR_CH_COUNT) continue;
+
+            uint64_t t = t0_ms + (uint64_t)(int64_t)dt;
+            UplinkCodecRecord_t rec = {
+                .name      = sensor_channel_name((SensorChannel_t)ch),
+                .ch        = ch,
+                .fmt       = s_channel_fmt[ch],
+                .t_ms      = convert ? wall_clock_unix_ms_at((uint32_t)t) : t,
+                .unix_time = unix_time,
+                .value     = value,
+            };
+            if (!uplink_codec_record(enc, out, &rec, sent == 0)) break;
+            sent++;
+        }
+        if (i < n) {
+            /* A plain buffer is full; the next batch carries on from sample i */
+            s_drain_part = (uint32_t)i;
+            ok = out->flush == NULL && (s_drain_pages > s_drain_from || i > from);
+            break;
+        }
+        s_drain_pages++;
+    }
+    ok = ok && (s_drain_pages > s_drain_from || s_drain_part > 0) && uplink_codec_end(enc, out);
+
+    encode_finish(out, t0, sent);
+    return ok;
+}
+
+bool uplink_drain_next(void) {
+    s_drain_from      = s_drain_pages;
+    s_drain_from_part = s_drain_part;
+    if (s_drain_last) {
+        s_drain_queued++;
+        s_drain_records += (uint32_t)s_payload_records;
+        s_drain_bytes   += (uint32_t)s_payload_len;
+        s_drain_last     = false;
+    }
+    return s_drain_part > 0 || s_drain_pages < flash_log_count(&s_log);
+}
+
+void uplink_drain_done(bool ok, uint32_t now_ms) {
+    uint32_t batches = s_drain_queued;
+    uint32_t sent    = s_drain_records;
+    uint32_t bytes   = s_drain_bytes;
+
+    if (s_drain_last) {
+        batches++;
+        sent  += (uint32_t)s_payload_records;
+        bytes += (uint32_t)s_payload_len;
+    }
+
+    if (ok) {
+        flash_log_consume(&s_log, s_drain_pages);
+        /* Until a reset, a partly posted record resumes where it stopped */
+        s_drain_skip     = s_drain_part;
+        s_drain_skip_seq = s_log.tail_seq;
+        s_backoff        = false;
+    } else {
+        s_backoff     = true;
+        s_retry_at_ms = now_ms + UPLINK_RETRY_MS;
+    }
+    s_drain_open      = false;
+    s_drain_pages     = 0;
+    s_drain_part      = 0;
+    s_drain_from      = 0;
+    s_drain_from_part = 0;
+    s_drain_queued    = 0;
+    s_drain_records   = 0;
+    s_drain_bytes     = 0;
+    s_drain_last      = false;
+
+    taskENTER_CRITICAL();
+    if (ok) {
+        s_stats.batches       += batches;
+        s_stats.records_sent  += sent;
+        s_stats.payload_bytes += bytes;
+        s_stats.drained       += sent;
+        s_stats.drain_us      += time_us_64() - s_drain_t0_us;
+    } else {
+        s_stats.failures++;
+    }
+    taskEXIT_CRITICAL();
+    log_stats();
+}
+#else
+bool uplink_drain_due(uint32_t now_ms) {
+    (void)now_ms;
+    return false;
+}
+
+bool uplink_encode_backlog(ByteSink_t *out) {
+    (void)out;
+    return false;
+}
+
+bool uplink_drain_next(void) {
+    return false;
+}
+
+void uplink_drain_done(bool ok, uint32_t now_ms) {
+    (void)ok;
+    (void)now_ms;
+}
+#endif
+
+void uplink_get_stats(UplinkStats_t *out) {
+    taskENTER_CRITICAL();
+    *out = s_stats;
+    taskEXIT_CRITICAL();
+}
@@ -0,0 +1,139 @@
+/* src/uplink.h — batching uplink over the sensor history rings.
+ *
+ * Instead of one snapshot per HTTPS request, the uplink reads every channel
+ * of sensor_history through its own cursors, keeps one sample per channel
+ * per UPLINK_CHANNEL_PERIOD_MS, and ships the accumulated records as one
+ * array in the selected encoding (uplink_codec.h), JSON by way of example:
+ *
+ *   [{"ch":"temperature","t":1760700000123,"v":23.51}, ...]
+ *
+ * "t" is Unix time in ms once wall_clock.h is synchronised; before that the
+ * key is "t_boot" (ms since boot). A batch is flushed when it holds
+ * UPLINK_FLUSH_RECORDS records or its oldest record is UPLINK_FLUSH_AGE_MS
+ * old. A failed post keeps the batch and retries after UPLINK_RETRY_MS.
+ *
+ * The encoding starts as UPLINK_ENCODING (CBOR; UPLINK_ENC_GORILLA is the
+ * compact choice for ingest servers that link gorilla_decode.c). If the
+ * server rejects it (415 Unsupported Media Type) the caller switches to JSON
+ * with uplink_set_encoding() and posts the batch again. All records of a
+ * batch share one time base.
+ *
+ * With UPLINK_LOG, a batch whose post fails is moved into a store-and-
+ * forward log in flash (flash_log.h) instead of waiting in RAM, so sampling
+ * carries on through Wi-Fi outages and resets. Once posts succeed again the
+ * log is drained oldest first, UPLINK_DRAIN_PAGES log records (up to 24
+ * samples each) per post, streamed straight from flash.
+ *
+ * Owned by a single task (the API task).
+ */
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flash_log.h"
+#include "uplink_codec.h"
+
+/* Initial encoding; see uplink_codec.h */
+#ifndef UPLINK_ENCODING
+#define UPLINK_ENCODING UPLINK_ENC_CBOR
+#endif
+/* Records per batch; collection pauses while the batch is full. */
+#ifndef UPLINK_BATCH_MAX
+#define UPLINK_BATCH_MAX 128u
+#endif
+/* Flush thresholds */
+#ifndef UPLINK_FLUSH_RECORDS
+#define UPLINK_FLUSH_RECORDS 96u
+#endif
+#ifndef UPLINK_FLUSH_AGE_MS
+#define UPLINK_FLUSH_AGE_MS 60000u
+#endif
+#ifndef UPLINK_RETRY_MS
+#define UPLINK_RETRY_MS 10000u
+#endif
+/* Decimation: at most one record per channel per period (0 = every sample). */
+#ifndef UPLINK_CHANNEL_PERIOD_MS
+#define UPLINK_CHANNEL_PERIOD_MS 5000u
+#endif
+
+/* Store-and-forward through the flash log */
+#ifndef UPLINK_LOG
+#define UPLINK_LOG 1
+#endif
+/* Log records per backlog post (64 = up to 1536 samples) */
+#ifndef UPLINK_DRAIN_PAGES
+#define UPLINK_DRAIN_PAGES 64u
+#endif
+
+typedef struct {
+    uint32_t batches;        // posted successfully
+    uint32_t failures;       // posts that failed (batch retried)
+    uint32_t records_sent;
+    uint32_t payload_bytes;  // encoded bytes of successful batches
+    uint32_t dropped;        // lost to history overruns while the batch was full
+    uint32_t pending;        // records waiting in the current batch
+    uint32_t encodes;        // uplink_encode() calls
+    uint32_t encoded_records;
+    uint64_t encode_us;      // total time encoding (sending excluded)
+    uint32_t spilled;        // records moved to the flash log after failed posts
+    uint32_t drained;        // records posted from the flash log
+    uint64_t drain_us;       // time encoding and posting them
+    FlashLogStats_t log;     // in log records; capacity 0 if there is no log
+} UplinkStats_t;
+
+/* Start reading all channels from "now". */
+void uplink_init(void);
+
+/* Move new history samples into the batch. Call periodically. */
+void uplink_collect(uint32_t now_ms);
+
+/* True when the size or age threshold is reached (and not backing off). */
+bool uplink_flush_due(uint32_t now_ms);
+
+/* Encode the pending batch in the current encoding into out. A streaming
+ * sink (with flush) takes the whole batch; a plain buffer takes as many
+ * records as fit. Returns false if nothing usable was written. May be
+ * called again to re-send the same batch. */
+bool uplink_encode(ByteSink_t *out);
+
+/* Bytes written by the last uplink_encode() */
+size_t uplink_encoded_len(void);
+
+void             uplink_set_encoding(UplinkEncoding_t enc);
+UplinkEncoding_t uplink_get_encoding(void);
+
+/* Content-Type of uplink_encode() output */
+const char *uplink_content_type(void);
+
+/* Report the outcome of posting uplink_encode(): on success the batch is
+ * cleared, otherwise it is moved to the flash log (or kept, without one)
+ * and posting resumes after UPLINK_RETRY_MS. Also call it with false when
+ * a due batch cannot be posted at all (Wi-Fi down). */
+void uplink_flush_done(bool ok, uint32_t now_ms);
+
+/* True when the flash log holds records and posting is not backing off. */
+bool uplink_drain_due(uint32_t now_ms);
+
+/* Like uplink_encode(), for the oldest flash log records. A plain buffer
+ * may end partway through a log record; once that post succeeds, the next
+ * one starts at the first sample left out (after a reset, at the start of
+ * the record again). */
+bool uplink_encode_backlog(ByteSink_t *out);
+
+/* Put the batch uplink_encode_backlog() just wrote into a group with the
+ * ones before it: the next call encodes the records after it, and nothing
+ * leaves the log until uplink_drain_done(). For a transport that has
+ * several batches in flight at once (MQTT). True if records are left. */
+bool uplink_drain_next(void);
+
+/* Report the outcome of posting uplink_encode_backlog(), or of the whole
+ * group; on success its records leave the log, otherwise all of them are
+ * posted again. */
+void uplink_drain_done(bool ok, uint32_t now_ms);
+
+void uplink_get_stats(UplinkStats_t *out);
+
+#endif /* UPLINK_H */
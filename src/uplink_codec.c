@@ -0,0 +1,247 @@
+/* src/uplink_codec.c — see uplink_codec.h. */
+#include "uplink_codec.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* ====================================================================
+   --- JSON ---
+   ==================================================================== */
+
+static size_t json_begin(uint8_t *buf, size_t cap) {
+    if (cap < 1u) return UPLINK_CODEC_NO_ROOM;
+    buf[0] = '[';
+    return 1;
+}
+
+static size_t json_record(uint8_t *buf, size_t cap, const UplinkCodecRecord_t *r, bool first) {
+    int n;
+    if (r->unix_time) {
+        n = snprintf((char *)buf, cap, "%s{\"ch\":\"%s\",\"t\":%llu,\"v\":%.2f}", first ? "" : ",",
+                     r->name, (unsigned long long)r->t_ms, (double)r->value);
+    } else {
+        n = snprintf((char *)buf, cap, "%s{\"ch\":\"%s\",\"t_boot\":%llu,\"v\":%.2f}", first ? "" : ",",
+                     r->name, (unsigned long long)r->t_ms, (double)r->value);
+    }
+    return (n < 0 || (size_t)n >= cap) ? UPLINK_CODEC_NO_ROOM : (size_t)n;
+}
+
+static size_t json_end(uint8_t *buf, size_t cap) {
+    if (cap < 1u) return UPLINK_CODEC_NO_ROOM;
+    buf[0] = ']';
+    return 1;
+}
+
+/* ====================================================================
+   --- CBOR (RFC 8949) ---
+   ==================================================================== */
+
+#define CBOR_UINT        0u     // major types
+#define CBOR_TEXT        3u
+#define CBOR_MAP         5u
+#define CBOR_ARRAY_INDEF 0x9Fu  // initial bytes
+#define CBOR_HALF        0xF9u
+#define CBOR_SINGLE      0xFAu
+#define CBOR_BREAK       0xFFu
+
+/* Length of a major type + argument head in its shortest form */
+static size_t cbor_head_len(uint64_t v) {
+    if (v < 24u)          return 1;
+    if (v <= 0xFFu)       return 2;
+    if (v <= 0xFFFFu)     return 3;
+    if (v <= 0xFFFFFFFFu) return 5;
+    return 9;
+}
+
+static uint8_t *cbor_head(uint8_t *p, uint8_t major, uint64_t v) {
+    size_t len = cbor_head_len(v);
+    static const uint8_t ai[10] = { 0, 0, 24, 25, 0, 26, 0, 0, 0, 27 };
+
+    if (len == 1) {
+        *p++ = (uint8_t)(major << 5 | v);
+        return p;
+    }
+    *p++ = (uint8_t)(major << 5 | ai[len]);
+    for (size_t i = len - 1u; i > 0; i--) {
+        *p++ = (uint8_t)(v >> (8u * (i - 1u)));
+    }
+    return p;
+}
+
+static uint8_t *cbor_text(uint8_t *p, const char *s, size_t len) {
+    p = cbor_head(p, CBOR_TEXT, len);
+    memcpy(p, s, len);
+    return p + len;
+}
+
+/* The half float equal to f, if there is one (NaN maps to the canonical 0x7E00) */
+static bool float_to_half_exact(float f, uint16_t *out) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000u);
+    uint32_t exp  = (bits >> 23) & 0xFFu;
+    uint32_t mant = bits & 0x7FFFFFu;
+
+    if (exp == 0xFFu) {
+        *out = mant ? 0x7E00u : (uint16_t)(sign | 0x7C00u);
+        return true;
+    }
+    if (exp == 0u) {
+        // Zero; float subnormals are far below the half range
+        *out = sign;
+        return mant == 0u;
+    }
+
+    int32_t e = (int32_t)exp - 127;
+    if (e > 15) return false;
+    if (e >= -14) {
+        if (mant & 0x1FFFu) return false;
+        *out = (uint16_t)(sign | (uint32_t)(e + 15) << 10 | mant >> 13);
+        return true;
+    }
+    if (e >= -24) {
+        // Half subnormal: value = m * 2^-24
+        uint32_t m     = mant | 0x800000u;
+        uint32_t shift = (uint32_t)(-(e + 1));
+        if (m & ((1u << shift) - 1u)) return false;
+        *out = (uint16_t)(sign | m >> shift);
+        return true;
+    }
+    return false;
+}
+
+static size_t cbor_begin(uint8_t *buf, size_t cap) {
+    if (cap < 1u) return UPLINK_CODEC_NO_ROOM;
+    buf[0] = CBOR_ARRAY_INDEF;
+    return 1;
+}
+
+static size_t cbor_record(uint8_t *buf, size_t cap, const UplinkCodecRecord_t *r, bool first) {
+    static const char k_ch[] = "ch", k_t[] = "t", k_t_boot[] = "t_boot", k_v[] = "v";
+    (void)first;  // the stream needs no separators
+
+    size_t   name_len = strlen(r->name);
+    uint16_t half;
+    bool     is_half  = float_to_half_exact(r->value, &half);
+    const char *k_time   = r->unix_time ? k_t : k_t_boot;
+    size_t   k_time_len  = r->unix_time ? sizeof(k_t) - 1u : sizeof(k_t_boot) - 1u;
+
+    size_t need = 1u                                                   // map(3)
+                + 1u + (sizeof(k_ch) - 1u) + cbor_head_len(name_len) + name_len
+                + 1u + k_time_len + cbor_head_len(r->t_ms)
+                + 1u + (sizeof(k_v) - 1u) + (is_half ? 3u : 5u);
+    if (need > cap) return UPLINK_CODEC_NO_ROOM;
+
+    uint8_t *p = buf;
+    p = cbor_head(p, CBOR_MAP, 3);
+    p = cbor_text(p, k_ch, sizeof(k_ch) - 1u);
+    p = cbor_text(p, r->name, name_len);
+    p = cbor_text(p, k_time, k_time_len);
+    p = cbor_head(p, CBOR_UINT, r->t_ms);
+    p = cbor_text(p, k_v, sizeof(k_v) - 1u);
+    if (is_half) {
+        *p++ = CBOR_HALF;
+        *p++ = (uint8_t)(half >> 8);
+        *p++ = (uint8_t)half;
+    } else {
+        uint32_t bits;
+        memcpy(&bits, &r->value, sizeof(bits));
+        *p++ = CBOR_SINGLE;
+        *p++ = (uint8_t)(bits >> 24);
+        *p++ = (uint8_t)(bits >> 16);
+        *p++ = (uint8_t)(bits >> 8);
+        *p++ = (uint8_t)bits;
+    }
+    return (size_t)(p - buf);
+}
+
+static size_t cbor_end(uint8_t *buf, size_t cap) {
+    if (cap < 1u) return UPLINK_CODEC_NO_ROOM;
+    buf[0] = CBOR_BREAK;
+    return 1;
+}
+
+/* ====================================================================
+   --- Gorilla (gorilla.h) ---
+   ==================================================================== */
+
+static GorillaEnc_t s_gorilla;  // one batch at a time
+
+static size_t gorilla_begin(uint8_t *buf, size_t cap) {
+    size_t n = gorilla_enc_begin(&s_gorilla, gorilla_ch_bits(UPLINK_CODEC_CHANNELS), buf, cap);
+    return n ? n : UPLINK_CODEC_NO_ROOM;
+}
+
+static size_t gorilla_record(uint8_t *buf, size_t cap, const UplinkCodecRecord_t *r, bool first) {
+    (void)first;  // the stream needs no separators
+    return gorilla_enc_record(&s_gorilla, r->ch, r->fmt, r->name, r->t_ms, r->unix_time, r->value, buf, cap);
+}
+
+static size_t gorilla_end(uint8_t *buf, size_t cap) {
+    return gorilla_enc_end(&s_gorilla, buf, cap);
+}
+
+/* ==================================================================== */
+
+static const UplinkEncoder_t s_encoders[UPLINK_ENC_COUNT] = {
+    [UPLINK_ENC_JSON]    = { "json",    "application/json",      50,    1, json_begin, json_record, json_end },
+    [UPLINK_ENC_CBOR]    = { "cbor",    "application/cbor",      60,    1, cbor_begin, cbor_record, cbor_end },
+    [UPLINK_ENC_GORILLA] = { "gorilla", "application/x-gorilla", 65000, GORILLA_END_MAX,
+                             gorilla_begin, gorilla_record, gorilla_end },
+};
+
+const UplinkEncoder_t *uplink_codec_get(UplinkEncoding_t enc) {
+    return (enc < UPLINK_ENC_COUNT) ? &s_encoders[enc] : &s_encoders[UPLINK_ENC_JSON];
+}
+
+/* ====================================================================
+   --- Sink helpers ---
+   ==================================================================== */
+
+/* Space for the next piece; a plain buffer keeps room for end() unless
+ * this is the end itself. */
+static size_t room(const UplinkEncoder_t *enc, const ByteSink_t *out, bool is_end) {
+    size_t reserve = (out->flush == NULL && !is_end) ? enc->end_len : 0u;
+    size_t free_   = out->cap - out->len;
+    return free_ > reserve ? free_ - reserve : 0u;
+}
+
+/* Nothing fitted: flush and try again, unless there is nothing to gain */
+static bool make_room(ByteSink_t *out) {
+    return out->flush != NULL && out->len > 0 && out->flush(out);
+}
+
+bool uplink_codec_begin(const UplinkEncoder_t *enc, ByteSink_t *out) {
+    for (;;) {
+        size_t n = enc->begin(out->buf + out->len, room(enc, out, false));
+        if (n != UPLINK_CODEC_NO_ROOM) {
+            out->len += n;
+            return true;
+        }
+        if (!make_room(out)) return false;
+    }
+}
+
+bool uplink_codec_record(const UplinkEncoder_t *enc, ByteSink_t *out,
+                         const UplinkCodecRecord_t *r, bool first) {
+    for (;;) {
+        size_t n = enc->record(out->buf + out->len, room(enc, out, false), r, first);
+        if (n != UPLINK_CODEC_NO_ROOM) {
+            out->len += n;
+            return true;
+        }
+        if (!make_room(out)) return false;
+    }
+}
+
+bool uplink_codec_end(const UplinkEncoder_t *enc, ByteSink_t *out) {
+    for (;;) {
+        size_t n = enc->end(out->buf + out->len, room(enc, out, true));
+        if (n != UPLINK_CODEC_NO_ROOM) {
+            out->len += n;
+            return true;
+        }
+        if (!make_room(out)) return false;
+    }
+}
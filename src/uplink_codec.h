@@ -0,0 +1,83 @@
+/* src/uplink_codec.h — wire encodings for uplink batches.
+ *
+ * An encoder writes one batch as an array of records
+ *
+ *   { "ch": <channel name>, "t": <Unix ms> | "t_boot": <ms since boot>, "v": <value> }
+ *
+ * straight into the transmit buffer, one record at a time. Through a
+ * ByteSink_t the window is flushed whenever the next piece does not fit, so
+ * a batch of any size streams through a small buffer; with a plain buffer
+ * (no flush) encoding stops at the first record that does not fit. Three
+ * encoders exist:
+ *
+ *   JSON     application/json       text, values rounded to 2 decimals
+ *   CBOR     application/cbor       RFC 8949, indefinite-length array of maps
+ *                                   with the same text keys; integers in their
+ *                                   shortest form, values as half floats when
+ *                                   that is exact, otherwise single floats
+ *   Gorilla  application/x-gorilla  gorilla.h bit stream keyed by channel
+ *                                   number: delta-of-delta timestamps, values
+ *                                   XOR-coded (fixed point or float) or as
+ *                                   zigzag varint differences, per record fmt
+ *
+ * The CoAP Content-Formats are the registered 50 (JSON) and 60 (CBOR);
+ * Gorilla uses 65000 from the experimental range.
+ *
+ * No dependencies beyond libc, so the host benchmark in
+ * tools/uplink_codec_bench builds the same files.
+ */
+#ifndef UPLINK_CODEC_H
+#define UPLINK_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "byte_sink.h"
+#include "gorilla.h"
+
+/* Channel numbers (UplinkCodecRecord_t.ch) are below this */
+#define UPLINK_CODEC_CHANNELS GORILLA_ENC_CHANNELS
+
+/* Returned by the encoder callbacks when a piece does not fit */
+#define UPLINK_CODEC_NO_ROOM ((size_t)-1)
+
+typedef enum {
+    UPLINK_ENC_JSON = 0,
+    UPLINK_ENC_CBOR,
+    UPLINK_ENC_GORILLA,
+    UPLINK_ENC_COUNT
+} UplinkEncoding_t;
+
+typedef struct {
+    const char *name;          // channel name
+    uint8_t     ch;            // channel number, < UPLINK_CODEC_CHANNELS
+    uint8_t     fmt;           // GORILLA_FMT_*: value resolution (Gorilla only)
+    uint64_t    t_ms;          // Unix ms if unix_time, else ms since boot
+    bool        unix_time;     // the same for every record of a batch
+    float       value;
+} UplinkCodecRecord_t;
+
+typedef struct {
+    const char *name;          // "json", "cbor", "gorilla"
+    const char *content_type;
+    uint16_t    coap_format;   // CoAP Content-Format number (RFC 7252 12.3)
+    size_t      end_len;       // bytes end() writes; reserve them while adding records
+    /* Each returns the bytes written (the Gorilla encoder may buffer a
+     * record entirely), or UPLINK_CODEC_NO_ROOM if they do not fit in cap. */
+    size_t (*begin)(uint8_t *buf, size_t cap);
+    size_t (*record)(uint8_t *buf, size_t cap, const UplinkCodecRecord_t *r, bool first);
+    size_t (*end)(uint8_t *buf, size_t cap);
+} UplinkEncoder_t;
+
+const UplinkEncoder_t *uplink_codec_get(UplinkEncoding_t enc);
+
+/* Write one piece into out, flushing first if it does not fit. Without a
+ * flush, room for end() is kept free. False if it cannot be written.
+ * One batch at a time: the Gorilla encoder state lives here. */
+bool uplink_codec_begin(const UplinkEncoder_t *enc, ByteSink_t *out);
+bool uplink_codec_record(const UplinkEncoder_t *enc, ByteSink_t *out,
+                         const UplinkCodecRecord_t *r, bool first);
+bool uplink_codec_end(const UplinkEncoder_t *enc, ByteSink_t *out);
+
+#endif /* UPLINK_CODEC_H */
@@ -0,0 +1,87 @@
+/* src/voc_state.c — see voc_state.h. */
+#include "voc_state.h"
+
+#include "pico/stdlib.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "SGP40.h"
+#include "flash_store.h"
+#include "wall_clock.h"
+
+#define VOC_STATE_TAG 0x31434F56u // "VOC1"
+
+typedef struct {
+    uint32_t unix_s;
+    int32_t  state0;
+    int32_t  state1;
+} VocSnapshot_t;
+
+/* Owned by the VOC task */
+static uint32_t s_learn_start_ms;
+static bool     s_learned;
+static uint32_t s_next_save_unix;
+
+static VocStateStats_t s_stats;
+
+static inline uint32_t now_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+bool voc_state_restore(void) {
+    VocSnapshot_t snap;
+    bool restored = false;
+    uint32_t age = 0;
+
+    s_learn_start_ms = now_ms();
+
+    if (flash_store_read(VOC_STATE_TAG, &snap, sizeof(snap)) == (int)sizeof(snap)) {
+        for (uint32_t waited = 0; !wall_clock_valid() && waited < VOC_STATE_CLOCK_WAIT_MS; waited += 100u) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+        }
+        uint32_t now = wall_clock_unix();
+        age = now - snap.unix_s;
+        if (now != 0 && (int32_t)age >= 0 && age <= VOC_STATE_MAX_AGE_S) {
+            SGP40_RestoreStates(snap.state0, snap.state1, VOC_STATE_WARMUP_S);
+            restored  = true;
+            s_learned = true;
+        }
+    }
+
+    taskENTER_CRITICAL();
+    s_stats.restored       = restored;
+    s_stats.restored_age_s = restored ? age : 0;
+    taskEXIT_CRITICAL();
+    return restored;
+}
+
+void voc_state_poll(void) {
+    if (!s_learned) {
+        if (now_ms() - s_learn_start_ms < VOC_STATE_LEARN_S * 1000u) return;
+        s_learned = true;
+    }
+
+    uint32_t now = wall_clock_unix();
+    if (now == 0 || (int32_t)(now - s_next_save_unix) < 0) return;
+    s_next_save_unix = now + VOC_STATE_SAVE_PERIOD_S;
+
+    VocSnapshot_t snap = { .unix_s = now };
+    SGP40_GetStates(&snap.state0, &snap.state1);
+    bool ok = flash_store_write(VOC_STATE_TAG, &snap, sizeof(snap));
+
+    taskENTER_CRITICAL();
+    if (ok) {
+        s_stats.saves++;
+        s_stats.last_save_unix = now;
+    } else {
+        s_stats.save_failures++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void voc_state_get_stats(VocStateStats_t *out) {
+    taskENTER_CRITICAL();
+    *out = s_stats;
+    taskEXIT_CRITICAL();
+}
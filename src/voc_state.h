@@ -0,0 +1,56 @@
+/* src/voc_state.h — warm restart of the SGP40 VOC algorithm.
+ *
+ * The VOC index needs hours to learn its baseline from scratch. Once the
+ * algorithm has learned (VOC_STATE_LEARN_S of operation, or a successful
+ * restore), its two state words are saved to flash_store every
+ * VOC_STATE_SAVE_PERIOD_S together with the Unix time. At boot they are
+ * restored if the record is younger than VOC_STATE_MAX_AGE_S, so the index
+ * is valid after VOC_STATE_WARMUP_S instead of after hours.
+ *
+ * Freshness needs wall-clock time across a power cycle, so both saving and
+ * restoring wait for the SNTP clock (wall_clock.h).
+ */
+#ifndef VOC_STATE_H
+#define VOC_STATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Sensirion: states must not be restored after more than 10 minutes. */
+#ifndef VOC_STATE_MAX_AGE_S
+#define VOC_STATE_MAX_AGE_S 600u
+#endif
+#ifndef VOC_STATE_SAVE_PERIOD_S
+#define VOC_STATE_SAVE_PERIOD_S 300u
+#endif
+/* Sensirion: get_states is only meaningful after 3 h of operation. */
+#ifndef VOC_STATE_LEARN_S
+#define VOC_STATE_LEARN_S (3u * 3600u)
+#endif
+/* Samples discarded after a restore while the hot plate settles. */
+#ifndef VOC_STATE_WARMUP_S
+#define VOC_STATE_WARMUP_S 5u
+#endif
+/* How long voc_state_restore() waits for the first SNTP response. */
+#ifndef VOC_STATE_CLOCK_WAIT_MS
+#define VOC_STATE_CLOCK_WAIT_MS 15000u
+#endif
+
+typedef struct {
+    bool     restored;
+    uint32_t restored_age_s;  // age of the restored snapshot
+    uint32_t saves;
+    uint32_t save_failures;
+    uint32_t last_save_unix;
+} VocStateStats_t;
+
+/* Call once from the VOC task after SGP40_init(), before the first sample.
+ * Blocks up to VOC_STATE_CLOCK_WAIT_MS; returns true if states were restored. */
+bool voc_state_restore(void);
+
+/* Call after every processed sample; saves when a snapshot is due. */
+void voc_state_poll(void);
+
+void voc_state_get_stats(VocStateStats_t *out);
+
+#endif /* VOC_STATE_H */
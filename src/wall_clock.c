@@ -0,0 +1,58 @@
+/* src/wall_clock.c — see wall_clock.h. */
+#include "wall_clock.h"
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/apps/sntp.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Unix time at s_sync_us; written by the lwIP thread */
+static uint32_t s_sync_unix;
+static uint64_t s_sync_us;
+
+void wall_clock_start(void) {
+    cyw43_arch_lwip_begin();
+    if (!sntp_enabled()) {
+        sntp_setoperatingmode(SNTP_OPMODE_POLL);
+        sntp_setservername(0, WALL_CLOCK_NTP_SERVER);
+        sntp_init();
+    }
+    cyw43_arch_lwip_end();
+}
+
+void wall_clock_set_unix(uint32_t sec) {
+    uint64_t now = time_us_64();
+    taskENTER_CRITICAL();
+    s_sync_unix = sec;
+    s_sync_us   = now;
+    taskEXIT_CRITICAL();
+}
+
+bool wall_clock_valid(void) {
+    return __atomic_load_n(&s_sync_unix, __ATOMIC_RELAXED) != 0;
+}
+
+uint32_t wall_clock_unix(void) {
+    taskENTER_CRITICAL();
+    uint32_t unix_s = s_sync_unix;
+    uint64_t at_us  = s_sync_us;
+    taskEXIT_CRITICAL();
+
+    if (unix_s == 0) return 0;
+    return unix_s + (uint32_t)((time_us_64() - at_us) / 1000000u);
+}
+
+uint64_t wall_clock_unix_ms_at(uint32_t boot_ms) {
+    taskENTER_CRITICAL();
+    uint32_t unix_s = s_sync_unix;
+    uint64_t at_us  = s_sync_us;
+    taskEXIT_CRITICAL();
+
+    if (unix_s == 0) return 0;
+    /* Widen boot_ms against the current time, then offset from the sync point */
+    uint64_t now_ms = time_us_64() / 1000u;
+    int64_t  t_us   = (int64_t)(now_ms - (uint32_t)((uint32_t)now_ms - boot_ms)) * 1000;
+    return (uint64_t)unix_s * 1000u + (uint64_t)((t_us - (int64_t)at_us) / 1000);
+}
@@ -0,0 +1,33 @@
+/* src/wall_clock.h — Unix time from SNTP, kept on the microsecond timer.
+ *
+ * lwIP's SNTP client (apps/sntp) polls WALL_CLOCK_NTP_SERVER and hands
+ * each result to wall_clock_set_unix() through SNTP_SET_SYSTEM_TIME in
+ * lwipopts.h. Between updates the time is extrapolated from time_us_64().
+ * Until the first response arrives the clock is invalid and reads 0.
+ */
+#ifndef WALL_CLOCK_H
+#define WALL_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef WALL_CLOCK_NTP_SERVER
+#define WALL_CLOCK_NTP_SERVER "pool.ntp.org"
+#endif
+
+/* Start the SNTP client. Call once the network is up. */
+void     wall_clock_start(void);
+
+bool     wall_clock_valid(void);
+
+/* Seconds since 1970-01-01 UTC, or 0 if not synchronised yet. */
+uint32_t wall_clock_unix(void);
+
+/* Unix time in ms of a to_ms_since_boot() timestamp from the last 49 days,
+ * or 0 if not synchronised yet. */
+uint64_t wall_clock_unix_ms_at(uint32_t boot_ms);
+
+/* Called from the lwIP thread on every SNTP response. */
+void     wall_clock_set_unix(uint32_t sec);
+
+#endif /* WALL_CLOCK_H */
@@ -0,0 +1,591 @@
+/* tools/coap_dtls/coap_dtls.c — src/coap_udp.c with DTLS against a local server.
+ *
+ *   coap_dtls -c CERT -k KEY [-b BODY_BYTES]
+ *
+ * Runs the firmware's DTLS transport (coap_udp.c, tls_net.c) and CoAP
+ * client (coap_client.c) on POSIX sockets against a DTLS 1.2 CoAP server
+ * in a second thread: mbedTLS with HelloVerifyRequest cookies and a
+ * session cache, answering block-wise (RFC 7959) POSTs of BODY_BYTES
+ * (3000) and checking every body. CERT and KEY are the server's PEM
+ * certificate and key; the client checks no chain, as on the device.
+ *
+ * The server can lose its next outgoing datagrams, ignore a request,
+ * flush its session cache or forget the client's session. The scenarios,
+ * in order, on one client:
+ *   full       first post, full handshake
+ *   reuse      second post on the same session, no handshake
+ *   resume     after a close, the offered session is resumed
+ *   lost       HelloVerifyRequest and the next flight are lost; the
+ *              handshake timer (mbedtls_ssl_set_timer_cb) retransmits,
+ *              and the post goes out in blocks that fit the cut MTU
+ *   timeout    the request is ignored; the read timeout set per read with
+ *              mbedtls_ssl_conf_read_timeout() fires and the client
+ *              retransmits
+ *   uncached   the server flushed its cache; the offered session is
+ *              refused and a full handshake follows
+ *   forgotten  the server lost the session mid-way (it reports the
+ *              client's records as bad ClientHellos); the post fails, the
+ *              next one resumes
+ * Prints one line per scenario; exits with 1 if any fails, 2 on bad
+ * arguments or setup.
+ */
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mbedtls/version.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_cookie.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+#if defined(MBEDTLS_PSA_CRYPTO_C)
+#include "psa/crypto.h"
+#endif
+
+#include "coap_client.h"
+#include "tls_net.h"
+
+static const char *s_usage = "usage: %s -c CERT -k KEY [-b BODY_BYTES]\n";
+
+#define PATH           "sensors/pico-w"
+#define FORMAT_OCTETS  42u
+#define WATCHDOG_S     120
+
+#ifndef MBEDTLS_ERR_NET_SEND_FAILED
+#define MBEDTLS_ERR_NET_SEND_FAILED -0x004E
+#endif
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/* Body byte at offset i: a post that is cut, shifted or reordered fails */
+static uint8_t body_byte(size_t i) {
+    return (uint8_t)(i * 7u + (i >> 8) + 3u);
+}
+
+/* ====================================================================
+   --- Server: mbedTLS DTLS on an unconnected UDP socket ---
+   ==================================================================== */
+
+static size_t s_body_len = 3000;
+
+/* Set by the client thread, applied by the server */
+static atomic_uint s_drop;        // outgoing datagrams to lose
+static atomic_uint s_ignore;      // CoAP requests to leave unanswered
+static atomic_bool s_flush;       // empty the session cache
+static atomic_bool s_forget;      // drop the client's session
+static atomic_bool s_stop;
+
+/* Counted by the server */
+static atomic_uint s_srv_handshakes;
+static atomic_uint s_srv_cache_hits;   // sessions found in the cache: resumptions
+static atomic_uint s_srv_bodies;       // bodies received whole and intact
+static atomic_uint s_srv_dropped;
+
+static struct {
+    int                       fd;
+    mbedtls_ssl_context       ssl;
+    mbedtls_ssl_config        conf;
+    mbedtls_x509_crt          cert;
+    mbedtls_pk_context        key;
+    mbedtls_ctr_drbg_context  ctr_drbg;
+    mbedtls_entropy_context   entropy;
+    mbedtls_ssl_cookie_ctx    cookie;
+    mbedtls_ssl_cache_context cache;
+    uint64_t                  int_us, fin_us;  // timer, fin_us 0: cancelled
+    struct sockaddr_in        peer;
+    bool                      have_peer;
+    bool                      hs_done;
+    uint8_t                   in[2048];        // the datagram for the next read
+    size_t                    in_len;
+    // CoAP: the body so far and the last response, for retransmissions
+    size_t                    rx_len;
+    bool                      rx_bad;
+    bool                      have_last;
+    uint16_t                  last_mid;
+    uint8_t                   last[32];
+    size_t                    last_len;
+} S;
+
+static void srv_timer_set(void *ctx, uint32_t int_ms, uint32_t fin_ms) {
+    (void)ctx;
+    uint64_t now = now_us();
+    S.int_us = now + (uint64_t)int_ms * 1000u;
+    S.fin_us = fin_ms ? now + (uint64_t)fin_ms * 1000u : 0;
+}
+
+static int srv_timer_get(void *ctx) {
+    (void)ctx;
+    if (S.fin_us == 0) return -1;
+    uint64_t now = now_us();
+    if (now >= S.fin_us) return 2;
+    if (now >= S.int_us) return 1;
+    return 0;
+}
+
+static int srv_send(void *ctx, const unsigned char *buf, size_t len) {
+    (void)ctx;
+    unsigned drop = atomic_load(&s_drop);
+    if (drop > 0 && atomic_compare_exchange_strong(&s_drop, &drop, drop - 1u)) {
+        atomic_fetch_add(&s_srv_dropped, 1u);
+        return (int)len;
+    }
+    ssize_t n = sendto(S.fd, buf, len, 0, (const struct sockaddr *)&S.peer, sizeof(S.peer));
+    if (n < 0) return errno == EAGAIN ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+    return (int)n;
+}
+
+static int srv_recv(void *ctx, unsigned char *buf, size_t len) {
+    (void)ctx;
+    if (S.in_len == 0) return MBEDTLS_ERR_SSL_WANT_READ;
+    size_t n = S.in_len < len ? S.in_len : len;
+    memcpy(buf, S.in, n);
+    S.in_len = 0;
+    return (int)n;
+}
+
+/* Count the cache hits: the sessions that are resumed */
+#if MBEDTLS_VERSION_MAJOR >= 3
+static int srv_cache_get(void *data, unsigned char const *id, size_t id_len, mbedtls_ssl_session *session) {
+    int ret = mbedtls_ssl_cache_get(data, id, id_len, session);
+#else
+static int srv_cache_get(void *data, mbedtls_ssl_session *session) {
+    int ret = mbedtls_ssl_cache_get(data, session);
+#endif
+    if (ret == 0) atomic_fetch_add(&s_srv_cache_hits, 1u);
+    return ret;
+}
+
+/* Start over with the peer in S.peer (or none) */
+static void srv_reset(void) {
+    mbedtls_ssl_session_reset(&S.ssl);
+    S.hs_done   = false;
+    S.have_last = false;
+    S.rx_len    = 0;
+    if (S.have_peer) {
+        // The cookie binds the ClientHello to the address and port
+        mbedtls_ssl_set_client_transport_id(&S.ssl, (const unsigned char *)&S.peer.sin_port,
+                                            sizeof(S.peer.sin_port) + sizeof(S.peer.sin_addr));
+    }
+}
+
+static bool srv_setup(const char *cert, const char *key) {
+    const char *pers = "coap_dtls_server";
+    int ret;
+
+    mbedtls_ssl_init(&S.ssl);
+    mbedtls_ssl_config_init(&S.conf);
+    mbedtls_x509_crt_init(&S.cert);
+    mbedtls_pk_init(&S.key);
+    mbedtls_ctr_drbg_init(&S.ctr_drbg);
+    mbedtls_entropy_init(&S.entropy);
+    mbedtls_ssl_cookie_init(&S.cookie);
+    mbedtls_ssl_cache_init(&S.cache);
+
+    if ((ret = mbedtls_ctr_drbg_seed(&S.ctr_drbg, mbedtls_entropy_func, &S.entropy,
+                                     (const unsigned char *)pers, strlen(pers))) != 0) {
+        tls_print_err("ctr_drbg_seed", ret);
+        return false;
+    }
+    if ((ret = mbedtls_x509_crt_parse_file(&S.cert, cert)) != 0) {
+        tls_print_err(cert, ret);
+        return false;
+    }
+#if MBEDTLS_VERSION_MAJOR >= 3
+    ret = mbedtls_pk_parse_keyfile(&S.key, key, NULL, mbedtls_ctr_drbg_random, &S.ctr_drbg);
+#else
+    ret = mbedtls_pk_parse_keyfile(&S.key, key, NULL);
+#endif
+    if (ret != 0) {
+        tls_print_err(key, ret);
+        return false;
+    }
+    if ((ret = mbedtls_ssl_config_defaults(&S.conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_DATAGRAM,
+                                           MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
+        tls_print_err("ssl_config_defaults", ret);
+        return false;
+    }
+    mbedtls_ssl_conf_rng(&S.conf, mbedtls_ctr_drbg_random, &S.ctr_drbg);
+    if ((ret = mbedtls_ssl_conf_own_cert(&S.conf, &S.cert, &S.key)) != 0) {
+        tls_print_err("ssl_conf_own_cert", ret);
+        return false;
+    }
+    if ((ret = mbedtls_ssl_cookie_setup(&S.cookie, mbedtls_ctr_drbg_random, &S.ctr_drbg)) != 0) {
+        tls_print_err("ssl_cookie_setup", ret);
+        return false;
+    }
+    mbedtls_ssl_conf_dtls_cookies(&S.conf, mbedtls_ssl_cookie_write, mbedtls_ssl_cookie_check, &S.cookie);
+    mbedtls_ssl_conf_session_cache(&S.conf, &S.cache, srv_cache_get, mbedtls_ssl_cache_set);
+    if ((ret = mbedtls_ssl_setup(&S.ssl, &S.conf)) != 0) {
+        tls_print_err("ssl_setup", ret);
+        return false;
+    }
+    mbedtls_ssl_set_bio(&S.ssl, NULL, srv_send, srv_recv, NULL);
+    mbedtls_ssl_set_timer_cb(&S.ssl, NULL, srv_timer_set, srv_timer_get);
+
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    S.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (S.fd < 0 || bind(S.fd, (const struct sockaddr *)&a, sizeof(a)) != 0) {
+        perror("server socket");
+        return false;
+    }
+    return true;
+}
+
+/* --- CoAP responder --- */
+
+static size_t coap_option(uint8_t *p, unsigned delta, const uint8_t *val, size_t len) {
+    size_t n = 0;
+    // Block1 (27) is the only option: one extended delta byte
+    p[n++] = (uint8_t)((delta < 13u ? delta : 13u) << 4 | len);
+    if (delta >= 13u) p[n++] = (uint8_t)(delta - 13u);
+    memcpy(&p[n], val, len);
+    return n + len;
+}
+
+static void coap_respond(const uint8_t *req, size_t tkl, uint16_t mid, uint8_t code,
+                         bool block1, uint32_t block1_val) {
+    uint8_t *r = S.last;
+    size_t   n = 0;
+    r[n++] = (uint8_t)(1u << 6 | 2u << 4 | tkl);  // ACK, piggybacked
+    r[n++] = code;
+    r[n++] = (uint8_t)(mid >> 8);
+    r[n++] = (uint8_t)mid;
+    memcpy(&r[n], &req[4], tkl);
+    n += tkl;
+    if (block1) {
+        uint8_t v[3] = { (uint8_t)(block1_val >> 16), (uint8_t)(block1_val >> 8), (uint8_t)block1_val };
+        size_t  vl   = block1_val > 0xFFFFu ? 3u : block1_val > 0xFFu ? 2u : 1u;
+        n += coap_option(&r[n], 27u, v + 3u - vl, vl);
+    }
+    S.last_len  = n;
+    S.last_mid  = mid;
+    S.have_last = true;
+    mbedtls_ssl_write(&S.ssl, S.last, S.last_len);
+}
+
+static void coap_handle(const uint8_t *m, size_t len) {
+    if (len < 4u || (m[0] >> 6) != 1u || ((m[0] >> 4) & 3u) != 0u || m[1] != 0x02u) return;  // CON POST
+    size_t   tkl = m[0] & 0x0Fu;
+    uint16_t mid = (uint16_t)(m[2] << 8 | m[3]);
+    if (tkl > 8u || 4u + tkl > len) return;
+
+    if (S.have_last && mid == S.last_mid) {
+        mbedtls_ssl_write(&S.ssl, S.last, S.last_len);  // retransmission
+        return;
+    }
+    unsigned ignore = atomic_load(&s_ignore);
+    if (ignore > 0 && atomic_compare_exchange_strong(&s_ignore, &ignore, ignore - 1u)) return;
+
+    size_t   i = 4u + tkl;
+    unsigned num = 0;
+    bool     block1 = false;
+    uint32_t b1 = 0;
+    while (i < len && m[i] != 0xFFu) {
+        unsigned delta = m[i] >> 4, olen = m[i] & 0x0Fu;
+        i++;
+        if (delta >= 14u || olen >= 14u) return;  // nothing here needs 2-byte extensions
+        if (delta == 13u) delta = 13u + m[i++];
+        if (olen == 13u) olen = 13u + m[i++];
+        if (i + olen > len) return;
+        num += delta;
+        if (num == 27u) {
+            block1 = true;
+            for (unsigned k = 0; k < olen; k++) b1 = b1 << 8 | m[i + k];
+        }
+        i += olen;
+    }
+    const uint8_t *payload = i < len ? &m[i + 1u] : NULL;
+    size_t         plen    = i < len ? len - i - 1u : 0;
+
+    bool   more   = block1 && (b1 & 8u);
+    size_t offset = block1 ? (size_t)(b1 >> 4) * (16u << (b1 & 7u)) : 0;
+    if (offset == 0) {
+        S.rx_len = 0;
+        S.rx_bad = false;
+    }
+    if (offset != S.rx_len) {
+        coap_respond(m, tkl, mid, 0x88u, false, 0);  // 4.08 Request Entity Incomplete
+        return;
+    }
+    for (size_t k = 0; k < plen; k++) {
+        if (payload[k] != body_byte(offset + k)) S.rx_bad = true;
+    }
+    S.rx_len += plen;
+    if (more) {
+        coap_respond(m, tkl, mid, 0x5Fu, true, b1);  // 2.31 Continue
+        return;
+    }
+    if (S.rx_bad || S.rx_len != s_body_len) {
+        printf("server: body of %zu B, %s\n", S.rx_len, S.rx_bad ? "corrupt" : "wrong length");
+        coap_respond(m, tkl, mid, 0x80u, block1, b1);  // 4.00
+        return;
+    }
+    atomic_fetch_add(&s_srv_bodies, 1u);
+    coap_respond(m, tkl, mid, 0x44u, block1, b1);      // 2.04 Changed
+}
+
+/* Drive the handshake, or read what the client sent */
+static void srv_step(void) {
+    int ret;
+    if (!S.hs_done) {
+        ret = mbedtls_ssl_handshake(&S.ssl);
+        if (ret == 0) {
+            S.hs_done = true;
+            atomic_fetch_add(&s_srv_handshakes, 1u);
+        } else if (ret == MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED) {
+            srv_reset();  // stateless until the ClientHello has the cookie
+            return;
+        } else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            tls_print_err("server handshake", ret);
+            S.have_peer = false;
+            srv_reset();
+            return;
+        }
+        if (!S.hs_done) return;
+    }
+    uint8_t buf[2048];
+    while ((ret = mbedtls_ssl_read(&S.ssl, buf, sizeof(buf))) > 0) coap_handle(buf, (size_t)ret);
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        if (ret != MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) tls_print_err("server read", ret);
+        S.have_peer = false;
+        srv_reset();
+    }
+}
+
+static void *srv_thread(void *arg) {
+    (void)arg;
+    while (!atomic_load(&s_stop)) {
+        if (atomic_exchange(&s_flush, false)) {
+            mbedtls_ssl_cache_free(&S.cache);
+            mbedtls_ssl_cache_init(&S.cache);
+        }
+        if (atomic_load(&s_forget)) {
+            S.have_peer = false;
+            srv_reset();
+            atomic_store(&s_forget, false);
+        }
+
+        struct pollfd pfd = { .fd = S.fd, .events = POLLIN };
+        if (poll(&pfd, 1, 20) > 0) {
+            struct sockaddr_in from;
+            socklen_t fl = sizeof(from);
+            ssize_t n = recvfrom(S.fd, S.in, sizeof(S.in), 0, (struct sockaddr *)&from, &fl);
+            if (n <= 0) continue;
+            S.in_len = (size_t)n;
+            if (!S.have_peer || from.sin_port != S.peer.sin_port ||
+                from.sin_addr.s_addr != S.peer.sin_addr.s_addr) {
+                // A new client socket: the firmware reopens with a new port
+                S.peer      = from;
+                S.have_peer = true;
+                srv_reset();
+            }
+        }
+        if (S.have_peer) srv_step();
+    }
+    return NULL;
+}
+
+/* ====================================================================
+   --- Client: the firmware's transport and client ---
+   ==================================================================== */
+
+static bool body(ByteSink_t *out, void *arg) {
+    size_t len = *(const size_t *)arg;
+    for (size_t i = 0; i < len; i++) {
+        if (out->len == out->cap && !out->flush(out)) return false;
+        out->buf[out->len++] = body_byte(i);
+    }
+    return true;
+}
+
+static CoapClient_t s_client;
+static int          s_failed;
+
+typedef struct {
+    CoapClientStats_t c;
+    CoapUdpStats_t    u;
+    unsigned          srv_hs, srv_hits;
+    uint32_t          ms;
+    int               code;
+} Snap_t;
+
+static void snap(Snap_t *s) {
+    coap_client_get_stats(&s_client, &s->c);
+    coap_udp_get_stats(&s->u);
+    s->srv_hs   = atomic_load(&s_srv_handshakes);
+    s->srv_hits = atomic_load(&s_srv_cache_hits);
+}
+
+/* One post, with the counters before (a) and after (b) */
+static void post(Snap_t *a, Snap_t *b) {
+    snap(a);
+    uint64_t t0 = now_us();
+    size_t   len = s_body_len;
+    b->code = coap_client_post(&s_client, PATH, FORMAT_OCTETS, body, &len);
+    b->ms   = (uint32_t)((now_us() - t0) / 1000u);
+    snap(b);
+}
+
+static void report(const char *name, bool ok, const Snap_t *a, const Snap_t *b, const char *what) {
+    uint32_t hs = b->u.handshakes - a->u.handshakes;
+    printf("%-10s %s: code %d in %lu ms, %lu blocks, %lu handshake(s) %lu ms, %lu resumed, "
+           "%lu retransmits, server %u handshake(s) %u cache hit(s)\n",
+           name, ok ? "ok" : "FAILED", b->code, (unsigned long)b->ms,
+           (unsigned long)(b->c.blocks - a->c.blocks), (unsigned long)hs,
+           (unsigned long)((b->u.hs_us - a->u.hs_us) / 1000u), (unsigned long)(b->u.resumed - a->u.resumed),
+           (unsigned long)(b->c.retransmits - a->c.retransmits), b->srv_hs - a->srv_hs,
+           b->srv_hits - a->srv_hits);
+    if (!ok) {
+        printf("           expected %s\n", what);
+        s_failed++;
+    }
+}
+
+/* Wait for the server thread to apply a flag */
+static void settle(atomic_bool *flag) {
+    while (atomic_load(flag)) usleep(1000);
+}
+
+static void on_watchdog(int sig) {
+    (void)sig;
+    static const char msg[] = "FAILED: no progress, a read is waiting forever\n";
+    if (write(STDOUT_FILENO, msg, sizeof(msg) - 1u) < 0) _exit(1);
+    _exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *cert = NULL, *key = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:k:b:")) != -1) {
+        if (opt == 'c') {
+            cert = optarg;
+        } else if (opt == 'k') {
+            key = optarg;
+        } else if (opt == 'b') {
+            s_body_len = (size_t)strtoul(optarg, NULL, 10);
+        } else {
+            fprintf(stderr, s_usage, argv[0]);
+            return 2;
+        }
+    }
+    if (!cert || !key || s_body_len == 0) {
+        fprintf(stderr, s_usage, argv[0]);
+        return 2;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+#if defined(MBEDTLS_PSA_CRYPTO_C)
+    psa_crypto_init();
+#endif
+
+    if (!srv_setup(cert, key)) return 2;
+    struct sockaddr_in a;
+    socklen_t al = sizeof(a);
+    getsockname(S.fd, (struct sockaddr *)&a, &al);
+    char port[8];
+    snprintf(port, sizeof(port), "%u", (unsigned)ntohs(a.sin_port));
+    pthread_t th;
+    if (pthread_create(&th, NULL, srv_thread, NULL) != 0) return 2;
+
+    const CoapTransport_t *tp = coap_udp_transport("127.0.0.1", port, true);
+    if (!tp) return 2;
+    coap_client_init(&s_client, tp);
+    signal(SIGALRM, on_watchdog);
+    alarm(WATCHDOG_S);
+
+    Snap_t a0, b0;
+    post(&a0, &b0);
+    report("full", b0.code == 204 && b0.u.handshakes == 1 && b0.u.resumed == 0 && b0.srv_hs == 1 &&
+                   b0.srv_hits == 0,
+           &a0, &b0, "2.04 after one full handshake");
+
+    Snap_t a1, b1;
+    post(&a1, &b1);
+    report("reuse", b1.code == 204 && b1.u.handshakes == a1.u.handshakes && b1.c.opens == a1.c.opens,
+           &a1, &b1, "2.04 without a handshake");
+
+    Snap_t a2, b2;
+    coap_client_close(&s_client);
+    post(&a2, &b2);
+    report("resume", b2.code == 204 && b2.u.handshakes == a2.u.handshakes + 1 &&
+                     b2.u.resumed == a2.u.resumed + 1 && b2.srv_hits == a2.srv_hits + 1,
+           &a2, &b2, "2.04 after a resumed handshake");
+
+    // HelloVerifyRequest, then the ServerHello flight
+    Snap_t a3, b3;
+    coap_client_close(&s_client);
+    atomic_store(&s_drop, 2u);
+    post(&a3, &b3);
+    // mbedTLS then holds the handshake MTU at 508 bytes until the server's
+    // first record: smaller blocks for this post, full ones for the next
+    uint32_t full_blocks = b0.c.blocks - a0.c.blocks;
+    report("lost", b3.code == 204 && b3.u.handshakes == a3.u.handshakes + 1 &&
+                   b3.u.resumed == a3.u.resumed + 1 && atomic_load(&s_drop) == 0 &&
+                   b3.u.hs_us - a3.u.hs_us >= COAP_DTLS_HS_TIMEOUT_MIN_MS * 1000u &&
+                   b3.c.blocks - a3.c.blocks > full_blocks,
+           &a3, &b3, "2.04 in smaller blocks after a resumed handshake with retransmitted flights");
+
+    Snap_t a4, b4;
+    atomic_store(&s_ignore, 1u);
+    post(&a4, &b4);
+    report("timeout", b4.code == 204 && b4.u.handshakes == a4.u.handshakes &&
+                      b4.c.retransmits > a4.c.retransmits && b4.ms >= COAP_CLIENT_ACK_TIMEOUT_MS &&
+                      b4.c.blocks - a4.c.blocks == full_blocks,
+           &a4, &b4, "2.04 after a retransmission on the read timeout");
+
+    Snap_t a5, b5;
+    atomic_store(&s_flush, true);
+    settle(&s_flush);
+    coap_client_close(&s_client);
+    post(&a5, &b5);
+    report("uncached", b5.code == 204 && b5.u.handshakes == a5.u.handshakes + 1 &&
+                       b5.u.resumed == a5.u.resumed && b5.srv_hits == a5.srv_hits,
+           &a5, &b5, "2.04 after a full handshake");
+
+    Snap_t a6, b6, a7, b7;
+    atomic_store(&s_forget, true);
+    settle(&s_forget);
+    post(&a6, &b6);
+    post(&a7, &b7);
+    report("forgotten", b6.code == -1 && b7.code == 204 && b7.u.handshakes == a7.u.handshakes + 1 &&
+                        b7.u.resumed == a7.u.resumed + 1 && b7.srv_hits == a7.srv_hits + 1,
+           &a6, &b7, "-1, then 2.04 after a resumed handshake");
+    alarm(0);
+
+    coap_client_close(&s_client);
+    atomic_store(&s_stop, true);
+    pthread_join(th, NULL);
+
+    Snap_t end;
+    snap(&end);
+    unsigned bodies = atomic_load(&s_srv_bodies);
+    printf("%lu posts, %u bodies intact at the server, %lu datagrams out, %lu in, "
+           "%u lost on purpose\n", (unsigned long)end.c.posts, bodies,
+           (unsigned long)end.u.datagrams_tx, (unsigned long)end.u.datagrams_rx,
+           atomic_load(&s_srv_dropped));
+    if (bodies != end.c.posts) {
+        printf("FAILED: %lu posts answered, %u bodies received\n", (unsigned long)end.c.posts, bodies);
+        s_failed++;
+    }
+    if (s_failed) {
+        printf("FAILED: %d check(s)\n", s_failed);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,2 @@
+/* tools/coap_dtls/host/lwip/errno.h */
+#include <errno.h>
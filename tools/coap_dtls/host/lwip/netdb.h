@@ -0,0 +1,2 @@
+/* tools/coap_dtls/host/lwip/netdb.h */
+#include <netdb.h>
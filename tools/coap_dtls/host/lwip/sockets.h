@@ -0,0 +1,18 @@
+/* tools/coap_dtls/host/lwip/sockets.h — lwIP's socket names for tls_net.c
+ * on POSIX sockets. */
+#ifndef COAP_DTLS_LWIP_SOCKETS_H
+#define COAP_DTLS_LWIP_SOCKETS_H
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define lwip_socket     socket
+#define lwip_connect    connect
+#define lwip_close      close
+#define lwip_read       read
+#define lwip_write      write
+#define lwip_recv       recv
+#define lwip_setsockopt setsockopt
+
+#endif
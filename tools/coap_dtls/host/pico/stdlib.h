@@ -0,0 +1,25 @@
+/* tools/coap_dtls/host/pico/stdlib.h — the pico_time calls of coap_udp.c,
+ * on CLOCK_MONOTONIC. */
+#ifndef COAP_DTLS_PICO_STDLIB_H
+#define COAP_DTLS_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <time.h>
+
+typedef uint64_t absolute_time_t;
+
+static inline uint64_t time_us_64(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static inline absolute_time_t get_absolute_time(void) {
+    return time_us_64();
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return (uint32_t)(t / 1000u);
+}
+
+#endif
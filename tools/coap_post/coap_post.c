@@ -0,0 +1,232 @@
+/* tools/coap_post/coap_post.c — src/coap_client.c against a local server.
+ *
+ *   coap_post [-H HOST] [-p PORT] [-P PATH] [-e json|cbor|gorilla] [-n POSTS]
+ *             [-r RECORDS] [-l LOSS_PERCENT]
+ *
+ * Runs the firmware's CoAP client over a plain UDP socket (no DTLS) to a
+ * CoAP server on HOST:PORT (localhost:5683) that takes POSTs on PATH,
+ * block-wise (RFC 7959) for bodies over COAP_CLIENT_BLOCK_SIZE: POSTS
+ * uplink batches of RECORDS synthetic records each, as confirmable
+ * requests with the encoding's Content-Format. With -l every datagram,
+ * sent or received, is dropped with that probability, to exercise the
+ * retransmissions. Prints the client's stats; exits with 1 unless every
+ * post got a 2.xx response.
+ */
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "coap_client.h"
+#include "uplink_codec.h"
+
+static const char *s_usage =
+    "usage: %s [-H HOST] [-p PORT] [-P PATH] [-e json|cbor|gorilla] [-n POSTS]\n"
+    "          [-r RECORDS] [-l LOSS_PERCENT]\n";
+
+/* A few of the firmware's channels (sensor_history.h numbering) */
+static const struct {
+    const char *name;
+    uint8_t     ch, fmt;
+    float       base, span;
+} s_channels[] = {
+    { "temperature", 0,  2,               22.0f,   4.0f },
+    { "humidity",    1,  2,               45.0f,  10.0f },
+    { "voc",         2,  GORILLA_FMT_INT, 100.0f,  80.0f },
+    { "light",       9,  GORILLA_FMT_INT, 300.0f, 200.0f },
+};
+#define CHANNELS (sizeof(s_channels) / sizeof(s_channels[0]))
+
+/* ====================================================================
+   --- Transport: connected POSIX UDP socket with simulated loss ---
+   ==================================================================== */
+
+static const char *s_host = "localhost";
+static const char *s_port = "5683";
+static int         s_fd   = -1;
+static long        s_loss;        // percent
+static unsigned long s_dropped;
+
+static bool lose(void) {
+    if (s_loss > 0 && rand() % 100 < s_loss) {
+        s_dropped++;
+        return true;
+    }
+    return false;
+}
+
+static bool udp_open(void *ctx) {
+    (void)ctx;
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM }, *res, *rp;
+    int err = getaddrinfo(s_host, s_port, &hints, &res);
+    if (err != 0) {
+        fprintf(stderr, "%s: %s\n", s_host, gai_strerror(err));
+        return false;
+    }
+    for (rp = res; rp != NULL; rp = rp->ai_next) {
+        s_fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if (s_fd < 0) continue;
+        if (connect(s_fd, rp->ai_addr, rp->ai_addrlen) == 0) break;
+        close(s_fd);
+        s_fd = -1;
+    }
+    freeaddrinfo(res);
+    if (s_fd < 0) fprintf(stderr, "no UDP socket for %s:%s\n", s_host, s_port);
+    return s_fd >= 0;
+}
+
+static void udp_close(void *ctx) {
+    (void)ctx;
+    close(s_fd);
+    s_fd = -1;
+}
+
+static bool udp_send(void *ctx, const uint8_t *buf, size_t len) {
+    (void)ctx;
+    if (lose()) return true;
+    // A refused port (ICMP) shows up here or in recv; the client retransmits
+    return send(s_fd, buf, len, 0) == (ssize_t)len || errno == ECONNREFUSED;
+}
+
+static uint32_t udp_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+static int udp_recv(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms) {
+    (void)ctx;
+    for (uint32_t start = udp_now_ms(), waited = 0; waited <= timeout_ms; waited = udp_now_ms() - start) {
+        struct pollfd pfd = { .fd = s_fd, .events = POLLIN };
+        int ready = poll(&pfd, 1, (int)(timeout_ms - waited));
+        if (ready < 0) return errno == EINTR ? 0 : -1;
+        if (ready == 0) return 0;
+        ssize_t n = recv(s_fd, buf, len, MSG_TRUNC);
+        if (n < 0) return (errno == ECONNREFUSED || errno == EINTR) ? 0 : -1;
+        if (lose()) continue;
+        return (size_t)n < len ? (int)n : (int)len;
+    }
+    return 0;
+}
+
+static const CoapTransport_t s_udp = {
+    .open = udp_open, .close = udp_close, .send = udp_send, .recv = udp_recv, .now_ms = udp_now_ms,
+};
+
+/* ====================================================================
+   --- Payload: synthetic records ---
+   ==================================================================== */
+
+typedef struct {
+    const UplinkEncoder_t *enc;
+    uint64_t t0_ms;         // of the first record
+    size_t   next;          // records posted so far
+    size_t   per_post;
+    float    walk[CHANNELS];
+} Source_t;
+
+static void make_record(Source_t *src, size_t i, UplinkCodecRecord_t *r) {
+    size_t ch = i % CHANNELS;
+    r->name      = s_channels[ch].name;
+    r->ch        = s_channels[ch].ch;
+    r->fmt       = s_channels[ch].fmt;
+    r->t_ms      = src->t0_ms + (uint64_t)(i / CHANNELS) * 5000u;
+    r->unix_time = true;
+    r->value     = s_channels[ch].base + s_channels[ch].span * src->walk[ch];
+}
+
+static bool body(ByteSink_t *out, void *arg) {
+    Source_t *src = (Source_t *)arg;
+    if (!uplink_codec_begin(src->enc, out)) return false;
+    for (size_t i = 0; i < src->per_post; i++) {
+        UplinkCodecRecord_t r;
+        make_record(src, src->next + i, &r);
+        if (!uplink_codec_record(src->enc, out, &r, i == 0)) return false;
+    }
+    return uplink_codec_end(src->enc, out);
+}
+
+int main(int argc, char **argv) {
+    const char *path = "sensors/pico-w", *enc_name = "cbor";
+    long posts = 20, per_post = 96;
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:P:e:n:r:l:")) != -1) {
+        if (opt == 'H') {
+            s_host = optarg;
+        } else if (opt == 'p') {
+            s_port = optarg;
+        } else if (opt == 'P') {
+            path = optarg;
+        } else if (opt == 'e') {
+            enc_name = optarg;
+        } else if (opt == 'n') {
+            posts = strtol(optarg, NULL, 10);
+        } else if (opt == 'r') {
+            per_post = strtol(optarg, NULL, 10);
+        } else if (opt == 'l') {
+            s_loss = strtol(optarg, NULL, 10);
+        } else {
+            fprintf(stderr, s_usage, argv[0]);
+            return 2;
+        }
+    }
+
+    Source_t src = { .t0_ms = 1760700000000ull, .per_post = (size_t)per_post };
+    for (int e = 0; e < UPLINK_ENC_COUNT; e++) {
+        if (strcmp(enc_name, uplink_codec_get((UplinkEncoding_t)e)->name) == 0) {
+            src.enc = uplink_codec_get((UplinkEncoding_t)e);
+        }
+    }
+    if (!src.enc || posts <= 0 || per_post <= 0 || s_loss < 0 || s_loss > 90) {
+        fprintf(stderr, s_usage, argv[0]);
+        return 2;
+    }
+
+    static CoapClient_t client;
+    coap_client_init(&client, &s_udp);
+
+    srand(1);
+    long ok = 0;
+    size_t records = 0;
+    for (long n = 0; n < posts; n++) {
+        for (size_t ch = 0; ch < CHANNELS; ch++) {
+            src.walk[ch] += 0.04f * ((float)rand() / (float)RAND_MAX - 0.5f);
+        }
+        int code = coap_client_post(&client, path, src.enc->coap_format, body, &src);
+        if (code >= 200 && code < 300) {
+            ok++;
+            records  += src.per_post;
+            src.next += src.per_post;
+        } else {
+            printf("post %ld: %d\n", n, code);
+        }
+    }
+    coap_client_close(&client);
+
+    CoapClientStats_t st;
+    coap_client_get_stats(&client, &st);
+    printf("%s (%s): %ld of %ld posts ok, %zu records, %lu payload B (%.1f B/record), "
+           "last code %u\n", path, src.enc->name, ok, posts, records, (unsigned long)st.payload_bytes,
+           records ? (double)st.payload_bytes / (double)records : 0.0, (unsigned)st.last_code);
+    printf("%lu blocks of %u B, %lu retransmitted, %lu timeouts, %lu separate responses, "
+           "%lu resets, %lu opens\n",
+           (unsigned long)st.blocks, (unsigned)st.block_size, (unsigned long)st.retransmits,
+           (unsigned long)st.timeouts, (unsigned long)st.separate, (unsigned long)st.resets,
+           (unsigned long)st.opens);
+    printf("post avg %lu ms max %lu ms, %lu B sent, %lu B received (%.1f B/record on air), "
+           "%lu datagrams dropped\n",
+           (unsigned long)(st.posts + st.failures ? st.post_ms / (st.posts + st.failures) : 0),
+           (unsigned long)st.post_ms_max, (unsigned long)st.tx_bytes, (unsigned long)st.rx_bytes,
+           records ? (double)(st.tx_bytes + st.rx_bytes) / (double)records : 0.0, s_dropped);
+    if (ok < posts) {
+        printf("FAILED: %ld posts without a 2.xx response\n", posts - ok);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,257 @@
+/* tools/flash_log_sim/flash_log_sim.c — src/flash_log.c on simulated NOR flash.
+ *
+ *   flash_log_sim [-s SECTORS] [-n STEPS] [-p CUT_PERMILLE] [-r SEED]
+ *
+ * Runs the log over a RAM array with NOR semantics (erase sets a sector to
+ * 0xFF, program can only clear bits) through a workload of Wi-Fi outages:
+ * records are appended every step, and drained in batches of up to 64 while
+ * the link is up. With -p, each flash operation is cut short with that
+ * probability (in 1/1000), leaving a partly erased sector or a partly
+ * programmed page, and the device "reboots": the log is rebuilt from the
+ * flash image alone.
+ *
+ * Checks that every record read back is intact and that records come out
+ * in order, and accounts for each one: delivered, dropped by the log when
+ * it was full, or (only with power cuts) lost or delivered twice. Prints
+ * fill level, drain throughput in flash time and per-sector wear.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "flash_log.h"
+
+/* Typical QSPI NOR timings, for the flash time estimate */
+#define ERASE_US   45000u
+#define PROGRAM_US 800u
+#define READ_US_PER_PAGE 20u
+
+static uint8_t  *s_flash;
+static uint32_t  s_sectors;
+static uint32_t *s_wear;
+static unsigned  s_cut_permille;
+static bool      s_cut;          // an operation was cut short: reboot
+static uint64_t  s_flash_us;
+
+static bool cut_now(void) {
+    return s_cut_permille > 0 && (unsigned)(rand() % 1000) < s_cut_permille;
+}
+
+static bool sim_erase(uint32_t offset) {
+    uint8_t *p = s_flash + offset;
+    s_wear[offset / FLASH_LOG_SECTOR_SIZE]++;
+    s_flash_us += ERASE_US;
+    if (cut_now()) {
+        /* Some pages erased, the rest left as they were */
+        for (uint32_t pg = 0; pg < FLASH_LOG_PAGES_PER_SECTOR; pg++) {
+            if (rand() & 1) memset(p + pg * FLASH_LOG_PAGE_SIZE, 0xFF, FLASH_LOG_PAGE_SIZE);
+        }
+        s_cut = true;
+        return false;
+    }
+    memset(p, 0xFF, FLASH_LOG_SECTOR_SIZE);
+    return true;
+}
+
+static bool sim_program(uint32_t offset, const uint8_t *page) {
+    uint8_t *p = s_flash + offset;
+    size_t n = FLASH_LOG_PAGE_SIZE;
+    s_flash_us += PROGRAM_US;
+    if (cut_now()) {
+        n = (size_t)rand() % FLASH_LOG_PAGE_SIZE;
+        s_cut = true;
+    }
+    for (size_t i = 0; i < n; i++) p[i] &= page[i];
+    return !s_cut;
+}
+
+/* Record contents: id, then bytes derived from it */
+static size_t make_record(uint64_t id, uint8_t *buf) {
+    size_t len = 8u + (size_t)(id * 2654435761u % (FLASH_LOG_MAX_PAYLOAD - 7u));
+    memcpy(buf, &id, 8);
+    for (size_t i = 8; i < len; i++) buf[i] = (uint8_t)(id * 31u + i);
+    return len;
+}
+
+static bool check_record(const uint8_t *p, size_t len, uint64_t *id) {
+    uint8_t want[FLASH_LOG_MAX_PAYLOAD];
+    if (len < 8u) return false;
+    memcpy(id, p, 8);
+    return make_record(*id, want) == len && memcmp(want, p, len) == 0;
+}
+
+int main(int argc, char **argv) {
+    long sectors = 16, steps = 200000;
+    unsigned seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:n:p:r:")) != -1) {
+        if (opt == 's') {
+            sectors = strtol(optarg, NULL, 10);
+        } else if (opt == 'n') {
+            steps = strtol(optarg, NULL, 10);
+        } else if (opt == 'p') {
+            s_cut_permille = (unsigned)strtoul(optarg, NULL, 10);
+        } else if (opt == 'r') {
+            seed = (unsigned)strtoul(optarg, NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-s SECTORS] [-n STEPS] [-p CUT_PERMILLE] [-r SEED]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (sectors < 2 || steps <= 0 || s_cut_permille > 1000) {
+        fprintf(stderr, "usage: %s [-s SECTORS] [-n STEPS] [-p CUT_PERMILLE] [-r SEED]\n", argv[0]);
+        return 2;
+    }
+
+    s_sectors = (uint32_t)sectors;
+    s_flash   = malloc(s_sectors * FLASH_LOG_SECTOR_SIZE);
+    s_wear    = calloc(s_sectors, sizeof(*s_wear));
+    uint8_t *delivered = calloc((size_t)steps + 1u, 1);  // per record id: times read back
+    if (!s_flash || !s_wear || !delivered) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    memset(s_flash, 0xFF, s_sectors * FLASH_LOG_SECTOR_SIZE);
+    srand(seed);
+
+    FlashLogOps_t ops = {
+        .base    = s_flash,
+        .sectors = s_sectors,
+        .erase   = sim_erase,
+        .program = sim_program,
+    };
+    static FlashLog_t log;
+    flash_log_init(&log, &ops);
+
+    uint64_t next_id = 1, appended = 0, append_failures = 0, drains = 0, drained = 0;
+    uint64_t dropped = 0, reboots = 0, drain_flash_us = 0;
+    uint64_t last_id = 0;     // newest id read back since the last reboot
+    uint32_t max_used = 0;
+    bool link_up = true;
+    long outage_left = 0;
+    unsigned errors = 0;
+
+    for (long step = 0; step < steps; step++) {
+        /* Outages of random length, a quarter of the time */
+        if (outage_left > 0) {
+            outage_left--;
+        } else if (link_up && rand() % 2000 == 0) {
+            link_up     = false;
+            outage_left = rand() % (long)(log.stats.capacity * 2u + 1u);
+        } else {
+            link_up = true;
+        }
+
+        uint8_t rec[FLASH_LOG_MAX_PAYLOAD];
+        size_t len = make_record(next_id, rec);
+        if (flash_log_append(&log, rec, len)) {
+            appended++;
+        } else {
+            append_failures++;
+        }
+        next_id++;
+
+        if (link_up && !s_cut && rand() % 3 != 0) {
+            /* Drain up to 64 records, as the uplink does per post */
+            FlashLogIter_t it;
+            const uint8_t *p;
+            uint32_t n = 0;
+            uint64_t t0 = s_flash_us;
+            flash_log_iter(&log, &it);
+            while (n < 64u && (p = flash_log_next(&log, &it, &len)) != NULL) {
+                uint64_t id;
+                if (!check_record(p, len, &id) || id >= next_id) {
+                    fprintf(stderr, "step %ld: corrupt record\n", step);
+                    errors++;
+                    break;
+                }
+                if (id <= last_id) {
+                    fprintf(stderr, "step %ld: record %llu after %llu\n", step,
+                            (unsigned long long)id, (unsigned long long)last_id);
+                    errors++;
+                }
+                last_id = id;
+                if (delivered[id] < 255u) delivered[id]++;
+                n++;
+            }
+            s_flash_us += n * READ_US_PER_PAGE;
+            if (n > 0) {
+                flash_log_consume(&log, n);
+                drains++;
+                drained += n;
+                drain_flash_us += s_flash_us - t0;
+            }
+        }
+        if (flash_log_count(&log) > max_used) max_used = flash_log_count(&log);
+
+        if (s_cut) {
+            /* Power cut: everything in RAM is gone */
+            dropped += log.stats.dropped;
+            s_cut   = false;
+            last_id = 0;
+            reboots++;
+            flash_log_init(&log, &ops);
+        }
+    }
+    dropped += log.stats.dropped;
+
+    /* What is still in the log counts as kept */
+    FlashLogIter_t it;
+    const uint8_t *p;
+    size_t len;
+    uint64_t in_log = 0;
+    flash_log_iter(&log, &it);
+    while ((p = flash_log_next(&log, &it, &len)) != NULL) {
+        uint64_t id;
+        if (check_record(p, len, &id) && delivered[id] < 255u) delivered[id]++;
+        in_log++;
+    }
+
+    uint64_t once = 0, twice = 0, never = 0;
+    for (uint64_t id = 1; id < next_id; id++) {
+        if (delivered[id] == 0) never++;
+        else if (delivered[id] == 1) once++;
+        else twice++;
+    }
+
+    uint32_t wmin = UINT32_MAX, wmax = 0;
+    uint64_t wsum = 0;
+    for (uint32_t i = 0; i < s_sectors; i++) {
+        if (s_wear[i] < wmin) wmin = s_wear[i];
+        if (s_wear[i] > wmax) wmax = s_wear[i];
+        wsum += s_wear[i];
+    }
+
+    printf("log: %u sectors, capacity %u records, peak fill %u (%u%%)\n", (unsigned)s_sectors,
+           (unsigned)log.stats.capacity, (unsigned)max_used,
+           (unsigned)(max_used * 100u / log.stats.capacity));
+    printf("records: %llu appended (%llu append failures), %llu delivered in %llu drains, "
+           "%llu still queued, %llu reboots\n",
+           (unsigned long long)appended, (unsigned long long)append_failures,
+           (unsigned long long)drained, (unsigned long long)drains, (unsigned long long)in_log,
+           (unsigned long long)reboots);
+    printf("accounting: %llu once, %llu more than once, %llu never (%llu dropped by the log when full)\n",
+           (unsigned long long)once, (unsigned long long)twice, (unsigned long long)never,
+           (unsigned long long)dropped);
+    printf("drain: %.0f records/s of flash time (%.1f records per drain)\n",
+           drain_flash_us ? (double)drained * 1e6 / (double)drain_flash_us : 0.0,
+           drains ? (double)drained / (double)drains : 0.0);
+    printf("wear: erases per sector min %u max %u mean %.1f\n", (unsigned)wmin, (unsigned)wmax,
+           (double)wsum / (double)s_sectors);
+
+    /* Without power cuts every record is accounted for exactly */
+    if (s_cut_permille == 0 && (twice != 0 || never != dropped + append_failures)) {
+        fprintf(stderr, "accounting mismatch\n");
+        errors++;
+    }
+    free(s_flash);
+    free(s_wear);
+    free(delivered);
+    if (errors) {
+        printf("FAILED: %u errors\n", errors);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+/* tools/gorilla_decode/gorilla_decode_main.c — Gorilla uplink body to CSV.
+ *
+ *   gorilla_decode [FILE]
+ *
+ * Reads one application/x-gorilla body (from FILE or stdin) and prints
+ *
+ *   <channel name>,<t>,<value>
+ *
+ * per sample, where t is Unix ms, or "boot+<ms>" for batches sent before
+ * the device had synchronised its clock. Values are printed at the
+ * channel's resolution. Exits 1 if the body is truncated or malformed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "gorilla.h"
+
+int main(int argc, char **argv) {
+    FILE *f = stdin;
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [FILE]\n", argv[0]);
+        return 2;
+    }
+    if (argc == 2 && (f = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    size_t len = 0, cap = 4096;
+    uint8_t *buf = malloc(cap);
+    size_t got;
+    while (buf && (got = fread(buf + len, 1, cap - len, f)) > 0) {
+        len += got;
+        if (len == cap) {
+            uint8_t *grown = realloc(buf, cap * 2u);
+            if (!grown) {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = grown;
+            cap *= 2u;
+        }
+    }
+    if (f != stdin) fclose(f);
+    if (!buf) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    static GorillaDec_t dec;
+    GorillaSample_t smp;
+    int rc;
+    if (!gorilla_dec_init(&dec, buf, len)) {
+        fprintf(stderr, "not a Gorilla v%u stream\n", GORILLA_VERSION);
+        free(buf);
+        return 1;
+    }
+    while ((rc = gorilla_dec_next(&dec, &smp)) == 1) {
+        int decimals = (smp.fmt == GORILLA_FMT_FLOAT) ? 9 : smp.fmt;
+        printf("%s,%s%llu,%.*f\n", smp.name, smp.unix_time ? "" : "boot+",
+               (unsigned long long)smp.t_ms, decimals, smp.value);
+    }
+    free(buf);
+    if (rc < 0) {
+        fprintf(stderr, "truncated or malformed stream\n");
+        return 1;
+    }
+    return 0;
+}
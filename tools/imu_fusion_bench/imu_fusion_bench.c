@@ -0,0 +1,467 @@
+/* tools/imu_fusion_bench/imu_fusion_bench.c — src/imu_fusion.c against a
+ * double-precision reference.
+ *
+ *   imu_fusion_bench [-s SECONDS] [-t TRACE] [-p PERIOD_US] [-n PASSES]
+ *                    [-e MAX_ERR_DEG] [-o TRACE_OUT]
+ *
+ * Runs the fixed-point Mahony filter and the same filter in double (same
+ * gains, accelerometer gate and half-angle update, exact normalisation)
+ * over one trace of raw QMI8658 counts, as imu_stream.h delivers them at
+ * the firmware's ranges (8 g: 4096 LSB/g, 512 dps: 64 LSB/dps). The trace
+ * is synthetic (SECONDS of smooth random rotation at 1 kHz with gyro bias,
+ * sensor noise and bursts of linear acceleration; the true attitude is
+ * known) or, with -t, a recorded one: CSV lines
+ *
+ *   <ax>,<ay>,<az>,<gx>,<gy>,<gz>
+ *
+ * one per sample, PERIOD_US apart (-o writes the synthetic trace in this
+ * format). Prints the attitude error of the fixed-point filter against the
+ * reference (angle of the rotation between the two quaternions) and of
+ * imu_fusion_euler() against double atan2/asin on the same quaternion,
+ * both against the true attitude for a synthetic trace, and the cost per
+ * update (ns, and TSC cycles on x86). Exits with 1 if the attitude error
+ * against the reference exceeds MAX_ERR_DEG (0.1) or the Euler angles
+ * differ by more than 0.05 degree.
+ *
+ * Host timings only rank the two; the RP2040 figure is the "Fusion" line
+ * of the firmware's stats output.
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#include "imu_fusion.h"
+
+/* QMI8658_init(): 8 g and 512 dps */
+#define ACC_LSB_PER_G    4096.0
+#define GYRO_LSB_PER_DPS 64.0
+
+#define EULER_MAX_ERR_DEG 0.05
+/* Euler angles are compared away from gimbal lock only */
+#define EULER_MAX_PITCH_DEG 80.0
+
+static const char *s_usage =
+    "usage: %s [-s SECONDS] [-t TRACE] [-p PERIOD_US] [-n PASSES]\n"
+    "          [-e MAX_ERR_DEG] [-o TRACE_OUT]\n";
+
+typedef struct {
+    int16_t acc[3];
+    int16_t gyro[3];
+} Sample_t;
+
+/* ====================================================================
+   --- Quaternions in double ---
+   ==================================================================== */
+
+static void quat_mul(const double a[4], const double b[4], double out[4]) {
+    double r[4] = {
+        a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3],
+        a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2],
+        a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1],
+        a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0],
+    };
+    memcpy(out, r, sizeof(r));
+}
+
+static void quat_normalise(double q[4]) {
+    double n = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    for (int i = 0; i < 4; i++) q[i] /= n;
+}
+
+/* Angle of the rotation taking one attitude to the other, in degrees */
+static double quat_angle_deg(const double a[4], const double b[4]) {
+    double dot = fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+    if (dot > 1.0) dot = 1.0;
+    return 2.0 * acos(dot) * 180.0 / M_PI;
+}
+
+/* Gravity direction in the body frame (what an accelerometer at rest reads) */
+static void quat_gravity(const double q[4], double v[3]) {
+    v[0] = 2.0 * (q[1] * q[3] - q[0] * q[2]);
+    v[1] = 2.0 * (q[0] * q[1] + q[2] * q[3]);
+    v[2] = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+}
+
+static void quat_euler_deg(const double q[4], double e[3]) {
+    double sp = 2.0 * (q[0] * q[2] - q[3] * q[1]);
+    if (sp > 1.0) sp = 1.0;
+    if (sp < -1.0) sp = -1.0;
+    e[0] = atan2(2.0 * (q[0] * q[1] + q[2] * q[3]), 1.0 - 2.0 * (q[1] * q[1] + q[2] * q[2])) * 180.0 / M_PI;
+    e[1] = asin(sp) * 180.0 / M_PI;
+    e[2] = atan2(2.0 * (q[0] * q[3] + q[1] * q[2]), 1.0 - 2.0 * (q[2] * q[2] + q[3] * q[3])) * 180.0 / M_PI;
+}
+
+/* ====================================================================
+   --- Reference filter: imu_fusion.c in double ---
+   ==================================================================== */
+
+typedef struct {
+    double q[4];
+    double bias[3];      // integral term, half-angle per sample
+    double k_gyro, k_p, k_i;
+    double acc_lo2, acc_hi2;
+} RefFusion_t;
+
+static void ref_init(RefFusion_t *f, double period_us) {
+    double dt = period_us * 1e-6;
+    double lo = ACC_LSB_PER_G * (1.0 - IMU_FUSION_ACC_GATE);
+    double hi = ACC_LSB_PER_G * (1.0 + IMU_FUSION_ACC_GATE);
+
+    memset(f, 0, sizeof(*f));
+    f->q[0]    = 1.0;
+    f->k_gyro  = 0.5 * dt * M_PI / 180.0 / GYRO_LSB_PER_DPS;
+    f->k_p     = 0.5 * dt * IMU_FUSION_KP;
+    f->k_i     = 0.5 * dt * dt * IMU_FUSION_KI;
+    f->acc_lo2 = floor(lo * lo);
+    f->acc_hi2 = floor(hi * hi);
+}
+
+static void ref_update(RefFusion_t *f, const Sample_t *s) {
+    double h[3], *q = f->q;
+
+    for (int i = 0; i < 3; i++) h[i] = s->gyro[i] * f->k_gyro;
+
+    double n2 = (double)s->acc[0] * s->acc[0] + (double)s->acc[1] * s->acc[1] +
+                (double)s->acc[2] * s->acc[2];
+    if (n2 >= f->acc_lo2 && n2 <= f->acc_hi2 && n2 != 0.0) {
+        double n = sqrt(n2), a[3], v[3];
+        for (int i = 0; i < 3; i++) a[i] = s->acc[i] / n;
+        quat_gravity(q, v);
+        double e[3] = {
+            a[1] * v[2] - a[2] * v[1],
+            a[2] * v[0] - a[0] * v[2],
+            a[0] * v[1] - a[1] * v[0],
+        };
+        for (int i = 0; i < 3; i++) {
+            f->bias[i] += e[i] * f->k_i;
+            h[i] += e[i] * f->k_p;
+        }
+    }
+    double dq[4], hq[4] = { 0.0, h[0] + f->bias[0], h[1] + f->bias[1], h[2] + f->bias[2] };
+    quat_mul(q, hq, dq);
+    for (int i = 0; i < 4; i++) q[i] += dq[i];
+    quat_normalise(q);
+}
+
+/* ====================================================================
+   --- Traces ---
+   ==================================================================== */
+
+static double gauss(void) {
+    double u = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+    double v = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static int16_t counts(double v) {
+    v = nearbyint(v);
+    if (v > 32767.0) return 32767;
+    if (v < -32768.0) return -32768;
+    return (int16_t)v;
+}
+
+/* Sum of three sinusoids per axis (up to ~250 dps), integrated exactly at
+ * the sample rate; truth[] gets the attitude after each sample. */
+static Sample_t *synthetic(size_t n, double period_us, double (*truth)[4]) {
+    Sample_t *s = malloc(n * sizeof(*s));
+    if (!s) return NULL;
+
+    double amp[3][3], freq[3][3], phase[3][3], bias[3];
+    for (int ax = 0; ax < 3; ax++) {
+        for (int k = 0; k < 3; k++) {
+            amp[ax][k]   = 20.0 + 60.0 * rand() / (double)RAND_MAX;
+            freq[ax][k]  = 0.05 + 0.8 * rand() / (double)RAND_MAX;
+            phase[ax][k] = 2.0 * M_PI * rand() / (double)RAND_MAX;
+        }
+        bias[ax] = 1.0 * (rand() / (double)RAND_MAX - 0.5); // dps
+    }
+
+    double q[4] = { 1.0, 0.0, 0.0, 0.0 }, dt = period_us * 1e-6;
+    double lin[3] = { 0.0, 0.0, 0.0 };
+    size_t burst_left = 0;
+    for (size_t i = 0; i < n; i++) {
+        double t = (double)i * dt, w[3];
+        for (int ax = 0; ax < 3; ax++) {
+            w[ax] = 0.0;
+            for (int k = 0; k < 3; k++) w[ax] += amp[ax][k] * sin(2.0 * M_PI * freq[ax][k] * t + phase[ax][k]);
+        }
+
+        /* Body rates are constant over the sample: rotate by |w| dt */
+        double wn = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]) * M_PI / 180.0;
+        if (wn > 0.0) {
+            double half = 0.5 * wn * dt, k = sin(half) / wn * M_PI / 180.0;
+            double r[4] = { cos(half), w[0] * k, w[1] * k, w[2] * k };
+            quat_mul(q, r, q);
+            quat_normalise(q);
+        }
+        memcpy(truth[i], q, sizeof(q));
+
+        /* Now and then a second or so of linear acceleration (up to ~0.6 g) */
+        if (burst_left == 0 && rand() % 5000 == 0) {
+            burst_left = (size_t)(1e6 / period_us);
+            for (int ax = 0; ax < 3; ax++) lin[ax] = 0.6 * (rand() / (double)RAND_MAX - 0.5);
+        }
+        double g[3];
+        quat_gravity(q, g);
+        for (int ax = 0; ax < 3; ax++) {
+            double a = g[ax] + (burst_left ? lin[ax] : 0.0) + 0.003 * gauss();
+            s[i].acc[ax]  = counts(a * ACC_LSB_PER_G);
+            s[i].gyro[ax] = counts((w[ax] + bias[ax] + 0.05 * gauss()) * GYRO_LSB_PER_DPS);
+        }
+        if (burst_left) burst_left--;
+    }
+    return s;
+}
+
+static Sample_t *load_trace(const char *path, size_t *count) {
+    FILE *f = fopen(path, "r");
+    Sample_t *s = NULL;
+    size_t n = 0, cap = 0;
+    char line[256];
+    unsigned line_no = 0;
+
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        int v[6];
+        line_no++;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%d,%d,%d,%d,%d,%d", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 6) {
+            fprintf(stderr, "%s:%u: expected <ax>,<ay>,<az>,<gx>,<gy>,<gz>\n", path, line_no);
+            goto fail;
+        }
+        if (n == cap) {
+            cap = cap ? cap * 2u : 65536u;
+            Sample_t *grown = realloc(s, cap * sizeof(*s));
+            if (!grown) goto fail;
+            s = grown;
+        }
+        for (int i = 0; i < 3; i++) {
+            s[n].acc[i]  = counts(v[i]);
+            s[n].gyro[i] = counts(v[3 + i]);
+        }
+        n++;
+    }
+    fclose(f);
+    if (n == 0) {
+        fprintf(stderr, "%s: no samples\n", path);
+        free(s);
+        return NULL;
+    }
+    *count = n;
+    return s;
+
+fail:
+    fclose(f);
+    free(s);
+    return NULL;
+}
+
+static bool save_trace(const char *path, const Sample_t *s, size_t n) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fprintf(f, "# ax,ay,az,gx,gy,gz (raw counts, 4096 LSB/g, 64 LSB/dps)\n");
+    for (size_t i = 0; i < n; i++) {
+        fprintf(f, "%d,%d,%d,%d,%d,%d\n", s[i].acc[0], s[i].acc[1], s[i].acc[2],
+                s[i].gyro[0], s[i].gyro[1], s[i].gyro[2]);
+    }
+    if (fclose(f) != 0) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+/* ====================================================================
+   --- Timing ---
+   ==================================================================== */
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t cycles(void) {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static volatile int32_t s_sink;
+
+int main(int argc, char **argv) {
+    long seconds = 120, passes = 20;
+    double period_us = 1000.0, max_err = 0.1;
+    const char *trace = NULL, *trace_out = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:t:p:n:e:o:")) != -1) {
+        if (opt == 's') {
+            seconds = strtol(optarg, NULL, 10);
+        } else if (opt == 't') {
+            trace = optarg;
+        } else if (opt == 'p') {
+            period_us = strtod(optarg, NULL);
+        } else if (opt == 'n') {
+            passes = strtol(optarg, NULL, 10);
+        } else if (opt == 'e') {
+            max_err = strtod(optarg, NULL);
+        } else if (opt == 'o') {
+            trace_out = optarg;
+        } else {
+            fprintf(stderr, s_usage, argv[0]);
+            return 2;
+        }
+    }
+    if (seconds <= 0 || passes <= 0 || period_us < 100.0 || period_us > 100000.0 || max_err <= 0.0) {
+        fprintf(stderr, s_usage, argv[0]);
+        return 2;
+    }
+
+    size_t n;
+    Sample_t *s;
+    double (*truth)[4] = NULL;
+    if (trace) {
+        s = load_trace(trace, &n);
+        if (!s) return 1;
+    } else {
+        n = (size_t)((double)seconds * 1e6 / period_us);
+        truth = malloc(n * sizeof(*truth));
+        srand(1);
+        s = truth ? synthetic(n, period_us, truth) : NULL;
+        if (!s) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        if (trace_out && !save_trace(trace_out, s, n)) return 1;
+    }
+    printf("%zu samples (%s), %.0f us apart\n", n, trace ? trace : "synthetic", period_us);
+
+    /* Accuracy: both filters side by side, compared after every sample */
+    static ImuFusion_t fx;
+    RefFusion_t ref;
+    imu_fusion_init(&fx, (float)ACC_LSB_PER_G, (float)GYRO_LSB_PER_DPS, (uint32_t)period_us);
+    ref_init(&ref, period_us);
+
+    double err_max = 0.0, err_sq = 0.0, eul_max = 0.0;
+    double truth_fx_max = 0.0, truth_ref_max = 0.0, truth_fx_sq = 0.0, truth_ref_sq = 0.0;
+    size_t err_at = 0, eul_n = 0, settled = 0;
+    for (size_t i = 0; i < n; i++) {
+        imu_fusion_update(&fx, s[i].acc, s[i].gyro);
+        ref_update(&ref, &s[i]);
+
+        double qf[4];
+        for (int k = 0; k < 4; k++) qf[k] = (double)fx.q[k] / (double)IMU_FUSION_Q30_ONE;
+        double err = quat_angle_deg(qf, ref.q);
+        err_sq += err * err;
+        if (err > err_max) {
+            err_max = err;
+            err_at  = i;
+        }
+
+        /* CORDIC Euler angles every 64 samples, as often as the firmware */
+        if (i % 64u == 63u) {
+            ImuEuler_t e;
+            double de[3];
+            imu_fusion_euler(&fx, &e);
+            quat_euler_deg(qf, de);
+            if (fabs(de[1]) < EULER_MAX_PITCH_DEG) {
+                double got[3] = { e.roll_cdeg / 100.0, e.pitch_cdeg / 100.0, e.yaw_cdeg / 100.0 };
+                for (int k = 0; k < 3; k++) {
+                    double d = fabs(got[k] - de[k]);
+                    if (d > 180.0) d = 360.0 - d;
+                    if (d > eul_max) eul_max = d;
+                }
+                eul_n++;
+            }
+        }
+
+        /* Against the truth after the filters settled (first 10 s); yaw
+         * is unobservable without a magnetometer, so tilt only */
+        if (truth && (double)i * period_us >= 10e6) {
+            double gt[3], gf[3], gr[3];
+            quat_gravity(truth[i], gt);
+            quat_gravity(qf, gf);
+            quat_gravity(ref.q, gr);
+            double tf = acos(fmin(1.0, gt[0] * gf[0] + gt[1] * gf[1] + gt[2] * gf[2])) * 180.0 / M_PI;
+            double tr = acos(fmin(1.0, gt[0] * gr[0] + gt[1] * gr[1] + gt[2] * gr[2])) * 180.0 / M_PI;
+            truth_fx_sq  += tf * tf;
+            truth_ref_sq += tr * tr;
+            if (tf > truth_fx_max) truth_fx_max = tf;
+            if (tr > truth_ref_max) truth_ref_max = tr;
+            settled++;
+        }
+    }
+    printf("fixed vs double: attitude error max %.4f deg (sample %zu), rms %.4f deg\n",
+           err_max, err_at, sqrt(err_sq / (double)n));
+    printf("Euler (CORDIC) vs atan2/asin: max %.4f deg over %zu readings\n", eul_max, eul_n);
+    if (settled) {
+        printf("tilt vs truth:   fixed max %.3f deg rms %.3f deg, double max %.3f deg rms %.3f deg\n",
+               truth_fx_max, sqrt(truth_fx_sq / (double)settled), truth_ref_max,
+               sqrt(truth_ref_sq / (double)settled));
+    }
+
+    /* Cost: the whole trace PASSES times, filter re-initialised per pass */
+    double fx_ns = 0.0, ref_ns = 0.0, eul_ns = 0.0;
+    uint64_t fx_cyc = 0, ref_cyc = 0;
+    for (long p = 0; p < passes; p++) {
+        imu_fusion_init(&fx, (float)ACC_LSB_PER_G, (float)GYRO_LSB_PER_DPS, (uint32_t)period_us);
+        double t0 = now_ns();
+        uint64_t c0 = cycles();
+        for (size_t i = 0; i < n; i++) imu_fusion_update(&fx, s[i].acc, s[i].gyro);
+        fx_cyc += cycles() - c0;
+        fx_ns  += now_ns() - t0;
+        s_sink += fx.q[0];
+
+        ref_init(&ref, period_us);
+        t0 = now_ns();
+        c0 = cycles();
+        for (size_t i = 0; i < n; i++) ref_update(&ref, &s[i]);
+        ref_cyc += cycles() - c0;
+        ref_ns  += now_ns() - t0;
+        s_sink += (int32_t)(ref.q[0] * 1e6);
+
+        t0 = now_ns();
+        for (int i = 0; i < 1000; i++) {
+            ImuEuler_t e;
+            fx.q[1] ^= i; // defeat hoisting
+            imu_fusion_euler(&fx, &e);
+            s_sink += e.yaw_cdeg;
+        }
+        eul_ns += now_ns() - t0;
+    }
+    double updates = (double)n * (double)passes;
+    printf("fixed:  %6.1f ns/update", fx_ns / updates);
+    if (HAVE_TSC) printf("  %6.1f TSC cycles/update", (double)fx_cyc / updates);
+    printf("\ndouble: %6.1f ns/update", ref_ns / updates);
+    if (HAVE_TSC) printf("  %6.1f TSC cycles/update", (double)ref_cyc / updates);
+    printf("\neuler:  %6.1f ns/call\n", eul_ns / (1000.0 * (double)passes));
+
+    free(s);
+    free(truth);
+    if (err_max > max_err || eul_max > EULER_MAX_ERR_DEG) {
+        printf("FAILED: attitude error %.4f deg (limit %.4f), Euler error %.4f deg (limit %.2f)\n",
+               err_max, max_err, eul_max, EULER_MAX_ERR_DEG);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,257 @@
+/* tools/mqtt_pub/mqtt_pub.c — src/mqtt_client.c against a local broker.
+ *
+ *   mqtt_pub [-H HOST] [-p PORT] [-t TOPIC] [-e json|cbor|gorilla] [-n MESSAGES]
+ *            [-r RECORDS] [-k KEEPALIVE_S] [-s IDLE_S] [-d N]
+ *
+ * Runs the firmware's MQTT client over a plain TCP socket, e.g. to a
+ * mosquitto started with "mosquitto -v" (localhost:1883): publishes
+ * MESSAGES uplink batches of up to RECORDS synthetic records each (as
+ * much as fits one slot, like the firmware) to TOPIC/<encoding> with QoS 1,
+ * keeping the window full, then stays connected for IDLE_S seconds so the
+ * keep-alive pings can be watched. With -d the socket is shut down before
+ * every Nth publish, so the next one reconnects and resends the window
+ * with DUP set. Waits for every PUBACK and prints the client's stats;
+ * exits with 1 if a message was not acknowledged.
+ */
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mqtt_client.h"
+#include "uplink_codec.h"
+
+static const char *s_usage =
+    "usage: %s [-H HOST] [-p PORT] [-t TOPIC] [-e json|cbor|gorilla] [-n MESSAGES]\n"
+    "          [-r RECORDS] [-k KEEPALIVE_S] [-s IDLE_S] [-d N]\n";
+
+/* A few of the firmware's channels (sensor_history.h numbering) */
+static const struct {
+    const char *name;
+    uint8_t     ch, fmt;
+    float       base, span;
+} s_channels[] = {
+    { "temperature", 0,  2,               22.0f,   4.0f },
+    { "humidity",    1,  2,               45.0f,  10.0f },
+    { "voc",         2,  GORILLA_FMT_INT, 100.0f,  80.0f },
+    { "light",       9,  GORILLA_FMT_INT, 300.0f, 200.0f },
+};
+#define CHANNELS (sizeof(s_channels) / sizeof(s_channels[0]))
+
+/* ====================================================================
+   --- Transport: blocking POSIX TCP socket ---
+   ==================================================================== */
+
+static const char *s_host = "localhost";
+static const char *s_port = "1883";
+static int         s_fd   = -1;
+
+static bool tcp_open(void *ctx) {
+    (void)ctx;
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM }, *res, *rp;
+    int err = getaddrinfo(s_host, s_port, &hints, &res);
+    if (err != 0) {
+        fprintf(stderr, "%s: %s\n", s_host, gai_strerror(err));
+        return false;
+    }
+    for (rp = res; rp != NULL; rp = rp->ai_next) {
+        s_fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if (s_fd < 0) continue;
+        if (connect(s_fd, rp->ai_addr, rp->ai_addrlen) == 0) break;
+        close(s_fd);
+        s_fd = -1;
+    }
+    freeaddrinfo(res);
+    if (s_fd < 0) fprintf(stderr, "connect to %s:%s failed\n", s_host, s_port);
+    return s_fd >= 0;
+}
+
+static void tcp_close(void *ctx) {
+    (void)ctx;
+    close(s_fd);
+    s_fd = -1;
+}
+
+static bool tcp_send(void *ctx, const uint8_t *buf, size_t len) {
+    (void)ctx;
+    while (len > 0) {
+        ssize_t n = send(s_fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static int tcp_recv(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms) {
+    (void)ctx;
+    struct pollfd pfd = { .fd = s_fd, .events = POLLIN };
+    int ready = poll(&pfd, 1, (int)timeout_ms);
+    if (ready < 0) return errno == EINTR ? 0 : -1;
+    if (ready == 0) return 0;
+    ssize_t n = recv(s_fd, buf, len, 0);
+    return n > 0 ? (int)n : -1;
+}
+
+static uint32_t tcp_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u);
+}
+
+static const MqttTransport_t s_tcp = {
+    .open = tcp_open, .close = tcp_close, .send = tcp_send, .recv = tcp_recv, .now_ms = tcp_now_ms,
+};
+
+/* ====================================================================
+   --- Payload: synthetic records, as many as fit ---
+   ==================================================================== */
+
+typedef struct {
+    const UplinkEncoder_t *enc;
+    uint64_t t0_ms;         // of the first record
+    size_t   next;          // records published so far
+    size_t   per_message;
+    size_t   encoded;       // records in the last body
+    float    walk[CHANNELS];
+} Source_t;
+
+static void make_record(Source_t *src, size_t i, UplinkCodecRecord_t *r) {
+    size_t ch = i % CHANNELS;
+    r->name      = s_channels[ch].name;
+    r->ch        = s_channels[ch].ch;
+    r->fmt       = s_channels[ch].fmt;
+    r->t_ms      = src->t0_ms + (uint64_t)(i / CHANNELS) * 5000u;
+    r->unix_time = true;
+    r->value     = s_channels[ch].base + s_channels[ch].span * src->walk[ch];
+}
+
+static bool body(ByteSink_t *out, void *arg) {
+    Source_t *src = (Source_t *)arg;
+    size_t i = 0;
+    if (!uplink_codec_begin(src->enc, out)) return false;
+    for (; i < src->per_message; i++) {
+        UplinkCodecRecord_t r;
+        make_record(src, src->next + i, &r);
+        if (!uplink_codec_record(src->enc, out, &r, i == 0)) break;
+    }
+    src->encoded = i;
+    return i > 0 && uplink_codec_end(src->enc, out);
+}
+
+int main(int argc, char **argv) {
+    const char *topic_base = "sensors/pico-w", *enc_name = "cbor";
+    long messages = 20, per_message = 96, keepalive = 10, idle_s = 0, drop_every = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "H:p:t:e:n:r:k:s:d:")) != -1) {
+        if (opt == 'H') {
+            s_host = optarg;
+        } else if (opt == 'p') {
+            s_port = optarg;
+        } else if (opt == 't') {
+            topic_base = optarg;
+        } else if (opt == 'e') {
+            enc_name = optarg;
+        } else if (opt == 'n') {
+            messages = strtol(optarg, NULL, 10);
+        } else if (opt == 'r') {
+            per_message = strtol(optarg, NULL, 10);
+        } else if (opt == 'k') {
+            keepalive = strtol(optarg, NULL, 10);
+        } else if (opt == 's') {
+            idle_s = strtol(optarg, NULL, 10);
+        } else if (opt == 'd') {
+            drop_every = strtol(optarg, NULL, 10);
+        } else {
+            fprintf(stderr, s_usage, argv[0]);
+            return 2;
+        }
+    }
+
+    Source_t src = { .t0_ms = 1760700000000ull, .per_message = (size_t)per_message };
+    for (int e = 0; e < UPLINK_ENC_COUNT; e++) {
+        if (strcmp(enc_name, uplink_codec_get((UplinkEncoding_t)e)->name) == 0) {
+            src.enc = uplink_codec_get((UplinkEncoding_t)e);
+        }
+    }
+    if (!src.enc || messages <= 0 || per_message <= 0 || keepalive < 0 || keepalive > 65535 ||
+        idle_s < 0 || drop_every < 0) {
+        fprintf(stderr, s_usage, argv[0]);
+        return 2;
+    }
+    char topic[MQTT_CLIENT_TOPIC_MAX + 1];
+    snprintf(topic, sizeof(topic), "%s/%s", topic_base, src.enc->name);
+
+    static MqttClient_t client;
+    MqttConnectOpts_t opts = { .client_id = "mqtt_pub", .keepalive_s = (uint16_t)keepalive };
+    mqtt_client_init(&client, &s_tcp, &opts);
+    if (!mqtt_client_connect(&client)) {
+        fprintf(stderr, "no connection to the broker at %s:%s\n", s_host, s_port);
+        return 1;
+    }
+
+    srand(1);
+    uint32_t t0 = tcp_now_ms();
+    size_t records = 0;
+    for (long m = 0; m < messages; m++) {
+        if (drop_every > 0 && m > 0 && m % drop_every == 0 && s_fd >= 0) {
+            shutdown(s_fd, SHUT_RDWR);  // the client notices on its next read or write
+        }
+        for (size_t ch = 0; ch < CHANNELS; ch++) {
+            src.walk[ch] += 0.04f * ((float)rand() / (float)RAND_MAX - 0.5f);
+        }
+        // A refused publish (connection lost) is retried, as the firmware does
+        bool ok;
+        for (int attempt = 0; !(ok = mqtt_client_publish(&client, topic, body, &src)) && attempt < 20; attempt++) {
+            mqtt_client_poll(&client);
+            usleep(100000);
+        }
+        if (!ok) {
+            fprintf(stderr, "publish %ld was not accepted\n", m);
+            break;
+        }
+        src.next += src.encoded;
+        records  += src.encoded;
+        mqtt_client_poll(&client);
+    }
+    for (uint32_t start = tcp_now_ms(); !mqtt_client_flush(&client, 1000);) {
+        mqtt_client_poll(&client);
+        if (tcp_now_ms() - start > 30000u) break;
+    }
+    uint32_t elapsed = tcp_now_ms() - t0;
+
+    for (long s = 0; s < idle_s * 10; s++) {
+        usleep(100000);
+        mqtt_client_poll(&client);
+    }
+    mqtt_client_disconnect(&client);
+
+    MqttClientStats_t st;
+    mqtt_client_get_stats(&client, &st);
+    printf("%s: %lu messages, %zu records, %lu payload B (%.1f B/record), %.1f messages/s\n", topic,
+           (unsigned long)st.publishes, records, (unsigned long)st.payload_bytes,
+           records ? (double)st.payload_bytes / (double)records : 0.0,
+           elapsed ? (double)st.publishes * 1000.0 / (double)elapsed : 0.0);
+    printf("acked %lu (avg %lu ms, max %lu ms), in flight max %lu, %lu window waits, %lu retransmitted\n",
+           (unsigned long)st.acked, (unsigned long)(st.acked ? st.ack_ms / st.acked : 0),
+           (unsigned long)st.ack_ms_max, (unsigned long)st.inflight_max,
+           (unsigned long)st.window_waits, (unsigned long)st.retransmits);
+    printf("%lu connects (%lu failed, %lu sessions resumed), %lu pings, %lu ping / %lu ack timeouts, "
+           "%lu B sent, %lu B received\n",
+           (unsigned long)st.connects, (unsigned long)st.connect_failures,
+           (unsigned long)st.sessions_resumed, (unsigned long)st.pings,
+           (unsigned long)st.ping_timeouts, (unsigned long)st.ack_timeouts,
+           (unsigned long)st.tx_bytes, (unsigned long)st.rx_bytes);
+    if (st.acked < st.publishes || st.inflight != 0) {
+        printf("FAILED: %lu messages not acknowledged\n", (unsigned long)st.inflight);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,276 @@
+/* tools/qmi8658_convert_bench/qmi8658_convert_bench.c — QMI8658 raw-count
+ * conversion, Q16 against float.
+ *
+ *   qmi8658_convert_bench [-n PASSES]
+ *
+ * For every accelerometer and gyroscope range, in both unit systems of the
+ * driver (mg and dps, the firmware's, or m/s2 and rad/s), derives the scale
+ * the way QMI8658_update_scale() does and converts every raw value from
+ * -32768 to 32767 with QMI8658_convert_q16() and QMI8658_convert_float().
+ * A last row puts k and shift at their limits.
+ *
+ * Checks that the Q16 results equal the same k/shift arithmetic done in 64
+ * bits (so nothing overflowed) and that they are within half a raw count
+ * of the exact value (raw * scale), the accuracy a 16-bit k allows, plus
+ * the Q16 rounding. Prints the largest error of both paths in raw counts,
+ * and how many raw values would overflow if the rounding were added before
+ * the shift. Checks that the per-call QMI8658_decode_scaled() gives the
+ * float batch's results.
+ *
+ * Then times, over PASSES (200) runs of the same samples, ns and (on x86)
+ * TSC cycles per 6-axis sample of:
+ *   call/div    the per-call decode as it was: six divides by the LSB
+ *               count per 12-byte register block (copied below)
+ *   call/mul    the per-call decode now, QMI8658_decode_scaled()
+ *   batch/float QMI8658_convert_float() on raw interleaved samples
+ *   batch/q16   QMI8658_convert_q16()
+ * each also relative to call/div, with its float operations per sample.
+ * Exits with 1 on a mismatch or an error over the limit.
+ *
+ * Host timings understate the gap: the RP2040 has a single-cycle integer
+ * multiplier but no FPU, so each float multiply or divide there is a
+ * library call, while an x86 FPU vectorises the float batch.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#include "QMI8658_convert.h"
+
+#define RAW_VALUES 65536u
+
+/* As in QMI8658.c */
+#define ONE_G (9.807f)
+
+static const struct {
+    const char *name;
+    float       unit;      // per g or per dps
+    unsigned    lsb_div;   // LSB per g or per dps
+} s_ranges[] = {
+    { "acc 2g mg",       1000.0f,   16384 },
+    { "acc 4g mg",       1000.0f,    8192 },
+    { "acc 8g mg",       1000.0f,    4096 },
+    { "acc 16g mg",      1000.0f,    2048 },
+    { "acc 2g m/s2",     ONE_G,     16384 },
+    { "acc 16g m/s2",    ONE_G,      2048 },
+    { "gyro 16dps dps",  1.0f,       2048 },
+    { "gyro 64dps dps",  1.0f,        512 },
+    { "gyro 512dps dps", 1.0f,         64 },
+    { "gyro 2048dps dps", 1.0f,        16 },
+    { "gyro 16dps rad/s", 0.01745f,  2048 },
+    { "gyro 2048dps rad/s", 0.01745f,  16 },
+    /* The bound itself: k = 0xFFFF at the largest shift */
+    { "edge k max shift 30", 65535.4f / 70368744177664.0f, 1 },
+};
+#define RANGES (sizeof(s_ranges) / sizeof(s_ranges[0]))
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t cycles(void) {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static volatile int s_sink;
+
+/* The per-call decode before the scales were precomputed (QMI8658.c with
+ * QMI8658_UINT_MG_DPS); the LSB counts are set per range at run time */
+static unsigned short acc_lsb_div, gyro_lsb_div;
+
+static void decode_div(const unsigned char buf_reg[12], float acc[3], float gyro[3])
+{
+	short raw_acc_xyz[3];
+	short raw_gyro_xyz[3];
+
+	raw_acc_xyz[0] = (short)((unsigned short)(buf_reg[1] << 8) | (buf_reg[0]));
+	raw_acc_xyz[1] = (short)((unsigned short)(buf_reg[3] << 8) | (buf_reg[2]));
+	raw_acc_xyz[2] = (short)((unsigned short)(buf_reg[5] << 8) | (buf_reg[4]));
+
+	raw_gyro_xyz[0] = (short)((unsigned short)(buf_reg[7] << 8) | (buf_reg[6]));
+	raw_gyro_xyz[1] = (short)((unsigned short)(buf_reg[9] << 8) | (buf_reg[8]));
+	raw_gyro_xyz[2] = (short)((unsigned short)(buf_reg[11] << 8) | (buf_reg[10]));
+
+	acc[0] = (float)(raw_acc_xyz[0] * 1000.0f) / acc_lsb_div;
+	acc[1] = (float)(raw_acc_xyz[1] * 1000.0f) / acc_lsb_div;
+	acc[2] = (float)(raw_acc_xyz[2] * 1000.0f) / acc_lsb_div;
+
+	gyro[0] = (float)(raw_gyro_xyz[0] * 1.0f) / gyro_lsb_div;
+	gyro[1] = (float)(raw_gyro_xyz[1] * 1.0f) / gyro_lsb_div;
+	gyro[2] = (float)(raw_gyro_xyz[2] * 1.0f) / gyro_lsb_div;
+}
+
+typedef void (*DecodeFn)(const unsigned char buf_reg[12], float acc[3], float gyro[3]);
+
+static struct QMI8658_Scale s_scale;
+
+static void decode_mul(const unsigned char buf_reg[12], float acc[3], float gyro[3])
+{
+	QMI8658_decode_scaled(&s_scale, buf_reg, acc, gyro);
+}
+
+int main(int argc, char **argv) {
+    long passes = 200;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') {
+            passes = strtol(optarg, NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-n PASSES]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (passes <= 0) {
+        fprintf(stderr, "usage: %s [-n PASSES]\n", argv[0]);
+        return 2;
+    }
+
+    /* Every raw value once on every axis */
+    short *raw  = malloc(RAW_VALUES * QMI8658_RAW_AXES * sizeof(*raw));
+    int   *q16  = malloc(RAW_VALUES * QMI8658_RAW_AXES * sizeof(*q16));
+    float *flt  = malloc(RAW_VALUES * QMI8658_RAW_AXES * sizeof(*flt));
+    float *call = malloc(RAW_VALUES * QMI8658_RAW_AXES * sizeof(*call));
+    /* The same samples as the register blocks the per-call path reads */
+    unsigned char *regs = malloc(RAW_VALUES * QMI8658_RAW_AXES * 2u);
+    if (!raw || !q16 || !flt || !call || !regs) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (unsigned i = 0; i < RAW_VALUES; i++) {
+        for (unsigned a = 0; a < QMI8658_RAW_AXES; a++) {
+            raw[i * QMI8658_RAW_AXES + a] = (short)((int)i - 32768);
+            regs[(i * QMI8658_RAW_AXES + a) * 2u]      = (unsigned char)(i & 0xFFu);
+            regs[(i * QMI8658_RAW_AXES + a) * 2u + 1u] = (unsigned char)((i - 32768u) >> 8 & 0xFFu);
+        }
+    }
+
+    int status = 0;
+    printf("%-20s %6s %5s %12s %12s\n", "range", "k", "shift", "q16 err", "float err");
+    for (size_t r = 0; r < RANGES; r++) {
+        struct QMI8658_Scale sc;
+        sc.accScale = sc.gyrScale = s_ranges[r].unit / (float)s_ranges[r].lsb_div;
+        QMI8658_scale_q(sc.accScale, &sc.accK, &sc.accShift);
+        sc.gyrK     = sc.accK;
+        sc.gyrShift = sc.accShift;
+
+        QMI8658_convert_q16(&sc, raw, q16, RAW_VALUES);
+        QMI8658_convert_float(&sc, raw, flt, RAW_VALUES);
+
+        double q_err = 0.0, f_err = 0.0;
+        unsigned mismatches = 0, early_round = 0;
+        for (unsigned i = 0; i < RAW_VALUES * QMI8658_RAW_AXES; i++) {
+            int64_t p = (int64_t)raw[i] * sc.accK;
+            int64_t wide = sc.accShift ? (p + ((int64_t)1 << (sc.accShift - 1))) >> sc.accShift : p;
+            if (q16[i] != wide) mismatches++;
+            if (sc.accShift && (p + ((int64_t)1 << (sc.accShift - 1)) > INT32_MAX)) early_round++;
+
+            /* Errors in raw counts, against the float scale taken exactly */
+            double exact = (double)raw[i] * (double)sc.accScale;
+            double q = fabs((double)q16[i] / 65536.0 - exact) / (double)sc.accScale;
+            double f = fabs((double)flt[i] - exact) / (double)sc.accScale;
+            if (q > q_err) q_err = q;
+            if (f > f_err) f_err = f;
+        }
+        /* Half a raw count from k, plus the Q16 rounding */
+        double limit = 0.5 + 0.5 / (65536.0 * (double)sc.accScale);
+        printf("%-20s %6d %5u %9.5f LSB %9.7f LSB", s_ranges[r].name, sc.accK, sc.accShift, q_err, f_err);
+        if (early_round) printf("  (%u overflow if rounded first)", early_round);
+        if (mismatches) {
+            printf("  FAILED: %u values differ from 64-bit arithmetic", mismatches);
+            status = 1;
+        } else if (q_err > limit) {
+            printf("  FAILED: limit %.5f LSB", limit);
+            status = 1;
+        }
+        printf("\n");
+    }
+
+    /* Cost, at the firmware's ranges (mg and dps, 8 g and 512 dps) */
+    s_scale = (struct QMI8658_Scale){ .accScale = 1000.0f / 4096.0f, .gyrScale = 1.0f / 64.0f };
+    QMI8658_scale_q(s_scale.accScale, &s_scale.accK, &s_scale.accShift);
+    QMI8658_scale_q(s_scale.gyrScale, &s_scale.gyrK, &s_scale.gyrShift);
+    acc_lsb_div  = 4096;
+    gyro_lsb_div = 64;
+
+    QMI8658_convert_float(&s_scale, raw, flt, RAW_VALUES);
+    unsigned call_mismatches = 0;
+    for (unsigned i = 0; i < RAW_VALUES; i++) {
+        float *o = &call[i * QMI8658_RAW_AXES];
+        decode_mul(&regs[i * QMI8658_RAW_AXES * 2u], o, o + 3);
+        for (unsigned a = 0; a < QMI8658_RAW_AXES; a++) {
+            if (o[a] != flt[i * QMI8658_RAW_AXES + a]) call_mismatches++;
+        }
+    }
+    if (call_mismatches) {
+        printf("FAILED: QMI8658_decode_scaled differs from QMI8658_convert_float in %u values\n",
+               call_mismatches);
+        status = 1;
+    }
+
+    /* Float operations per sample, as compiled (the divisors are converted
+     * once per call); on the RP2040 each is a library call */
+    static const struct {
+        const char *name;
+        DecodeFn    call;   // NULL: batch
+        int         q16;
+        const char *float_ops;
+    } paths[] = {
+        { "call/div",    decode_div, 0, "8 int-to-float, 3 mul, 6 div" },
+        { "call/mul",    decode_mul, 0, "6 int-to-float, 6 mul" },
+        { "batch/float", NULL,       0, "6 int-to-float, 6 mul" },
+        { "batch/q16",   NULL,       1, "none" },
+    };
+    double ns[4] = {0}, cyc[4] = {0};
+    for (long p = 0; p < passes; p++) {
+        for (unsigned k = 0; k < 4; k++) {
+            double t0 = now_ns();
+            uint64_t c0 = cycles();
+            if (paths[k].call) {
+                for (unsigned i = 0; i < RAW_VALUES; i++) {
+                    float *o = &call[i * QMI8658_RAW_AXES];
+                    paths[k].call(&regs[i * QMI8658_RAW_AXES * 2u], o, o + 3);
+                }
+            } else if (paths[k].q16) {
+                QMI8658_convert_q16(&s_scale, raw, q16, RAW_VALUES);
+            } else {
+                QMI8658_convert_float(&s_scale, raw, flt, RAW_VALUES);
+            }
+            cyc[k] += (double)(cycles() - c0);
+            ns[k]  += now_ns() - t0;
+        }
+        s_sink += q16[p % RAW_VALUES] + (int)flt[p % RAW_VALUES] + (int)call[p % RAW_VALUES];
+    }
+    double samples = (double)RAW_VALUES * (double)passes;
+    for (unsigned k = 0; k < 4; k++) {
+        printf("%-12s %6.2f ns/sample", paths[k].name, ns[k] / samples);
+        if (HAVE_TSC) printf("  %6.2f TSC cycles/sample", cyc[k] / samples);
+        printf("  %5.2fx call/div  float ops: %s\n", ns[0] / ns[k], paths[k].float_ops);
+    }
+
+    free(raw);
+    free(q16);
+    free(flt);
+    free(call);
+    free(regs);
+    if (status) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,184 @@
+/* tools/sensor_data_stress/sensor_data_stress.c — src/sensor_data.c under contention.
+ *
+ *   sensor_data_stress [-s SECONDS] [-r READERS]
+ *
+ * One writer thread per field group publishes as fast as it can, as the
+ * firmware's single writer per group does, and READERS threads take
+ * sensor_data_snapshot() in a loop. On the host the threads really run in
+ * parallel, which is harsher than the single-core scheduler.
+ *
+ * Writers keep publishing until the end of the run. The n-th publish of a
+ * group writes values derived from n only (wrapped below 2^23, where floats
+ * are still exact), so every snapshot can be checked exactly: all fields of a group must come from the
+ * same publish, and that publish must be the one its sequence number names
+ * (a torn copy or a copy from the buffer being written breaks either).
+ * Sequence numbers seen by one reader must never go backwards. Exits with
+ * 1 on the first violation.
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sensor_data.h"
+
+/* Floats hold every integer below 2^24 exactly; publishes that far apart
+ * never meet in one copy, so the values may repeat */
+#define VALUE_WRAP (1u << 23)
+
+static atomic_bool s_stop;
+static atomic_bool s_failed;
+
+/* The float written by publish n, never 0 (the value before any publish) */
+static float value_of(uint32_t n) {
+    return n ? (float)((n - 1u) % VALUE_WRAP + 1u) : 0.0f;
+}
+
+static void *writer(void *arg) {
+    SensorField_t field = (SensorField_t)(intptr_t)arg;
+    for (uint32_t n = 1; !atomic_load(&s_stop); n++) {
+        float f = value_of(n);
+        switch (field) {
+        case SENSOR_FIELD_TEMP_HUM:
+            sensor_data_publish_temp_hum(f, -f);
+            break;
+        case SENSOR_FIELD_VOC:
+            sensor_data_publish_voc(n);
+            break;
+        case SENSOR_FIELD_IMU: {
+            const float acc[3]  = { f, f + 1.0f, f + 2.0f };
+            const float gyro[3] = { -f, -f - 1.0f, -f - 2.0f };
+            sensor_data_publish_imu(acc, gyro);
+            break;
+        }
+        case SENSOR_FIELD_ORIENTATION: {
+            const float quat[4]  = { f, 2.0f * f, 3.0f * f, 4.0f * f };
+            const float euler[3] = { -f, -2.0f * f, -3.0f * f };
+            sensor_data_publish_orientation(quat, euler);
+            break;
+        }
+        case SENSOR_FIELD_LIGHT:
+            sensor_data_publish_light((uint16_t)n);
+            break;
+        case SENSOR_FIELD_SOUND:
+            sensor_data_publish_sound((uint16_t)n);
+            break;
+        default:
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* True if group f of d is exactly publish n (0: never written, all zero) */
+static bool consistent(const SensorData_t *d, SensorField_t f, uint32_t n) {
+    float v = value_of(n);
+    switch (f) {
+    case SENSOR_FIELD_TEMP_HUM:
+        return d->temp == v && d->hum == -v;
+    case SENSOR_FIELD_VOC:
+        return d->voc == n;
+    case SENSOR_FIELD_IMU:
+        for (int i = 0; i < 3; i++) {
+            if (d->acc[i] != (n ? v + (float)i : 0.0f) || d->gyro[i] != (n ? -v - (float)i : 0.0f)) return false;
+        }
+        return true;
+    case SENSOR_FIELD_ORIENTATION:
+        for (int i = 0; i < 4; i++) {
+            if (d->quat[i] != (float)(i + 1) * v) return false;
+        }
+        for (int i = 0; i < 3; i++) {
+            if (d->euler[i] != -(float)(i + 1) * v) return false;
+        }
+        return true;
+    case SENSOR_FIELD_LIGHT:
+        return d->light == (uint16_t)n;
+    case SENSOR_FIELD_SOUND:
+        return d->sound == (uint16_t)n;
+    default:
+        return true;
+    }
+}
+
+typedef struct {
+    int      id;
+    uint64_t snapshots;
+} Reader_t;
+
+static void *reader(void *arg) {
+    Reader_t *r = (Reader_t *)arg;
+    SensorDataSeq_t last = { { 0 } };
+    while (!atomic_load(&s_stop)) {
+        SensorData_t d;
+        SensorDataSeq_t seq;
+        sensor_data_snapshot(&d, &seq);
+        r->snapshots++;
+        for (int f = 0; f < SENSOR_FIELD_COUNT; f++) {
+            if (seq.seq[f] < last.seq[f]) {
+                printf("reader %d: group %d went back from %u to %u\n", r->id, f,
+                       (unsigned)last.seq[f], (unsigned)seq.seq[f]);
+                atomic_store(&s_failed, true);
+            } else if (!consistent(&d, (SensorField_t)f, seq.seq[f])) {
+                printf("reader %d: group %d is not publish %u (torn or stale)\n", r->id, f,
+                       (unsigned)seq.seq[f]);
+                atomic_store(&s_failed, true);
+            }
+        }
+        if (atomic_load(&s_failed)) atomic_store(&s_stop, true);
+        last = seq;
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    long seconds = 5, readers = 3;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:")) != -1) {
+        if (opt == 's') {
+            seconds = strtol(optarg, NULL, 10);
+        } else if (opt == 'r') {
+            readers = strtol(optarg, NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-s SECONDS] [-r READERS]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (seconds <= 0 || readers <= 0 || readers > 16) {
+        fprintf(stderr, "usage: %s [-s SECONDS] [-r READERS]\n", argv[0]);
+        return 2;
+    }
+
+    pthread_t wt[SENSOR_FIELD_COUNT], rt[16];
+    Reader_t  rs[16];
+    for (int f = 0; f < SENSOR_FIELD_COUNT; f++) {
+        pthread_create(&wt[f], NULL, writer, (void *)(intptr_t)f);
+    }
+    for (long i = 0; i < readers; i++) {
+        rs[i] = (Reader_t){ .id = (int)i };
+        pthread_create(&rt[i], NULL, reader, &rs[i]);
+    }
+    for (long s = 0; s < seconds * 10 && !atomic_load(&s_stop); s++) usleep(100000);
+    atomic_store(&s_stop, true);
+    for (int f = 0; f < SENSOR_FIELD_COUNT; f++) pthread_join(wt[f], NULL);
+
+    uint64_t snapshots = 0;
+    for (long i = 0; i < readers; i++) {
+        pthread_join(rt[i], NULL);
+        snapshots += rs[i].snapshots;
+    }
+    SensorDataSeq_t seq;
+    SensorData_t d;
+    sensor_data_snapshot(&d, &seq);
+    printf("%llu snapshots by %ld readers against", (unsigned long long)snapshots, readers);
+    for (int f = 0; f < SENSOR_FIELD_COUNT; f++) printf(" %u", (unsigned)seq.seq[f]);
+    printf(" publishes per group in %ld s\n", seconds);
+    if (atomic_load(&s_failed)) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("ok: no torn or stale snapshot\n");
+    return 0;
+}
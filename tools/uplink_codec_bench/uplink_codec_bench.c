@@ -0,0 +1,274 @@
+/* tools/uplink_codec_bench/uplink_codec_bench.c — uplink batch encodings.
+ *
+ *   uplink_codec_bench [-n PASSES] [-r RECORDS] [-t TRACE] [-o DIR]
+ *
+ * Encodes batches of RECORDS records shaped like the firmware's with every
+ * encoder in uplink_codec.c and prints payload bytes and encode time per
+ * record. The records are a synthetic trace (all channels of
+ * sensor_history, one record per channel per 5 s, each value a bounded
+ * random walk, Unix ms timestamps) or, with -t, a recorded one: CSV lines
+ *
+ *   <channel name>,<Unix ms>,<value>
+ *
+ * in upload order, split into consecutive batches. Gorilla batches are
+ * decoded again with gorilla_decode.c and checked against the input at the
+ * channel's resolution. With -o the first batch of each encoder is written
+ * to DIR/batch.<name> for testing the backend.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "uplink_codec.h"
+
+/* As in sensor_history.c and uplink.c, with a typical value range */
+static const struct {
+    const char *name;
+    uint8_t     fmt;
+    float       base, span;
+} s_channels[] = {
+    { "temperature", 2,               22.0f,   4.0f },
+    { "humidity",    2,               45.0f,  10.0f },
+    { "voc",         GORILLA_FMT_INT, 100.0f,  80.0f },
+    { "acc_x",       3,                0.0f,   0.05f },
+    { "acc_y",       3,                0.0f,   0.05f },
+    { "acc_z",       3,                1.0f,   0.05f },
+    { "gyro_x",      2,                0.0f,   2.0f },
+    { "gyro_y",      2,                0.0f,   2.0f },
+    { "gyro_z",      2,                0.0f,   2.0f },
+    { "light",       GORILLA_FMT_INT, 300.0f, 200.0f },
+    { "sound",       GORILLA_FMT_INT, 400.0f, 200.0f },
+    { "mcu_temp",    1,               30.0f,   5.0f },
+    { "roll",        1,                0.0f,  10.0f },
+    { "pitch",       1,                0.0f,  10.0f },
+    { "yaw",         1,              180.0f, 180.0f },
+};
+#define CHANNELS (sizeof(s_channels) / sizeof(s_channels[0]))
+
+static const char *s_usage = "usage: %s [-n PASSES] [-r RECORDS] [-t TRACE] [-o DIR]\n";
+
+/* Into a plain buffer, as a transport without streaming would */
+static size_t encode(const UplinkEncoder_t *enc, const UplinkCodecRecord_t *recs, size_t n,
+                     uint8_t *buf, size_t cap, size_t *records) {
+    ByteSink_t out = { .buf = buf, .cap = cap };
+    size_t i = 0;
+    if (uplink_codec_begin(enc, &out)) {
+        while (i < n && uplink_codec_record(enc, &out, &recs[i], i == 0)) i++;
+        uplink_codec_end(enc, &out);
+    }
+    *records = i;
+    return out.len;
+}
+
+static void set_channel(UplinkCodecRecord_t *r, size_t ch) {
+    r->name = s_channels[ch].name;
+    r->ch   = (uint8_t)ch;
+    r->fmt  = s_channels[ch].fmt;
+}
+
+static UplinkCodecRecord_t *synthetic(size_t n) {
+    UplinkCodecRecord_t *recs = calloc(n, sizeof(*recs));
+    float walk[CHANNELS] = { 0 };
+    uint64_t t = 1760700000000ull;
+    if (!recs) return NULL;
+
+    srand(1);
+    for (size_t i = 0; i < n; i++) {
+        size_t ch = i % CHANNELS;
+        if (ch == 0) t += 5000u;
+        walk[ch] += 0.04f * ((float)rand() / (float)RAND_MAX - 0.5f);
+        if (walk[ch] > 0.5f)  walk[ch] = 0.5f;
+        if (walk[ch] < -0.5f) walk[ch] = -0.5f;
+        set_channel(&recs[i], ch);
+        recs[i].t_ms      = t + (uint64_t)(rand() % 100);
+        recs[i].unix_time = true;
+        recs[i].value     = s_channels[ch].base + s_channels[ch].span * walk[ch];
+    }
+    return recs;
+}
+
+static UplinkCodecRecord_t *load_trace(const char *path, size_t *count) {
+    FILE *f = fopen(path, "r");
+    UplinkCodecRecord_t *recs = NULL;
+    size_t n = 0, cap = 0;
+    char line[256];
+    unsigned line_no = 0;
+
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char name[64];
+        unsigned long long t_ms;
+        float value;
+        size_t ch;
+
+        line_no++;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%63[^,],%llu,%f", name, &t_ms, &value) != 3) {
+            fprintf(stderr, "%s:%u: expected <channel>,<Unix ms>,<value>\n", path, line_no);
+            goto fail;
+        }
+        for (ch = 0; ch < CHANNELS && strcmp(name, s_channels[ch].name) != 0; ch++) {}
+        if (ch == CHANNELS) {
+            fprintf(stderr, "%s:%u: unknown channel \"%s\"\n", path, line_no, name);
+            goto fail;
+        }
+        if (n == cap) {
+            cap = cap ? cap * 2u : 1024u;
+            UplinkCodecRecord_t *grown = realloc(recs, cap * sizeof(*recs));
+            if (!grown) goto fail;
+            recs = grown;
+        }
+        set_channel(&recs[n], ch);
+        recs[n].t_ms      = t_ms;
+        recs[n].unix_time = true;
+        recs[n].value     = value;
+        n++;
+    }
+    fclose(f);
+    if (n == 0) {
+        fprintf(stderr, "%s: no records\n", path);
+        free(recs);
+        return NULL;
+    }
+    *count = n;
+    return recs;
+
+fail:
+    fclose(f);
+    free(recs);
+    return NULL;
+}
+
+/* Decode one Gorilla batch and compare it with the records it came from;
+ * returns the largest value error, or -1 on a mismatch. */
+static double check_gorilla(const uint8_t *buf, size_t len, const UplinkCodecRecord_t *recs, size_t n) {
+    static GorillaDec_t dec;
+    GorillaSample_t smp;
+    double max_err = 0.0;
+    size_t i = 0;
+    int rc;
+
+    if (!gorilla_dec_init(&dec, buf, len)) return -1.0;
+    while ((rc = gorilla_dec_next(&dec, &smp)) == 1) {
+        const UplinkCodecRecord_t *r = &recs[i];
+        double err = fabs(smp.value - (double)r->value);
+        double tol = (r->fmt == GORILLA_FMT_FLOAT) ? 0.0 : 0.5 * pow(10.0, -(double)r->fmt) * 1.0001;
+        if (i >= n || smp.ch != r->ch || smp.t_ms != r->t_ms || strcmp(smp.name, r->name) != 0 ||
+            err > tol + fabs((double)r->value) * 1e-6) {
+            return -1.0;
+        }
+        if (err > max_err) max_err = err;
+        i++;
+    }
+    return (rc == 0 && i == n) ? max_err : -1.0;
+}
+
+int main(int argc, char **argv) {
+    long passes = -1, per_batch = 128;
+    const char *out_dir = NULL, *trace = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:t:o:")) != -1) {
+        if (opt == 'n') {
+            passes = strtol(optarg, NULL, 10);
+        } else if (opt == 'r') {
+            per_batch = strtol(optarg, NULL, 10);
+        } else if (opt == 't') {
+            trace = optarg;
+        } else if (opt == 'o') {
+            out_dir = optarg;
+        } else {
+            fprintf(stderr, s_usage, argv[0]);
+            return 2;
+        }
+    }
+    if (passes == 0 || passes < -1 || per_batch <= 0) {
+        fprintf(stderr, s_usage, argv[0]);
+        return 2;
+    }
+
+    size_t total;
+    UplinkCodecRecord_t *recs;
+    if (trace) {
+        recs = load_trace(trace, &total);
+        if (!recs) return 1;
+        if (passes < 0) passes = 20;
+    } else {
+        total = (size_t)per_batch;
+        recs  = synthetic(total);
+        if (passes < 0) passes = 20000;
+    }
+
+    size_t n = (size_t)per_batch;
+    size_t cap = n * 64u;  // room for every record
+    uint8_t *buf = malloc(cap);
+    if (!recs || !buf) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    printf("%zu records (%s), batches of %zu\n", total, trace ? trace : "synthetic", n);
+
+    size_t json_bytes = 0;
+    int status = 0;
+    for (int e = 0; e < UPLINK_ENC_COUNT; e++) {
+        const UplinkEncoder_t *enc = uplink_codec_get((UplinkEncoding_t)e);
+        size_t bytes = 0, records = 0;
+        double max_err = 0.0;
+        bool check_ok = true;
+
+        clock_t t0 = clock();
+        for (long p = 0; p < passes; p++) {
+            bytes = records = 0;
+            for (size_t at = 0; at < total;) {
+                size_t len, got;
+                len = encode(enc, &recs[at], total - at < n ? total - at : n, buf, cap, &got);
+                if (got == 0) {
+                    fprintf(stderr, "%s: record %zu does not fit\n", enc->name, at);
+                    return 1;
+                }
+                if (p == 0 && e == UPLINK_ENC_GORILLA) {
+                    double err = check_gorilla(buf, len, &recs[at], got);
+                    if (err < 0) check_ok = false;
+                    else if (err > max_err) max_err = err;
+                }
+                if (p == 0 && at == 0 && out_dir) {
+                    char path[4096];
+                    snprintf(path, sizeof(path), "%s/batch.%s", out_dir, enc->name);
+                    FILE *f = fopen(path, "wb");
+                    if (!f || fwrite(buf, 1, len, f) != len || fclose(f) != 0) {
+                        perror(path);
+                        return 1;
+                    }
+                }
+                bytes   += len;
+                records += got;
+                at      += got;
+            }
+        }
+        double cpu_s = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+        if (e == UPLINK_ENC_JSON) json_bytes = bytes;
+        printf("%-7s %-21s %8zu bytes  %5.1f B/record  %6.1f ns/record  %3.0f%% of JSON size",
+               enc->name, enc->content_type, bytes, (double)bytes / (double)records,
+               cpu_s * 1e9 / ((double)passes * (double)records),
+               json_bytes ? 100.0 * (double)bytes / (double)json_bytes : 100.0);
+        if (e == UPLINK_ENC_GORILLA) {
+            if (check_ok) {
+                printf("  round trip ok, max |error| %g", max_err);
+            } else {
+                printf("  ROUND TRIP FAILED");
+                status = 1;
+            }
+        }
+        printf("\n");
+    }
+
+    free(recs);
+    free(buf);
+    return status;
+}
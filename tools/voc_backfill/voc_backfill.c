@@ -0,0 +1,160 @@
+/* tools/voc_backfill/voc_backfill.c — recompute VOC indices from SRAW logs.
+ *
+ *   voc_backfill [-c] [-o DIR] LOG...
+ *
+ * Each LOG is one device stream: one SRAW value per line, one line per
+ * sampling interval ('#' lines are skipped). All streams run in lockstep
+ * through VocBatch; streams that end early are padded and their padding
+ * output dropped. With -o the indices go to DIR/<log name>.voc, one per line.
+ * With -c every stream is also run through the scalar VocAlgorithm_process()
+ * and the results compared. Throughput is reported per core (single thread).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sensirion_voc_batch.h"
+
+typedef struct {
+    const char *path;
+    int32_t    *sraw;
+    int32_t    *voc;
+    size_t      len;
+} Stream_t;
+
+static bool load(Stream_t *s) {
+    FILE *f = fopen(s->path, "r");
+    if (!f) {
+        perror(s->path);
+        return false;
+    }
+    size_t cap = 4096;
+    char line[64];
+    s->sraw = malloc(cap * sizeof(int32_t));
+    s->len  = 0;
+    while (s->sraw && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (s->len == cap) {
+            cap *= 2;
+            int32_t *p = realloc(s->sraw, cap * sizeof(int32_t));
+            if (!p) {
+                free(s->sraw);
+                s->sraw = NULL;
+                break;
+            }
+            s->sraw = p;
+        }
+        s->sraw[s->len++] = (int32_t)strtol(line, NULL, 10);
+    }
+    fclose(f);
+    s->voc = s->sraw ? malloc((s->len ? s->len : 1) * sizeof(int32_t)) : NULL;
+    if (!s->voc) fprintf(stderr, "%s: out of memory\n", s->path);
+    return s->voc != NULL;
+}
+
+static bool save(const Stream_t *s, const char *dir) {
+    const char *base = strrchr(s->path, '/');
+    base = base ? base + 1 : s->path;
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.voc", dir, base);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    for (size_t i = 0; i < s->len; i++) fprintf(f, "%ld\n", (long)s->voc[i]);
+    return fclose(f) == 0;
+}
+
+static size_t check(const Stream_t *s) {
+    VocAlgorithmParams params;
+    size_t mismatches = 0;
+    VocAlgorithm_init(&params);
+    for (size_t i = 0; i < s->len; i++) {
+        int32_t voc;
+        VocAlgorithm_process(&params, s->sraw[i], &voc);
+        if (voc != s->voc[i] && mismatches++ == 0) {
+            fprintf(stderr, "%s:%zu: batch %ld, scalar %ld\n", s->path, i + 1,
+                    (long)s->voc[i], (long)voc);
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char **argv) {
+    const char *out_dir = NULL;
+    bool verify = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "co:")) != -1) {
+        if (opt == 'c') {
+            verify = true;
+        } else if (opt == 'o') {
+            out_dir = optarg;
+        } else {
+            fprintf(stderr, "usage: %s [-c] [-o DIR] LOG...\n", argv[0]);
+            return 2;
+        }
+    }
+    size_t lanes = (size_t)(argc - optind);
+    if (lanes == 0) {
+        fprintf(stderr, "usage: %s [-c] [-o DIR] LOG...\n", argv[0]);
+        return 2;
+    }
+
+    Stream_t *streams = calloc(lanes, sizeof(Stream_t));
+    int32_t  *in      = calloc(lanes, sizeof(int32_t));
+    int32_t  *out     = calloc(lanes, sizeof(int32_t));
+    VocBatch *batch   = VocBatch_create(lanes);
+    if (!streams || !in || !out || !batch) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    size_t steps = 0, samples = 0;
+    for (size_t l = 0; l < lanes; l++) {
+        streams[l].path = argv[optind + (int)l];
+        if (!load(&streams[l])) return 1;
+        if (streams[l].len > steps) steps = streams[l].len;
+        samples += streams[l].len;
+    }
+
+    clock_t t0 = clock();
+    for (size_t t = 0; t < steps; t++) {
+        for (size_t l = 0; l < lanes; l++) {
+            in[l] = (t < streams[l].len) ? streams[l].sraw[t] : 0;
+        }
+        VocBatch_process(batch, in, out);
+        for (size_t l = 0; l < lanes; l++) {
+            if (t < streams[l].len) streams[l].voc[t] = out[l];
+        }
+    }
+    double cpu_s = (double)(clock() - t0) / CLOCKS_PER_SEC;
+
+    printf("%zu streams, %zu samples in %.3f s CPU: %.0f samples/s per core\n",
+           lanes, samples, cpu_s, cpu_s > 0 ? (double)samples / cpu_s : 0.0);
+
+    int rc = 0;
+    for (size_t l = 0; l < lanes; l++) {
+        if (out_dir && !save(&streams[l], out_dir)) rc = 1;
+        if (verify) {
+            size_t bad = check(&streams[l]);
+            if (bad) {
+                fprintf(stderr, "%s: %zu of %zu indices differ\n", streams[l].path, bad, streams[l].len);
+                rc = 1;
+            }
+        }
+    }
+    if (verify && rc == 0) printf("batch and scalar indices identical\n");
+
+    for (size_t l = 0; l < lanes; l++) {
+        free(streams[l].sraw);
+        free(streams[l].voc);
+    }
+    VocBatch_free(batch);
+    free(streams);
+    free(in);
+    free(out);
+    return rc;
+}
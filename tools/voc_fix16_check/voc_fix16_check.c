@@ -0,0 +1,381 @@
+/* tools/voc_fix16_check/voc_fix16_check.c — the two fix16 backends of the
+ * SGP40 VOC algorithm against each other.
+ *
+ *   voc_fix16_check [-d DAYS] [-s SEED] [SRAW_LOG...]
+ *
+ * Each SRAW_LOG is in voc_backfill's format: one SRAW value per line, one
+ * line per sampling interval, '#' lines skipped. Without logs, DAYS (2)
+ * synthetic days at 1 Hz are generated from SEED: baseline near 30000 with
+ * a daily drift, noise, VOC events of both signs and one baseline step.
+ * These are not recorded traces; pass real logs when there are some.
+ *
+ * Primitives first: fix16_fast_div against the reference on random and
+ * edge operands (must be bit-exact, division by zero and overflow
+ * included), fix16_fast_sqrt on random and all small inputs (exact below
+ * 16384.0, at most 1 LSB apart above), fix16_fast_exp over its whole
+ * unsaturated domain against exp() (within 2.2e-5 relative above 1.0 and
+ * 1 LSB below, as sensirion_fix16_fast.h states; the reference's own error
+ * is printed beside it). Then every trace is run through VocAlgorithm_process
+ * with each backend from the same initial state; the VOC indices may differ
+ * by at most 1 at any sample.
+ *
+ * Prints ns and, on x86, TSC cycles per call of each primitive and of
+ * VocAlgorithm_process. On the host the fast backend emulates the RP2040
+ * divider and interpolator in C, so its host timings say nothing about the
+ * device, where the divider takes 8 cycles and the reference div/sqrt/exp
+ * are bit loops. Exits with 1 on any violation.
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+/* SGP40_FIX16_FAST=0 here: fix16_div/sqrt/exp are the reference */
+#include "sensirion_fix16.h"
+
+/* voc_fast: the same algorithm built with SGP40_FIX16_FAST=1 */
+void VocAlgorithmFast_init(VocAlgorithmParams *params);
+void VocAlgorithmFast_process(VocAlgorithmParams *params, int32_t sraw, int32_t *voc_index);
+
+/* Saturation limits of both exp implementations */
+#define EXP_MAX_X 681391
+#define EXP_MIN_X (-772243)
+
+#define PRIM_N      4096u
+#define PRIM_PASSES 2000u
+
+static const char *s_usage = "usage: %s [-d DAYS] [-s SEED] [SRAW_LOG...]\n";
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static uint64_t cycles(void) {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void print_cost(const char *what, double ns, uint64_t cyc, double calls) {
+    printf("  %-22s %7.1f ns/call", what, ns / calls);
+    if (HAVE_TSC) printf("  %8.1f TSC cycles/call", (double)cyc / calls);
+    printf("\n");
+}
+
+/* xorshift64*, so traces are the same on every libc */
+static uint64_t s_rng = 1;
+
+static uint32_t rnd32(void) {
+    s_rng ^= s_rng >> 12;
+    s_rng ^= s_rng << 25;
+    s_rng ^= s_rng >> 27;
+    return (uint32_t)((s_rng * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static double rnd01(void) {
+    return (double)rnd32() / 4294967296.0;
+}
+
+/* Random int32 with a random magnitude, so small operands are common too */
+static int32_t rnd_operand(void) {
+    int32_t v = (int32_t)(rnd32() >> (rnd32() % 31));
+    return (rnd32() & 1) ? -v : v;
+}
+
+/* ====================================================================
+   --- Primitives ---
+   ==================================================================== */
+
+static volatile int32_t s_sink;
+
+/* Times EXPR over in[] (and in2[]) PRIM_PASSES times */
+#define TIME_PRIM(label, EXPR)                                          \
+    do {                                                                \
+        int32_t acc = 0;                                                \
+        double t0 = now_ns();                                           \
+        uint64_t c0 = cycles();                                         \
+        for (unsigned p = 0; p < PRIM_PASSES; p++) {                    \
+            for (unsigned i = 0; i < PRIM_N; i++) acc += (EXPR);        \
+        }                                                               \
+        uint64_t c = cycles() - c0;                                     \
+        double ns = now_ns() - t0;                                      \
+        s_sink = acc;                                                   \
+        print_cost(label, ns, c, (double)PRIM_N * PRIM_PASSES);         \
+    } while (0)
+
+static bool check_div(void) {
+    static const int32_t edge[] = { 0, 1, -1, 2, -2, 0x10000, -0x10000, 0x7FFF, 0x8000,
+                                    0x7FFFFFFF, (int32_t)0x80000000, 0x7FFFFFFE,
+                                    (int32_t)0x80000001, 0x12345678, -0x12345678 };
+    const size_t n_edge = sizeof(edge) / sizeof(edge[0]);
+    unsigned long mismatches = 0, tested = 0;
+
+    for (size_t i = 0; i < n_edge; i++) {
+        for (size_t j = 0; j < n_edge; j++) {
+            tested++;
+            if (fix16_fast_div(edge[i], edge[j]) != fix16_div(edge[i], edge[j])) mismatches++;
+        }
+    }
+    for (unsigned long k = 0; k < 4000000ul; k++) {
+        int32_t a = rnd_operand(), b = rnd_operand();
+        tested++;
+        if (fix16_fast_div(a, b) != fix16_div(a, b)) {
+            if (mismatches++ < 5) printf("  div %d / %d: fast %d, reference %d\n", a, b,
+                                         fix16_fast_div(a, b), fix16_div(a, b));
+        }
+    }
+    printf("fix16_div:  %lu operand pairs, %lu differ", tested, mismatches);
+    printf(mismatches ? "  FAILED: must be bit-exact\n" : "\n");
+    return mismatches == 0;
+}
+
+static bool check_sqrt(void) {
+    unsigned long exact_fail = 0, off_by_one = 0, worse = 0, tested = 0;
+    for (unsigned long k = 0; k < (1ul << 20) + 4000000ul; k++) {
+        // All of [0, 16.0), then random over the positive range
+        int32_t x = k < (1ul << 20) ? (int32_t)k : (int32_t)(rnd32() >> 1);
+        int32_t d = fix16_fast_sqrt(x) - fix16_sqrt(x);
+        tested++;
+        if (d == 0) continue;
+        if (x < 0x40000000) {  // 16384.0
+            if (exact_fail++ < 5) printf("  sqrt %d: fast %d, reference %d\n", x, fix16_fast_sqrt(x),
+                                         fix16_sqrt(x));
+        } else if (d == 1 || d == -1) {
+            off_by_one++;
+        } else {
+            worse++;
+        }
+    }
+    printf("fix16_sqrt: %lu inputs, %lu differ below 16384.0, %lu by 1 LSB above, %lu by more",
+           tested, exact_fail, off_by_one, worse);
+    bool ok = exact_fail == 0 && worse == 0;
+    printf(ok ? "\n" : "  FAILED\n");
+    return ok;
+}
+
+static bool check_exp(void) {
+    double fast_rel = 0.0, fast_lsb = 0.0, ref_rel = 0.0, ref_lsb = 0.0;
+    unsigned long sat_fail = 0;
+    for (int32_t x = EXP_MIN_X - 1000; x <= EXP_MAX_X + 1000; x++) {
+        int32_t f = fix16_fast_exp(x), r = fix16_exp(x);
+        if (x >= EXP_MAX_X || x <= EXP_MIN_X) {
+            if (f != r) sat_fail++;
+            continue;
+        }
+        double exact = exp((double)x / 65536.0) * 65536.0;
+        if (exact >= 65536.0) {
+            double fr = fabs((double)f - exact) / exact, rr = fabs((double)r - exact) / exact;
+            if (fr > fast_rel) fast_rel = fr;
+            if (rr > ref_rel) ref_rel = rr;
+        } else {
+            double fl = fabs((double)f - exact), rl = fabs((double)r - exact);
+            if (fl > fast_lsb) fast_lsb = fl;
+            if (rl > ref_lsb) ref_lsb = rl;
+        }
+    }
+    printf("fix16_exp:  every x in [%.4f, %.4f]: fast %.2e rel above 1.0, %.2f LSB below; "
+           "reference %.2e rel, %.1f LSB\n", (double)EXP_MIN_X / 65536.0, (double)EXP_MAX_X / 65536.0,
+           fast_rel, fast_lsb, ref_rel, ref_lsb);
+    bool ok = sat_fail == 0 && fast_rel <= 2.2e-5 && fast_lsb <= 1.0;
+    if (!ok) printf("  FAILED: %lu saturated results differ, limits 2.2e-5 rel and 1 LSB\n", sat_fail);
+    return ok;
+}
+
+static void time_primitives(void) {
+    static int32_t in[PRIM_N], in2[PRIM_N], xs[PRIM_N], xe[PRIM_N];
+    for (unsigned i = 0; i < PRIM_N; i++) {
+        in[i]  = rnd_operand();
+        in2[i] = rnd_operand() | 1;
+        xs[i]  = (int32_t)(rnd32() >> 1);
+        xe[i]  = EXP_MIN_X + (int32_t)(rnd32() % (uint32_t)(EXP_MAX_X - EXP_MIN_X));
+    }
+    printf("cost per call (host; fast backend emulated):\n");
+    TIME_PRIM("fix16_div reference", fix16_div(in[i], in2[i]));
+    TIME_PRIM("fix16_div fast", fix16_fast_div(in[i], in2[i]));
+    TIME_PRIM("fix16_sqrt reference", fix16_sqrt(xs[i]));
+    TIME_PRIM("fix16_sqrt fast", fix16_fast_sqrt(xs[i]));
+    TIME_PRIM("fix16_exp reference", fix16_exp(xe[i]));
+    TIME_PRIM("fix16_exp fast", fix16_fast_exp(xe[i]));
+}
+
+/* ====================================================================
+   --- Traces ---
+   ==================================================================== */
+
+typedef struct {
+    char     name[64];
+    int32_t *sraw;
+    size_t   len;
+} Trace_t;
+
+static bool load(Trace_t *t, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    snprintf(t->name, sizeof(t->name), "%s", path);
+    size_t cap = 4096;
+    char line[64];
+    t->sraw = malloc(cap * sizeof(int32_t));
+    t->len  = 0;
+    while (t->sraw && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (t->len == cap) {
+            cap *= 2;
+            int32_t *p = realloc(t->sraw, cap * sizeof(int32_t));
+            if (!p) {
+                free(t->sraw);
+                t->sraw = NULL;
+                break;
+            }
+            t->sraw = p;
+        }
+        t->sraw[t->len++] = (int32_t)strtol(line, NULL, 10);
+    }
+    fclose(f);
+    if (!t->sraw) fprintf(stderr, "%s: out of memory\n", path);
+    return t->sraw != NULL;
+}
+
+/* One synthetic day at 1 Hz per DAYS: drift, noise, events, one step */
+static bool synthesize(Trace_t *t, long days) {
+    snprintf(t->name, sizeof(t->name), "synthetic %ld d", days);
+    t->len  = (size_t)days * 86400u;
+    t->sraw = malloc(t->len * sizeof(int32_t));
+    if (!t->sraw) {
+        fprintf(stderr, "out of memory\n");
+        return false;
+    }
+    const double pi = 3.14159265358979;
+    double event = 0.0, target = 0.0, step = 0.0;
+    size_t step_at = t->len / 3 + rnd32() % (t->len / 3);
+    for (size_t i = 0; i < t->len; i++) {
+        // A VOC event about every two hours: mostly SRAW down (more VOC)
+        if (rnd32() % 7200u == 0) target = (rnd01() < 0.8 ? -1.0 : 0.4) * (500.0 + 5500.0 * rnd01());
+        event += (target - event) / 60.0;      // rises over about a minute
+        target -= target / 900.0;              // decays over a quarter hour
+        if (i == step_at) step = (rnd32() & 1) ? 1500.0 : -1500.0;
+        double noise = (rnd01() + rnd01() + rnd01() + rnd01() - 2.0) * 25.0;
+        double v = 30000.0 + 400.0 * sin(2.0 * pi * (double)i / 86400.0) + step + event + noise;
+        t->sraw[i] = v < 0.0 ? 0 : v > 65535.0 ? 65535 : (int32_t)lrint(v);
+    }
+    return true;
+}
+
+typedef struct {
+    double   ref_ns, fast_ns;
+    uint64_t ref_cyc, fast_cyc;
+    double   calls;
+} Cost_t;
+
+static bool compare(const Trace_t *t, Cost_t *cost) {
+    int32_t *ref  = malloc((t->len ? t->len : 1) * sizeof(int32_t));
+    int32_t *fast = malloc((t->len ? t->len : 1) * sizeof(int32_t));
+    if (!ref || !fast) {
+        fprintf(stderr, "out of memory\n");
+        free(ref);
+        free(fast);
+        return false;
+    }
+    VocAlgorithmParams p;
+    VocAlgorithm_init(&p);
+    double t0 = now_ns();
+    uint64_t c0 = cycles();
+    for (size_t i = 0; i < t->len; i++) VocAlgorithm_process(&p, t->sraw[i], &ref[i]);
+    cost->ref_cyc += cycles() - c0;
+    cost->ref_ns  += now_ns() - t0;
+
+    VocAlgorithmFast_init(&p);
+    t0 = now_ns();
+    c0 = cycles();
+    for (size_t i = 0; i < t->len; i++) VocAlgorithmFast_process(&p, t->sraw[i], &fast[i]);
+    cost->fast_cyc += cycles() - c0;
+    cost->fast_ns  += now_ns() - t0;
+    cost->calls    += (double)t->len;
+
+    size_t differ = 0, first_bad = 0;
+    int32_t max_diff = 0, max_voc = 0;
+    for (size_t i = 0; i < t->len; i++) {
+        int32_t d = abs(ref[i] - fast[i]);
+        if (d) differ++;
+        if (d > max_diff) {
+            max_diff = d;
+            if (d > 1 && !first_bad) first_bad = i + 1;
+        }
+        if (ref[i] > max_voc) max_voc = ref[i];
+    }
+    printf("%-24s %8zu samples, VOC index up to %3d, %6zu differ, max diff %d", t->name, t->len,
+           (int)max_voc, differ, (int)max_diff);
+    if (first_bad) {
+        printf("  FAILED: sample %zu: %d vs %d\n", first_bad - 1, (int)ref[first_bad - 1],
+               (int)fast[first_bad - 1]);
+    } else {
+        printf("\n");
+    }
+    free(ref);
+    free(fast);
+    return first_bad == 0;
+}
+
+int main(int argc, char **argv) {
+    long days = 2;
+    int opt;
+    while ((opt = getopt(argc, argv, "d:s:")) != -1) {
+        if (opt == 'd') {
+            days = strtol(optarg, NULL, 10);
+        } else if (opt == 's') {
+            s_rng = strtoull(optarg, NULL, 10) | 1u;
+        } else {
+            fprintf(stderr, s_usage, argv[0]);
+            return 2;
+        }
+    }
+    if (days <= 0 || days > 365) {
+        fprintf(stderr, s_usage, argv[0]);
+        return 2;
+    }
+
+    bool ok = check_div();
+    ok = check_sqrt() && ok;
+    ok = check_exp() && ok;
+    time_primitives();
+
+    Cost_t cost = { 0 };
+    if (optind == argc) {
+        Trace_t t;
+        if (!synthesize(&t, days)) return 1;
+        ok = compare(&t, &cost) && ok;
+        free(t.sraw);
+    }
+    for (int a = optind; a < argc; a++) {
+        Trace_t t;
+        if (!load(&t, argv[a])) return 1;
+        ok = compare(&t, &cost) && ok;
+        free(t.sraw);
+    }
+    printf("VocAlgorithm_process per sample:\n");
+    print_cost("reference", cost.ref_ns, cost.ref_cyc, cost.calls);
+    print_cost("fast", cost.fast_ns, cost.fast_cyc, cost.calls);
+
+    if (!ok) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}